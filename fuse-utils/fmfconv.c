@@ -1592,6 +1592,11 @@ out_write_frame( void )
       printi( 2, "out_write_frame(): add frame.\n" );
       add_frame = 1;
     }
+#ifdef HAVE_PTHREAD
+    if( out_jobs > 1 && ( out_t == TYPE_PNG || out_t == TYPE_JPEG ) ) {
+      if( ( err = out_queue_frame() ) ) return err;
+    } else
+#endif
     if( out_t == TYPE_YUV ) {
       if( ( err = out_write_yuv() ) ) return err;
     } else if( out_t == TYPE_SCR ) {
@@ -1754,6 +1759,8 @@ print_help( void )
 	  "                                 100-200, 300, 500 and frames from 1min 11sec\n"
 	  "                                 to 2min 22sec (in the given timing see:\n"
 	  "                                 -f/--frate).\n"
+	  "  -j --jobs <n>                Encode PNG and JPEG screenshots on <n> threads\n"
+	  "                                 (by default one per processor).\n"
 	  "     --info                    Scan input file(s) and print information.\n"
 	  "  -v --verbose                 Increase the verbosity level by one.\n"
 	  "  -q --quiet                   Decrease the verbosity level by one.\n"
@@ -1872,6 +1879,7 @@ parse_args( int argc, char *argv[] )
 #endif
     {"greyscale",  0, NULL, ARG_GREYSCALE},		/* convert to grescale */
     {"info", 0, &do_info, 1},
+    {"jobs", 1, NULL, 'j'},		/* encoder threads */
 
     {"help", 0, NULL, 'h'},
     {"version", 0, NULL, 'V'},
@@ -1889,7 +1897,7 @@ parse_args( int argc, char *argv[] )
     char t;
     int  i;
 
-    c = getopt_long (argc, argv, "i:o:s:f:g:C:wumSPYyE:"
+    c = getopt_long (argc, argv, "i:o:s:f:g:C:j:wumSPYyE:"
 #ifdef USE_LIBJPEG
 				"JQ:M"
 #endif
@@ -2073,6 +2081,13 @@ parse_args( int argc, char *argv[] )
 	out_cut = optarg;
 	inp_get_next_cut();
 	break;
+    case 'j':
+      out_jobs = atoi( optarg );
+      if( out_jobs < 1 ) {
+	printe( "Bad value for '-j/--jobs' ...\n");
+	return ERR_BAD_PARAM;
+      }
+      break;
     case 'h':
 	print_help();
 	help_exit = 1;
@@ -2158,6 +2173,14 @@ main( int argc, char *argv[] )
 
   if( help_exit ) return 0;
 
+  if( !out_jobs ) {			/* one per processor */
+#if defined HAVE_PTHREAD && defined _SC_NPROCESSORS_ONLN
+    long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    out_jobs = cpus > 64 ? 64 : cpus;
+#endif
+    if( out_jobs < 1 ) out_jobs = 1;
+  }
+
   if( do_info ) {
     snd_t = TYPE_NONE;
     out_t = TYPE_NONE;
@@ -2250,6 +2273,9 @@ main( int argc, char *argv[] )
     }
     if( prg_t != TYPE_NONE && frame_no % 11 == 0 ) print_progress( 0 );
   }
+#ifdef HAVE_PTHREAD
+  out_finish_frames();			/* write any frames still encoding */
+#endif
   if( prg_t != TYPE_NONE ) print_progress( 1 ); /* update progress */
   if( ( out_t >= TYPE_SCR && out_t <= TYPE_JPEG ) && out_name ) unlink( out_name );
   close_snd();				/* close snd file */
@@ -163,6 +163,15 @@ extern int machine_timing[];
 
 extern int force_aifc;			/* record aifc file even PCM sound */
 
+extern int out_jobs;			/* threads encoding image files */
+
+/* An image file encoded into memory */
+typedef struct {
+  libspectrum_byte *data;
+  unsigned long size;			/* bytes used */
+  unsigned long allocated;		/* bytes allocated */
+} out_image;
+
 FILE *fopen_overwr( const char *path, const char *mode, int rw );
 libspectrum_dword swap_endian_dword( libspectrum_dword d );
 void pcm_swap_endian( void );	/* buff == sound */
@@ -180,10 +189,12 @@ int out_write_scr( void );
 int out_write_ppm( void );
 #ifdef USE_LIBPNG
 int out_write_png( void );
+int out_encode_png( libspectrum_byte *pix, int w, int h, out_image *image );
 void print_png_version( void );
 #endif
 #ifdef USE_LIBJPEG
 int out_write_jpg( void );
+int out_encode_jpg( libspectrum_byte *pix, int w, int h, out_image *image );
 int out_write_mjpeg( void );
 int out_build_avi_mjpeg_frame( char **frame_buff,
                                unsigned long int *frame_size );
@@ -191,6 +202,11 @@ void out_finalize_mjpeg( void );
 void print_jpeg_version( void );
 #endif
 
+#ifdef HAVE_PTHREAD
+int out_queue_frame( void );
+int out_finish_frames( void );
+#endif
+
 int snd_write_wav( void );
 void snd_finalize_wav( void );
 
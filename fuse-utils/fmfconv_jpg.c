@@ -59,6 +59,35 @@ static libspectrum_byte *row_pointers[480];
 void jpeg_avi_mem_dest( j_compress_ptr cinfo, unsigned char **outbuffer,
                         unsigned long *outsize );
 
+/* Create a compressor for w x h images with the current options */
+static void
+jpeg_setup( j_compress_ptr cinfo, struct jpeg_error_mgr *jerr, int w, int h )
+{
+  cinfo->err = jpeg_std_error( jerr );
+  jpeg_create_compress( cinfo );
+  cinfo->image_height = h;
+  cinfo->image_width  = w;
+  cinfo->input_components = greyscale ? 1 : 3;
+  cinfo->in_color_space = greyscale ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_set_defaults( cinfo );
+  cinfo->dct_method = jpg_dctfloat ? JDCT_FLOAT :
+                    ( jpg_idctfast ? JDCT_IFAST : JDCT_ISLOW );
+  cinfo->optimize_coding = jpg_optimize ? TRUE : FALSE;
+  cinfo->smoothing_factor = jpg_smooth < 0 || jpg_smooth > 100 ?
+                            0 : jpg_smooth;
+  cinfo->write_JFIF_header = TRUE;
+
+  if( out_t != TYPE_JPEG )
+    jpeg_set_colorspace( cinfo, JCS_YCbCr );
+  if( greyscale ) /* override AVI YCbCr... */
+    jpeg_set_colorspace( cinfo, JCS_GRAYSCALE );
+  if( progressive )
+    jpeg_simple_progression( cinfo );
+  jpeg_set_quality( cinfo,
+                    ( jpg_quality < 0 || jpg_quality > 100 ? 75 : jpg_quality ),
+                    0 );
+}
+
 static int
 out_write_jpegheader( void )
 {
@@ -67,29 +96,8 @@ out_write_jpegheader( void )
   for( y = 0; y < frm_h; y++ )
     row_pointers[y] = &pix_rgb[ ( greyscale ? 1 : 3 ) * y * frm_w ];
 
-  cinfo.err = jpeg_std_error( &jerr );
-  jpeg_create_compress( &cinfo );
-  cinfo.image_height = frm_h;
-  cinfo.image_width  = frm_w;
-  cinfo.input_components = greyscale ? 1 : 3;
-  cinfo.in_color_space = greyscale ? JCS_GRAYSCALE : JCS_RGB;
-  jpeg_set_defaults( &cinfo );
-  cinfo.dct_method = jpg_dctfloat ? JDCT_FLOAT :
-                   ( jpg_idctfast ? JDCT_IFAST : JDCT_ISLOW );
-  cinfo.optimize_coding = jpg_optimize ? TRUE : FALSE;
-  cinfo.smoothing_factor = jpg_smooth < 0 || jpg_smooth > 100 ?
-                           0 : jpg_smooth;
-  cinfo.write_JFIF_header = TRUE;
+  jpeg_setup( &cinfo, &jerr, frm_w, frm_h );
 
-  if( out_t != TYPE_JPEG )
-    jpeg_set_colorspace( &cinfo, JCS_YCbCr );
-  if( greyscale ) /* override AVI YCbCr... */
-    jpeg_set_colorspace( &cinfo, JCS_GRAYSCALE );
-  if( progressive )
-    jpeg_simple_progression( &cinfo );
-  jpeg_set_quality( &cinfo,
-                    ( jpg_quality < 0 || jpg_quality > 100 ? 75 : jpg_quality ),
-                    0 );
   if( out_t == TYPE_AVI )
     jpeg_avi_mem_dest( &cinfo, &mem_dest, &mem_size );
   else
@@ -143,14 +151,15 @@ out_finalize_mjpeg( void )
   jpeg_destroy_compress( &cinfo );
 }
 
+static const char jpg_comment[] =
+  "fmfconv created JPEG file (http://fuse-emulator.sourceforge.net)\n";
+
 int
 out_write_jpg( void )
 {
   int err;
-  const char str[] =
-    "fmfconv created JPEG file (http://fuse-emulator.sourceforge.net)\n";
 
-  if( ( err = write_jpeg_img( TRUE, (void *)str ) ) ) return err;
+  if( ( err = write_jpeg_img( TRUE, (void *)jpg_comment ) ) ) return err;
   jpeg_header_ok = 0;
   jpeg_destroy_compress( &cinfo );
 
@@ -159,6 +168,43 @@ out_write_jpg( void )
   return 0;
 }
 
+/* Compress the w x h image in pix into a JPEG file held in image; unlike
+   the functions above, this uses no shared state, so may be called from
+   several threads at once */
+int
+out_encode_jpg( libspectrum_byte *pix, int w, int h, out_image *image )
+{
+  struct jpeg_compress_struct enc;
+  struct jpeg_error_mgr enc_err;
+  libspectrum_byte *rows[480];
+  unsigned char *buffer = image->data;
+  unsigned long size = image->allocated;
+  int y;
+
+  for( y = 0; y < h; y++ )
+    rows[y] = &pix[ ( greyscale ? 1 : 3 ) * y * w ];
+
+  jpeg_setup( &enc, &enc_err, w, h );
+  jpeg_avi_mem_dest( &enc, &buffer, &size );
+
+  jpeg_start_compress( &enc, TRUE );
+  jpeg_write_marker( &enc, JPEG_COM, (const JOCTET *)jpg_comment,
+                     strlen( jpg_comment ) );
+  jpeg_write_scanlines( &enc, rows, h );
+  jpeg_finish_compress( &enc );
+  jpeg_destroy_compress( &enc );
+
+  /* A buffer we passed in isn't freed when a bigger one replaces it */
+  if( buffer != image->data ) {
+    free( image->data );
+    image->data = buffer;
+    image->allocated = size;
+  }
+  image->size = size;
+
+  return 0;
+}
+
 /*-------------AVI/MJPEG---------------------*/
 /*
 Byte order: Little-endian
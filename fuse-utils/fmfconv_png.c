@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <png.h>
 
@@ -48,8 +49,37 @@ extern int png_palette;
 
 int png_compress = Z_DEFAULT_COMPRESSION;
 
-int
-out_write_png( void )
+/* libpng output function for writing into memory */
+static void
+write_image_data( png_structp png_ptr, png_bytep data, png_size_t length )
+{
+  out_image *image = png_get_io_ptr( png_ptr );
+
+  if( image->size + length > image->allocated ) {
+    unsigned long allocated = image->allocated ? image->allocated : 4096;
+    libspectrum_byte *buffer;
+
+    while( image->size + length > allocated ) allocated *= 2;
+
+    buffer = realloc( image->data, allocated );
+    if( !buffer ) png_error( png_ptr, "out of memory" );
+
+    image->data = buffer;
+    image->allocated = allocated;
+  }
+
+  memcpy( image->data + image->size, data, length );
+  image->size += length;
+}
+
+static void
+flush_image_data( png_structp png_ptr )
+{
+}
+
+/* Write the w x h image in pix either to f or, if f is NULL, to image */
+static int
+write_png( libspectrum_byte *pix, int w, int h, FILE *f, out_image *image )
 {
   int y;
   libspectrum_byte *row_pointers[480];
@@ -57,11 +87,11 @@ out_write_png( void )
   png_infop info_ptr;
   png_text text[3];
 
-  for( y = 0; y < frm_h; y++ )
+  for( y = 0; y < h; y++ )
     if( png_palette )
-      row_pointers[y] = &pix_rgb[ y * frm_w / 2 ];
+      row_pointers[y] = &pix[ y * w / 2 ];
     else
-      row_pointers[y] = &pix_rgb[ 3 * y * frm_w ];
+      row_pointers[y] = &pix[ 3 * y * w ];
 
   png_ptr = png_create_write_struct( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL );
 
@@ -85,13 +115,18 @@ out_write_png( void )
     return ERR_WRITE_OUT;
   }
 
-  png_init_io( png_ptr, out );
+  if( f ) {
+    png_init_io( png_ptr, f );
+  } else {
+    image->size = 0;
+    png_set_write_fn( png_ptr, image, write_image_data, flush_image_data );
+  }
 
   /* Make files as small as possible */
   png_set_compression_level( png_ptr, png_compress );
 
   png_set_IHDR( png_ptr, info_ptr,
-                frm_w, frm_h, png_palette ? 4 : 8,
+                w, h, png_palette ? 4 : 8,
                 png_palette ? PNG_COLOR_TYPE_PALETTE : PNG_COLOR_TYPE_RGB,
                 progressive ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE,
                 PNG_COMPRESSION_TYPE_DEFAULT,
@@ -135,11 +170,27 @@ out_write_png( void )
 
   png_destroy_write_struct( &png_ptr, &info_ptr );
 
+  return 0;
+}
+
+int
+out_write_png( void )
+{
+  int err;
+
+  if( ( err = write_png( pix_rgb, frm_w, frm_h, out, NULL ) ) ) return err;
+
   printi( 2, "out_write_png()\n" );
 
   return 0;
 }
 
+int
+out_encode_png( libspectrum_byte *pix, int w, int h, out_image *image )
+{
+  return write_png( pix, w, h, NULL, image );
+}
+
 void
 print_png_version( void )
 {
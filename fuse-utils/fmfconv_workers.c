@@ -0,0 +1,261 @@
+/* fmfconv_workers.c: encode image file output on several threads
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libspectrum.h"
+
+#include "fmfconv.h"
+
+/* Threads used to encode PNG and JPEG screenshots; 1 encodes each frame
+   as it is read, and 0 uses one per processor */
+int out_jobs = 0;
+
+#ifdef HAVE_PTHREAD
+
+#include <pthread.h>
+
+/* The input is still read and converted to pixels on the main thread, one
+   frame after another, as each frame only updates the slices which changed
+   since the last one. Each finished frame is copied into a job, encoded
+   into memory by one of the workers, and then written to its own file by
+   the main thread, in order */
+
+extern int png_palette;
+extern int greyscale;
+
+typedef enum job_state {
+  JOB_FREE = 0,
+  JOB_QUEUED,
+  JOB_BUSY,
+  JOB_DONE,
+} job_state;
+
+typedef struct out_job {
+  job_state state;
+  libspectrum_byte *pix;	/* copy of pix_rgb */
+  size_t pix_size;
+  int w, h;
+  FILE *file;			/* where the image goes */
+  libspectrum_qword number;	/* output frame number */
+  out_image image;
+  int err;
+} out_job;
+
+static out_job *jobs;
+static int job_count;
+static int job_next;		/* next slot the main thread fills */
+static int job_take;		/* next slot a worker encodes */
+static int jobs_quit;
+
+static pthread_t *workers;
+static int worker_count;
+
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+
+static void*
+worker_thread( void *arg )
+{
+  out_job *job;
+
+  pthread_mutex_lock( &job_mutex );
+
+  while( 1 ) {
+    while( !jobs_quit && jobs[ job_take ].state != JOB_QUEUED )
+      pthread_cond_wait( &job_queued, &job_mutex );
+    if( jobs_quit ) break;
+
+    job = &jobs[ job_take ];
+    job->state = JOB_BUSY;
+    job_take = ( job_take + 1 ) % job_count;
+
+    pthread_mutex_unlock( &job_mutex );
+
+    switch( out_t ) {
+#ifdef USE_LIBPNG
+    case TYPE_PNG:
+      job->err = out_encode_png( job->pix, job->w, job->h, &job->image );
+      break;
+#endif
+#ifdef USE_LIBJPEG
+    case TYPE_JPEG:
+      job->err = out_encode_jpg( job->pix, job->w, job->h, &job->image );
+      break;
+#endif
+    default:
+      job->err = ERR_WRITE_OUT;
+      break;
+    }
+
+    pthread_mutex_lock( &job_mutex );
+    job->state = JOB_DONE;
+    pthread_cond_broadcast( &job_done );
+  }
+
+  pthread_mutex_unlock( &job_mutex );
+
+  return NULL;
+}
+
+static int
+start_workers( void )
+{
+  int i;
+
+  job_count = 2 * out_jobs;
+  jobs = calloc( job_count, sizeof( *jobs ) );
+  workers = calloc( out_jobs, sizeof( *workers ) );
+  if( !jobs || !workers ) {
+    printe( "\n\nMemory allocation error.\n" );
+    return ERR_OUTOFMEM;
+  }
+
+  for( i = 0; i < out_jobs; i++ ) {
+    if( pthread_create( &workers[i], NULL, worker_thread, NULL ) ) break;
+    worker_count++;
+  }
+
+  if( !worker_count ) {
+    printe( "Cannot start encoder threads.\n" );
+    return ERR_OUTOFMEM;
+  }
+
+  printi( 1, "start_workers(): encoding on %d threads.\n", worker_count );
+
+  return 0;
+}
+
+/* Wait for the job in a slot to be encoded, then write it out */
+static int
+write_job( out_job *job )
+{
+  int err;
+
+  pthread_mutex_lock( &job_mutex );
+  while( job->state != JOB_DONE )
+    pthread_cond_wait( &job_done, &job_mutex );
+  pthread_mutex_unlock( &job_mutex );
+
+  err = job->err;
+  if( !err &&
+      fwrite( job->image.data, job->image.size, 1, job->file ) != 1 ) {
+    printe( "Error writing output frame %"PRIu64".\n", job->number );
+    err = ERR_WRITE_OUT;
+  }
+  fclose( job->file );
+  job->file = NULL;
+  job->state = JOB_FREE;
+
+  printi( 2, "write_job(): frame %"PRIu64"\n", job->number );
+
+  return err;
+}
+
+/* Hand the frame in pix_rgb to the workers, and take over the output file.
+   May write out an earlier frame to make room for it */
+int
+out_queue_frame( void )
+{
+  out_job *job;
+  size_t row, length;
+  int err = 0;
+
+  if( !jobs && ( err = start_workers() ) ) return err;
+
+  job = &jobs[ job_next ];
+  if( job->state != JOB_FREE ) err = write_job( job );
+
+  if( png_palette > 0 && out_t == TYPE_PNG )
+    row = frm_w / 2;
+  else
+    row = greyscale ? frm_w : 3 * frm_w;
+  length = row * frm_h;
+
+  if( job->pix_size < length ) {
+    free( job->pix );
+    job->pix = malloc( length );
+    job->pix_size = 0;
+    if( !job->pix ) {
+      printe( "\n\nMemory allocation error.\n" );
+      return ERR_OUTOFMEM;
+    }
+    job->pix_size = length;
+  }
+  memcpy( job->pix, pix_rgb, length );
+  job->w = frm_w;
+  job->h = frm_h;
+  job->number = output_no;
+  job->file = out;
+  out = NULL;
+
+  pthread_mutex_lock( &job_mutex );
+  job->state = JOB_QUEUED;
+  pthread_cond_signal( &job_queued );
+  pthread_mutex_unlock( &job_mutex );
+
+  job_next = ( job_next + 1 ) % job_count;
+
+  return err;
+}
+
+/* Write out every frame still in hand, and stop the workers */
+int
+out_finish_frames( void )
+{
+  int i, err = 0, job_err;
+
+  if( !jobs ) return 0;
+
+  for( i = 0; i < job_count; i++ ) {
+    out_job *job = &jobs[ ( job_next + i ) % job_count ];
+    if( job->state != JOB_FREE && ( job_err = write_job( job ) ) && !err )
+      err = job_err;
+  }
+
+  pthread_mutex_lock( &job_mutex );
+  jobs_quit = 1;
+  pthread_cond_broadcast( &job_queued );
+  pthread_mutex_unlock( &job_mutex );
+
+  for( i = 0; i < worker_count; i++ )
+    pthread_join( workers[i], NULL );
+
+  for( i = 0; i < job_count; i++ ) {
+    free( jobs[i].pix );
+    free( jobs[i].image.data );
+  }
+  free( jobs ); jobs = NULL;
+  free( workers ); workers = NULL;
+  worker_count = 0;
+
+  return err;
+}
+
+#endif				/* #ifdef HAVE_PTHREAD */
@@ -0,0 +1,383 @@
+/* profile2callgrind.c: convert Fuse call graph profiles to callgrind format
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   Philip: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libspectrum.h>
+
+#include "utils.h"
+
+#define PROGRAM_NAME "profile2callgrind"
+
+/* argv[0] */
+char *progname;
+
+/* A position in the Spectrum's memory: which source (ROM, RAM, ...) it
+   came from, the page within that source and the offset within the page.
+   The address is where the position was mapped when it was executed */
+typedef struct location_t {
+  unsigned int source, page;
+  long offset, address;
+} location_t;
+
+typedef enum record_type {
+  RECORD_SELF,
+  RECORD_CALL,
+} record_type;
+
+typedef struct record_t {
+  record_type type;
+  location_t function, location, callee;
+  uint64_t count, inclusive;
+} record_t;
+
+static char *sources[ 0x100 ];
+
+static record_t *records;
+static size_t record_count, record_allocated;
+
+static void
+show_version( void )
+{
+  printf(
+    PROGRAM_NAME " (" PACKAGE ") " PACKAGE_VERSION "\n"
+    "Copyright (c) 2026 Fuse contributors\n"
+    "License GPLv2+: GNU GPL version 2 or later "
+    "<http://gnu.org/licenses/gpl.html>\n"
+    "This is free software: you are free to change and redistribute it.\n"
+    "There is NO WARRANTY, to the extent permitted by law.\n" );
+}
+
+static void
+show_help( void )
+{
+  printf(
+    "Usage: %s [OPTION] <profile> <callgrind>\n"
+    "Converts Fuse call graph profiles into callgrind format.\n"
+    "\n"
+    "Options:\n"
+    "  -h, --help     Display this help and exit.\n"
+    "  -V, --version  Output version information and exit.\n"
+    "\n"
+    "Report %s bugs to <%s>\n"
+    "%s home page: <%s>\n"
+    "For complete documentation, see the manual page of %s.\n",
+    progname,
+    PROGRAM_NAME, PACKAGE_BUGREPORT, PACKAGE_NAME, PACKAGE_URL, PROGRAM_NAME
+  );
+}
+
+/* Parse one "source page offset address" group from the start of
+   *string, advancing *string past it */
+static int
+parse_location( const char **string, location_t *location )
+{
+  int consumed;
+
+  if( sscanf( *string, " %u %u %li %li%n", &location->source,
+              &location->page, &location->offset,
+              &location->address, &consumed ) != 4 )
+    return 1;
+
+  if( location->source > 0xff ) return 1;
+
+  *string += consumed;
+  return 0;
+}
+
+static record_t*
+new_record( void )
+{
+  if( record_count == record_allocated ) {
+    record_allocated = record_allocated ? 2 * record_allocated : 1024;
+    records = realloc( records, record_allocated * sizeof( *records ) );
+    if( !records ) {
+      fprintf( stderr, "%s: out of memory\n", progname );
+      exit( 1 );
+    }
+  }
+
+  return &records[ record_count++ ];
+}
+
+static int
+parse_line( const char *line )
+{
+  record_t *record;
+  unsigned int source;
+  int consumed;
+
+  if( sscanf( line, "source %u %n", &source, &consumed ) == 1 ) {
+    size_t length;
+
+    if( source > 0xff ) return 1;
+
+    length = strcspn( line + consumed, "\r\n" );
+    free( sources[ source ] );
+    sources[ source ] = malloc( length + 1 );
+    if( !sources[ source ] ) return 1;
+    memcpy( sources[ source ], line + consumed, length );
+    sources[ source ][ length ] = '\0';
+    return 0;
+  }
+
+  if( !strncmp( line, "self ", 5 ) ) {
+    line += 4;
+    record = new_record();
+    record->type = RECORD_SELF;
+    if( parse_location( &line, &record->function ) ||
+        parse_location( &line, &record->location ) ||
+        sscanf( line, " %" SCNu64, &record->count ) != 1 )
+      return 1;
+    record->inclusive = 0;
+    return 0;
+  }
+
+  if( !strncmp( line, "call ", 5 ) ) {
+    line += 4;
+    record = new_record();
+    record->type = RECORD_CALL;
+    if( parse_location( &line, &record->function ) ||
+        parse_location( &line, &record->location ) ||
+        parse_location( &line, &record->callee ) ||
+        sscanf( line, " %" SCNu64 " %" SCNu64, &record->count,
+                &record->inclusive ) != 2 )
+      return 1;
+    return 0;
+  }
+
+  return 1;
+}
+
+static int
+compare_location( const location_t *a, const location_t *b )
+{
+  if( a->source != b->source ) return a->source < b->source ? -1 : 1;
+  if( a->page != b->page ) return a->page < b->page ? -1 : 1;
+  if( a->offset != b->offset ) return a->offset < b->offset ? -1 : 1;
+  return 0;
+}
+
+/* Group records by function, with the function's own costs first */
+static int
+compare_record( const void *a, const void *b )
+{
+  const record_t *ra = a, *rb = b;
+  int result;
+
+  result = compare_location( &ra->function, &rb->function );
+  if( result ) return result;
+
+  if( ra->type != rb->type ) return ra->type == RECORD_SELF ? -1 : 1;
+
+  result = compare_location( &ra->location, &rb->location );
+  if( result ) return result;
+
+  return compare_location( &ra->callee, &rb->callee );
+}
+
+static const char*
+source_name( unsigned int source )
+{
+  return sources[ source ] ? sources[ source ] : "Unknown";
+}
+
+/* Functions are named after the address they were entered at and the
+   memory page they live in; the "file" is the page itself */
+static void
+write_file( FILE *f, const char *key, const location_t *location )
+{
+  fprintf( f, "%s=%s %u\n", key, source_name( location->source ),
+           location->page );
+}
+
+static void
+write_function( FILE *f, const char *key, const location_t *location )
+{
+  fprintf( f, "%s=0x%04lx (%s %u:0x%04lx)\n", key,
+           (unsigned long)location->address, source_name( location->source ),
+           location->page, (unsigned long)location->offset );
+}
+
+static void
+write_callgrind( FILE *f )
+{
+  const location_t *function = NULL;
+  size_t i;
+
+  fprintf( f, "# callgrind format\n" );
+  fprintf( f, "version: 1\n" );
+  fprintf( f, "creator: " PROGRAM_NAME " (" PACKAGE ") " PACKAGE_VERSION
+           "\n" );
+  fprintf( f, "positions: instr\n" );
+  fprintf( f, "events: Tstates\n" );
+
+  for( i = 0; i < record_count; i++ ) {
+    const record_t *record = &records[ i ];
+
+    if( !function || compare_location( function, &record->function ) ) {
+      function = &record->function;
+      fprintf( f, "\n" );
+      write_file( f, "fl", function );
+      write_function( f, "fn", function );
+    }
+
+    switch( record->type ) {
+
+    case RECORD_SELF:
+      fprintf( f, "0x%04lx %" PRIu64 "\n",
+               (unsigned long)record->location.address, record->count );
+      break;
+
+    case RECORD_CALL:
+      write_file( f, "cfl", &record->callee );
+      write_function( f, "cfn", &record->callee );
+      fprintf( f, "calls=%" PRIu64 " 0x%04lx\n", record->count,
+               (unsigned long)record->callee.address );
+      fprintf( f, "0x%04lx %" PRIu64 "\n",
+               (unsigned long)record->location.address, record->inclusive );
+      break;
+
+    }
+  }
+}
+
+int main( int argc, char **argv )
+{
+  char *profile, *callgrind;
+  char line[ 1024 ];
+  FILE *f;
+  size_t line_number = 0;
+  size_t i;
+
+  int c;
+  int error = 0;
+
+  struct option long_options[] = {
+    { "help", 0, NULL, 'h' },
+    { "version", 0, NULL, 'V' },
+    { 0, 0, 0, 0 }
+  };
+
+  progname = argv[0];
+
+  while( ( c = getopt_long( argc, argv, "hV", long_options, NULL ) ) != -1 ) {
+
+    switch( c ) {
+
+    case 'h': show_help(); return 0;
+
+    case 'V': show_version(); return 0;
+
+    case '?':
+      /* getopt prints an error message to stderr */
+      error = 1;
+      break;
+
+    default:
+      error = 1;
+      fprintf( stderr, "%s: unknown option `%c'\n", progname, (char) c );
+      break;
+
+    }
+  }
+  argc -= optind;
+  argv += optind;
+
+  if( error ) {
+    fprintf( stderr, "Try `%s --help' for more information.\n", progname );
+    return error;
+  }
+
+  if( argc != 2 ) {
+    fprintf( stderr, "%s: usage: %s <profile> <callgrind>\n", progname,
+             progname );
+    fprintf( stderr, "Try `%s --help' for more information.\n", progname );
+    return 1;
+  }
+
+  profile = argv[0];
+  callgrind = argv[1];
+
+  f = fopen( profile, "r" );
+  if( !f ) {
+    fprintf( stderr, "%s: unable to open profile '%s' for reading\n",
+             progname, profile );
+    return 1;
+  }
+
+  if( !fgets( line, sizeof( line ), f ) ||
+      strncmp( line, "# Fuse profile 2", 16 ) ) {
+    fprintf( stderr, "%s: '%s' is not a call graph profile; run Fuse with "
+             "--profile-call-graph\n", progname, profile );
+    fclose( f );
+    return 1;
+  }
+  line_number++;
+
+  while( fgets( line, sizeof( line ), f ) ) {
+    line_number++;
+    if( line[0] == '#' || line[0] == '\n' ) continue;
+
+    if( parse_line( line ) ) {
+      fprintf( stderr, "%s: %s:%lu: invalid line\n", progname, profile,
+               (unsigned long)line_number );
+      fclose( f );
+      return 1;
+    }
+  }
+
+  fclose( f );
+
+  qsort( records, record_count, sizeof( *records ), compare_record );
+
+  f = fopen( callgrind, "w" );
+  if( !f ) {
+    fprintf( stderr, "%s: unable to open callgrind file '%s' for writing\n",
+             progname, callgrind );
+    return 1;
+  }
+
+  write_callgrind( f );
+
+  if( fclose( f ) ) {
+    fprintf( stderr, "%s: failed to write callgrind file '%s'\n", progname,
+             callgrind );
+    return 1;
+  }
+
+  free( records );
+  for( i = 0; i < 0x100; i++ ) free( sources[ i ] );
+
+  return 0;
+}
@@ -78,8 +78,8 @@ int main( int argc, char **argv )
 {
   char *profile, *mapfile;
   FILE *f;
+  char line[ 256 ];
   long address, count;
-  int ret;
 
   int c;
   int error = 0;
@@ -138,9 +138,14 @@ int main( int argc, char **argv )
 
   memset( map, 0, sizeof( map ) );
 
-  while( 1 ) {
-    ret = fscanf( f, "%li,%li\n", &address, &count );
-    if( ret == EOF ) break;
+  /* Accept both the flat "address,tstates" profile and the call graph
+     profile, where the instruction's address is the eighth field of each
+     "self" line */
+  while( fgets( line, sizeof( line ), f ) ) {
+    if( sscanf( line, "%li,%li", &address, &count ) != 2 &&
+        sscanf( line, "self %*u %*u %*i %*i %*u %*u %*i %li %li", &address,
+                &count ) != 2 )
+      continue;
 
     if( count && address >= 0 && address < 0x10000 )
       map[ address / 8 ] |= ( 1 << ( address % 8 ) );
@@ -168,6 +168,7 @@ write_pulses( char *filename, libspectrum_tape *tape )
   short level = 0; /* The last level output to this block */
   libspectrum_dword pulse_tstates = 0;
   libspectrum_dword balance_tstates = 0;
+  size_t count, i;
   int flags = 0;
   FILE *output_file;
 
@@ -183,37 +184,41 @@ write_pulses( char *filename, libspectrum_tape *tape )
   }
 
   while( !(flags & LIBSPECTRUM_TAPE_FLAGS_TAPE) ) {
-    error = libspectrum_tape_get_next_edge( &pulse_tstates, &flags, tape );
+    error = libspectrum_tape_get_next_edges( &pulse_tstates, &count, &flags,
+                                             tape );
     if( error != LIBSPECTRUM_ERROR_NONE ) {
       return 1;
     }
 
-    /* Invert the microphone state */
-    if( pulse_tstates ||
-        !( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) ||
-        ( flags & ( LIBSPECTRUM_TAPE_FLAGS_STOP |
-                    LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW |
-                    LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH ) ) ) {
-
-      if( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) {
-        /* Do nothing */
-      } else if( flags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW ) {
-        level = 0;
-      } else if( flags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH ) {
-        level = 1;
-      } else {
-        level = !level;
-      }
+    for( i = 0; i < count; i++ ) {
+
+      /* Invert the microphone state */
+      if( pulse_tstates ||
+          !( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) ||
+          ( flags & ( LIBSPECTRUM_TAPE_FLAGS_STOP |
+                      LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW |
+                      LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH ) ) ) {
+
+        if( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) {
+          /* Do nothing */
+        } else if( flags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW ) {
+          level = 0;
+        } else if( flags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH ) {
+          level = 1;
+        } else {
+          level = !level;
+        }
 
-    }
+      }
 
-    balance_tstates += pulse_tstates;
+      balance_tstates += pulse_tstates;
 
-    if( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) continue;
+      if( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) continue;
 
-    fprintf(output_file, "%u : %d\n", balance_tstates, level);
+      fprintf(output_file, "%u : %d\n", balance_tstates, level);
 
-    balance_tstates = 0;
+      balance_tstates = 0;
+    }
   }
 
   if( fclose(output_file) == EOF ) {
@@ -197,61 +197,66 @@ write_tape( char *filename, libspectrum_tape *tape )
 
   while( !(flags & LIBSPECTRUM_TAPE_FLAGS_TAPE) ) {
     libspectrum_dword pulse_length = 0;
-    size_t i;
+    size_t count, i, j;
 
-    error = libspectrum_tape_get_next_edge( &pulse_tstates, &flags, tape );
+    error = libspectrum_tape_get_next_edges( &pulse_tstates, &count, &flags,
+                                             tape );
     if( error != LIBSPECTRUM_ERROR_NONE ) {
       free( buffer );
       return 1;
     }
 
-    /* Invert the microphone state */
-    if( pulse_tstates ||
-        !( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) ||
-        ( flags & ( LIBSPECTRUM_TAPE_FLAGS_STOP |
-                    LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW |
-                    LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH ) ) ) {
-
-      if( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) {
-        /* Do nothing */
-      } else if( flags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW ) {
-        level = 0;
-      } else if( flags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH ) {
-        level = 1;
-      } else {
-        level = !level;
-      }
+    for( j = 0; j < count; j++ ) {
+
+      /* Invert the microphone state */
+      if( pulse_tstates ||
+          !( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) ||
+          ( flags & ( LIBSPECTRUM_TAPE_FLAGS_STOP |
+                      LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW |
+                      LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH ) ) ) {
+
+        if( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) {
+          /* Do nothing */
+        } else if( flags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW ) {
+          level = 0;
+        } else if( flags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH ) {
+          level = 1;
+        } else {
+          level = !level;
+        }
 
-    }
+      }
 
-    balance_tstates += pulse_tstates;
+      balance_tstates += pulse_tstates;
 
-    if( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) continue;
+      if( flags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE ) continue;
 
-    pulse_length = balance_tstates / scale;
-    balance_tstates = balance_tstates % scale;
+      pulse_length = balance_tstates / scale;
+      balance_tstates = balance_tstates % scale;
 
-    /* TZXs produced by snap2tzx have very tight tolerances, err on the side of
-       producing a pulse that is too long rather than too short */
-    if( balance_tstates > scale>>1 ) {
-      pulse_length++;
-      balance_tstates = 0;
-    }
+      /* TZXs produced by snap2tzx have very tight tolerances, err on the side
+         of producing a pulse that is too long rather than too short */
+      if( balance_tstates > scale>>1 ) {
+        pulse_length++;
+        balance_tstates = 0;
+      }
 
-    while( tape_length + pulse_length > length ) {
-      length *= 2;
-      ptr = buffer;
-      buffer = realloc( buffer, length );
-      if( !buffer ) {
-        free( ptr );
-        fprintf( stderr, "%s: unable to allocate memory for conversion buffer\n",
-                 progname );
-        return 1;
+      while( tape_length + pulse_length > length ) {
+        length *= 2;
+        ptr = buffer;
+        buffer = realloc( buffer, length );
+        if( !buffer ) {
+          free( ptr );
+          fprintf( stderr,
+                   "%s: unable to allocate memory for conversion buffer\n",
+                   progname );
+          return 1;
+        }
       }
-    }
 
-    for( i = 0; i < pulse_length; i++ ) {
-      buffer[ tape_length++ ] = level ? 0xff : 0x00;
+      for( i = 0; i < pulse_length; i++ ) {
+        buffer[ tape_length++ ] = level ? 0xff : 0x00;
+      }
     }
   }
 
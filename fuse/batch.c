@@ -0,0 +1,299 @@
+/* batch.c: Support for running Fuse non-interactively
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_FORK
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif				/* #ifdef HAVE_FORK */
+
+#include <libspectrum.h>
+
+#include "batch.h"
+#include "compat.h"
+#include "event.h"
+#include "fuse.h"
+#include "memory.h"
+#include "profile.h"
+#include "screenshot.h"
+#include "settings.h"
+#include "snapshot.h"
+#include "ui/ui.h"
+#include "utils.h"
+#include "z80/z80.h"
+
+/* How many frames have been emulated so far */
+static libspectrum_dword frames_done = 0;
+
+/* Set once the final state has been written, along with whether that
+   succeeded */
+static int finished = 0;
+static int finish_error = 0;
+
+/* The input file of the job being run, or NULL if we're not running a
+   list of jobs */
+static const char *job_file = NULL;
+
+#define MAX_JOB_LINE_LENGTH 1024
+
+void
+batch_frame( void )
+{
+  if( !settings_current.batch_frames ) return;
+
+  if( ++frames_done >= (libspectrum_dword)settings_current.batch_frames )
+    batch_finish();
+}
+
+void
+batch_rzx_finished( void )
+{
+  if( settings_current.batch_stop_after_rzx ) batch_finish();
+}
+
+/* The screen is written as a PNG if the filename says so and we have
+   libpng, or as a raw .scr otherwise */
+static int
+batch_write_screenshot( const char *filename )
+{
+#ifdef USE_LIBPNG
+  size_t length = strlen( filename );
+
+  if( length >= 4 && !strcasecmp( filename + length - 4, ".png" ) )
+    return screenshot_write( filename, SCALER_NORMAL );
+#endif				/* #ifdef USE_LIBPNG */
+
+  return screenshot_scr_write( filename );
+}
+
+/* When running a list of jobs, replace the first "%s" in an output
+   filename with the base name of the job's input file */
+static char*
+batch_output_filename( const char *template )
+{
+  const char *marker, *base;
+  char *filename;
+  size_t length;
+
+  marker = job_file ? strstr( template, "%s" ) : NULL;
+  if( !marker ) return utils_safe_strdup( template );
+
+  base = strrchr( job_file, FUSE_DIR_SEP_CHR );
+  base = base ? base + 1 : job_file;
+
+  length = strlen( template ) - 2 + strlen( base ) + 1;
+  filename = libspectrum_new( char, length );
+
+  memcpy( filename, template, marker - template );
+  strcpy( filename + ( marker - template ), base );
+  strcat( filename, marker + 2 );
+
+  return filename;
+}
+
+int
+batch_finish( void )
+{
+  char *filename;
+  int error = 0;
+
+  if( finished ) return finish_error;
+  finished = 1;
+
+  if( settings_current.batch_snapshot ) {
+    filename = batch_output_filename( settings_current.batch_snapshot );
+    if( snapshot_write( filename ) ) error = 1;
+    libspectrum_free( filename );
+  }
+
+  if( settings_current.batch_screenshot ) {
+    filename = batch_output_filename( settings_current.batch_screenshot );
+    if( batch_write_screenshot( filename ) ) error = 1;
+    libspectrum_free( filename );
+  }
+
+  if( settings_current.batch_profile && profile_active ) {
+    filename = batch_output_filename( settings_current.batch_profile );
+    profile_finish( filename );
+    libspectrum_free( filename );
+  }
+
+  if( settings_current.batch_hash ) {
+    if( job_file ) {
+      printf( "%08x  %s\n", batch_memory_hash(), job_file );
+    } else {
+      printf( "%08x\n", batch_memory_hash() );
+    }
+    fflush( stdout );
+  }
+
+  fuse_exiting = 1;
+
+  finish_error = error;
+  return error;
+}
+
+/* 32-bit FNV-1a; cheap, and good enough to spot differing states */
+libspectrum_dword
+batch_memory_hash( void )
+{
+  libspectrum_dword hash = 2166136261UL;
+  size_t i;
+
+  for( i = 0; i < 0x10000; i++ ) {
+    hash ^= readbyte_internal( i );
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+#ifdef HAVE_FORK
+
+/* Run one job in a child process. The child is a copy of the fully
+   initialised emulator, so start-up costs are paid once and memory which
+   is never written (e.g. the ROMs) is shared between all the jobs */
+static void
+batch_run_job( const char *filename )
+{
+  int error;
+
+  job_file = filename;
+
+  error = utils_open_file( filename, 1, NULL );
+
+  while( !error && !fuse_exiting ) {
+    z80_do_opcodes();
+    event_do_events();
+  }
+
+  if( !error ) error = batch_finish();
+
+  fflush( stdout );
+  fflush( stderr );
+
+  _exit( error ? 1 : 0 );
+}
+
+static int
+batch_wait_job( int *failed )
+{
+  int status;
+
+  if( wait( &status ) == -1 ) {
+    ui_error( UI_ERROR_ERROR, "error waiting for batch job: %s",
+              strerror( errno ) );
+    return 1;
+  }
+
+  if( !WIFEXITED( status ) || WEXITSTATUS( status ) ) (*failed)++;
+
+  return 0;
+}
+
+int
+batch_run_jobs( void )
+{
+  char line[ MAX_JOB_LINE_LENGTH ];
+  FILE *f;
+  int running = 0, failed = 0, workers;
+
+  if( !settings_current.batch_frames &&
+      !settings_current.batch_stop_after_rzx ) {
+    ui_error( UI_ERROR_ERROR,
+              "batch jobs need --batch-frames or --batch-stop-after-rzx" );
+    return 1;
+  }
+
+  f = fopen( settings_current.batch_jobs, "r" );
+  if( !f ) {
+    ui_error( UI_ERROR_ERROR, "couldn't open '%s': %s",
+              settings_current.batch_jobs, strerror( errno ) );
+    return 1;
+  }
+
+  workers = settings_current.batch_workers < 1 ?
+            1 : settings_current.batch_workers;
+
+  /* Make sure nothing buffered is output once per child */
+  fflush( stdout );
+  fflush( stderr );
+
+  while( fgets( line, MAX_JOB_LINE_LENGTH, f ) ) {
+    pid_t pid;
+
+    line[ strcspn( line, "\r\n" ) ] = '\0';
+    if( !line[0] || line[0] == '#' ) continue;
+
+    if( running == workers ) {
+      if( batch_wait_job( &failed ) ) break;
+      running--;
+    }
+
+    pid = fork();
+    if( pid == -1 ) {
+      ui_error( UI_ERROR_ERROR, "couldn't start batch job: %s",
+                strerror( errno ) );
+      failed++;
+      break;
+    }
+
+    if( !pid ) batch_run_job( line );
+
+    running++;
+  }
+
+  fclose( f );
+
+  while( running ) {
+    if( batch_wait_job( &failed ) ) return 1;
+    running--;
+  }
+
+  if( failed ) {
+    ui_error( UI_ERROR_ERROR, "%d batch job%s failed", failed,
+              failed == 1 ? "" : "s" );
+    return 1;
+  }
+
+  return 0;
+}
+
+#else				/* #ifdef HAVE_FORK */
+
+int
+batch_run_jobs( void )
+{
+  ui_error( UI_ERROR_ERROR, "batch jobs are not supported on this platform" );
+  return 1;
+}
+
+#endif				/* #ifdef HAVE_FORK */
@@ -0,0 +1,46 @@
+/* batch.h: Support for running Fuse non-interactively
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#ifndef FUSE_BATCH_H
+#define FUSE_BATCH_H
+
+#include <libspectrum.h>
+
+/* Called once per emulated frame */
+void batch_frame( void );
+
+/* Called when RZX playback finishes */
+void batch_rzx_finished( void );
+
+/* Write out any requested final state and exit the emulator */
+int batch_finish( void );
+
+/* Run each of the files listed in the --batch-jobs file in turn */
+int batch_run_jobs( void );
+
+/* A hash of the 64K address space as currently seen by the Z80 */
+libspectrum_dword batch_memory_hash( void );
+
+#endif				/* #ifndef FUSE_BATCH_H */
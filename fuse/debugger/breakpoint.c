@@ -46,6 +46,18 @@ GSList *debugger_breakpoints;
 /* The next breakpoint ID to use */
 static size_t next_breakpoint_id;
 
+/* For the address and port breakpoint types, a bitmap of the 64K values
+   which might trigger a breakpoint of that type. This is a superset of
+   the values which will actually trigger: page-specific breakpoints mark
+   their offset in every 16K bank, and stale bits may remain after a
+   breakpoint is removed until the next rebuild. Only values with their
+   bit set need the full walk of the breakpoint list */
+#define BREAKPOINT_BITMAP_TYPES ( DEBUGGER_BREAKPOINT_TYPE_PORT_WRITE + 1 )
+
+static libspectrum_byte
+  breakpoint_bitmap[ BREAKPOINT_BITMAP_TYPES ][ 0x10000 / 8 ];
+static int breakpoint_bitmap_dirty = 1;
+
 /* Textual representations of the breakpoint types and lifetimes */
 const char *debugger_breakpoint_type_text[] = {
   "Execute", "Read", "Write", "Port Read", "Port Write", "Time", "Event",
@@ -73,13 +85,13 @@ static int breakpoint_check( debugger_breakpoint *bp,
 static debugger_breakpoint* get_breakpoint_by_id( size_t id );
 static gint find_breakpoint_by_id( gconstpointer data,
 				   gconstpointer user_data );
-static void remove_time( gpointer data, gpointer user_data );
 static gint find_breakpoint_by_id( gconstpointer data,
 				   gconstpointer user_data );
 static gint find_breakpoint_by_address( gconstpointer data,
 					gconstpointer user_data );
 static void free_breakpoint( gpointer data, gpointer user_data );
 static void add_time_event( gpointer data, gpointer user_data );
+static void breakpoint_bitmap_build( void );
 
 /* Add a breakpoint */
 int
@@ -207,6 +219,7 @@ breakpoint_add( debugger_breakpoint_type type, debugger_breakpoint_value value,
       libspectrum_free( bp );
       return 1;
     }
+    debugger_expression_compile( bp->condition );
   } else {
     bp->condition = NULL;
   }
@@ -214,6 +227,7 @@ breakpoint_add( debugger_breakpoint_type type, debugger_breakpoint_value value,
   bp->commands = NULL;
 
   debugger_breakpoints = g_slist_append( debugger_breakpoints, bp );
+  breakpoint_bitmap_dirty = 1;
 
   if( debugger_mode == DEBUGGER_MODE_INACTIVE )
     debugger_mode = DEBUGGER_MODE_ACTIVE;
@@ -242,6 +256,13 @@ debugger_check( debugger_breakpoint_type type, libspectrum_dword value )
   case DEBUGGER_MODE_INACTIVE: return 0;
 
   case DEBUGGER_MODE_ACTIVE:
+    if( type < BREAKPOINT_BITMAP_TYPES ) {
+      if( breakpoint_bitmap_dirty ) breakpoint_bitmap_build();
+      if( !( breakpoint_bitmap[ type ][ ( value & 0xffff ) >> 3 ] &
+             ( 1 << ( value & 0x07 ) ) ) )
+        return 0;
+    }
+
     for( ptr = debugger_breakpoints; ptr; ptr = ptr_next ) {
 
       bp = ptr->data;
@@ -254,6 +275,7 @@ debugger_check( debugger_breakpoint_type type, libspectrum_dword value )
         if( bp->life == DEBUGGER_BREAKPOINT_LIFE_ONESHOT ) {
           debugger_breakpoints = g_slist_remove( debugger_breakpoints, bp );
           libspectrum_free( bp );
+          breakpoint_bitmap_dirty = 1;
           signal_breakpoints_updated = 1;
         }
       }
@@ -372,13 +394,6 @@ breakpoint_check( debugger_breakpoint *bp, debugger_breakpoint_type type,
   return debugger_breakpoint_trigger( bp );
 }
 
-struct remove_t {
-
-  libspectrum_dword tstates;
-  int done;
-
-};
-
 /* Remove breakpoint with the given ID */
 int
 debugger_breakpoint_remove( size_t id )
@@ -388,19 +403,14 @@ debugger_breakpoint_remove( size_t id )
   bp = get_breakpoint_by_id( id ); if( !bp ) return 1;
 
   debugger_breakpoints = g_slist_remove( debugger_breakpoints, bp );
+  breakpoint_bitmap_dirty = 1;
   if( debugger_mode == DEBUGGER_MODE_ACTIVE && !debugger_breakpoints )
     debugger_mode = DEBUGGER_MODE_INACTIVE;
 
   /* If this was a timed breakpoint, remove the event as well */
-  if( bp->type == DEBUGGER_BREAKPOINT_TYPE_TIME ) {
-
-    struct remove_t remove;
-
-    remove.tstates = bp->value.time.tstates;
-    remove.done = 0;
-
-    event_foreach( remove_time, &remove );
-  }
+  if( bp->type == DEBUGGER_BREAKPOINT_TYPE_TIME )
+    event_remove_type_tstates( debugger_breakpoint_event,
+                               bp->value.time.tstates );
 
   libspectrum_free( bp );
 
@@ -434,23 +444,6 @@ find_breakpoint_by_id( gconstpointer data, gconstpointer user_data )
   return bp->id - id;
 }
 
-static void
-remove_time( gpointer data, gpointer user_data )
-{
-  event_t *event;
-  struct remove_t *remove;
-
-  event = data; remove = user_data;
-
-  if( remove->done ) return;
-
-  if( event->type == debugger_breakpoint_event &&
-      event->tstates == remove->tstates ) {
-    event->type = event_type_null;
-    remove->done = 1;
-  }
-}
-
 /* Remove all breakpoints at the given address */
 int
 debugger_breakpoint_clear( libspectrum_word address )
@@ -470,6 +463,7 @@ debugger_breakpoint_clear( libspectrum_word address )
 
     ptr_data = ptr->data;
     debugger_breakpoints = g_slist_remove( debugger_breakpoints, ptr_data );
+    breakpoint_bitmap_dirty = 1;
     if( debugger_mode == DEBUGGER_MODE_ACTIVE && !debugger_breakpoints )
       debugger_mode = DEBUGGER_MODE_INACTIVE;
 
@@ -512,6 +506,7 @@ debugger_breakpoint_remove_all( void )
 {
   g_slist_foreach( debugger_breakpoints, free_breakpoint, NULL );
   g_slist_free( debugger_breakpoints ); debugger_breakpoints = NULL;
+  breakpoint_bitmap_dirty = 1;
 
   if( debugger_mode == DEBUGGER_MODE_ACTIVE )
     debugger_mode = DEBUGGER_MODE_INACTIVE;
@@ -577,6 +572,7 @@ debugger_breakpoint_set_condition( size_t id, debugger_expression *condition )
   if( condition ) {
     bp->condition = debugger_expression_copy( condition );
     if( !bp->condition ) return 1;
+    debugger_expression_compile( bp->condition );
   } else {
     bp->condition = NULL;
   }
@@ -623,3 +619,53 @@ debugger_breakpoint_time_fn( libspectrum_dword tstates, int type GCC_UNUSED,
 {
   debugger_check( DEBUGGER_BREAKPOINT_TYPE_TIME, 0 );
 }
+
+/* Mark the values which could trigger breakpoint 'bp' in its bitmap */
+static void
+breakpoint_bitmap_add( gpointer data, gpointer user_data GCC_UNUSED )
+{
+  debugger_breakpoint *bp = data;
+  libspectrum_byte *bitmap;
+  libspectrum_dword value;
+
+  if( bp->type >= BREAKPOINT_BITMAP_TYPES ) return;
+
+  bitmap = breakpoint_bitmap[ bp->type ];
+
+  switch( bp->type ) {
+
+  case DEBUGGER_BREAKPOINT_TYPE_EXECUTE:
+  case DEBUGGER_BREAKPOINT_TYPE_READ:
+  case DEBUGGER_BREAKPOINT_TYPE_WRITE:
+    if( bp->value.address.source == memory_source_any ) {
+      value = bp->value.address.offset;
+      bitmap[ value >> 3 ] |= 1 << ( value & 0x07 );
+    } else {
+      /* The page could be mapped into any 16K bank */
+      for( value = bp->value.address.offset & 0x3fff; value < 0x10000;
+           value += 0x4000 )
+        bitmap[ value >> 3 ] |= 1 << ( value & 0x07 );
+    }
+    break;
+
+  case DEBUGGER_BREAKPOINT_TYPE_PORT_READ:
+  case DEBUGGER_BREAKPOINT_TYPE_PORT_WRITE:
+    for( value = 0; value < 0x10000; value++ )
+      if( ( value & bp->value.port.mask ) == bp->value.port.port )
+        bitmap[ value >> 3 ] |= 1 << ( value & 0x07 );
+    break;
+
+  default:
+    break;
+
+  }
+}
+
+/* Rebuild the bitmaps from the current list of breakpoints */
+static void
+breakpoint_bitmap_build( void )
+{
+  memset( breakpoint_bitmap, 0, sizeof( breakpoint_bitmap ) );
+  g_slist_foreach( debugger_breakpoints, breakpoint_bitmap_add, NULL );
+  breakpoint_bitmap_dirty = 0;
+}
@@ -33,6 +33,7 @@
 #include "memory.h"
 #include "mempool.h"
 #include "periph.h"
+#include "rewind.h"
 #include "ui/ui.h"
 #include "z80/z80.h"
 #include "z80/z80_macros.h"
@@ -167,6 +168,18 @@ debugger_breakpoint_exit( void )
   return 0;
 }
 
+/* Go back to the rewind point steps before the most recent one */
+int
+debugger_rewind( size_t steps )
+{
+  if( rewind_back( steps ) ) {
+    ui_error( UI_ERROR_ERROR, "No earlier state to rewind to" );
+    return 1;
+  }
+
+  return 0;
+}
+
 /* Poke a value into RAM */
 int
 debugger_poke( libspectrum_word address, libspectrum_byte value )
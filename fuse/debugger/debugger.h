@@ -58,6 +58,7 @@ int debugger_trap( void );	/* Activate the debugger */
 int debugger_step( void );	/* Single step */
 int debugger_next( void );	/* Go to next instruction, ignoring CALL etc */
 int debugger_run( void ); /* Set debugger_mode so that emulation will occur */
+int debugger_rewind( size_t steps ); /* Go back to an earlier state */
 
 /* Disassemble the instruction at 'address', returning its length in
    '*length' */
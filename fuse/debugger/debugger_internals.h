@@ -99,6 +99,7 @@ debugger_expression_new_variable( const char *name, int pool );
 
 debugger_expression* debugger_expression_copy( debugger_expression *src );
 void debugger_expression_delete( debugger_expression* expression );
+void debugger_expression_compile( debugger_expression *expression );
 
 libspectrum_dword
 debugger_expression_evaluate( debugger_expression* expression );
@@ -115,6 +116,8 @@ void debugger_system_variable_init( void );
 void debugger_system_variable_end( void );
 int debugger_system_variable_find( const char *type, const char *detail );
 libspectrum_dword debugger_system_variable_get( int system_variable );
+debugger_get_system_variable_fn_t
+debugger_system_variable_get_fn( int system_variable );
 void debugger_system_variable_set( const char *type, const char *detail,
                                    libspectrum_dword value );
 void debugger_system_variable_text( char *buffer, size_t length,
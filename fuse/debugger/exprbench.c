@@ -0,0 +1,233 @@
+/* exprbench.c: Benchmark for evaluating debugger expressions
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libspectrum.h>
+
+#include "debugger_internals.h"
+#include "fuse.h"
+#include "memory.h"
+#include "mempool.h"
+#include "ui/ui.h"
+#include "utils.h"
+
+/* Compares the time taken to evaluate a typical breakpoint condition by
+   walking the expression tree and by running the compiled program. Also
+   checks that both give the same answers */
+
+static const char *progname;
+
+static libspectrum_byte memory[ 0x10000 ];
+memory_page memory_map_read[ MEMORY_PAGES_IN_64K ];
+
+int debugger_output_base = 16;
+const char *debugger_z80_system_variable_type = "z80";
+
+static libspectrum_word pc, hl;
+static libspectrum_byte a;
+
+static libspectrum_dword get_pc( void ) { return pc; }
+static libspectrum_dword get_hl( void ) { return hl; }
+static libspectrum_dword get_a( void ) { return a; }
+
+static debugger_expression*
+sysvar( const char *detail )
+{
+  return debugger_expression_new_system_variable(
+    debugger_z80_system_variable_type, detail, 0 );
+}
+
+/* ( PC == 0x8000 && A > 5 ) || ( [HL + 1] & 0x0f ) == 3 */
+static debugger_expression*
+create_condition( void )
+{
+  debugger_expression *left, *right;
+
+  left = debugger_expression_new_binaryop(
+    DEBUGGER_TOKEN_LOGICAL_AND,
+    debugger_expression_new_binaryop(
+      DEBUGGER_TOKEN_EQUAL_TO, sysvar( "PC" ),
+      debugger_expression_new_number( 0x8000, 0 ), 0 ),
+    debugger_expression_new_binaryop(
+      '>', sysvar( "A" ), debugger_expression_new_number( 5, 0 ), 0 ),
+    0 );
+
+  right = debugger_expression_new_binaryop(
+    DEBUGGER_TOKEN_EQUAL_TO,
+    debugger_expression_new_binaryop(
+      '&',
+      debugger_expression_new_unaryop(
+        DEBUGGER_TOKEN_DEREFERENCE,
+        debugger_expression_new_binaryop(
+          '+', sysvar( "HL" ), debugger_expression_new_number( 1, 0 ), 0 ),
+        0 ),
+      debugger_expression_new_number( 0x0f, 0 ), 0 ),
+    debugger_expression_new_number( 3, 0 ), 0 );
+
+  return debugger_expression_new_binaryop( DEBUGGER_TOKEN_LOGICAL_OR, left,
+                                           right, 0 );
+}
+
+/* Step the 'registers' through a fixed pseudo-random sequence */
+static void
+set_state( size_t i )
+{
+  pc = ( i & 1 ) ? 0x8000 : ( i * 7 ) & 0xffff;
+  a = ( i * 13 ) & 0xff;
+  hl = ( i * 40503 ) & 0xffff;
+}
+
+static double
+time_evaluations( debugger_expression *exp, size_t count,
+                  libspectrum_dword *total )
+{
+  clock_t start;
+  size_t i;
+
+  *total = 0;
+
+  start = clock();
+  for( i = 0; i < count; i++ ) {
+    set_state( i );
+    *total += debugger_expression_evaluate( exp );
+  }
+
+  return (double)( clock() - start ) / CLOCKS_PER_SEC;
+}
+
+int
+main( int argc, char **argv )
+{
+  debugger_expression *tree, *compiled;
+  libspectrum_dword tree_total, compiled_total;
+  double tree_time, compiled_time;
+  size_t i, count = 10000000;
+
+  progname = argv[0];
+
+  if( argc > 1 ) count = strtoul( argv[1], NULL, 10 );
+  if( !count ) {
+    fprintf( stderr, "Usage: %s [<evaluations>]\n", progname );
+    return 1;
+  }
+
+  for( i = 0; i < MEMORY_PAGES_IN_64K; i++ )
+    memory_map_read[ i ].page = &memory[ i * MEMORY_PAGE_SIZE ];
+  for( i = 0; i < 0x10000; i++ ) memory[ i ] = ( i * 31 ) & 0xff;
+
+  debugger_system_variable_init();
+  debugger_system_variable_register( debugger_z80_system_variable_type, "PC",
+                                     get_pc, NULL );
+  debugger_system_variable_register( debugger_z80_system_variable_type, "HL",
+                                     get_hl, NULL );
+  debugger_system_variable_register( debugger_z80_system_variable_type, "A",
+                                     get_a, NULL );
+
+  tree = create_condition();
+  compiled = debugger_expression_copy( tree );
+  debugger_expression_compile( compiled );
+
+  for( i = 0; i < 0x10000; i++ ) {
+    set_state( i );
+    if( debugger_expression_evaluate( tree ) !=
+        debugger_expression_evaluate( compiled ) ) {
+      fprintf( stderr, "%s: results differ at step %lu\n", progname,
+               (unsigned long)i );
+      return 1;
+    }
+  }
+
+  tree_time = time_evaluations( tree, count, &tree_total );
+  compiled_time = time_evaluations( compiled, count, &compiled_total );
+
+  if( tree_total != compiled_total ) {
+    fprintf( stderr, "%s: totals differ\n", progname );
+    return 1;
+  }
+
+  printf( "%lu evaluations\n", (unsigned long)count );
+  printf( "tree:     %8.3f s  %6.1f ns/evaluation\n", tree_time,
+          tree_time * 1e9 / count );
+  printf( "compiled: %8.3f s  %6.1f ns/evaluation\n", compiled_time,
+          compiled_time * 1e9 / count );
+
+  debugger_expression_delete( compiled );
+  debugger_expression_delete( tree );
+  debugger_system_variable_end();
+
+  return 0;
+}
+
+/* Stubs for the parts of Fuse the expression code uses */
+
+void*
+mempool_malloc_n( int pool GCC_UNUSED, size_t nmemb, size_t size )
+{
+  return libspectrum_malloc_n( nmemb, size );
+}
+
+char*
+mempool_strdup( int pool GCC_UNUSED, const char *string )
+{
+  return utils_safe_strdup( string );
+}
+
+char*
+utils_safe_strdup( const char *src )
+{
+  char *dest = NULL;
+  if( src ) {
+    dest = libspectrum_new( char, strlen( src ) + 1 );
+    strcpy( dest, src );
+  }
+  return dest;
+}
+
+int
+ui_error( ui_error_level severity GCC_UNUSED, const char *format, ... )
+{
+  va_list ap;
+
+  va_start( ap, format );
+  fprintf( stderr, "%s: ", progname );
+  vfprintf( stderr, format, ap );
+  fprintf( stderr, "\n" );
+  va_end( ap );
+
+  return 0;
+}
+
+void
+fuse_abort( void )
+{
+  abort();
+}
@@ -79,11 +79,73 @@ struct binaryop_type {
 
 };
 
+/* Expressions used as breakpoint conditions are compiled into a linear
+   program for a simple stack machine, so evaluating them doesn't need
+   to walk the tree */
+typedef enum program_opcode {
+
+  PROGRAM_INTEGER,
+  PROGRAM_SYSVAR,
+  PROGRAM_VARIABLE,
+
+  PROGRAM_LOGICAL_NOT,
+  PROGRAM_BITWISE_NOT,
+  PROGRAM_NEGATE,
+  PROGRAM_DEREFERENCE,
+
+  PROGRAM_ADD,
+  PROGRAM_SUBTRACT,
+  PROGRAM_MULTIPLY,
+  PROGRAM_DIVIDE,
+  PROGRAM_EQUAL_TO,
+  PROGRAM_NOT_EQUAL_TO,
+  PROGRAM_GREATER_THAN,
+  PROGRAM_LESS_THAN,
+  PROGRAM_LESS_THAN_OR_EQUAL_TO,
+  PROGRAM_GREATER_THAN_OR_EQUAL_TO,
+  PROGRAM_BITWISE_AND,
+  PROGRAM_BITWISE_XOR,
+  PROGRAM_BITWISE_OR,
+
+  /* Short circuit the logical operators by jumping to 'target' if the
+     left hand side decides the result; otherwise, the right hand side
+     is evaluated and converted to a truth value */
+  PROGRAM_LOGICAL_AND,
+  PROGRAM_LOGICAL_OR,
+  PROGRAM_TRUTH_VALUE,
+
+} program_opcode;
+
+typedef struct program_instruction {
+
+  program_opcode opcode;
+
+  union {
+    libspectrum_dword integer;
+    debugger_get_system_variable_fn_t get;
+    const char *variable;
+    size_t target;
+  } types;
+
+} program_instruction;
+
+typedef struct expression_program {
+
+  program_instruction *code;
+  size_t length;
+
+  libspectrum_dword *stack;
+
+} expression_program;
+
 struct debugger_expression {
 
   expression_type type;
   enum precedence_t precedence;
 
+  /* The compiled form of this expression, or NULL if not compiled */
+  expression_program *program;
+
   union {
     int integer;
     struct unaryop_type unaryop;
@@ -95,6 +157,7 @@ struct debugger_expression {
 };
 
 static libspectrum_dword evaluate_unaryop( struct unaryop_type *unaryop );
+static libspectrum_dword evaluate_program( expression_program *program );
 static libspectrum_dword evaluate_binaryop( struct binaryop_type *binary );
 
 static int deparse_unaryop( char *buffer, size_t length,
@@ -158,6 +221,7 @@ debugger_expression_new_number( libspectrum_dword number, int pool )
 
   exp->type = DEBUGGER_EXPRESSION_TYPE_INTEGER;
   exp->precedence = PRECEDENCE_ATOMIC;
+  exp->program = NULL;
   exp->types.integer = number;
 
   return exp;
@@ -184,6 +248,7 @@ debugger_expression_new_binaryop( int operation, debugger_expression *operand1,
 
   exp->type = DEBUGGER_EXPRESSION_TYPE_BINARYOP;
   exp->precedence = binaryop_precedence( operation );
+  exp->program = NULL;
 
   exp->types.binaryop.operation = operation;
   exp->types.binaryop.op1 = operand1;
@@ -202,6 +267,7 @@ debugger_expression_new_unaryop( int operation, debugger_expression *operand,
 
   exp->type = DEBUGGER_EXPRESSION_TYPE_UNARYOP;
   exp->precedence = unaryop_precedence( operation );
+  exp->program = NULL;
 
   exp->types.unaryop.operation = operation;
   exp->types.unaryop.op = operand;
@@ -227,6 +293,7 @@ debugger_expression_new_system_variable( const char *type, const char *detail,
 
   exp->type = DEBUGGER_EXPRESSION_TYPE_SYSVAR;
   exp->precedence = PRECEDENCE_ATOMIC;
+  exp->program = NULL;
   exp->types.system_variable = system_variable;
 
   return exp;
@@ -241,6 +308,7 @@ debugger_expression_new_variable( const char *name, int pool )
 
   exp->type = DEBUGGER_EXPRESSION_TYPE_VARIABLE;
   exp->precedence = PRECEDENCE_ATOMIC;
+  exp->program = NULL;
   exp->types.variable = mempool_strdup( pool, name );
 
   return exp;
@@ -268,6 +336,12 @@ debugger_expression_delete( debugger_expression *exp )
     libspectrum_free( exp->types.variable );
     break;
   }
+
+  if( exp->program ) {
+    libspectrum_free( exp->program->code );
+    libspectrum_free( exp->program->stack );
+    libspectrum_free( exp->program );
+  }
     
   libspectrum_free( exp );
 }
@@ -282,6 +356,7 @@ debugger_expression_copy( debugger_expression *src )
 
   dest->type = src->type;
   dest->precedence = src->precedence;
+  dest->program = NULL;
 
   switch( dest->type ) {
 
@@ -327,9 +402,146 @@ debugger_expression_copy( debugger_expression *src )
   return dest;
 }
 
+/* Append one instruction to 'program', returning its index */
+static size_t
+compile_instruction( expression_program *program, program_opcode opcode )
+{
+  program->code = libspectrum_renew( program_instruction, program->code,
+                                     program->length + 1 );
+  program->code[ program->length ].opcode = opcode;
+
+  return program->length++;
+}
+
+static program_opcode
+compile_unaryop( int operation )
+{
+  switch( operation ) {
+
+  case '!': return PROGRAM_LOGICAL_NOT;
+  case '~': return PROGRAM_BITWISE_NOT;
+  case '-': return PROGRAM_NEGATE;
+
+  case DEBUGGER_TOKEN_DEREFERENCE: return PROGRAM_DEREFERENCE;
+
+  }
+
+  ui_error( UI_ERROR_ERROR, "unknown unary operator %d", operation );
+  fuse_abort();
+}
+
+static program_opcode
+compile_binaryop( int operation )
+{
+  switch( operation ) {
+
+  case '+': return PROGRAM_ADD;
+  case '-': return PROGRAM_SUBTRACT;
+  case '*': return PROGRAM_MULTIPLY;
+  case '/': return PROGRAM_DIVIDE;
+
+  case DEBUGGER_TOKEN_EQUAL_TO: return PROGRAM_EQUAL_TO;
+  case DEBUGGER_TOKEN_NOT_EQUAL_TO: return PROGRAM_NOT_EQUAL_TO;
+  case '>': return PROGRAM_GREATER_THAN;
+  case '<': return PROGRAM_LESS_THAN;
+  case DEBUGGER_TOKEN_LESS_THAN_OR_EQUAL_TO:
+    return PROGRAM_LESS_THAN_OR_EQUAL_TO;
+  case DEBUGGER_TOKEN_GREATER_THAN_OR_EQUAL_TO:
+    return PROGRAM_GREATER_THAN_OR_EQUAL_TO;
+
+  case '&': return PROGRAM_BITWISE_AND;
+  case '^': return PROGRAM_BITWISE_XOR;
+  case '|': return PROGRAM_BITWISE_OR;
+
+  case DEBUGGER_TOKEN_LOGICAL_AND: return PROGRAM_LOGICAL_AND;
+  case DEBUGGER_TOKEN_LOGICAL_OR: return PROGRAM_LOGICAL_OR;
+
+  }
+
+  ui_error( UI_ERROR_ERROR, "unknown binary operator %d", operation );
+  fuse_abort();
+}
+
+/* Compile 'exp' onto the end of 'program', returning the number of stack
+   entries needed to evaluate it */
+static size_t
+compile_expression( expression_program *program,
+                    const debugger_expression *exp )
+{
+  size_t depth1, depth2, jump;
+  program_opcode opcode;
+
+  switch( exp->type ) {
+
+  case DEBUGGER_EXPRESSION_TYPE_INTEGER:
+    jump = compile_instruction( program, PROGRAM_INTEGER );
+    program->code[ jump ].types.integer = exp->types.integer;
+    return 1;
+
+  case DEBUGGER_EXPRESSION_TYPE_SYSVAR:
+    jump = compile_instruction( program, PROGRAM_SYSVAR );
+    program->code[ jump ].types.get =
+      debugger_system_variable_get_fn( exp->types.system_variable );
+    return 1;
+
+  case DEBUGGER_EXPRESSION_TYPE_VARIABLE:
+    jump = compile_instruction( program, PROGRAM_VARIABLE );
+    program->code[ jump ].types.variable = exp->types.variable;
+    return 1;
+
+  case DEBUGGER_EXPRESSION_TYPE_UNARYOP:
+    depth1 = compile_expression( program, exp->types.unaryop.op );
+    compile_instruction( program,
+                         compile_unaryop( exp->types.unaryop.operation ) );
+    return depth1;
+
+  case DEBUGGER_EXPRESSION_TYPE_BINARYOP:
+    opcode = compile_binaryop( exp->types.binaryop.operation );
+    depth1 = compile_expression( program, exp->types.binaryop.op1 );
+
+    if( opcode == PROGRAM_LOGICAL_AND || opcode == PROGRAM_LOGICAL_OR ) {
+      jump = compile_instruction( program, opcode );
+      depth2 = compile_expression( program, exp->types.binaryop.op2 );
+      compile_instruction( program, PROGRAM_TRUTH_VALUE );
+      program->code[ jump ].types.target = program->length;
+      return depth1 > depth2 ? depth1 : depth2;
+    }
+
+    depth2 = compile_expression( program, exp->types.binaryop.op2 ) + 1;
+    compile_instruction( program, opcode );
+    return depth1 > depth2 ? depth1 : depth2;
+
+  }
+
+  ui_error( UI_ERROR_ERROR, "unknown expression type %d", exp->type );
+  fuse_abort();
+}
+
+/* Compile 'exp' so that future evaluations of it don't need to walk the
+   expression tree. The tree is kept for deparsing */
+void
+debugger_expression_compile( debugger_expression *exp )
+{
+  expression_program *program;
+  size_t depth;
+
+  if( exp->program ) return;
+
+  program = libspectrum_new( expression_program, 1 );
+  program->code = NULL;
+  program->length = 0;
+
+  depth = compile_expression( program, exp );
+  program->stack = libspectrum_new( libspectrum_dword, depth );
+
+  exp->program = program;
+}
+
 libspectrum_dword
 debugger_expression_evaluate( debugger_expression *exp )
 {
+  if( exp->program ) return evaluate_program( exp->program );
+
   switch( exp->type ) {
 
   case DEBUGGER_EXPRESSION_TYPE_INTEGER:
@@ -353,6 +565,79 @@ debugger_expression_evaluate( debugger_expression *exp )
   fuse_abort();
 }
 
+static libspectrum_dword
+evaluate_program( expression_program *program )
+{
+  const program_instruction *code = program->code;
+  libspectrum_dword *sp = program->stack;
+  size_t pc;
+
+  /* 'sp' points at the next free stack entry */
+  for( pc = 0; pc < program->length; pc++ ) {
+
+    switch( code[ pc ].opcode ) {
+
+    case PROGRAM_INTEGER: *sp++ = code[ pc ].types.integer; break;
+    case PROGRAM_SYSVAR: *sp++ = code[ pc ].types.get(); break;
+    case PROGRAM_VARIABLE:
+      *sp++ = debugger_variable_get( code[ pc ].types.variable ); break;
+
+    case PROGRAM_LOGICAL_NOT: sp[-1] = !sp[-1]; break;
+    case PROGRAM_BITWISE_NOT: sp[-1] = ~sp[-1]; break;
+    case PROGRAM_NEGATE: sp[-1] = -sp[-1]; break;
+    case PROGRAM_DEREFERENCE: sp[-1] = readbyte_internal( sp[-1] ); break;
+
+    case PROGRAM_ADD: sp--; sp[-1] += sp[0]; break;
+    case PROGRAM_SUBTRACT: sp--; sp[-1] -= sp[0]; break;
+    case PROGRAM_MULTIPLY: sp--; sp[-1] *= sp[0]; break;
+
+    case PROGRAM_DIVIDE:
+      sp--;
+      if( sp[0] == 0 ) {
+        ui_error( UI_ERROR_ERROR, "divide by 0" );
+        sp[-1] = 0;
+      } else {
+        sp[-1] /= sp[0];
+      }
+      break;
+
+    case PROGRAM_EQUAL_TO: sp--; sp[-1] = sp[-1] == sp[0]; break;
+    case PROGRAM_NOT_EQUAL_TO: sp--; sp[-1] = sp[-1] != sp[0]; break;
+    case PROGRAM_GREATER_THAN: sp--; sp[-1] = sp[-1] > sp[0]; break;
+    case PROGRAM_LESS_THAN: sp--; sp[-1] = sp[-1] < sp[0]; break;
+    case PROGRAM_LESS_THAN_OR_EQUAL_TO: sp--; sp[-1] = sp[-1] <= sp[0]; break;
+    case PROGRAM_GREATER_THAN_OR_EQUAL_TO:
+      sp--; sp[-1] = sp[-1] >= sp[0]; break;
+
+    case PROGRAM_BITWISE_AND: sp--; sp[-1] &= sp[0]; break;
+    case PROGRAM_BITWISE_XOR: sp--; sp[-1] ^= sp[0]; break;
+    case PROGRAM_BITWISE_OR: sp--; sp[-1] |= sp[0]; break;
+
+    case PROGRAM_LOGICAL_AND:
+      if( !sp[-1] ) {
+        pc = code[ pc ].types.target - 1;
+      } else {
+        sp--;
+      }
+      break;
+
+    case PROGRAM_LOGICAL_OR:
+      if( sp[-1] ) {
+        sp[-1] = 1; pc = code[ pc ].types.target - 1;
+      } else {
+        sp--;
+      }
+      break;
+
+    case PROGRAM_TRUTH_VALUE: sp[-1] = !!sp[-1]; break;
+
+    }
+
+  }
+
+  return program->stack[0];
+}
+
 static libspectrum_dword
 evaluate_unaryop( struct unaryop_type *unary )
 {
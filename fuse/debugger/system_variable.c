@@ -108,6 +108,13 @@ debugger_system_variable_get( int system_variable )
   return sysvar.get();
 }
 
+debugger_get_system_variable_fn_t
+debugger_system_variable_get_fn( int system_variable )
+{
+  return g_array_index( system_variables, system_variable_t,
+                        system_variable ).get;
+}
+
 void
 debugger_system_variable_set( const char *type, const char *detail,
                               libspectrum_dword value )
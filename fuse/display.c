@@ -100,6 +100,9 @@ static libspectrum_qword display_all_dirty;
 /* Used to signify that we're redrawing the entire screen */
 static int display_redraw_all;
 
+/* The buffer we're drawing directly into, if pixels is non-NULL */
+static display_framebuffer framebuffer;
+
 /* Value used to signify a border line has more than one colour on it. */
 static const int display_border_mixed = 0xff;
 
@@ -323,32 +326,48 @@ display_get_attr_byte( int x, int y )
   return attr;
 }
 
+/* The number of trailing zero bits in a non-zero word */
+static inline int
+count_trailing_zeros( libspectrum_qword bits )
+{
+#ifdef __GNUC__
+  return __builtin_ctzll( bits );
+#else				/* #ifdef __GNUC__ */
+  int count = 0;
+
+  while( !( bits & 0x01 ) ) { bits >>= 1; count++; }
+
+  return count;
+#endif				/* #ifdef __GNUC__ */
+}
+
 static void
 update_dirty_rects( void )
 {
-  int start, y;
+  int y;
 
   for( y=0; y<DISPLAY_SCREEN_HEIGHT; y++ ) {
-    int x = 0;
-    while( display_is_dirty[y] ) {
+    libspectrum_qword dirty = display_is_dirty[y];
+    int x = 0, length;
 
-      /* Find the first dirty chunk on this row */
-      while( !( display_is_dirty[y] & 0x01 ) ) {
-        display_is_dirty[y] >>= 1;
-        x++;
-      }
+    /* Each row has fewer than 64 columns, so the top bit is always clear
+       and every run of dirty chunks ends before the end of the word */
+    while( dirty ) {
 
-      start = x;
+      /* Skip to the first dirty chunk on this row */
+      length = count_trailing_zeros( dirty );
+      dirty >>= length; x += length;
 
-      /* Walk to the end of the dirty region */
-      do {
-        display_is_dirty[y] >>= 1;
-        x++;
-      } while( display_is_dirty[y] & 0x01 );
+      /* And find the end of the dirty region */
+      length = count_trailing_zeros( ~dirty );
+      dirty >>= length;
 
-      rectangle_add( y, start, x - start );
+      rectangle_add( y, x, length );
+      x += length;
     }
 
+    display_is_dirty[y] = 0;
+
     /* compress the active rectangles list */
     rectangle_end_line( y );
   }
@@ -357,6 +376,73 @@ update_dirty_rects( void )
   rectangle_end_line( DISPLAY_SCREEN_HEIGHT );
 }
 
+/* Draw the pixels in the low bits bits of data to the framebuffer,
+   starting at pixel x on line y; each pixel is drawn repeat times */
+static inline void
+framebuffer_plot( int x, int y, libspectrum_word data, int bits, int repeat,
+                  libspectrum_byte ink, libspectrum_byte paper )
+{
+  libspectrum_byte *line =
+    (libspectrum_byte*)framebuffer.pixels + y * framebuffer.pitch;
+  int i, j;
+
+  if( framebuffer.format == DISPLAY_FRAMEBUFFER_INDEXED ) {
+    libspectrum_byte *dest = line + x;
+
+    for( i = bits - 1; i >= 0; i-- ) {
+      libspectrum_byte colour = ( data >> i ) & 0x01 ? ink : paper;
+      for( j = 0; j < repeat; j++ ) *dest++ = colour;
+    }
+  } else {
+    libspectrum_dword *dest = (libspectrum_dword*)line + x;
+    libspectrum_dword pi = framebuffer.palette[ ink ],
+                      pp = framebuffer.palette[ paper ];
+
+    for( i = bits - 1; i >= 0; i-- ) {
+      libspectrum_dword colour = ( data >> i ) & 0x01 ? pi : pp;
+      for( j = 0; j < repeat; j++ ) *dest++ = colour;
+    }
+  }
+}
+
+/* Draw 8 pixels at ( 8*x, y ), either to the framebuffer, the UI or both */
+static inline void
+display_plot8( int x, int y, libspectrum_byte data, libspectrum_byte ink,
+               libspectrum_byte paper )
+{
+  if( framebuffer.pixels ) {
+    framebuffer_plot( x << 4, y, data, 8, 2, ink, paper );
+    if( framebuffer.exclusive ) return;
+  }
+
+  uidisplay_plot8( x, y, data, ink, paper );
+}
+
+/* And the same for 16 high resolution pixels */
+static inline void
+display_plot16( int x, int y, libspectrum_word data, libspectrum_byte ink,
+                libspectrum_byte paper )
+{
+  if( framebuffer.pixels ) {
+    framebuffer_plot( x << 4, y, data, 16, 1, ink, paper );
+    if( framebuffer.exclusive ) return;
+  }
+
+  uidisplay_plot16( x, y, data, ink, paper );
+}
+
+/* And for a single low resolution pixel at ( x, y ) */
+static inline void
+display_putpixel( int x, int y, libspectrum_byte colour )
+{
+  if( framebuffer.pixels ) {
+    framebuffer_plot( x << 1, y, 0, 1, 2, colour, colour );
+    if( framebuffer.exclusive ) return;
+  }
+
+  uidisplay_putpixel( x, y, colour );
+}
+
 void
 display_write_if_dirty_timex( int x, int y )
 {
@@ -412,9 +498,9 @@ display_write_if_dirty_timex( int x, int y )
     display_get_attr( x, y, &ink, &paper );
     if( scld_last_dec.name.hires ) {
       libspectrum_word hires_data = (data << 8) + data2;
-      uidisplay_plot16( beam_x, beam_y, hires_data, ink, paper );
+      display_plot16( beam_x, beam_y, hires_data, ink, paper );
     } else {
-      uidisplay_plot8( beam_x, beam_y, data, ink, paper );
+      display_plot8( beam_x, beam_y, data, ink, paper );
     }
 
     /* Update last display record */
@@ -486,17 +572,17 @@ display_write_if_dirty_pentagon_16_col( int x, int y )
 
     int draw_x = beam_x << 3;
     pentagon_16c_get_colour( data1, &colour1, &colour2 );
-    uidisplay_putpixel( draw_x++, beam_y, colour1 );
-    uidisplay_putpixel( draw_x++, beam_y, colour2 );
+    display_putpixel( draw_x++, beam_y, colour1 );
+    display_putpixel( draw_x++, beam_y, colour2 );
     pentagon_16c_get_colour( data2, &colour1, &colour2 );
-    uidisplay_putpixel( draw_x++, beam_y, colour1 );
-    uidisplay_putpixel( draw_x++, beam_y, colour2 );
+    display_putpixel( draw_x++, beam_y, colour1 );
+    display_putpixel( draw_x++, beam_y, colour2 );
     pentagon_16c_get_colour( data3, &colour1, &colour2 );
-    uidisplay_putpixel( draw_x++, beam_y, colour1 );
-    uidisplay_putpixel( draw_x++, beam_y, colour2 );
+    display_putpixel( draw_x++, beam_y, colour1 );
+    display_putpixel( draw_x++, beam_y, colour2 );
     pentagon_16c_get_colour( data4, &colour1, &colour2 );
-    uidisplay_putpixel( draw_x++, beam_y, colour1 );
-    uidisplay_putpixel( draw_x  , beam_y, colour2 );
+    display_putpixel( draw_x++, beam_y, colour1 );
+    display_putpixel( draw_x  , beam_y, colour2 );
 
     /* Update last display record */
     display_last_screen[ index ] = last_chunk_detail;
@@ -531,7 +617,7 @@ display_write_if_dirty_sinclair( int x, int y )
   if( display_last_screen[ index ] != last_chunk_detail ) {
     libspectrum_byte ink, paper;
     display_parse_attr( data2, &ink, &paper );
-    uidisplay_plot8( beam_x, beam_y, data, ink, paper );
+    display_plot8( beam_x, beam_y, data, ink, paper );
 
     /* Update last display record */
     display_last_screen[ index ] = last_chunk_detail;
@@ -785,7 +871,7 @@ set_border( int y, int start, int end, int colour )
     /* Draw it if it is different to what was there last time - we know that
     data and mode will have been the same */
     if( display_last_screen[ index ] != chunk_detail ) {
-      uidisplay_plot8( start, y, 0x00, 0, colour );
+      display_plot8( start, y, 0x00, 0, colour );
 
       /* Update last display record */
       display_last_screen[ index ] = chunk_detail;
@@ -903,6 +989,10 @@ update_ui_screen( void )
       movie_start_frame();
     }
 
+    if( framebuffer.pixels && framebuffer.frame_end )
+      framebuffer.frame_end( rectangle_inactive, rectangle_inactive_count,
+                             display_redraw_all );
+
     if( display_redraw_all ) {
       if( movie_recording ) {
         movie_add_area( 0, 0, DISPLAY_ASPECT_WIDTH >> 3,
@@ -1032,6 +1122,18 @@ void display_refresh_all(void)
           * sizeof(libspectrum_dword) );
 }
 
+void
+display_framebuffer_set( const display_framebuffer *new_framebuffer )
+{
+  if( new_framebuffer ) {
+    framebuffer = *new_framebuffer;
+  } else {
+    framebuffer.pixels = NULL;
+  }
+
+  display_refresh_all();
+}
+
 /* Fetch pixel (x, y). On a Timex this will be a point on a 640x480 canvas,
    on a Sinclair/Amstrad/Russian clone this will be a point on a 320x240
    canvas */
@@ -125,4 +125,47 @@ int display_getpixel( int x, int y );
 
 void display_update_critical( int x, int y );
 
+/* A buffer the core draws the screen into directly as it is emulated, for
+   a UI which can display it without keeping its own copy (an SDL texture,
+   say) or for sharing with another process. The image is always
+   DISPLAY_SCREEN_WIDTH x DISPLAY_SCREEN_HEIGHT pixels; each low resolution
+   pixel is drawn twice across, so Timex high resolution modes fit
+   without any rescaling */
+
+typedef enum display_framebuffer_format {
+
+  /* One byte per pixel, holding the Spectrum colour 0-15 */
+  DISPLAY_FRAMEBUFFER_INDEXED,
+
+  /* One libspectrum_dword per pixel, taken from the palette */
+  DISPLAY_FRAMEBUFFER_RGB32,
+
+} display_framebuffer_format;
+
+struct rectangle;
+
+/* Called at the end of each frame which is sent to the UI with the
+   rectangles (in 8x1 pixel chunks of the low resolution screen) which have
+   changed, or with all set if the whole screen has */
+typedef void (*display_framebuffer_frame_fn)( const struct rectangle *rects,
+                                              size_t count, int all );
+
+typedef struct display_framebuffer {
+
+  void *pixels;			/* The top left pixel of the image */
+  ptrdiff_t pitch;		/* Bytes from the start of one line to the
+				   start of the next */
+  display_framebuffer_format format;
+  libspectrum_dword palette[ 16 ]; /* Used only for DISPLAY_FRAMEBUFFER_RGB32 */
+
+  int exclusive;		/* If set, the uidisplay_plot*() functions
+				   aren't called as well */
+  display_framebuffer_frame_fn frame_end; /* May be NULL */
+
+} display_framebuffer;
+
+/* Start drawing into framebuffer, or stop if it is NULL. The whole screen
+   is redrawn at the end of the next frame */
+void display_framebuffer_set( const display_framebuffer *framebuffer );
+
 #endif			/* #ifndef FUSE_DISPLAY_H */
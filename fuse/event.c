@@ -25,6 +25,7 @@
 
 #include <config.h>
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <libspectrum.h>
@@ -41,11 +42,48 @@ static const libspectrum_dword event_no_events = 0xffffffff;
 /* When will the next event happen? */
 libspectrum_dword event_next_event;
 
-/* The actual list of events */
-static GSList *event_list = NULL;
+/* An entry in the event pool */
+typedef struct event_entry_t {
 
-/* An event ready to be reused */
-static event_t *event_free = NULL;
+  event_t event;
+
+  /* The type the event was scheduled with; unlike event.type, this is not
+     changed when the event is removed, so the heap ordering stays valid */
+  int key_type;
+
+  /* Used to order events with the same time and type: the most recently
+     added such event happens first, as it did with the old sorted list */
+  libspectrum_dword sequence;
+
+  /* Has the event been removed from the list of its type? */
+  int deleted;
+
+  /* Links in the list of live events of this type, or in the free list */
+  int type_prev, type_next;
+
+} event_entry_t;
+
+/* All events are stored in a pool which grows as needed; entries are
+   referred to by index so the pool can be reallocated */
+static event_entry_t *event_pool = NULL;
+static size_t event_pool_size = 0;
+
+/* The first unused entry in the pool, or -1 if the pool is full */
+static int event_pool_free = -1;
+
+#define EVENT_POOL_INITIAL_SIZE 64
+
+/* A binary min-heap of indexes into the pool; the next event to happen
+   is always at the top */
+static int *event_heap = NULL;
+static size_t event_heap_count = 0;
+
+/* The first live event of each type, or -1 if none */
+static int *event_type_head = NULL;
+static size_t event_type_head_size = 0;
+
+/* Incremented each time an event is added */
+static libspectrum_dword event_sequence = 0;
 
 /* A null event */
 int event_type_null;
@@ -79,93 +117,202 @@ event_register( event_fn_t fn, const char *description )
 
   g_array_append_val( registered_events, descriptor );
 
+  if( registered_events->len > event_type_head_size ) {
+    size_t i, new_size = event_type_head_size ? 2 * event_type_head_size : 32;
+
+    event_type_head = libspectrum_renew( int, event_type_head, new_size );
+    for( i = event_type_head_size; i < new_size; i++ )
+      event_type_head[i] = -1;
+    event_type_head_size = new_size;
+  }
+
   return registered_events->len - 1;
 }
 
-static gint
-event_add_cmp( gconstpointer a1, gconstpointer b1 )
+/* Does event a happen before event b? Events are ordered by time, then by
+   type and then most recently added first */
+static inline int
+event_before( const event_entry_t *a, const event_entry_t *b )
 {
-  const event_t *a = a1, *b = b1;
+  if( a->event.tstates != b->event.tstates )
+    return a->event.tstates < b->event.tstates;
+
+  if( a->key_type != b->key_type ) return a->key_type < b->key_type;
 
-  return a->tstates != b->tstates ? a->tstates - b->tstates
-		                  : a->type - b->type;
+  return (libspectrum_signed_dword)( a->sequence - b->sequence ) > 0;
 }
 
-/* Add an event at the correct place in the event list */
-void
-event_add_with_data( libspectrum_dword event_time, int type, void *user_data )
+static void
+event_pool_grow( void )
 {
-  event_t *ptr;
+  size_t i, new_size;
 
-  if( event_free ) {
-    ptr = event_free;
-    event_free = NULL;
-  } else {
-    ptr = libspectrum_new( event_t, 1 );
+  new_size = event_pool_size ? 2 * event_pool_size : EVENT_POOL_INITIAL_SIZE;
+
+  event_pool = libspectrum_renew( event_entry_t, event_pool, new_size );
+  event_heap = libspectrum_renew( int, event_heap, new_size );
+
+  for( i = event_pool_size; i < new_size; i++ )
+    event_pool[i].type_next = i + 1 < new_size ? (int)i + 1 : -1;
+  event_pool_free = event_pool_size;
+
+  event_pool_size = new_size;
+}
+
+static void
+event_heap_sift_up( size_t position )
+{
+  int index = event_heap[ position ];
+
+  while( position ) {
+    size_t parent = ( position - 1 ) / 2;
+    if( !event_before( &event_pool[ index ],
+                       &event_pool[ event_heap[ parent ] ] ) ) break;
+    event_heap[ position ] = event_heap[ parent ];
+    position = parent;
+  }
+
+  event_heap[ position ] = index;
+}
+
+static void
+event_heap_sift_down( size_t position )
+{
+  int index = event_heap[ position ];
+
+  while( 1 ) {
+    size_t child = 2 * position + 1;
+    if( child >= event_heap_count ) break;
+    if( child + 1 < event_heap_count &&
+        event_before( &event_pool[ event_heap[ child + 1 ] ],
+                      &event_pool[ event_heap[ child ] ] ) )
+      child++;
+    if( !event_before( &event_pool[ event_heap[ child ] ],
+                       &event_pool[ index ] ) ) break;
+    event_heap[ position ] = event_heap[ child ];
+    position = child;
   }
 
-  ptr->tstates = event_time;
-  ptr->type =type;
-  ptr->user_data = user_data;
+  event_heap[ position ] = index;
+}
+
+static void
+event_type_link( int index )
+{
+  event_entry_t *entry = &event_pool[ index ];
+  int type = entry->key_type;
+
+  entry->type_prev = -1;
+  entry->type_next = event_type_head[ type ];
+  if( entry->type_next != -1 ) event_pool[ entry->type_next ].type_prev = index;
+  event_type_head[ type ] = index;
+}
 
-  if( event_time < event_next_event ) {
-    event_next_event = event_time;
-    event_list = g_slist_prepend( event_list, ptr );
+static void
+event_type_unlink( int index )
+{
+  event_entry_t *entry = &event_pool[ index ];
+
+  if( entry->type_prev != -1 ) {
+    event_pool[ entry->type_prev ].type_next = entry->type_next;
   } else {
-    event_list = g_slist_insert_sorted( event_list, ptr, event_add_cmp );
+    event_type_head[ entry->key_type ] = entry->type_next;
+  }
+
+  if( entry->type_next != -1 )
+    event_pool[ entry->type_next ].type_prev = entry->type_prev;
+}
+
+/* Mark an event as deleted; it stays in the heap until its time comes */
+static void
+event_set_null( int index )
+{
+  event_entry_t *entry = &event_pool[ index ];
+
+  if( !entry->deleted ) {
+    event_type_unlink( index );
+    entry->deleted = 1;
   }
+  entry->event.type = event_type_null;
+}
+
+static void
+event_update_next_event( void )
+{
+  event_next_event = event_heap_count ?
+    event_pool[ event_heap[0] ].event.tstates : event_no_events;
+}
+
+/* Add an event at the correct place in the event list */
+void
+event_add_with_data( libspectrum_dword event_time, int type, void *user_data )
+{
+  event_entry_t *entry;
+  int index;
+
+  if( event_pool_free == -1 ) event_pool_grow();
+
+  index = event_pool_free;
+  entry = &event_pool[ index ];
+  event_pool_free = entry->type_next;
+
+  entry->event.tstates = event_time;
+  entry->event.type = type;
+  entry->event.user_data = user_data;
+  entry->key_type = type;
+  entry->sequence = event_sequence++;
+  entry->deleted = 0;
+
+  event_type_link( index );
+
+  event_heap[ event_heap_count ] = index;
+  event_heap_sift_up( event_heap_count++ );
+
+  if( event_time < event_next_event ) event_next_event = event_time;
 }
 
 /* Do all events which have passed */
 int
 event_do_events( void )
 {
-  event_t *ptr;
-
   while(event_next_event <= tstates) {
     event_descriptor_t descriptor;
-    ptr = event_list->data;
+    event_t event;
+    int index = event_heap[0];
+
+    event = event_pool[ index ].event;
     descriptor =
-      g_array_index( registered_events, event_descriptor_t, ptr->type );
+      g_array_index( registered_events, event_descriptor_t, event.type );
+
+    /* Remove the event from the heap *before* processing */
+    if( !event_pool[ index ].deleted ) event_type_unlink( index );
 
-    /* Remove the event from the list *before* processing */
-    event_list = g_slist_remove( event_list, ptr );
+    event_heap[0] = event_heap[ --event_heap_count ];
+    if( event_heap_count ) event_heap_sift_down( 0 );
 
-    if( event_list == NULL ) {
-      event_next_event = event_no_events;
-    } else {
-      event_next_event = ((event_t*)(event_list->data))->tstates;
-    }
+    event_pool[ index ].type_next = event_pool_free;
+    event_pool_free = index;
 
-    if( descriptor.fn ) descriptor.fn( ptr->tstates, ptr->type, ptr->user_data );
+    event_update_next_event();
 
-    if( event_free ) {
-      libspectrum_free( ptr );
-    } else {
-      event_free = ptr;
-    }
+    if( descriptor.fn ) descriptor.fn( event.tstates, event.type,
+                                       event.user_data );
   }
 
   return 0;
 }
 
-static void
-event_reduce_tstates( gpointer data, gpointer user_data )
-{
-  event_t *ptr = data;
-  libspectrum_dword *tstates_per_frame = user_data;
-
-  ptr->tstates -= *tstates_per_frame;
-}
-
 /* Called at end of frame to reduce T-state count of all entries */
 void
 event_frame( libspectrum_dword tstates_per_frame )
 {
-  g_slist_foreach( event_list, event_reduce_tstates, &tstates_per_frame );
+  size_t i;
+
+  /* Every event moves by the same amount, so the heap order is unchanged */
+  for( i = 0; i < event_heap_count; i++ )
+    event_pool[ event_heap[i] ].event.tstates -= tstates_per_frame;
 
-  event_next_event = event_list ?
-    ((event_t*)(event_list->data))->tstates : event_no_events;
+  event_update_next_event();
 }
 
 /* Do all events that would happen between the current time and when
@@ -185,69 +332,89 @@ event_force_events( void )
   }
 }
 
-static void
-set_event_null( gpointer data, gpointer user_data )
-{
-  event_t *ptr = data;
-  int *type = user_data;
-
-  if( ptr->type == *type ) ptr->type = event_type_null;
-}
-
-static void
-set_event_null_with_user_data( gpointer data, gpointer user_data )
-{
-  event_t *event = data;
-  event_t *template = user_data;
-
-  if( event->type == template->type && event->user_data == template->user_data )
-    event->type = event_type_null;
-}
-
 /* Remove all events of a specific type from the stack */
 void
 event_remove_type( int type )
 {
-  g_slist_foreach( event_list, set_event_null, &type );
+  while( event_type_head[ type ] != -1 )
+    event_set_null( event_type_head[ type ] );
 }
 
 /* Remove all events of a specific type and user data from the stack */
 void
 event_remove_type_user_data( int type, gpointer user_data )
 {
-  event_t template;
+  int index = event_type_head[ type ];
 
-  template.type = type;
-  template.user_data = user_data;
-  g_slist_foreach( event_list, set_event_null_with_user_data, &template );
+  while( index != -1 ) {
+    int next = event_pool[ index ].type_next;
+    if( event_pool[ index ].event.user_data == user_data )
+      event_set_null( index );
+    index = next;
+  }
 }
 
-/* Free the memory used by a specific entry */
-static void
-event_free_entry( gpointer data, gpointer user_data GCC_UNUSED )
+/* Remove the first event of a specific type due at a specific time */
+void
+event_remove_type_tstates( int type, libspectrum_dword event_time )
 {
-  libspectrum_free( data );
+  int index, first = -1;
+
+  for( index = event_type_head[ type ]; index != -1;
+       index = event_pool[ index ].type_next ) {
+    if( event_pool[ index ].event.tstates == event_time &&
+        ( first == -1 ||
+          event_before( &event_pool[ index ], &event_pool[ first ] ) ) )
+      first = index;
+  }
+
+  if( first != -1 ) event_set_null( first );
 }
 
 /* Clear the event stack */
 void
 event_reset( void )
 {
-  g_slist_foreach( event_list, event_free_entry, NULL );
-  g_slist_free( event_list );
-  event_list = NULL;
+  size_t i;
+
+  for( i = 0; i < event_type_head_size; i++ ) event_type_head[i] = -1;
+
+  for( i = 0; i < event_pool_size; i++ )
+    event_pool[i].type_next = i + 1 < event_pool_size ? (int)i + 1 : -1;
+  event_pool_free = event_pool_size ? 0 : -1;
+
+  event_heap_count = 0;
 
   event_next_event = event_no_events;
+}
+
+static int
+event_foreach_cmp( const void *a1, const void *b1 )
+{
+  const event_entry_t *a = &event_pool[ *(const int*)a1 ],
+                      *b = &event_pool[ *(const int*)b1 ];
 
-  libspectrum_free( event_free );
-  event_free = NULL;
+  return event_before( a, b ) ? -1 : event_before( b, a ) ? 1 : 0;
 }
 
 /* Call a user-supplied function for every event in the current list */
 void
 event_foreach( GFunc function, gpointer user_data )
 {
-  g_slist_foreach( event_list, function, user_data );
+  int *sorted;
+  size_t i, count = event_heap_count;
+
+  if( !count ) return;
+
+  /* Present the events in the order they will happen */
+  sorted = libspectrum_new( int, count );
+  memcpy( sorted, event_heap, count * sizeof( *sorted ) );
+  qsort( sorted, count, sizeof( *sorted ), event_foreach_cmp );
+
+  for( i = 0; i < count; i++ )
+    function( &event_pool[ sorted[i] ].event, user_data );
+
+  libspectrum_free( sorted );
 }
 
 /* A textual representation of each event type */
@@ -272,6 +439,10 @@ registered_events_free( void )
 
   g_array_free( registered_events, TRUE );
   registered_events = NULL;
+
+  libspectrum_free( event_type_head );
+  event_type_head = NULL;
+  event_type_head_size = 0;
 }
 
 /* Tidy-up function called at end of emulation */
@@ -280,6 +451,13 @@ event_end( void )
 {
   event_reset();
   registered_events_free();
+
+  libspectrum_free( event_pool );
+  event_pool = NULL;
+  libspectrum_free( event_heap );
+  event_heap = NULL;
+  event_pool_size = 0;
+  event_pool_free = -1;
 }
 
 void
@@ -76,6 +76,9 @@ void event_remove_type( int type );
 /* Remove all events of a specific type and user data from the stack */
 void event_remove_type_user_data( int type, gpointer user_data );
 
+/* Remove the first event of a specific type due at a specific time */
+void event_remove_type_tstates( int type, libspectrum_dword event_time );
+
 /* Clear the event stack */
 void event_reset( void );
 
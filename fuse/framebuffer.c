@@ -0,0 +1,206 @@
+/* framebuffer.c: Share the emulated screen with other processes
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif				/* #ifdef HAVE_SYS_MMAN_H */
+
+#include <libspectrum.h>
+
+#include "display.h"
+#include "framebuffer.h"
+#include "fuse.h"
+#include "infrastructure/startup_manager.h"
+#include "rectangle.h"
+#include "settings.h"
+#include "ui/ui.h"
+
+/* The core draws into a private copy of the screen as it emulates each
+   frame; at the end of the frame the parts which have changed are copied
+   into the shared file, so other processes only ever see complete frames */
+
+#define IMAGE_PITCH DISPLAY_SCREEN_WIDTH
+#define IMAGE_SIZE ( IMAGE_PITCH * DISPLAY_SCREEN_HEIGHT )
+
+/* Leave room for the header to grow */
+#define IMAGE_OFFSET 64
+
+#ifdef HAVE_SYS_MMAN_H
+
+static int fd = -1;
+static libspectrum_byte *shared = NULL;
+static size_t shared_size;
+
+static libspectrum_byte *image = NULL;
+
+static void
+write_barrier( void )
+{
+#ifdef __GNUC__
+  __sync_synchronize();
+#endif				/* #ifdef __GNUC__ */
+}
+
+static void
+copy_area( libspectrum_byte *dest, int x, int y, int w, int h )
+{
+  size_t offset = y * IMAGE_PITCH + x;
+
+  for( ; h > 0; h--, offset += IMAGE_PITCH )
+    memcpy( dest + offset, image + offset, w );
+}
+
+static void
+frame_end( const struct rectangle *rects, size_t count, int all )
+{
+  framebuffer_header *header = (framebuffer_header*)shared;
+  volatile libspectrum_dword *sequence = &header->sequence;
+  libspectrum_byte *dest = shared + IMAGE_OFFSET;
+  size_t i;
+
+  ( *sequence )++;
+  write_barrier();
+
+  if( all ) {
+    memcpy( dest, image, IMAGE_SIZE );
+  } else {
+    /* Rectangles are in 8 pixel chunks of the low resolution screen */
+    for( i = 0; i < count; i++ )
+      copy_area( dest, 16 * rects[i].x, rects[i].y, 16 * rects[i].w,
+                 rects[i].h );
+  }
+
+  header->frame++;
+
+  write_barrier();
+  ( *sequence )++;
+}
+
+static void
+framebuffer_end( void )
+{
+  if( !shared ) return;
+
+  display_framebuffer_set( NULL );
+
+  munmap( shared, shared_size ); shared = NULL;
+  close( fd ); fd = -1;
+  libspectrum_free( image ); image = NULL;
+}
+
+static int
+framebuffer_init( void *context GCC_UNUSED )
+{
+  const char *filename = settings_current.framebuffer_file;
+  framebuffer_header *header;
+  display_framebuffer framebuffer;
+
+  if( !filename ) return 0;
+
+  fd = open( filename, O_RDWR | O_CREAT, 0644 );
+  if( fd == -1 ) {
+    ui_error( UI_ERROR_ERROR, "couldn't open '%s': %s", filename,
+              strerror( errno ) );
+    return 1;
+  }
+
+  shared_size = IMAGE_OFFSET + IMAGE_SIZE;
+
+  if( ftruncate( fd, shared_size ) ) {
+    ui_error( UI_ERROR_ERROR, "couldn't resize '%s': %s", filename,
+              strerror( errno ) );
+    close( fd ); fd = -1;
+    return 1;
+  }
+
+  shared = mmap( NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 0 );
+  if( shared == MAP_FAILED ) {
+    ui_error( UI_ERROR_ERROR, "couldn't map '%s': %s", filename,
+              strerror( errno ) );
+    shared = NULL;
+    close( fd ); fd = -1;
+    return 1;
+  }
+
+  memset( shared, 0, shared_size );
+
+  header = (framebuffer_header*)shared;
+  memcpy( header->magic, FRAMEBUFFER_MAGIC, sizeof( header->magic ) );
+  header->width = DISPLAY_SCREEN_WIDTH;
+  header->height = DISPLAY_SCREEN_HEIGHT;
+  header->pitch = IMAGE_PITCH;
+  header->offset = IMAGE_OFFSET;
+
+  image = libspectrum_new0( libspectrum_byte, IMAGE_SIZE );
+
+  memset( &framebuffer, 0, sizeof( framebuffer ) );
+  framebuffer.pixels = image;
+  framebuffer.pitch = IMAGE_PITCH;
+  framebuffer.format = DISPLAY_FRAMEBUFFER_INDEXED;
+  framebuffer.frame_end = frame_end;
+
+  display_framebuffer_set( &framebuffer );
+
+  return 0;
+}
+
+#else				/* #ifdef HAVE_SYS_MMAN_H */
+
+static void
+framebuffer_end( void )
+{
+}
+
+static int
+framebuffer_init( void *context GCC_UNUSED )
+{
+  if( !settings_current.framebuffer_file ) return 0;
+
+  ui_error( UI_ERROR_ERROR,
+            "sharing the screen is not supported on this platform" );
+  return 1;
+}
+
+#endif				/* #ifdef HAVE_SYS_MMAN_H */
+
+void
+framebuffer_register_startup( void )
+{
+  startup_manager_module dependencies[] = {
+    STARTUP_MANAGER_MODULE_DISPLAY,
+    STARTUP_MANAGER_MODULE_SETUID,
+  };
+  startup_manager_register( STARTUP_MANAGER_MODULE_FRAMEBUFFER, dependencies,
+                            ARRAY_SIZE( dependencies ), framebuffer_init, NULL,
+                            framebuffer_end );
+}
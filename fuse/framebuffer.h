@@ -0,0 +1,56 @@
+/* framebuffer.h: Share the emulated screen with other processes
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#ifndef FUSE_FRAMEBUFFER_H
+#define FUSE_FRAMEBUFFER_H
+
+#include <libspectrum.h>
+
+/* The start of the file given by --framebuffer-file. All fields are in
+   the machine's native byte order */
+
+#define FRAMEBUFFER_MAGIC "FuseFB1"
+
+typedef struct framebuffer_header {
+
+  char magic[8];		/* FRAMEBUFFER_MAGIC, including the NUL */
+
+  libspectrum_dword width;	/* In pixels */
+  libspectrum_dword height;
+  libspectrum_dword pitch;	/* Bytes from one line to the next */
+  libspectrum_dword offset;	/* Bytes from the start of the file to the
+				   top left pixel */
+
+  /* Odd while Fuse is copying a frame into the image; a reader should
+     wait for it to be even, copy the image and check it hasn't changed */
+  libspectrum_dword sequence;
+
+  libspectrum_dword frame;	/* The number of frames written */
+
+} framebuffer_header;
+
+void framebuffer_register_startup( void );
+
+#endif			/* #ifndef FUSE_FRAMEBUFFER_H */
@@ -55,9 +55,11 @@
 #include <libxml/encoding.h>
 #endif
 
+#include "batch.h"
 #include "debugger/debugger.h"
 #include "display.h"
 #include "event.h"
+#include "framebuffer.h"
 #include "fuse.h"
 #include "infrastructure/startup_manager.h"
 #include "keyboard.h"
@@ -91,6 +93,7 @@
 #include "pokefinder/pokemem.h"
 #include "profile.h"
 #include "psg.h"
+#include "rewind.h"
 #include "rzx.h"
 #include "settings.h"
 #include "slt.h"
@@ -104,6 +107,7 @@
 #include "ui/uimedia.h"
 #include "unittests/unittests.h"
 #include "utils.h"
+#include "writeback.h"
 
 #include "z80/z80.h"
 
@@ -190,6 +194,8 @@ int main(int argc, char **argv)
 
   if( settings_current.unittests ) {
     r = unittests_run();
+  } else if( settings_current.batch_jobs ) {
+    r = batch_run_jobs();
   } else {
     while( !fuse_exiting ) {
       z80_do_opcodes();
@@ -299,6 +305,7 @@ run_startup_manager( int *argc, char ***argv )
   divide_register_startup();
   event_register_startup();
   fdd_register_startup();
+  framebuffer_register_startup();
   fuller_register_startup();
   if1_register_startup();
   if2_register_startup();
@@ -315,6 +322,7 @@ run_startup_manager( int *argc, char ***argv )
   printer_register_startup();
   profile_register_startup();
   psg_register_startup();
+  rewind_register_startup();
   rzx_register_startup();
   scld_register_startup();
   settings_register_startup();
@@ -330,6 +338,7 @@ run_startup_manager( int *argc, char ***argv )
   timer_register_startup();
   ula_register_startup();
   usource_register_startup();
+  writeback_register_startup();
   z80_register_startup();
   zxatasp_register_startup();
   zxcf_register_startup();
@@ -397,6 +406,8 @@ static int fuse_init(int argc, char **argv)
   /* Must do this after all subsytems are initialised */
   debugger_command_evaluate( settings_current.debugger_command );
 
+  if( settings_current.batch_profile ) profile_start();
+
   if( ui_mouse_present ) ui_mouse_grabbed = ui_mouse_grab( 1 );
 
   fuse_emulation_paused = 0;
@@ -933,6 +944,7 @@ static int fuse_end(void)
   fuse_keyboard_end();
   fuse_joystick_end();
   ui_end();
+  scaler_end();
   ui_media_drive_end();
   module_end();
   pokemem_end();
@@ -39,6 +39,7 @@ typedef enum startup_manager_module {
   STARTUP_MANAGER_MODULE_DIVIDE,
   STARTUP_MANAGER_MODULE_EVENT,
   STARTUP_MANAGER_MODULE_FDD,
+  STARTUP_MANAGER_MODULE_FRAMEBUFFER,
   STARTUP_MANAGER_MODULE_FULLER,
   STARTUP_MANAGER_MODULE_IF1,
   STARTUP_MANAGER_MODULE_IF2,
@@ -55,6 +56,7 @@ typedef enum startup_manager_module {
   STARTUP_MANAGER_MODULE_PRINTER,
   STARTUP_MANAGER_MODULE_PROFILE,
   STARTUP_MANAGER_MODULE_PSG,
+  STARTUP_MANAGER_MODULE_REWIND,
   STARTUP_MANAGER_MODULE_RZX,
   STARTUP_MANAGER_MODULE_SCLD,
   STARTUP_MANAGER_MODULE_SETTINGS_END,
@@ -70,6 +72,7 @@ typedef enum startup_manager_module {
   STARTUP_MANAGER_MODULE_TIMER,
   STARTUP_MANAGER_MODULE_ULA,
   STARTUP_MANAGER_MODULE_USOURCE,
+  STARTUP_MANAGER_MODULE_WRITEBACK,
   STARTUP_MANAGER_MODULE_Z80,
   STARTUP_MANAGER_MODULE_ZXATASP,
   STARTUP_MANAGER_MODULE_ZXCF,
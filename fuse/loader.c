@@ -25,6 +25,7 @@
 
 #include <config.h>
 
+#include "compat.h"
 #include "event.h"
 #include "loader.h"
 #include "memory.h"
@@ -32,6 +33,7 @@
 #include "spectrum.h"
 #include "tape.h"
 #include "z80/z80.h"
+#include "z80/z80_macros.h"
 
 static int successive_reads = 0;
 static libspectrum_signed_dword last_tstates_read = -100000;
@@ -48,6 +50,80 @@ typedef enum acceleration_mode_t {
 static acceleration_mode_t acceleration_mode;
 static size_t acceleration_pc;
 
+/* Loaders whose byte loop is recognised, so that a whole block can be
+   loaded at once rather than edge by edge. `code' is the loop, with -1
+   matching any byte; how the loop is found, how its timings are worked
+   out and how it is left afterwards is up to each loader's `decode'
+   routine, which returns 0 if it loaded the block */
+typedef struct loader_signature loader_signature;
+
+typedef int (*loader_decode_fn)( const loader_signature *signature );
+
+struct loader_signature {
+  const char *name;
+  const int *code;
+  size_t length;
+  loader_decode_fn decode;
+  const void *layout;	/* Anything else decode needs about the code */
+};
+
+/* For copies of the ROM loader, the offsets into `code' of the bytes
+   decode_rom_loader() needs */
+typedef struct rom_loader_layout {
+  size_t bits;		/* The CALL of the edge routine for each bit */
+  size_t threshold;	/* The constant B is compared with */
+  size_t timing;	/* The constant B is reset to for each bit */
+  size_t reject;	/* The RET NZ taken if the flag byte is wrong */
+  size_t exit;		/* Where A and F are set from the parity */
+} rom_loader_layout;
+
+static int decode_rom_loader( const loader_signature *signature );
+
+/* LD-LOOP to the end of LD-BYTES from the 48K ROM; many turbo loaders
+   are copies of this with their own timings */
+static const int rom_loader_code[] = {
+  0x08, 0x20,   -1, 0x30,   -1, 0xdd, 0x75, 0x00, 0x18,   -1, /* LD-LOOP */
+  0xcb, 0x11, 0xad, 0xc0, 0x79, 0x1f, 0x4f, 0x13, 0x18,   -1, /* LD-FLAG */
+  0xdd, 0x7e, 0x00, 0xad, 0xc0,				      /* LD-VERIFY */
+  0xdd, 0x23,						      /* LD-NEXT */
+  0x1b, 0x08, 0x06,   -1,				      /* LD-DEC */
+  0x2e, 0x01,						      /* LD-MARKER */
+  0xcd,   -1,   -1, 0xd0, 0x3e,   -1, 0xb8, 0xcb, 0x15, 0x06, /* LD-8-BITS */
+    -1, 0xd2,   -1,   -1,
+  0x7c, 0xad, 0x67, 0x7a, 0xb3, 0x20,   -1,
+  0x7c, 0xfe, 0x01, 0xc9,
+};
+
+/* The same with a relative jump back to LD-8-BITS */
+static const int rom_loader_jr_code[] = {
+  0x08, 0x20,   -1, 0x30,   -1, 0xdd, 0x75, 0x00, 0x18,   -1,
+  0xcb, 0x11, 0xad, 0xc0, 0x79, 0x1f, 0x4f, 0x13, 0x18,   -1,
+  0xdd, 0x7e, 0x00, 0xad, 0xc0,
+  0xdd, 0x23,
+  0x1b, 0x08, 0x06,   -1,
+  0x2e, 0x01,
+  0xcd,   -1,   -1, 0xd0, 0x3e,   -1, 0xb8, 0xcb, 0x15, 0x06,
+    -1, 0x30,   -1,
+  0x7c, 0xad, 0x67, 0x7a, 0xb3, 0x20,   -1,
+  0x7c, 0xfe, 0x01, 0xc9,
+};
+
+static const rom_loader_layout rom_loader_offsets = { 33, 38, 43, 13, 54 };
+static const rom_loader_layout rom_loader_jr_offsets = { 33, 38, 43, 13, 53 };
+
+static const loader_signature loader_signatures[] = {
+  { "ROM", rom_loader_code, ARRAY_SIZE( rom_loader_code ),
+    decode_rom_loader, &rom_loader_offsets },
+  { "ROM (JR)", rom_loader_jr_code, ARRAY_SIZE( rom_loader_jr_code ),
+    decode_rom_loader, &rom_loader_jr_offsets },
+};
+
+/* LD-EDGE-2 and the delay at the start of LD-EDGE-1 */
+static const int edge_code[] = {
+  0xcd,   -1,   -1, 0xd0,		/* CALL LD-EDGE-1; RET NC */
+  0x3e,   -1, 0x3d, 0x20, 0xfd, 0xa7,	/* LD A,nn; DEC A; JR NZ,-3; AND A */
+};
+
 void
 loader_frame( libspectrum_dword frame_length )
 {
@@ -291,6 +367,113 @@ acceleration_detector( libspectrum_word pc )
 
 }      
 
+static int
+code_matches( libspectrum_word address, const int *code, size_t length )
+{
+  size_t i;
+
+  for( i = 0; i < length; i++ )
+    if( code[i] != -1 && readbyte_internal( address + i ) != code[i] )
+      return 0;
+
+  return 1;
+}
+
+static libspectrum_word
+read_word( libspectrum_word address )
+{
+  return readbyte_internal( address ) |
+         readbyte_internal( address + 1 ) << 8;
+}
+
+/* How long each pass round the edge detection loop takes */
+static int
+sample_loop_tstates( libspectrum_word sample )
+{
+  /* INC B; RET Z; LD A,nn; IN A,(nn); RRA then */
+  if( readbyte_internal( sample + 6 ) != 0x1f ) return 0;
+
+  switch( readbyte_internal( sample + 7 ) ) {
+  case 0xa9: return 54;			/* XOR C; AND nn; JR Z */
+  case 0x00: case 0xa7: return 58;	/* NOP or AND A first */
+  case 0xc8: case 0xd0: return 59;	/* RET Z or RET NC first */
+  default: return 0;
+  }
+}
+
+/* A copy of the ROM loader: the edge routine has been called from the
+   loop and is waiting for the first edge of the block's data */
+static int
+decode_rom_loader( const loader_signature *signature )
+{
+  const rom_loader_layout *layout = signature->layout;
+  libspectrum_word sample = z80.pc.w - 6, edge1 = sample - 6,
+    edge2 = edge1 - 4, bits, start;
+  libspectrum_dword threshold;
+  int loop_tstates, delay, counts;
+  libspectrum_byte timing;
+
+  /* Only at the start of a byte, while LD-EDGE-2 waits for its first edge */
+  if( z80.hl.b.l != 0x01 ) return 1;
+  if( read_word( z80.sp.w ) != edge2 + 3 ) return 1;
+
+  if( !code_matches( edge2, edge_code, ARRAY_SIZE( edge_code ) ) ||
+      read_word( edge2 + 1 ) != edge1 ) return 1;
+
+  loop_tstates = sample_loop_tstates( sample );
+  if( !loop_tstates ) return 1;
+
+  bits = read_word( z80.sp.w + 2 ) - 3;
+  start = bits - layout->bits;
+
+  if( !code_matches( start, signature->code, signature->length ) ||
+      read_word( bits + 1 ) != edge2 ) return 1;
+
+  timing = readbyte_internal( start + layout->timing );
+  counts = readbyte_internal( start + layout->threshold ) - timing + 1;
+  if( !timing || counts <= 0 ) return 1;
+
+  /* The length of a bit the loader reads as a 1: each edge has a delay
+     loop and the loader's other overheads, then B counts passes round
+     the sample loop */
+  delay = readbyte_internal( edge2 + 5 );
+  if( !delay ) delay = 256;
+  threshold = 184 + 32 * delay + counts * loop_tstates;
+
+  if( tape_load_block_data( threshold, timing ) ) return 1;
+
+  /* Return to the loader's own code as if the data had been read. After
+     a successful load it sets A and F from the parity in H; otherwise
+     leave through the RET NZ which rejects the flag byte */
+  z80.sp.w += 4;
+  if( z80.bc.b.h == timing ) {
+    z80.pc.w = start + layout->exit;
+  } else {
+    z80.af.b.l &= ~( FLAG_C | FLAG_Z );
+    z80.pc.w = start + layout->reject;
+  }
+
+  return 0;
+}
+
+/* If a recognised loader is waiting for the first edge of a block's data,
+   load the whole block and return 0 */
+static int
+load_block( void )
+{
+  size_t i;
+
+  for( i = 0; i < ARRAY_SIZE( loader_signatures ); i++ ) {
+    if( !loader_signatures[i].decode( &loader_signatures[i] ) ) {
+      successive_reads = 0;
+      length_known1 = 0;
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
 static void
 check_for_acceleration( void )
 {
@@ -305,6 +488,11 @@ check_for_acceleration( void )
     acceleration_pc = z80.pc.w;
   }
 
+  if( acceleration_mode == ACCELERATION_MODE_INCREASING && !load_block() ) {
+    acceleration_mode = ACCELERATION_MODE_NONE;
+    return;
+  }
+
   if( acceleration_mode ) do_acceleration();
 }
 
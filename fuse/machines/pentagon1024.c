@@ -136,6 +136,7 @@ pentagon1024_v22_memoryport_write( libspectrum_word port GCC_UNUSED,
     display_write_if_dirty = display_write_if_dirty_pentagon_16_col;
     display_dirty_flashing = display_dirty_flashing_pentagon_16_col;
     memory_display_dirty = memory_display_dirty_pentagon_16_col;
+    memory_screen_changed();
   } else {
     spec48_common_display_setup();
   }
@@ -151,6 +152,7 @@ static int pentagon1024_memory_map( void )
     display_update_critical( 0, 0 );
     display_refresh_main_screen();
     memory_current_screen = screen;
+    memory_screen_changed();
   }
 
   if( beta_active && !( machine_current->ram.last_byte & 0x10 ) ) {
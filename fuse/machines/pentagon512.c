@@ -121,6 +121,7 @@ pentagon_memory_map( void )
     display_update_critical( 0, 0 );
     display_refresh_main_screen();
     memory_current_screen = screen;
+    memory_screen_changed();
   }
 
   if( beta_active && !( machine_current->ram.last_byte & 0x10 ) ) {
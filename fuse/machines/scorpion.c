@@ -125,6 +125,7 @@ scorpion_memory_map( void )
     display_update_critical( 0, 0 );
     display_refresh_main_screen();
     memory_current_screen = screen;
+    memory_screen_changed();
   }
 
   if( machine_current->ram.last_byte2 & 0x02 ) {
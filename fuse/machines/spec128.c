@@ -103,6 +103,7 @@ spec128_common_reset( int contention )
 
   memory_current_screen = 5;
   memory_screen_mask = 0xffff;
+  memory_screen_changed();
 
   /* Odd pages contended on the 128K/+2; the loop is up to 16 to
      ensure all of the Scorpion's 256Kb RAM is not contended */
@@ -163,6 +164,7 @@ spec128_memory_map( void )
     display_update_critical( 0, 0 );
     display_refresh_main_screen();
     memory_current_screen = screen;
+    memory_screen_changed();
   }
 
   spec128_select_rom( rom );
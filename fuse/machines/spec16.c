@@ -113,6 +113,7 @@ spec16_reset( void )
 
   memory_current_screen = 5;
   memory_screen_mask = 0xffff;
+  memory_screen_changed();
 
   spec48_common_display_setup();
 
@@ -87,6 +87,7 @@ spec48_reset( void )
 
   memory_current_screen = 5;
   memory_screen_mask = 0xffff;
+  memory_screen_changed();
 
   spec48_common_display_setup();
 
@@ -101,6 +102,7 @@ spec48_common_display_setup( void )
   display_dirty_flashing = display_dirty_flashing_sinclair;
 
   memory_display_dirty = memory_display_dirty_sinclair;
+  memory_screen_changed();
 }
 
 int
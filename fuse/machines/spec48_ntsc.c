@@ -78,6 +78,7 @@ spec48_ntsc_reset( void )
 
   memory_current_screen = 5;
   memory_screen_mask = 0xffff;
+  memory_screen_changed();
 
   spec48_common_display_setup();
 
@@ -173,6 +173,7 @@ spec_se_reset( void )
 
   memory_current_screen = 5;
   memory_screen_mask = 0xdfff;
+  memory_screen_changed();
 
   /* Make sure SCLD and friends are enabled, calls memory_map() as a side
      effect so we need memory related variables etc. to be initialised */
@@ -236,6 +236,7 @@ specplus3_plus2a_common_reset( void )
 
   memory_current_screen = 5;
   memory_screen_mask = 0xffff;
+  memory_screen_changed();
 
   /* All memory comes from the home bank */
   for( i = 0; i < MEMORY_PAGES_IN_64K; i++ )
@@ -331,6 +332,7 @@ specplus3_memory_map( void )
     display_update_critical( 0, 0 );
     display_refresh_main_screen();
     memory_current_screen = screen;
+    memory_screen_changed();
   }
 
   /* Check whether we want a special RAM configuration */
@@ -192,6 +192,7 @@ tc2068_tc2048_common_reset( void )
 
   memory_current_screen = 5;
   memory_screen_mask = 0xdfff;
+  memory_screen_changed();
 
   scld_dec_write( 0x00ff, 0x00 );
   scld_hsr_write( 0x00f4, 0x00 );
@@ -222,4 +223,5 @@ tc2068_tc2048_common_display_setup( void )
   display_dirty_flashing = display_dirty_flashing_timex;
 
   memory_display_dirty = memory_display_dirty_sinclair;
+  memory_screen_changed();
 }
@@ -83,6 +83,15 @@ int memory_current_screen;
 /* Which bits to look at when working out where the screen is */
 libspectrum_word memory_screen_mask;
 
+libspectrum_byte memory_screen_chunks[ MEMORY_RAM_CHUNKS ];
+
+libspectrum_byte memory_ram_dirty[ MEMORY_RAM_CHUNKS ];
+
+/* Everything which wants to know about RAM writes */
+static GSList *ram_trackers;
+
+int memory_snapshot_ram = 1;
+
 static void memory_from_snapshot( libspectrum_snap *snap );
 static void memory_to_snapshot( libspectrum_snap *snap );
 
@@ -132,6 +141,7 @@ memory_init( void *context )
       page->offset = j * MEMORY_PAGE_SIZE;
       page->writable = 1;
       page->source = memory_source_ram;
+      page->ram_chunk = i * MEMORY_PAGES_IN_16K + j + 1;
     }
 
   module_register( &memory_module_info );
@@ -161,6 +171,9 @@ memory_end( void )
     pool = NULL;
   }
 
+  g_slist_free( ram_trackers );
+  ram_trackers = NULL;
+
   /* Free memory source types */
   if( memory_sources ) {
     for( i = 0; i < memory_sources->len; i++ ) {
@@ -445,6 +458,89 @@ memory_display_dirty_sinclair( libspectrum_word address, libspectrum_byte b ) \
 
 memory_display_dirty_fn memory_display_dirty;
 
+/* Mark the chunks of RAM page which can hold a screen, looking only at
+   the bits of the offset in mask */
+static void
+mark_screen_chunks( int page, libspectrum_word mask )
+{
+  int i;
+
+  if( page < 0 || page >= SPECTRUM_RAM_PAGES ) return;
+
+  for( i = 0; i < MEMORY_PAGES_IN_16K; i++ )
+    if( ( ( i * MEMORY_PAGE_SIZE ) & mask ) < 0x1b00 )
+      memory_screen_chunks[ page * MEMORY_PAGES_IN_16K + i + 1 ] = 1;
+}
+
+void
+memory_screen_changed( void )
+{
+  memset( memory_screen_chunks, 0, sizeof( memory_screen_chunks ) );
+
+  if( memory_display_dirty == memory_display_dirty_pentagon_16_col ) {
+    /* Both the standard and ALTDFILE areas of the screen page and the one
+       below it */
+    mark_screen_chunks( memory_current_screen, 0xdfff );
+    mark_screen_chunks( memory_current_screen - 1, 0xdfff );
+  } else {
+    mark_screen_chunks( memory_current_screen, memory_screen_mask );
+  }
+}
+
+void
+memory_ram_mark_dirty( int page )
+{
+  if( page < 0 ) {
+    memset( memory_ram_dirty, 1, sizeof( memory_ram_dirty ) );
+  } else if( page < SPECTRUM_RAM_PAGES ) {
+    memset( &memory_ram_dirty[ page * MEMORY_PAGES_IN_16K + 1 ], 1,
+            MEMORY_PAGES_IN_16K );
+  }
+}
+
+void
+memory_ram_track( memory_ram_tracker *tracker )
+{
+  memset( tracker->dirty, 1, sizeof( tracker->dirty ) );
+  ram_trackers = g_slist_append( ram_trackers, tracker );
+}
+
+void
+memory_ram_update_trackers( void )
+{
+  GSList *ptr;
+  size_t i;
+
+  for( i = 0; i < MEMORY_RAM_CHUNKS; i++ ) {
+    if( !memory_ram_dirty[i] ) continue;
+
+    for( ptr = ram_trackers; ptr; ptr = ptr->next )
+      ( (memory_ram_tracker*)ptr->data )->dirty[i] = 1;
+
+    memory_ram_dirty[i] = 0;
+  }
+}
+
+int
+memory_ram_page_dirty( memory_ram_tracker *tracker, int page )
+{
+  int i;
+
+  memory_ram_update_trackers();
+
+  for( i = 1; i <= MEMORY_PAGES_IN_16K; i++ )
+    if( tracker->dirty[ page * MEMORY_PAGES_IN_16K + i ] ) return 1;
+
+  return 0;
+}
+
+void
+memory_ram_clean( memory_ram_tracker *tracker )
+{
+  memory_ram_update_trackers();
+  memset( tracker->dirty, 0, sizeof( tracker->dirty ) );
+}
+
 void
 writebyte_internal( libspectrum_word address, libspectrum_byte b )
 {
@@ -470,12 +566,7 @@ writebyte_internal( libspectrum_word address, libspectrum_byte b )
   } else if( mapping->writable ||
              (mapping->source != memory_source_none &&
               settings_current.writable_roms) ) {
-    libspectrum_word offset = address & MEMORY_PAGE_SIZE_MASK;
-    libspectrum_byte *memory = mapping->page;
-
-    memory_display_dirty( address, b );
-
-    memory[ offset ] = b;
+    memory_write_page( mapping, address, b );
   }
 }
 
@@ -528,10 +619,12 @@ memory_from_snapshot( libspectrum_snap *snap )
       );
   }
 
-  for( i = 0; i < 64; i++ )
+  for( i = 0; i < MEMORY_SNAPSHOT_RAM_PAGES; i++ )
     if( libspectrum_snap_pages( snap, i ) )
       memcpy( RAM[i], libspectrum_snap_pages( snap, i ), 0x4000 );
 
+  memory_ram_mark_dirty( -1 );
+
   if( libspectrum_snap_custom_rom( snap ) ) {
     for( i = 0; i < libspectrum_snap_custom_rom_pages( snap ) && i < 4; i++ ) {
       if( libspectrum_snap_roms( snap, i ) ) {
@@ -574,6 +667,9 @@ memory_reset( void )
 
   for( i = 0; i < SPECTRUM_ROM_PAGES * MEMORY_PAGES_IN_16K; i++ )
     memory_map_rom[ i ].save_to_snapshot = 0;
+
+  /* Machine and peripheral resets may load anything into RAM */
+  memory_ram_mark_dirty( -1 );
 }
 
 static void
@@ -632,7 +728,7 @@ memory_to_snapshot( libspectrum_snap *snap )
   libspectrum_snap_set_out_plus3_memoryport( snap,
 					     machine_current->ram.last_byte2 );
 
-  for( i = 0; i < 64; i++ ) {
+  for( i = 0; i < MEMORY_SNAPSHOT_RAM_PAGES && memory_snapshot_ram; i++ ) {
     if( RAM[i] != NULL ) {
 
       buffer = libspectrum_new( libspectrum_byte, 0x4000 );
@@ -60,6 +60,10 @@ typedef struct memory_page {
   int page_num;			/* Which page from the source */
   libspectrum_word offset;	/* How far into the page this chunk starts */
 
+  int ram_chunk;		/* Which 2 KB chunk of Spectrum RAM this is,
+				   as an index into memory_screen_chunks and
+				   memory_ram_dirty; zero if it isn't RAM */
+
 } memory_page;
 
 /* A memory page will be 1 << (this many) bytes in size
@@ -105,6 +109,9 @@ extern memory_page memory_map_write[MEMORY_PAGES_IN_64K];
 /* The number of 16Kb RAM pages we support: 1040 Kb needed for the Pentagon 1024 */
 #define SPECTRUM_RAM_PAGES 65
 
+/* The number of 16Kb RAM pages copied to and from snapshots */
+#define MEMORY_SNAPSHOT_RAM_PAGES 64
+
 /* The maximum number of 16Kb ROMs we support */
 #define SPECTRUM_ROM_PAGES 4
 
@@ -117,6 +124,49 @@ extern int memory_current_screen;
 /* Which bits to look at when working out where the screen is */
 extern libspectrum_word memory_screen_mask;
 
+/* The number of entries in memory_screen_chunks and memory_ram_dirty */
+#define MEMORY_RAM_CHUNKS ( SPECTRUM_RAM_PAGES * MEMORY_PAGES_IN_16K + 1 )
+
+/* Non-zero for each 2 KB chunk of RAM which currently holds part of the
+   screen, indexed by memory_page.ram_chunk; writes anywhere else can't
+   change the display so needn't be checked */
+extern libspectrum_byte memory_screen_chunks[ MEMORY_RAM_CHUNKS ];
+
+/* Rebuild memory_screen_chunks; must be called whenever
+   memory_current_screen, memory_screen_mask or memory_display_dirty
+   changes */
+void memory_screen_changed( void );
+
+/* Non-zero for each 2 KB chunk of RAM which has been written to since
+   the trackers were last updated, indexed by memory_page.ram_chunk
+   like memory_screen_chunks */
+extern libspectrum_byte memory_ram_dirty[ MEMORY_RAM_CHUNKS ];
+
+/* Something which wants to know which RAM has changed since it last
+   looked; each tracker is cleaned independently of the others */
+typedef struct memory_ram_tracker {
+  libspectrum_byte dirty[ MEMORY_RAM_CHUNKS ];
+} memory_ram_tracker;
+
+/* Start passing changes to tracker, with all of RAM initially dirty */
+void memory_ram_track( memory_ram_tracker *tracker );
+
+/* Hand the chunks written to since the last update to every tracker */
+void memory_ram_update_trackers( void );
+
+/* Note that a 16 KB RAM page has been changed other than by a write to
+   the memory map, or every page if page is -1 */
+void memory_ram_mark_dirty( int page );
+
+/* Has a 16 KB RAM page changed since tracker was last cleaned? */
+int memory_ram_page_dirty( memory_ram_tracker *tracker, int page );
+
+void memory_ram_clean( memory_ram_tracker *tracker );
+
+/* Set to zero to leave RAM out of snapshots, for callers which store it
+   themselves */
+extern int memory_snapshot_ram;
+
 void memory_register_startup( void );
 libspectrum_byte *memory_pool_allocate( size_t length );
 libspectrum_byte *memory_pool_allocate_persistent( size_t length,
@@ -187,6 +237,20 @@ void memory_display_dirty_sinclair( libspectrum_word address,
 void memory_display_dirty_pentagon_16_col( libspectrum_word address,
                                            libspectrum_byte b );
 
+/* Store a byte to a writable page, keeping the display and
+   memory_ram_dirty up to date; shared by writebyte_internal() and the
+   core's own inline writes */
+static inline void
+memory_write_page( memory_page *mapping, libspectrum_word address,
+                   libspectrum_byte b )
+{
+  if( memory_screen_chunks[ mapping->ram_chunk ] )
+    memory_display_dirty( address, b );
+
+  memory_ram_dirty[ mapping->ram_chunk ] = 1;
+  mapping->page[ address & MEMORY_PAGE_SIZE_MASK ] = b;
+}
+
 typedef enum trap_type {
   CHECK_TAPE_ROM,
   CHECK_48K_ROM
@@ -52,6 +52,7 @@
 #include "peripherals/joystick.h"
 #include "profile.h"
 #include "psg.h"
+#include "rewind.h"
 #include "rzx.h"
 #include "screenshot.h"
 #include "settings.h"
@@ -312,6 +313,15 @@ MENU_CALLBACK( menu_options_save )
   settings_write_config( &settings_current );
 }
 
+MENU_CALLBACK( menu_machine_rewind )
+{
+  ui_widget_finish();
+
+  fuse_emulation_pause();
+  rewind_back( 1 );
+  fuse_emulation_unpause();
+}
+
 MENU_CALLBACK( menu_machine_profiler_start )
 {
   ui_widget_finish();
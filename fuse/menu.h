@@ -80,6 +80,7 @@ MENU_DETAIL( menu_filter_detail );
 MENU_CALLBACK( menu_options_fullscreen );
 MENU_CALLBACK( menu_options_save );
 
+MENU_CALLBACK( menu_machine_rewind );
 MENU_CALLBACK( menu_machine_profiler_start );
 MENU_CALLBACK( menu_machine_profiler_stop );
 MENU_CALLBACK( menu_machine_nmi );
@@ -26,6 +26,8 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include <libspectrum.h>
 
 #include "debugger/debugger.h"
@@ -65,6 +67,16 @@ typedef struct periph_port_private_t {
 /* The list of currently active ports */
 static GSList *ports = NULL;
 
+/* The active ports compiled into a per-port dispatch table:
+   port_dispatch[ port ] is the offset into port_handlers of a NULL
+   terminated list of the responses for that port, in the same order as
+   in the ports list. Port values which match the same set of responses
+   share a list, so the table is rebuilt whenever the list changes */
+static libspectrum_dword *port_dispatch = NULL;
+static const periph_port_t **port_handlers = NULL;
+static size_t port_handlers_size = 0;
+static int port_dispatch_dirty = 1;
+
 /* The strings used for debugger events */
 static const char * const page_event_string = "page",
   * const unpage_event_string = "unpage";
@@ -81,6 +93,7 @@ port_register( periph_type type, const periph_port_t *port )
   private->port = *port;
 
   ports = g_slist_append( ports, private );
+  port_dispatch_dirty = 1;
 }
 
 /* Register a peripheral with the system */
@@ -137,6 +150,7 @@ periph_activate_type( periph_type type, int active )
     GSList *found;
     while( ( found = g_slist_find_custom( ports, GINT_TO_POINTER( type ), find_by_type ) ) != NULL )
       ports = g_slist_remove( ports, found->data );
+    port_dispatch_dirty = 1;
   }
 
   return 1;
@@ -225,6 +239,7 @@ periph_clear( void )
   g_slist_foreach( ports, free_peripheral, NULL );
   g_slist_free( ports );
   ports = NULL;
+  port_dispatch_dirty = 1;
   set_types_inactive();
 }
 
@@ -236,15 +251,105 @@ periph_end( void )
   g_slist_free( ports );
   ports = NULL;
 
+  libspectrum_free( port_dispatch ); port_dispatch = NULL;
+  libspectrum_free( port_handlers ); port_handlers = NULL;
+  port_handlers_size = 0;
+  port_dispatch_dirty = 1;
+
   g_hash_table_destroy( peripherals );
   peripherals = NULL;
 }
 
+/* Is the list of responses starting at port_handlers[ offset ] the same
+   as the n responses in match? */
+static int
+port_list_equal( size_t offset, const periph_port_t **match, size_t n )
+{
+  size_t i;
+
+  for( i = 0; i < n; i++ )
+    if( port_handlers[ offset + i ] != match[ i ] ) return 0;
+
+  return port_handlers[ offset + n ] == NULL;
+}
+
+/* Compile the list of active ports into the dispatch table */
+static void
+port_dispatch_build( void )
+{
+  const periph_port_t **all, **match;
+  size_t *lists;
+  size_t count, used, nlists, n, i, j;
+  libspectrum_dword port;
+  GSList *ptr;
+
+  count = g_slist_length( ports );
+
+  all = libspectrum_new( const periph_port_t *, count + 1 );
+  match = libspectrum_new( const periph_port_t *, count + 1 );
+  for( ptr = ports, i = 0; ptr; ptr = ptr->next, i++ ) {
+    periph_port_private_t *private = ptr->data;
+    all[ i ] = &( private->port );
+  }
+
+  if( !port_dispatch )
+    port_dispatch = libspectrum_new( libspectrum_dword, 0x10000 );
+
+  /* Start off with just the empty list */
+  if( port_handlers_size < count + 1 ) {
+    port_handlers_size = 2 * ( count + 1 );
+    port_handlers = libspectrum_renew( const periph_port_t *, port_handlers,
+                                       port_handlers_size );
+  }
+  port_handlers[ 0 ] = NULL; used = 1;
+
+  lists = libspectrum_new( size_t, 1 ); lists[ 0 ] = 0; nlists = 1;
+
+  for( port = 0; port < 0x10000; port++ ) {
+
+    for( i = 0, n = 0; i < count; i++ )
+      if( ( port & all[ i ]->mask ) == all[ i ]->value )
+        match[ n++ ] = all[ i ];
+
+    /* Most ports match the same responses as the previous port, so try
+       that list first */
+    if( port && port_list_equal( port_dispatch[ port - 1 ], match, n ) ) {
+      port_dispatch[ port ] = port_dispatch[ port - 1 ];
+      continue;
+    }
+
+    for( j = 0; j < nlists; j++ )
+      if( port_list_equal( lists[ j ], match, n ) ) break;
+
+    if( j == nlists ) {
+      if( used + n + 1 > port_handlers_size ) {
+        port_handlers_size = 2 * ( used + n + 1 );
+        port_handlers = libspectrum_renew( const periph_port_t *,
+                                           port_handlers, port_handlers_size );
+      }
+      memcpy( &port_handlers[ used ], match, n * sizeof( *match ) );
+      port_handlers[ used + n ] = NULL;
+
+      lists = libspectrum_renew( size_t, lists, nlists + 1 );
+      lists[ nlists++ ] = used;
+      used += n + 1;
+    }
+
+    port_dispatch[ port ] = lists[ j ];
+  }
+
+  libspectrum_free( lists );
+  libspectrum_free( match );
+  libspectrum_free( all );
+
+  port_dispatch_dirty = 0;
+}
+
 /*
  * The actual routines to read and write a port
  */
 
-/* Internal type used for passing to read_peripheral and write_peripheral */
+/* Internal type used for passing to read_peripheral */
 struct peripheral_data_t {
 
   libspectrum_word port;
@@ -277,16 +382,12 @@ readport( libspectrum_word port )
 
 /* Read a byte from a specific port response */
 static void
-read_peripheral( gpointer data, gpointer user_data )
+read_peripheral( const periph_port_t *port,
+                 struct peripheral_data_t *callback_info )
 {
-  periph_port_private_t *private = data;
-  struct peripheral_data_t *callback_info = user_data;
   libspectrum_byte last_attached;
 
-  periph_port_t *port = &( private->port );
-
-  if( port->read &&
-      ( ( callback_info->port & port->mask ) == port->value ) ) {
+  if( port->read ) {
     last_attached = callback_info->attached;
     callback_info->value &= (   port->read( callback_info->port,
 					    &( callback_info->attached ) )
@@ -299,6 +400,7 @@ libspectrum_byte
 readport_internal( libspectrum_word port )
 {
   struct peripheral_data_t callback_info;
+  const periph_port_t **handler;
 
   /* Trigger the debugger if wanted */
   if( debugger_mode != DEBUGGER_MODE_INACTIVE )
@@ -328,7 +430,10 @@ readport_internal( libspectrum_word port )
   callback_info.attached = 0x00;
   callback_info.value = 0xff;
 
-  g_slist_foreach( ports, read_peripheral, &callback_info );
+  if( port_dispatch_dirty ) port_dispatch_build();
+
+  for( handler = &port_handlers[ port_dispatch[ port ] ]; *handler; handler++ )
+    read_peripheral( *handler, &callback_info );
 
   if( callback_info.attached != 0xff )
     callback_info.value =
@@ -359,34 +464,23 @@ writeport( libspectrum_word port, libspectrum_byte b )
   ula_contend_port_late( port ); tstates++;
 }
 
-/* Write a byte to a specific port response */
-static void
-write_peripheral( gpointer data, gpointer user_data )
-{
-  periph_port_private_t *private = data;
-  struct peripheral_data_t *callback_info = user_data;
-
-  periph_port_t *port = &( private->port );
-  
-  if( port->write &&
-      ( ( callback_info->port & port->mask ) == port->value ) )
-    port->write( callback_info->port, callback_info->value );
-}
 
 /* Write a byte to a port, taking no time */
 void
 writeport_internal( libspectrum_word port, libspectrum_byte b )
 {
-  struct peripheral_data_t callback_info;
+  const periph_port_t **handler;
 
   /* Trigger the debugger if wanted */
   if( debugger_mode != DEBUGGER_MODE_INACTIVE )
     debugger_check( DEBUGGER_BREAKPOINT_TYPE_PORT_WRITE, port );
 
-  callback_info.port = port;
-  callback_info.value = b;
-  
-  g_slist_foreach( ports, write_peripheral, &callback_info );
+  if( port_dispatch_dirty ) port_dispatch_build();
+
+  for( handler = &port_handlers[ port_dispatch[ port ] ]; *handler;
+       handler++ ) {
+    if( ( *handler )->write ) ( *handler )->write( port, b );
+  }
 }
 
 /*
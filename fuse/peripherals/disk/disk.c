@@ -67,8 +67,6 @@ static const int disk_bpt[] = {
   12500,			/* HD */
 };
 
-static unsigned char head[256];
-
 typedef struct disk_gap_t {
   int gap;			/* gap byte */
   int sync;			/* sync byte */
@@ -682,6 +680,30 @@ disk_close( disk_t *d )
   d->type = DISK_TYPE_NONE;
 }
 
+/* make an independent copy of a disk, e.g. to write it out while the
+   original carries on being used */
+void
+disk_copy( disk_t *dest, const disk_t *src )
+{
+  size_t dlen = src->sides * src->cylinders * src->tlen;
+
+  *dest = *src;
+  dest->filename = utils_safe_strdup( src->filename );
+
+  if( !src->data ) return;
+
+  dest->data = libspectrum_new( libspectrum_byte, dlen );
+  memcpy( dest->data, src->data, dlen );
+
+  /* Point at the same place in the new data */
+  if( src->track ) {
+    dest->track = dest->data + ( src->track - src->data );
+    dest->clocks = dest->data + ( src->clocks - src->data );
+    dest->fm = dest->data + ( src->fm - src->data );
+    dest->weak = dest->data + ( src->weak - src->data );
+  }
+}
+
 /*
  *  if d->density == DISK_DENS_AUTO => 
  *                            use d->tlen if d->bpt == 0
@@ -1253,6 +1275,7 @@ open_trd( buffer_t *buffer, disk_t *d )
 static int
 open_fdi( buffer_t *buffer, disk_t *d, int preindex )
 {
+  unsigned char head[256];
   int i, j, h, gap;
   int bpt, bpt_fm, max_bpt = 0, max_bpt_fm = 0;
   int data_offset, track_offset, head_offset, sector_offset;
@@ -1565,6 +1588,7 @@ open_cpc( buffer_t *buffer, disk_t *d, int preindex )
 static int
 open_scl( buffer_t *buffer, disk_t *d )
 {
+  unsigned char head[256];
   int i, j, s, sectors, seclen;
   int scl_deleted, scl_files, scl_i;
 
@@ -2096,6 +2120,7 @@ write_udi( FILE *file, disk_t *d )
   int i, j, error;
   size_t len;
   libspectrum_dword crc;
+  libspectrum_byte header[16];
 
   udi_pack_tracks( d );
 #ifdef LIBSPECTRUM_SUPPORTS_ZLIB_COMPRESSION
@@ -2112,32 +2137,32 @@ write_udi( FILE *file, disk_t *d )
     else
       len += 3 + UDI_TLEN( d->track[-1], d->track[-3] + 256 * d->track[-2] );
   }
-  head[0] = 'U';
-  head[1] = 'D';
-  head[2] = 'I';
-  head[3] = '!';
-  head[4] = len & 0xff;
-  head[5] = ( len >> 8 ) & 0xff;
-  head[6] = ( len >> 16 ) & 0xff;
-  head[7] = ( len >> 24 ) & 0xff;
-  head[8] = 0x00;
-  head[9] = d->cylinders - 1;
-  head[10] = d->sides - 1;
-  head[11] = head[12] = head[13] = head[14] = head[15] = 0;
-  if( fwrite( head, 16, 1, file ) != 1 )
+  header[0] = 'U';
+  header[1] = 'D';
+  header[2] = 'I';
+  header[3] = '!';
+  header[4] = len & 0xff;
+  header[5] = ( len >> 8 ) & 0xff;
+  header[6] = ( len >> 16 ) & 0xff;
+  header[7] = ( len >> 24 ) & 0xff;
+  header[8] = 0x00;
+  header[9] = d->cylinders - 1;
+  header[10] = d->sides - 1;
+  header[11] = header[12] = header[13] = header[14] = header[15] = 0;
+  if( fwrite( header, 16, 1, file ) != 1 )
     return d->status = DISK_WRPART;
   for( j = 0; j < 16; j++ )
-    crc = crc_udi( crc, head[j] );
+    crc = crc_udi( crc, header[j] );
   for( i = 0; i < d->sides * d->cylinders; i++ ) {	/* write tracks */
     DISK_SET_TRACK_IDX( d, i );
-    head[0] = d->track[-1];		/* track type */
-    head[1] = d->track[-3];		/* track len  */
-    head[2] = d->track[-2];		/* track len2 */
-    if( fwrite( head, 3, 1, file ) != 1 )
+    header[0] = d->track[-1];		/* track type */
+    header[1] = d->track[-3];		/* track len  */
+    header[2] = d->track[-2];		/* track len2 */
+    if( fwrite( header, 3, 1, file ) != 1 )
       return d->status = DISK_WRPART;
 
     for( j = 0; j < 3; j++ )
-      crc = crc_udi( crc, head[j] );
+      crc = crc_udi( crc, header[j] );
 
     if( d->track[-1] == 0xf0 )
       len = 4 + d->track[-3] + 256 * d->track[-2];
@@ -2151,11 +2176,11 @@ write_udi( FILE *file, disk_t *d )
       d->track++;
     }
   }
-  head[0] = crc & 0xff;
-  head[1] = ( crc >> 8 ) & 0xff;
-  head[2] = ( crc >> 16 ) & 0xff;
-  head[3] = ( crc >> 24 ) & 0xff;
-  if( fwrite( head, 4, 1, file ) != 1 )		/* CRC */
+  header[0] = crc & 0xff;
+  header[1] = ( crc >> 8 ) & 0xff;
+  header[2] = ( crc >> 16 ) & 0xff;
+  header[3] = ( crc >> 24 ) & 0xff;
+  if( fwrite( header, 4, 1, file ) != 1 )		/* CRC */
     fclose( file );
 
 #ifdef LIBSPECTRUM_SUPPORTS_ZLIB_COMPRESSION
@@ -2247,6 +2272,7 @@ write_trd( FILE *file, disk_t *d )
 static int
 write_sad( FILE *file, disk_t *d )
 {
+  unsigned char head[22];
   int i, j, sbase, sectors, seclen, mfm, cyl;
 
   if( check_disk_geom( d, &sbase, &sectors, &seclen, &mfm, &cyl ) || sbase != 1 )
@@ -2273,6 +2299,7 @@ write_sad( FILE *file, disk_t *d )
 static int
 write_fdi( FILE *file, disk_t *d )
 {
+  unsigned char head[256];
   int i, j, k, sbase, sectors, seclen, mfm, del;
   int h, t, s, b;
   int toff, soff;
@@ -2361,6 +2388,7 @@ write_fdi( FILE *file, disk_t *d )
 static int
 write_cpc( FILE *file, disk_t *d )
 {
+  unsigned char head[256];
   int i, j, k, sbase, sectors, seclen, mfm, cyl;
   int h, t, s, b;
   size_t len;
@@ -2420,6 +2448,7 @@ write_cpc( FILE *file, disk_t *d )
 static int
 write_scl( FILE *file, disk_t *d )
 {
+  unsigned char head[256];
   int i, j, k, l, t, s, sbase, sectors, seclen, mfm, del, cyl;
   int entries;
   libspectrum_dword sum = 597;		/* sum of "SINCLAIR" */
@@ -2617,17 +2646,11 @@ write_log( FILE *file, disk_t *d )
   return d->status = DISK_OK;
 }
 
-int
-disk_write( disk_t *d, const char *filename )
+void
+disk_guess_type( disk_t *d, const char *filename )
 {
-  FILE *file;
   const char *ext;
   size_t namelen;
-  libspectrum_byte *t, *c, *f, *w;
-  int idx;
-
-  if( ( file = fopen( filename, "wb" ) ) == NULL )
-    return d->status = DISK_WRFILE;
 
   namelen = strlen( filename );
   if( namelen < 4 )
@@ -2635,36 +2658,47 @@ disk_write( disk_t *d, const char *filename )
   else
     ext = filename + namelen - 4;
 
-  if( d->type == DISK_TYPE_NONE ) {
-    if( !strcasecmp( ext, ".udi" ) )
-      d->type = DISK_UDI;				/* ALT side */
-    else if( !strcasecmp( ext, ".dsk" ) )
-      d->type = DISK_CPC;				/* ALT side */
-    else if( !strcasecmp( ext, ".mgt" ) )
-      d->type = DISK_MGT;				/* ALT side */
-    else if( !strcasecmp( ext, ".opd" ) || !strcasecmp( ext, ".opu" ) )
-      d->type = DISK_OPD;				/* ALT side */
-    else if( !strcasecmp( ext, ".img" ) )		/* out-out */
-      d->type = DISK_IMG;
-    else if( !strcasecmp( ext, ".trd" ) )		/* ALT */
-      d->type = DISK_TRD;
-    else if( !strcasecmp( ext, ".sad" ) )		/* ALT */
-      d->type = DISK_SAD;
-    else if( !strcasecmp( ext, ".fdi" ) )		/* ALT */
-      d->type = DISK_FDI;
-    else if( !strcasecmp( ext, ".d40" ) )		/* ALT side */
-      d->type = DISK_D40;
-    else if( !strcasecmp( ext, ".d80" ) )		/* ALT side */
-      d->type = DISK_D80;
-    else if( !strcasecmp( ext, ".scl" ) )		/* not really a disk image */
-      d->type = DISK_SCL;
-    else if( !strcasecmp( ext, ".td0" ) )		/* not supported */
-      d->type = DISK_TD0;
-    else if( !strcasecmp( ext, ".log" ) )		/* ALT */
-      d->type = DISK_LOG;
-    else
-      d->type = DISK_UDI;				/* ALT side */
-  }
+  if( !strcasecmp( ext, ".udi" ) )
+    d->type = DISK_UDI;				/* ALT side */
+  else if( !strcasecmp( ext, ".dsk" ) )
+    d->type = DISK_CPC;				/* ALT side */
+  else if( !strcasecmp( ext, ".mgt" ) )
+    d->type = DISK_MGT;				/* ALT side */
+  else if( !strcasecmp( ext, ".opd" ) || !strcasecmp( ext, ".opu" ) )
+    d->type = DISK_OPD;				/* ALT side */
+  else if( !strcasecmp( ext, ".img" ) )		/* out-out */
+    d->type = DISK_IMG;
+  else if( !strcasecmp( ext, ".trd" ) )		/* ALT */
+    d->type = DISK_TRD;
+  else if( !strcasecmp( ext, ".sad" ) )		/* ALT */
+    d->type = DISK_SAD;
+  else if( !strcasecmp( ext, ".fdi" ) )		/* ALT */
+    d->type = DISK_FDI;
+  else if( !strcasecmp( ext, ".d40" ) )		/* ALT side */
+    d->type = DISK_D40;
+  else if( !strcasecmp( ext, ".d80" ) )		/* ALT side */
+    d->type = DISK_D80;
+  else if( !strcasecmp( ext, ".scl" ) )		/* not really a disk image */
+    d->type = DISK_SCL;
+  else if( !strcasecmp( ext, ".td0" ) )		/* not supported */
+    d->type = DISK_TD0;
+  else if( !strcasecmp( ext, ".log" ) )		/* ALT */
+    d->type = DISK_LOG;
+  else
+    d->type = DISK_UDI;				/* ALT side */
+}
+
+int
+disk_write( disk_t *d, const char *filename )
+{
+  FILE *file;
+  libspectrum_byte *t, *c, *f, *w;
+  int idx;
+
+  if( ( file = fopen( filename, "wb" ) ) == NULL )
+    return d->status = DISK_WRFILE;
+
+  if( d->type == DISK_TYPE_NONE ) disk_guess_type( d, filename );
 
   /* Save position of current data */
   t = d->track;
@@ -153,11 +153,18 @@ int disk_merge_sides( disk_t *d, disk_t *d1, disk_t *d2, int autofill );
    UDI.
 */
 int disk_write( disk_t *d, const char *filename );
+/* set d->type from the extension of the file name, as disk_write does
+   for DISK_TYPE_NONE
+*/
+void disk_guess_type( disk_t *d, const char *filename );
 /* format disk to plus3 accept for formatting
 */
 int disk_preformat( disk_t *d );
 /* close a disk and free buffers
 */
 void disk_close( disk_t *d );
+/* copy a disk with its own buffers, which must be freed with disk_close
+*/
+void disk_copy( disk_t *dest, const disk_t *src );
 
 #endif /* FUSE_DISK_H */
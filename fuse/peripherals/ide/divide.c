@@ -237,7 +237,9 @@ divide_commit( libspectrum_ide_unit unit )
 {
   int error;
 
-  error = libspectrum_ide_commit( divide_idechn0, unit );
+  error = ide_commit( divide_idechn0, unit, unit == LIBSPECTRUM_IDE_MASTER ?
+                      settings_current.divide_master_file :
+                      settings_current.divide_slave_file );
 
   return error;
 }
@@ -25,11 +25,16 @@
 
 #include <config.h>
 
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
 #include <libspectrum.h>
 
 #include "ide.h"
 #include "ui/ui.h"
 #include "settings.h"
+#include "writeback.h"
 
 int
 ide_insert( const char *filename, libspectrum_ide_channel *chn,
@@ -47,6 +52,9 @@ ide_insert( const char *filename, libspectrum_ide_channel *chn,
 
   settings_set_string( setting, filename );
 
+  /* Make sure we don't read the image while it's still being written */
+  writeback_flush( filename );
+
   error = libspectrum_ide_insert( chn, unit, filename );
   if( error ) return error;
 
@@ -62,6 +70,9 @@ ide_eject( libspectrum_ide_channel *chn, libspectrum_ide_unit unit,
 {
   int error;
 
+  /* Finish any earlier commits first, as they may not have worked */
+  writeback_flush( *setting );
+
   if( libspectrum_ide_dirty( chn, unit ) ) {
     
     ui_confirm_save_t confirm = ui_confirm_save(
@@ -80,6 +91,10 @@ ide_eject( libspectrum_ide_channel *chn, libspectrum_ide_unit unit,
     }
   }
 
+  /* Wait for the image to be written before letting go of it, and keep it
+     if that failed */
+  if( writeback_flush( *setting ) ) return 1;
+
   libspectrum_free( *setting ); *setting = NULL;
   
   error = libspectrum_ide_eject( chn, unit );
@@ -90,3 +105,155 @@ ide_eject( libspectrum_ide_channel *chn, libspectrum_ide_unit unit,
 
   return 0;
 }
+
+/* The changed sectors from one commit, to be written in the background */
+typedef struct ide_sector {
+  long offset;
+  libspectrum_byte *data;
+  size_t length;
+} ide_sector;
+
+typedef struct ide_sectors {
+  ide_sector *sectors;
+  size_t count, allocated;
+  size_t length;
+} ide_sectors;
+
+static void
+add_sector( long offset, const libspectrum_byte *data, size_t length,
+            void *context )
+{
+  ide_sectors *sectors = context;
+  ide_sector *sector;
+
+  if( sectors->count == sectors->allocated ) {
+    sectors->allocated = sectors->allocated ? 2 * sectors->allocated : 64;
+    sectors->sectors = libspectrum_renew( ide_sector, sectors->sectors,
+                                          sectors->allocated );
+  }
+
+  sector = &sectors->sectors[ sectors->count++ ];
+  sector->offset = offset;
+  sector->data = libspectrum_new( libspectrum_byte, length );
+  memcpy( sector->data, data, length );
+  sector->length = length;
+
+  sectors->length += length;
+}
+
+static const char*
+write_sectors( const char *filename, void *data )
+{
+  ide_sectors *sectors = data;
+  ide_sector *sector;
+  FILE *f;
+  size_t i;
+
+  f = fopen( filename, "rb+" );
+  if( !f ) return strerror( errno );
+
+  for( i = 0, sector = sectors->sectors; i < sectors->count; i++, sector++ ) {
+    if( fseek( f, sector->offset, SEEK_SET ) ||
+        fwrite( sector->data, 1, sector->length, f ) != sector->length ) {
+      fclose( f );
+      return "write error";
+    }
+  }
+
+  if( fclose( f ) ) return strerror( errno );
+
+  return NULL;
+}
+
+static void
+free_sectors( void *data )
+{
+  ide_sectors *sectors = data;
+  size_t i;
+
+  for( i = 0; i < sectors->count; i++ )
+    libspectrum_free( sectors->sectors[i].data );
+  libspectrum_free( sectors->sectors );
+  libspectrum_free( sectors );
+}
+
+/* A drive whose changes are being written, and how many of its commits
+   haven't finished yet */
+typedef struct ide_commit_drive {
+  libspectrum_ide_channel *chn;
+  libspectrum_ide_unit unit;
+  size_t pending;
+  struct ide_commit_drive *next;
+} ide_commit_drive;
+
+static ide_commit_drive *committing;
+
+static ide_commit_drive*
+commit_drive_get( libspectrum_ide_channel *chn, libspectrum_ide_unit unit )
+{
+  ide_commit_drive *drive;
+
+  for( drive = committing; drive; drive = drive->next )
+    if( drive->chn == chn && drive->unit == unit ) return drive;
+
+  drive = libspectrum_new( ide_commit_drive, 1 );
+  drive->chn = chn;
+  drive->unit = unit;
+  drive->pending = 0;
+  drive->next = committing;
+  committing = drive;
+
+  return drive;
+}
+
+static void
+commit_drive_free( ide_commit_drive *drive )
+{
+  ide_commit_drive **link;
+
+  for( link = &committing; *link != drive; link = &( *link )->next ) ;
+  *link = drive->next;
+
+  libspectrum_free( drive );
+}
+
+static void
+sectors_written( void *context, int error )
+{
+  ide_commit_drive *drive = context;
+
+  /* The changes are still in the write cache, so can be committed again */
+  if( error ) libspectrum_ide_mark_dirty( drive->chn, drive->unit );
+
+  if( --drive->pending ) return;
+
+  /* Once every commit has been written, the image holds everything
+     committed, so it needn't be kept in memory any more */
+  libspectrum_ide_drop_committed( drive->chn, drive->unit );
+  commit_drive_free( drive );
+}
+
+int
+ide_commit( libspectrum_ide_channel *chn, libspectrum_ide_unit unit,
+            const char *filename )
+{
+  ide_sectors *sectors;
+  ide_commit_drive *drive;
+  int error;
+
+  if( !filename ) return libspectrum_ide_commit( chn, unit );
+
+  sectors = libspectrum_new0( ide_sectors, 1 );
+
+  error = libspectrum_ide_commit_to( chn, unit, add_sector, sectors );
+  if( error || !sectors->count ) {
+    free_sectors( sectors );
+    return error;
+  }
+
+  drive = commit_drive_get( chn, unit );
+  drive->pending++;
+
+  return writeback_queue( filename, sectors->length, write_sectors,
+                          free_sectors, sectors, sectors_written, drive );
+}
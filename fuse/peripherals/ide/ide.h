@@ -39,4 +39,9 @@ ide_eject( libspectrum_ide_channel *chn, libspectrum_ide_unit unit,
 	   int (*commit_fn)( libspectrum_ide_unit unit ), char **setting,
 	   ui_menu_item item );
 
+/* Write any changes to the image in `filename' in the background */
+int
+ide_commit( libspectrum_ide_channel *chn, libspectrum_ide_unit unit,
+	    const char *filename );
+
 #endif			/* #ifndef FUSE_IDE_H */
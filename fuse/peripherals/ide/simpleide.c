@@ -157,7 +157,9 @@ simpleide_commit( libspectrum_ide_unit unit )
 {
   int error;
 
-  error = libspectrum_ide_commit( simpleide_idechn, unit );
+  error = ide_commit( simpleide_idechn, unit, unit == LIBSPECTRUM_IDE_MASTER ?
+                      settings_current.simpleide_master_file :
+                      settings_current.simpleide_slave_file );
 
   return error;
 }
@@ -275,7 +275,9 @@ zxatasp_commit( libspectrum_ide_unit unit )
 {
   int error;
 
-  error = libspectrum_ide_commit( zxatasp_idechn0, unit );
+  error = ide_commit( zxatasp_idechn0, unit, unit == LIBSPECTRUM_IDE_MASTER ?
+                      settings_current.zxatasp_master_file :
+                      settings_current.zxatasp_slave_file );
 
   return error;
 }
@@ -201,7 +201,8 @@ zxcf_commit( void )
 {
   int error;
 
-  error = libspectrum_ide_commit( zxcf_idechn, LIBSPECTRUM_IDE_MASTER );
+  error = ide_commit( zxcf_idechn, LIBSPECTRUM_IDE_MASTER,
+                      settings_current.zxcf_pri_file );
 
   return error;
 }
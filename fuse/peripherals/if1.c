@@ -46,6 +46,7 @@
 #include "utils.h"
 #include "ui/ui.h"
 #include "unittests/unittests.h"
+#include "writeback.h"
 
 #undef IF1_DEBUG_MDR
 #undef IF1_DEBUG_NET
@@ -1149,6 +1150,8 @@ if1_mdr_insert( int which, const char *filename )
     return 0;
   }
 
+  writeback_flush( filename );
+
   if( utils_read_file( filename, &mdr->file ) ) {
     ui_error( UI_ERROR_ERROR, "Failed to open cartridge image" );
     return 1;
@@ -1189,6 +1192,10 @@ if1_mdr_eject( int which )
   if( !mdr->inserted )
     return 0;
 
+  /* Finish any earlier saves first, as they may not have worked */
+  if( mdr->filename != NULL )
+    writeback_flush( mdr->filename );
+
   if( mdr->modified ) {
 
     ui_confirm_save_t confirm = ui_confirm_save(
@@ -1209,6 +1216,11 @@ if1_mdr_eject( int which )
     }
   }
 
+  /* Don't let go of the cartridge until it has been written, and keep it
+     if that failed */
+  if( mdr->filename != NULL && writeback_flush( mdr->filename ) )
+    return 1;
+
   mdr->inserted = 0;
   if( mdr->filename != NULL ) {
     libspectrum_free( mdr->filename );
@@ -1238,6 +1250,15 @@ if1_mdr_save( int which, int saveas )
   return 0;
 }
 
+static void
+mdr_written( void *context, int error )
+{
+  microdrive_t *mdr = context;
+
+  /* The cartridge still needs saving if it couldn't be written */
+  if( error ) mdr->modified = 1;
+}
+
 int
 if1_mdr_write( int which, const char *filename )
 {
@@ -1248,7 +1269,8 @@ if1_mdr_write( int which, const char *filename )
 
   if( filename == NULL ) filename = mdr->filename;	/* Write over the original file */
 
-  if( utils_write_file( filename, mdr->file.buffer, mdr->file.length ) )
+  if( writeback_file( filename, mdr->file.buffer, mdr->file.length,
+                      mdr_written, mdr ) )
     return 1;
 
   if( mdr->filename && strcmp( filename, mdr->filename ) ) {
@@ -197,6 +197,9 @@ ula_read( libspectrum_word port, libspectrum_byte *attached )
 static void
 ula_write( libspectrum_word port GCC_UNUSED, libspectrum_byte b )
 {
+  if( tape_recording && ( ( b ^ last_byte ) & 0x08 ) )
+    tape_record_edge( tstates );
+
   last_byte = b;
 
   display_set_lores_border( b & 0x07 );
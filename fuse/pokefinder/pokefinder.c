@@ -27,6 +27,10 @@
 
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif				/* #ifdef __SSE2__ */
+
 #include <libspectrum.h>
 
 #include "machine.h"
@@ -38,6 +42,25 @@ libspectrum_byte pokefinder_possible[ MEMORY_PAGES_IN_16K * SPECTRUM_RAM_PAGES ]
 libspectrum_byte pokefinder_impossible[ MEMORY_PAGES_IN_16K * SPECTRUM_RAM_PAGES ][ MEMORY_PAGE_SIZE / 8 ];
 size_t pokefinder_count;
 
+/* The searches work through RAM in chunks of this many bytes, each of
+   which corresponds to two bytes of the impossible bitmap */
+#define CHUNK_SIZE 16
+
+typedef enum pokefinder_test {
+  POKEFINDER_TEST_EQUAL,
+  POKEFINDER_TEST_RANGE,
+  POKEFINDER_TEST_WORD,
+  POKEFINDER_TEST_INCREMENTED,
+  POKEFINDER_TEST_DECREMENTED,
+  POKEFINDER_TEST_CHANGED,
+  POKEFINDER_TEST_UNCHANGED,
+  POKEFINDER_TEST_DELTA,
+} pokefinder_test;
+
+/* Which of these tests compare against the previous contents of memory,
+   and so update pokefinder_possible as they go */
+#define TEST_IS_RELATIONAL( test ) ( (test) >= POKEFINDER_TEST_INCREMENTED )
+
 void
 pokefinder_clear( void )
 {
@@ -54,71 +77,251 @@ pokefinder_clear( void )
       memset( pokefinder_impossible[page], 255, MEMORY_PAGE_SIZE / 8 );
 }
 
-int
-pokefinder_search( libspectrum_byte value )
+/* Return a bitmask with bit i set if byte i of the chunk passes the test.
+   For word searches, next points to the byte after each byte in current */
+
+#ifdef __SSE2__
+
+static unsigned int
+chunk_test( pokefinder_test test, const libspectrum_byte *current,
+            const libspectrum_byte *next, const libspectrum_byte *previous,
+            libspectrum_byte a, libspectrum_byte b )
 {
-  size_t page, offset;
+  __m128i now = _mm_loadu_si128( (const __m128i*)current ), then, pass;
 
-  for( page = 0; page < MEMORY_PAGES_IN_16K * SPECTRUM_RAM_PAGES; page++ ) {
-    memory_page *mapping = &memory_map_ram[ page ];
+  switch( test ) {
 
-    for( offset = 0; offset < MEMORY_PAGE_SIZE; offset++ ) {
-      if( pokefinder_impossible[page][offset/8] & 1 << (offset & 7) ) continue;
+  case POKEFINDER_TEST_EQUAL:
+    pass = _mm_cmpeq_epi8( now, _mm_set1_epi8( a ) );
+    break;
+
+  case POKEFINDER_TEST_RANGE:
+    /* a <= x <= b exactly when x - a <= b - a, with unsigned wraparound */
+    then = _mm_set1_epi8( b - a );
+    pass = _mm_cmpeq_epi8(
+      _mm_max_epu8( _mm_sub_epi8( now, _mm_set1_epi8( a ) ), then ), then );
+    break;
+
+  case POKEFINDER_TEST_WORD:
+    then = _mm_loadu_si128( (const __m128i*)next );
+    pass = _mm_and_si128( _mm_cmpeq_epi8( now, _mm_set1_epi8( a ) ),
+                          _mm_cmpeq_epi8( then, _mm_set1_epi8( b ) ) );
+    break;
+
+  case POKEFINDER_TEST_INCREMENTED:
+    then = _mm_loadu_si128( (const __m128i*)previous );
+    return _mm_movemask_epi8(
+             _mm_cmpeq_epi8( _mm_max_epu8( now, then ), now ) ) &
+           ~_mm_movemask_epi8( _mm_cmpeq_epi8( now, then ) );
+
+  case POKEFINDER_TEST_DECREMENTED:
+    then = _mm_loadu_si128( (const __m128i*)previous );
+    return _mm_movemask_epi8(
+             _mm_cmpeq_epi8( _mm_min_epu8( now, then ), now ) ) &
+           ~_mm_movemask_epi8( _mm_cmpeq_epi8( now, then ) );
+
+  case POKEFINDER_TEST_CHANGED:
+    then = _mm_loadu_si128( (const __m128i*)previous );
+    return ~_mm_movemask_epi8( _mm_cmpeq_epi8( now, then ) ) & 0xffff;
+
+  case POKEFINDER_TEST_UNCHANGED:
+    then = _mm_loadu_si128( (const __m128i*)previous );
+    pass = _mm_cmpeq_epi8( now, then );
+    break;
+
+  case POKEFINDER_TEST_DELTA:
+    then = _mm_loadu_si128( (const __m128i*)previous );
+    pass = _mm_cmpeq_epi8( now, _mm_add_epi8( then, _mm_set1_epi8( a ) ) );
+    break;
+
+  default:
+    return 0;
 
-      if( mapping->page[offset] != value ) {
-	pokefinder_impossible[page][offset/8] |= 1 << (offset & 7);
-	pokefinder_count--;
-      }
-    }
   }
 
-  return 0;
+  return _mm_movemask_epi8( pass );
 }
 
-int
-pokefinder_incremented( void )
+#else				/* #ifdef __SSE2__ */
+
+static unsigned int
+chunk_test( pokefinder_test test, const libspectrum_byte *current,
+            const libspectrum_byte *next, const libspectrum_byte *previous,
+            libspectrum_byte a, libspectrum_byte b )
+{
+  unsigned int pass = 0, i;
+
+  switch( test ) {
+
+  case POKEFINDER_TEST_EQUAL:
+    for( i = 0; i < CHUNK_SIZE; i++ ) pass |= ( current[i] == a ) << i;
+    break;
+
+  case POKEFINDER_TEST_RANGE:
+    for( i = 0; i < CHUNK_SIZE; i++ )
+      pass |= ( (libspectrum_byte)( current[i] - a ) <= b - a ) << i;
+    break;
+
+  case POKEFINDER_TEST_WORD:
+    for( i = 0; i < CHUNK_SIZE; i++ )
+      pass |= ( current[i] == a && next[i] == b ) << i;
+    break;
+
+  case POKEFINDER_TEST_INCREMENTED:
+    for( i = 0; i < CHUNK_SIZE; i++ )
+      pass |= ( current[i] > previous[i] ) << i;
+    break;
+
+  case POKEFINDER_TEST_DECREMENTED:
+    for( i = 0; i < CHUNK_SIZE; i++ )
+      pass |= ( current[i] < previous[i] ) << i;
+    break;
+
+  case POKEFINDER_TEST_CHANGED:
+    for( i = 0; i < CHUNK_SIZE; i++ )
+      pass |= ( current[i] != previous[i] ) << i;
+    break;
+
+  case POKEFINDER_TEST_UNCHANGED:
+    for( i = 0; i < CHUNK_SIZE; i++ )
+      pass |= ( current[i] == previous[i] ) << i;
+    break;
+
+  case POKEFINDER_TEST_DELTA:
+    for( i = 0; i < CHUNK_SIZE; i++ )
+      pass |= ( current[i] == (libspectrum_byte)( previous[i] + a ) ) << i;
+    break;
+
+  }
+
+  return pass;
+}
+
+#endif				/* #ifdef __SSE2__ */
+
+static size_t
+count_bits( unsigned int bits )
+{
+  size_t count = 0;
+
+  for( ; bits; bits &= bits - 1 ) count++;
+
+  return count;
+}
+
+/* The byte which follows the last byte of RAM page `page' in the same
+   16K bank, or -1 if that byte is in a different bank */
+static int
+following_byte( size_t page )
+{
+  if( page % MEMORY_PAGES_IN_16K == MEMORY_PAGES_IN_16K - 1 ) return -1;
+  return memory_map_ram[ page + 1 ].page[0];
+}
+
+/* Remove from the possible locations every location which fails the
+   test */
+static void
+pokefinder_scan( pokefinder_test test, libspectrum_byte a, libspectrum_byte b )
 {
   size_t page, offset;
 
   for( page = 0; page < MEMORY_PAGES_IN_16K * SPECTRUM_RAM_PAGES; page++ ) {
-    memory_page *mapping = &memory_map_ram[ page ];
+    libspectrum_byte *current = memory_map_ram[ page ].page;
+    libspectrum_byte *previous = pokefinder_possible[ page ];
+    libspectrum_byte *impossible = pokefinder_impossible[ page ];
+    libspectrum_byte tail[ CHUNK_SIZE ];
+
+    for( offset = 0; offset < MEMORY_PAGE_SIZE; offset += CHUNK_SIZE ) {
+      libspectrum_byte *bits = &impossible[ offset / 8 ];
+      unsigned int candidates = ~( bits[0] | bits[1] << 8 ) & 0xffff;
+      const libspectrum_byte *next = &current[ offset + 1 ];
+      unsigned int pass, valid = 0xffff;
 
-    for( offset = 0; offset < MEMORY_PAGE_SIZE; offset++ ) {
-      if( pokefinder_impossible[page][offset/8] & 1 << (offset & 7) ) continue;
+      if( !candidates ) continue;
 
-      if( mapping->page[offset] > pokefinder_possible[page][offset] ) {
-        pokefinder_possible[page][offset] = mapping->page[offset];
-      } else {
-	pokefinder_impossible[page][offset/8] |= 1 << (offset & 7);
-	pokefinder_count--;
+      /* The high byte of a word at the end of a page comes from the next
+         page; words which would straddle a 16K bank never match */
+      if( test == POKEFINDER_TEST_WORD &&
+          offset + CHUNK_SIZE == MEMORY_PAGE_SIZE ) {
+        int following = following_byte( page );
+        memcpy( tail, next, CHUNK_SIZE - 1 );
+        tail[ CHUNK_SIZE - 1 ] = following;
+        if( following < 0 ) valid &= ~( 1 << ( CHUNK_SIZE - 1 ) );
+        next = tail;
       }
 
+      pass = chunk_test( test, &current[ offset ], next, &previous[ offset ],
+                         a, b ) & valid;
+
+      if( TEST_IS_RELATIONAL( test ) )
+        memcpy( &previous[ offset ], &current[ offset ], CHUNK_SIZE );
+
+      if( candidates & ~pass ) {
+        pokefinder_count -= count_bits( candidates & ~pass );
+        candidates &= pass;
+        bits[0] = ~candidates & 0xff;
+        bits[1] = ~candidates >> 8;
+      }
     }
   }
+}
 
+int
+pokefinder_search( libspectrum_byte value )
+{
+  pokefinder_scan( POKEFINDER_TEST_EQUAL, value, 0 );
   return 0;
 }
 
 int
-pokefinder_decremented( void )
+pokefinder_search_range( libspectrum_byte low, libspectrum_byte high )
 {
-  size_t page, offset;
+  if( low > high ) return 1;
 
-  for( page = 0; page < MEMORY_PAGES_IN_16K * SPECTRUM_RAM_PAGES; page++ ) {
-    memory_page *mapping = &memory_map_ram[ page ];
+  pokefinder_scan( POKEFINDER_TEST_RANGE, low, high );
+  return 0;
+}
 
-    for( offset = 0; offset < MEMORY_PAGE_SIZE; offset++ ) {
-      if( pokefinder_impossible[page][offset/8] & 1 << (offset & 7) ) continue;
+int
+pokefinder_search_word( libspectrum_word value )
+{
+  pokefinder_scan( POKEFINDER_TEST_WORD, value & 0xff, value >> 8 );
+  return 0;
+}
 
-      if( mapping->page[offset] < pokefinder_possible[page][offset] ) {
-        pokefinder_possible[page][offset] = mapping->page[offset];
-      } else {
-	pokefinder_impossible[page][offset/8] |= 1 << (offset & 7);
-	pokefinder_count--;
-      }
+int
+pokefinder_incremented( void )
+{
+  pokefinder_scan( POKEFINDER_TEST_INCREMENTED, 0, 0 );
+  return 0;
+}
 
-    }
-  }
+int
+pokefinder_decremented( void )
+{
+  pokefinder_scan( POKEFINDER_TEST_DECREMENTED, 0, 0 );
+  return 0;
+}
+
+int
+pokefinder_changed( void )
+{
+  pokefinder_scan( POKEFINDER_TEST_CHANGED, 0, 0 );
+  return 0;
+}
+
+int
+pokefinder_unchanged( void )
+{
+  pokefinder_scan( POKEFINDER_TEST_UNCHANGED, 0, 0 );
+  return 0;
+}
+
+int
+pokefinder_delta( int delta )
+{
+  if( delta < -255 || delta > 255 ) return 1;
 
+  pokefinder_scan( POKEFINDER_TEST_DELTA, delta & 0xff, 0 );
   return 0;
 }
@@ -25,18 +25,27 @@
 
 #include <config.h>
 
+#include <inttypes.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_LIB_GLIB
+#include <glib.h>
+#endif				/* #ifdef HAVE_LIB_GLIB */
+
 #include <libspectrum.h>
 
 #include "event.h"
 #include "infrastructure/startup_manager.h"
 #include "fuse.h"
+#include "memory.h"
 #include "module.h"
 #include "profile.h"
+#include "settings.h"
 #include "ui/ui.h"
 #include "z80/z80.h"
+#include "z80/z80_macros.h"
 
 int profile_active = 0;
 
@@ -44,6 +53,63 @@ static int total_tstates[ 0x10000 ];
 static libspectrum_word profile_last_pc;
 static libspectrum_dword profile_last_tstates;
 
+/*
+ * Call graph profiling
+ *
+ * T-states are attributed to where the code actually was, rather than
+ * just its 64K address, and to the function which was running at the
+ * time. A function is identified by its entry point, and is entered by
+ * a taken CALL or RST, or by an interrupt. Rather than trying to match
+ * up RETs, a function is left when the stack pointer goes above the
+ * return address pushed on entry, which also copes with code which
+ * discards its return address.
+ */
+
+/* A location in memory: the memory source in the top 8 bits, the page
+   number from that source in the next 8 bits and the offset into the
+   page in the low 16 bits */
+typedef libspectrum_dword profile_location;
+
+/* T-states spent at one location while in one function */
+typedef struct profile_cost_t {
+  profile_location function, location;
+  libspectrum_word function_address, address;
+  libspectrum_qword tstates;
+} profile_cost_t;
+
+/* Calls from one location in one function to another function */
+typedef struct profile_call_t {
+  profile_location function, callsite, callee;
+  libspectrum_word function_address, callsite_address, callee_address;
+  libspectrum_qword calls, inclusive;
+} profile_call_t;
+
+/* One entry on the shadow call stack */
+typedef struct profile_frame_t {
+  profile_location function, callsite;
+  libspectrum_word function_address, callsite_address;
+  libspectrum_word sp;
+  libspectrum_dword start;
+} profile_frame_t;
+
+#define PROFILE_MAX_DEPTH 1024
+
+static int call_graph = 0;
+
+static GHashTable *costs, *calls;
+
+static profile_frame_t frames[ PROFILE_MAX_DEPTH ];
+static size_t depth;
+
+static profile_location last_location;
+static libspectrum_byte last_opcode;
+static libspectrum_word last_sp;
+
+/* Details of an interrupt accepted since the last opcode */
+static int interrupt_pending = 0;
+static profile_location interrupt_location;
+static libspectrum_word interrupt_pc, interrupt_sp;
+
 static void profile_from_snapshot( libspectrum_snap *snap GCC_UNUSED );
 
 static module_info_t profile_module_info = {
@@ -73,11 +139,190 @@ profile_register_startup( void )
                             NULL );
 }
 
+static profile_location
+get_location( libspectrum_word address )
+{
+  memory_page *page =
+    &memory_map_read[ address >> MEMORY_PAGE_SIZE_LOGARITHM ];
+
+  return ( ( page->source & 0xff ) << 24 ) | ( ( page->page_num & 0xff ) << 16 ) |
+         ( ( page->offset + ( address & MEMORY_PAGE_SIZE_MASK ) ) & 0xffff );
+}
+
+static guint
+cost_hash( gconstpointer key )
+{
+  const profile_cost_t *cost = key;
+  return cost->function * 31 + cost->location;
+}
+
+static gboolean
+cost_equal( gconstpointer a, gconstpointer b )
+{
+  const profile_cost_t *cost1 = a, *cost2 = b;
+  return cost1->function == cost2->function &&
+         cost1->location == cost2->location;
+}
+
+static guint
+call_hash( gconstpointer key )
+{
+  const profile_call_t *call = key;
+  return ( call->function * 31 + call->callsite ) * 31 + call->callee;
+}
+
+static gboolean
+call_equal( gconstpointer a, gconstpointer b )
+{
+  const profile_call_t *call1 = a, *call2 = b;
+  return call1->function == call2->function &&
+         call1->callsite == call2->callsite &&
+         call1->callee == call2->callee;
+}
+
+static void
+frame_push( profile_location function, libspectrum_word function_address,
+            profile_location callsite, libspectrum_word callsite_address,
+            libspectrum_word sp )
+{
+  profile_frame_t *frame;
+
+  /* Anything deeper than this is attributed to the deepest function */
+  if( depth == PROFILE_MAX_DEPTH ) return;
+
+  frame = &frames[ depth++ ];
+  frame->function = function;
+  frame->function_address = function_address;
+  frame->callsite = callsite;
+  frame->callsite_address = callsite_address;
+  frame->sp = sp;
+  frame->start = tstates;
+}
+
+static void
+frame_pop( void )
+{
+  profile_frame_t *frame = &frames[ depth - 1 ], *caller = &frames[ depth - 2 ];
+  profile_call_t key, *call;
+
+  key.function = caller->function;
+  key.callsite = frame->callsite;
+  key.callee = frame->function;
+
+  call = g_hash_table_lookup( calls, &key );
+  if( !call ) {
+    call = libspectrum_new( profile_call_t, 1 );
+    *call = key;
+    call->function_address = caller->function_address;
+    call->callsite_address = frame->callsite_address;
+    call->callee_address = frame->function_address;
+    call->calls = call->inclusive = 0;
+    g_hash_table_insert( calls, call, call );
+  }
+
+  call->calls++;
+  call->inclusive += tstates - frame->start;
+
+  depth--;
+}
+
+static void
+add_cost( libspectrum_dword delta )
+{
+  profile_frame_t *frame = &frames[ depth - 1 ];
+  profile_cost_t key, *cost;
+
+  key.function = frame->function;
+  key.location = last_location;
+
+  cost = g_hash_table_lookup( costs, &key );
+  if( !cost ) {
+    cost = libspectrum_new( profile_cost_t, 1 );
+    *cost = key;
+    cost->function_address = frame->function_address;
+    cost->address = profile_last_pc;
+    cost->tstates = 0;
+    g_hash_table_insert( costs, cost, cost );
+  }
+
+  cost->tstates += delta;
+}
+
+/* Is 'opcode' a CALL, conditional CALL or RST? */
+static int
+is_call( libspectrum_byte opcode )
+{
+  return opcode == 0xcd || ( opcode & 0xc7 ) == 0xc4 ||
+         ( opcode & 0xc7 ) == 0xc7;
+}
+
+static void
+call_graph_map( libspectrum_word pc, libspectrum_dword delta )
+{
+  profile_location after;
+  libspectrum_word after_address, sp_after;
+
+  add_cost( delta );
+
+  /* Where the last instruction left things, before any interrupt */
+  if( interrupt_pending ) {
+    after = interrupt_location; after_address = interrupt_pc;
+    sp_after = interrupt_sp;
+  } else {
+    after = get_location( pc ); after_address = pc;
+    sp_after = SP;
+  }
+
+  /* Leave any functions whose return address is now off the stack */
+  while( depth > 1 &&
+         (libspectrum_signed_word)( sp_after - frames[ depth - 1 ].sp ) > 0 )
+    frame_pop();
+
+  /* A taken CALL or RST pushes the return address */
+  if( is_call( last_opcode ) && sp_after == (libspectrum_word)( last_sp - 2 ) )
+    frame_push( after, after_address, last_location, profile_last_pc,
+                sp_after );
+
+  if( interrupt_pending ) {
+    frame_push( get_location( pc ), pc, interrupt_location, interrupt_pc, SP );
+    interrupt_pending = 0;
+  }
+
+  last_location = get_location( pc );
+  last_opcode = readbyte_internal( pc );
+  last_sp = SP;
+}
+
+static void
+call_graph_reset( void )
+{
+  /* Anything still on the stack is finished as far as we're concerned */
+  while( depth > 1 ) frame_pop();
+
+  depth = 0;
+  frame_push( get_location( PC ), PC, get_location( PC ), PC, SP );
+
+  last_location = get_location( PC );
+  last_opcode = readbyte_internal( PC );
+  last_sp = SP;
+  interrupt_pending = 0;
+}
+
+static void
+call_graph_free( void )
+{
+  if( costs ) { g_hash_table_destroy( costs ); costs = NULL; }
+  if( calls ) { g_hash_table_destroy( calls ); calls = NULL; }
+  depth = 0;
+}
+
 static void
 init_profiling_counters( void )
 {
   profile_last_pc = z80.pc.w;
   profile_last_tstates = tstates;
+
+  if( call_graph ) call_graph_reset();
 }
 
 void
@@ -85,6 +330,15 @@ profile_start( void )
 {
   memset( total_tstates, 0, sizeof( total_tstates ) );
 
+  call_graph_free();
+  call_graph = settings_current.profile_call_graph;
+  if( call_graph ) {
+    costs = g_hash_table_new_full( cost_hash, cost_equal, NULL,
+                                   libspectrum_free );
+    calls = g_hash_table_new_full( call_hash, call_equal, NULL,
+                                   libspectrum_free );
+  }
+
   profile_active = 1;
   init_profiling_counters();
 
@@ -99,18 +353,37 @@ profile_start( void )
 void
 profile_map( libspectrum_word pc )
 {
-  if( tstates - profile_last_tstates > 256 ) fuse_abort();
+  libspectrum_dword delta = tstates - profile_last_tstates;
+
+  total_tstates[ profile_last_pc ] += delta;
 
-  total_tstates[ profile_last_pc ] += tstates - profile_last_tstates;
+  if( call_graph ) call_graph_map( pc, delta );
 
   profile_last_pc = z80.pc.w;
   profile_last_tstates = tstates;
 }
 
+/* Called when an interrupt is accepted, before the return address is
+   pushed */
+void
+profile_interrupt( void )
+{
+  if( !call_graph ) return;
+
+  interrupt_pending = 1;
+  interrupt_pc = PC;
+  interrupt_sp = SP;
+  interrupt_location = get_location( PC );
+}
+
 void
 profile_frame( libspectrum_dword frame_length )
 {
+  size_t i;
+
   profile_last_tstates -= frame_length;
+
+  for( i = 0; i < depth; i++ ) frames[ i ].start -= frame_length;
 }
 
 /* On snapshot load, PC and the tstate counter will jump so reset our
@@ -121,6 +394,73 @@ profile_from_snapshot( libspectrum_snap *snap GCC_UNUSED )
   init_profiling_counters();
 }
 
+static void
+write_location( FILE *f, profile_location location, libspectrum_word address )
+{
+  fprintf( f, " %lu %lu 0x%04lx 0x%04x", (unsigned long)( location >> 24 ),
+           (unsigned long)( ( location >> 16 ) & 0xff ),
+           (unsigned long)( location & 0xffff ), address );
+}
+
+static void
+write_cost( gpointer key GCC_UNUSED, gpointer value, gpointer user_data )
+{
+  const profile_cost_t *cost = value;
+  FILE *f = user_data;
+
+  fprintf( f, "self" );
+  write_location( f, cost->function, cost->function_address );
+  write_location( f, cost->location, cost->address );
+  fprintf( f, " %" PRIu64 "\n", cost->tstates );
+}
+
+static void
+write_call( gpointer key GCC_UNUSED, gpointer value, gpointer user_data )
+{
+  const profile_call_t *call = value;
+  FILE *f = user_data;
+
+  fprintf( f, "call" );
+  write_location( f, call->function, call->function_address );
+  write_location( f, call->callsite, call->callsite_address );
+  write_location( f, call->callee, call->callee_address );
+  fprintf( f, " %" PRIu64 " %" PRIu64 "\n", call->calls, call->inclusive );
+}
+
+static void
+mark_source( gpointer key GCC_UNUSED, gpointer value, gpointer user_data )
+{
+  const profile_cost_t *cost = value;
+  libspectrum_byte *used = user_data;
+
+  used[ cost->function >> 24 ] = 1;
+  used[ cost->location >> 24 ] = 1;
+}
+
+/* Write the call graph profile. The format is described in the
+   profile2callgrind man page in fuse-utils */
+static void
+write_call_graph( FILE *f )
+{
+  libspectrum_byte used[ 0x100 ];
+  size_t i;
+
+  while( depth > 1 ) frame_pop();
+
+  memset( used, 0, sizeof( used ) );
+  g_hash_table_foreach( costs, mark_source, used );
+
+  fprintf( f, "# Fuse profile 2\n" );
+
+  for( i = 0; i < 0x100; i++ )
+    if( used[ i ] )
+      fprintf( f, "source %lu %s\n", (unsigned long)i,
+               memory_source_description( i ) );
+
+  g_hash_table_foreach( costs, write_cost, f );
+  g_hash_table_foreach( calls, write_call, f );
+}
+
 void
 profile_finish( const char *filename )
 {
@@ -134,16 +474,23 @@ profile_finish( const char *filename )
     return;
   }
 
-  for( i = 0; i < 0x10000; i++ ) {
+  if( call_graph ) {
+    write_call_graph( f );
+  } else {
+    for( i = 0; i < 0x10000; i++ ) {
 
-    if( !total_tstates[ i ] ) continue;
+      if( !total_tstates[ i ] ) continue;
 
-    fprintf( f, "0x%04lx,%d\n", (unsigned long)i, total_tstates[ i ] );
+      fprintf( f, "0x%04lx,%d\n", (unsigned long)i, total_tstates[ i ] );
 
+    }
   }
 
   fclose( f );
 
+  call_graph_free();
+  call_graph = 0;
+
   profile_active = 0;
 
   /* Again, schedule an event to ensure this change is picked up by
@@ -31,6 +31,7 @@ extern int profile_active;
 void profile_register_startup( void );
 void profile_start( void );
 void profile_map( libspectrum_word pc );
+void profile_interrupt( void );
 void profile_frame( libspectrum_dword frame_length );
 void profile_finish( const char *filename );
 
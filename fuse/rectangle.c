@@ -42,6 +42,48 @@ static size_t rectangle_active_count = 0, rectangle_active_allocated = 0;
 struct rectangle *rectangle_inactive = NULL;
 size_t rectangle_inactive_count = 0, rectangle_inactive_allocated = 0;
 
+#ifndef MAX
+#define MAX(a,b)    (((a) > (b)) ? (a) : (b))
+#define MIN(a,b)    (((a) < (b)) ? (a) : (b))
+#endif
+
+/* The most 8 pixel wide chunks which may be redrawn unnecessarily to
+   avoid passing the UI another rectangle; a little less than a full line
+   of the screen, as each rectangle costs the UI a call into the scaler
+   and a copy to the screen */
+#define RECTANGLE_MAX_OVERDRAW 32
+
+/* Try to widen rectangle so it covers { x, y, w, 1 } as well, if that
+   doesn't redraw too much which hasn't changed */
+static int
+coalesce_rectangle( struct rectangle *rectangle, int y, int x, int w )
+{
+  int left, right, height, overdraw;
+
+  /* Only rectangles which reach the line above, or this line */
+  if( rectangle->y + rectangle->h == y ) {
+    height = rectangle->h + 1;
+  } else if( rectangle->y + rectangle->h == y + 1 ) {
+    height = rectangle->h;
+  } else {
+    return 0;
+  }
+
+  /* And which overlap or touch horizontally */
+  if( x > rectangle->x + rectangle->w || rectangle->x > x + w ) return 0;
+
+  left = MIN( rectangle->x, x );
+  right = MAX( rectangle->x + rectangle->w, x + w );
+
+  overdraw = ( right - left ) * height - rectangle->w * rectangle->h - w;
+  if( overdraw > RECTANGLE_MAX_OVERDRAW ) return 0;
+
+  rectangle->x = left; rectangle->w = right - left;
+  rectangle->h = height;
+
+  return 1;
+}
+
 /* Add the rectangle { x, line, w, 1 } to the list of rectangles to be
    redrawn, either by extending an existing rectangle or creating a
    new one */
@@ -63,6 +105,12 @@ rectangle_add( int y, int x, int w )
     }
   }
 
+  /* Failing that, see if we can merge it into a vertically adjacent
+     rectangle of a different width, as happens with scrolling text and
+     sprites */
+  for( i = 0; i < rectangle_active_count; i++ )
+    if( coalesce_rectangle( &rectangle_active[i], y, x, w ) ) return;
+
   /* We couldn't find a rectangle to extend, so create a new one */
   if( ++rectangle_active_count > rectangle_active_allocated ) {
 
@@ -83,11 +131,6 @@ rectangle_add( int y, int x, int w )
   ptr->w = w; ptr->h = 1;
 }
 
-#ifndef MAX
-#define MAX(a,b)    (((a) > (b)) ? (a) : (b))
-#define MIN(a,b)    (((a) < (b)) ? (a) : (b))
-#endif
-
 static inline int
 compare_and_merge_rectangles( struct rectangle *source )
 {
@@ -0,0 +1,410 @@
+/* rewind.c: Go back to recent states of the emulated machine
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <string.h>
+
+#include <libspectrum.h>
+
+#include "compat.h"
+#include "display.h"
+#include "infrastructure/startup_manager.h"
+#include "memory.h"
+#include "rewind.h"
+#include "rzx.h"
+#include "settings.h"
+#include "snapshot.h"
+#include "spectrum.h"
+#include "ui/ui.h"
+
+/* Each rewind point is a snapshot of everything apart from RAM, taken
+   through the usual module hooks so every peripheral is included. Copying
+   all of RAM each time would cost over a megabyte, so instead a copy of
+   RAM as it was at the most recent point is kept, and each point holds
+   only the differences in the 2 KB chunks written to since the point
+   before it. Going back means undoing those differences, newest first.
+
+   The differences are stored as the bytes which changed, exclusive-ORed
+   with their old values, in runs of
+
+     2 bytes	number of unchanged bytes to skip
+     2 bytes	number of changed bytes which follow
+     n bytes	the changed bytes
+
+   and so can be applied to the old contents to get the new or vice
+   versa */
+
+typedef struct rewind_chunk {
+  int index;			/* memory_page.ram_chunk */
+  libspectrum_byte *data;
+  size_t length;
+} rewind_chunk;
+
+typedef struct rewind_point {
+  libspectrum_snap *snap;
+  rewind_chunk *chunks;
+  size_t chunk_count;
+  size_t size;			/* What this point counts against the budget */
+} rewind_point;
+
+/* A rough allowance for the snapshot structure itself, on top of the
+   peripheral memory it holds and the RAM differences for each point. Some
+   peripherals copy a lot of memory into every snapshot (a megabyte for
+   the ZXCF), so that must be counted against the budget too */
+#define POINT_OVERHEAD 8192
+
+/* Unchanged runs shorter than this are stored along with the changed bytes
+   around them */
+#define MIN_SKIP 4
+
+/* The rewind points, oldest first, in a ring of point_allocated entries
+   starting at point_first */
+static rewind_point *points;
+static size_t point_first, point_count, point_allocated;
+
+/* The total size of all the points */
+static size_t total_size;
+
+/* RAM as it was at the most recent point, in ram_chunk order */
+static libspectrum_byte *shadow;
+
+/* Frames since the last point was stored */
+static size_t frame_count;
+
+/* Set after going back to a point, as the end of frame that point was
+   taken at is about to happen again */
+static int skip_next_point;
+
+/* The RAM written to since the last point */
+static memory_ram_tracker tracker;
+
+static rewind_point*
+get_point( size_t n )
+{
+  return &points[ ( point_first + n ) % point_allocated ];
+}
+
+static libspectrum_byte*
+chunk_memory( int index )
+{
+  index--;
+  return RAM[ index / MEMORY_PAGES_IN_16K ] +
+         ( index % MEMORY_PAGES_IN_16K ) * MEMORY_PAGE_SIZE;
+}
+
+static libspectrum_byte*
+chunk_shadow( int index )
+{
+  return shadow + ( index - 1 ) * MEMORY_PAGE_SIZE;
+}
+
+static libspectrum_byte*
+put_word( libspectrum_byte *ptr, size_t value )
+{
+  *ptr++ = value & 0xff; *ptr++ = value >> 8;
+  return ptr;
+}
+
+/* Store the differences between a chunk of RAM and its shadow copy,
+   returning zero if there are none */
+static int
+store_chunk( rewind_chunk *chunk, int index )
+{
+  /* Runs of changed bytes are separated by at least MIN_SKIP unchanged
+     bytes, so this is the most the differences can take */
+  static libspectrum_byte
+    buffer[ MEMORY_PAGE_SIZE + 4 * ( MEMORY_PAGE_SIZE / MIN_SKIP + 1 ) ];
+  const libspectrum_byte *now = chunk_memory( index );
+  const libspectrum_byte *before = chunk_shadow( index );
+  libspectrum_byte *ptr = buffer;
+  size_t i = 0, start, literal, same;
+
+  while( i < MEMORY_PAGE_SIZE ) {
+
+    for( start = i; i < MEMORY_PAGE_SIZE && now[i] == before[i]; i++ )
+      ;
+    if( i == MEMORY_PAGE_SIZE ) break;
+    ptr = put_word( ptr, i - start );
+
+    for( literal = i; i < MEMORY_PAGE_SIZE; ) {
+      if( now[i] != before[i] ) { i++; continue; }
+      for( same = i;
+           same < MEMORY_PAGE_SIZE && same - i < MIN_SKIP &&
+             now[ same ] == before[ same ];
+           same++ )
+        ;
+      if( same == MEMORY_PAGE_SIZE || same - i == MIN_SKIP ) break;
+      i = same;
+    }
+    ptr = put_word( ptr, i - literal );
+
+    for( ; literal < i; literal++ ) *ptr++ = now[ literal ] ^ before[ literal ];
+  }
+
+  if( ptr == buffer ) return 0;
+
+  chunk->index = index;
+  chunk->length = ptr - buffer;
+  chunk->data = libspectrum_new( libspectrum_byte, chunk->length );
+  memcpy( chunk->data, buffer, chunk->length );
+
+  return 1;
+}
+
+/* Undo (or redo) the differences held in a chunk on the shadow copy */
+static void
+apply_chunk( const rewind_chunk *chunk )
+{
+  libspectrum_byte *dest = chunk_shadow( chunk->index );
+  const libspectrum_byte *ptr = chunk->data, *end = ptr + chunk->length;
+  size_t offset = 0, skip, length;
+
+  while( end - ptr >= 4 ) {
+    skip = ptr[0] | ( ptr[1] << 8 );
+    length = ptr[2] | ( ptr[3] << 8 );
+    ptr += 4;
+
+    offset += skip;
+    if( offset + length > MEMORY_PAGE_SIZE || length > (size_t)( end - ptr ) )
+      break;
+
+    for( ; length; length-- ) dest[ offset++ ] ^= *ptr++;
+  }
+}
+
+static void
+free_point( rewind_point *point )
+{
+  size_t i;
+
+  for( i = 0; i < point->chunk_count; i++ )
+    libspectrum_free( point->chunks[i].data );
+  libspectrum_free( point->chunks );
+  libspectrum_snap_free( point->snap );
+
+  total_size -= point->size;
+}
+
+static void
+grow_points( void )
+{
+  rewind_point *new_points;
+  size_t i, new_allocated;
+
+  new_allocated = point_allocated ? 2 * point_allocated : 64;
+  new_points = libspectrum_new( rewind_point, new_allocated );
+
+  for( i = 0; i < point_count; i++ ) new_points[i] = *get_point( i );
+
+  libspectrum_free( points );
+  points = new_points;
+  point_allocated = new_allocated;
+  point_first = 0;
+}
+
+static int
+add_point( void )
+{
+  rewind_point *point;
+  libspectrum_snap *snap;
+  size_t i, count;
+  int error;
+
+  snap = libspectrum_snap_alloc();
+
+  memory_snapshot_ram = 0;
+  error = snapshot_copy_to( snap );
+  memory_snapshot_ram = 1;
+  if( error ) { libspectrum_snap_free( snap ); return error; }
+
+  if( point_count == point_allocated ) grow_points();
+
+  point = get_point( point_count );
+  point->snap = snap;
+  point->chunks = NULL;
+  point->chunk_count = 0;
+  point->size = POINT_OVERHEAD + libspectrum_snap_memory_size( snap );
+
+  memory_ram_update_trackers();
+
+  if( !point_count ) {
+
+    /* Nothing to go back to yet, just a copy of RAM to start from */
+    if( !shadow )
+      shadow = libspectrum_new( libspectrum_byte,
+                                ( MEMORY_RAM_CHUNKS - 1 ) * MEMORY_PAGE_SIZE );
+    for( i = 1; i < MEMORY_RAM_CHUNKS; i++ )
+      memcpy( chunk_shadow( i ), chunk_memory( i ), MEMORY_PAGE_SIZE );
+
+  } else {
+
+    for( i = 1, count = 0; i < MEMORY_RAM_CHUNKS; i++ )
+      if( tracker.dirty[i] ) count++;
+
+    if( count ) point->chunks = libspectrum_new( rewind_chunk, count );
+
+    for( i = 1; i < MEMORY_RAM_CHUNKS; i++ ) {
+      if( !tracker.dirty[i] ) continue;
+
+      if( store_chunk( &point->chunks[ point->chunk_count ], i ) ) {
+        point->size += sizeof( rewind_chunk ) +
+                       point->chunks[ point->chunk_count ].length;
+        point->chunk_count++;
+        memcpy( chunk_shadow( i ), chunk_memory( i ), MEMORY_PAGE_SIZE );
+      }
+    }
+
+  }
+
+  memory_ram_clean( &tracker );
+
+  point_count++;
+  total_size += point->size;
+
+  return 0;
+}
+
+/* The oldest point's differences take RAM from the point before it, which
+   has already gone, so they are never needed */
+static void
+drop_oldest_point( void )
+{
+  free_point( get_point( 0 ) );
+
+  point_first = ( point_first + 1 ) % point_allocated;
+  point_count--;
+}
+
+void
+rewind_frame( void )
+{
+  size_t interval, budget;
+
+  /* Rewinding would break an RZX recording, which has rollback instead */
+  if( !settings_current.rewind || rzx_recording || rzx_playback ) {
+    if( point_count ) rewind_reset();
+    return;
+  }
+
+  if( skip_next_point ) {
+    skip_next_point = 0;
+    return;
+  }
+
+  interval = settings_current.rewind_interval > 0 ?
+             settings_current.rewind_interval : 1;
+  if( ++frame_count < interval ) return;
+  frame_count = 0;
+
+  if( add_point() ) return;
+
+  budget = settings_current.rewind_size > 0 ?
+           (size_t)settings_current.rewind_size * 1024 * 1024 : 0;
+  while( point_count > 1 && total_size > budget ) drop_oldest_point();
+}
+
+int
+rewind_back( size_t steps )
+{
+  rewind_point *point;
+  size_t target, i;
+  int error;
+
+  if( !point_count ) return 1;
+
+  target = steps < point_count ? point_count - 1 - steps : 0;
+
+  error = snapshot_copy_from( get_point( target )->snap );
+  if( error ) return error;
+
+  while( point_count > target + 1 ) {
+    point = get_point( point_count - 1 );
+    for( i = 0; i < point->chunk_count; i++ ) apply_chunk( &point->chunks[i] );
+    free_point( point );
+    point_count--;
+  }
+
+  /* The snapshot may have come from a different machine, and resetting
+     the machine may have changed anything, so copy back all of RAM */
+  for( i = 1; i < MEMORY_RAM_CHUNKS; i++ )
+    memcpy( chunk_memory( i ), chunk_shadow( i ), MEMORY_PAGE_SIZE );
+
+  memory_ram_clean( &tracker );
+  display_refresh_all();
+
+  frame_count = 0;
+  skip_next_point = 1;
+
+  return 0;
+}
+
+size_t
+rewind_total_size( void )
+{
+  return total_size;
+}
+
+void
+rewind_reset( void )
+{
+  while( point_count ) drop_oldest_point();
+
+  frame_count = 0;
+  skip_next_point = 0;
+}
+
+static int
+rewind_init( void *context GCC_UNUSED )
+{
+  memory_ram_track( &tracker );
+
+  return 0;
+}
+
+static void
+rewind_end( void )
+{
+  rewind_reset();
+
+  libspectrum_free( points );
+  points = NULL;
+  point_allocated = 0;
+
+  libspectrum_free( shadow );
+  shadow = NULL;
+}
+
+void
+rewind_register_startup( void )
+{
+  startup_manager_module dependencies[] = {
+    STARTUP_MANAGER_MODULE_MEMORY,
+    STARTUP_MANAGER_MODULE_SETUID,
+  };
+  startup_manager_register( STARTUP_MANAGER_MODULE_REWIND, dependencies,
+                            ARRAY_SIZE( dependencies ), rewind_init, NULL,
+                            rewind_end );
+}
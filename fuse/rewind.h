@@ -0,0 +1,48 @@
+/* rewind.h: Go back to recent states of the emulated machine
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#ifndef FUSE_REWIND_H
+#define FUSE_REWIND_H
+
+#include <stddef.h>
+
+void rewind_register_startup( void );
+
+/* Called at the end of every frame to store a rewind point every
+   settings_current.rewind_interval frames */
+void rewind_frame( void );
+
+/* Go back to the rewind point steps before the most recent one, or to the
+   oldest if there aren't that many; returns non-zero if there are none */
+int rewind_back( size_t steps );
+
+/* The memory counted against settings_current.rewind_size by the current
+   rewind points */
+size_t rewind_total_size( void );
+
+/* Forget all the rewind points */
+void rewind_reset( void );
+
+#endif			/* #ifndef FUSE_REWIND_H */
@@ -35,11 +35,13 @@
 #include <windows.h>
 #endif				/* #ifdef WIN32 */
 
+#include "batch.h"
 #include "debugger/debugger.h"
 #include "event.h"
 #include "fuse.h"
 #include "infrastructure/startup_manager.h"
 #include "machine.h"
+#include "memory.h"
 #include "movie.h"
 #include "peripherals/ula.h"
 #include "rzx.h"
@@ -64,6 +66,15 @@ size_t rzx_in_count;
 /* The number of frames we've recorded in this RZX file */
 static size_t autosave_frame_count;
 
+/* The number of autosaves since the last one holding every RAM page */
+static size_t autosave_delta_count;
+
+/* Must the next autosave hold every RAM page? */
+static int autosave_keyframe_needed;
+
+/* The RAM written to since the last autosave */
+static memory_ram_tracker autosave_tracker;
+
 /* And the values of those bytes */
 libspectrum_byte *rzx_in_bytes;
 
@@ -101,8 +112,9 @@ libspectrum_rzx_dsa_key rzx_key = {
    a competition mode RZX file */
 static const float SPEED_TOLERANCE = 5;
 
-/* How often will we create an autosave file */
-static const size_t AUTOSAVE_INTERVAL = 5 * 50;
+/* How often an autosave holds every RAM page, rather than just those
+   written to since the previous autosave */
+static const size_t AUTOSAVE_KEYFRAME_INTERVAL = 50;
 
 /* Debugger events */
 static const char * const event_type_string = "rzx";
@@ -130,6 +142,8 @@ rzx_init( void *context )
 
   sentinel_event = event_register( rzx_sentinel, "RZX sentinel" );
 
+  memory_ram_track( &autosave_tracker );
+
   end_event = debugger_event_register( event_type_string, end_event_detail_string );
 
   return 0;
@@ -156,6 +170,146 @@ rzx_add_snap( libspectrum_rzx *to_rzx, int automatic )
   return 0;
 }
 
+/* Autosaves normally hold only the RAM pages written to since the previous
+   autosave; a missing page is the same as in the autosave before it. Every
+   so often, and whenever the dirty page information can't be trusted, an
+   autosave holding every page is made instead */
+static int
+autosave_add_snap( void )
+{
+  int error, keyframe;
+  size_t i;
+  libspectrum_snap *snap = libspectrum_snap_alloc();
+
+  error = snapshot_copy_to( snap );
+  if( error ) {
+    libspectrum_snap_free( snap );
+    return error;
+  }
+
+  keyframe = autosave_keyframe_needed ||
+             ++autosave_delta_count >= AUTOSAVE_KEYFRAME_INTERVAL;
+
+  if( keyframe ) {
+    autosave_delta_count = 0;
+  } else {
+    for( i = 0; i < MEMORY_SNAPSHOT_RAM_PAGES; i++ ) {
+      if( !memory_ram_page_dirty( &autosave_tracker, i ) ) {
+        libspectrum_free( libspectrum_snap_pages( snap, i ) );
+        libspectrum_snap_set_pages( snap, i, NULL );
+      }
+    }
+  }
+
+  error = libspectrum_rzx_add_snap( rzx, snap, 1 );
+  if( error ) {
+    libspectrum_snap_free( snap );
+    return error;
+  }
+
+  memory_ram_clean( &autosave_tracker );
+  autosave_keyframe_needed = 0;
+
+  return 0;
+}
+
+/* Fill in the pages missing from each autosave up to and including until
+   (or all of them if until is NULL) with those from the autosaves before
+   it. The pages are only lent, and must be handed back with
+   autosave_return_pages() before any autosave is changed or freed */
+static void
+autosave_borrow_pages( libspectrum_rzx *from_rzx, libspectrum_snap *until )
+{
+  libspectrum_byte *last[ MEMORY_SNAPSHOT_RAM_PAGES ];
+  libspectrum_rzx_iterator it;
+  libspectrum_snap *snap;
+  size_t i;
+
+  memset( last, 0, sizeof( last ) );
+
+  for( it = libspectrum_rzx_iterator_begin( from_rzx );
+       it;
+       it = libspectrum_rzx_iterator_next( it ) ) {
+
+    if( !libspectrum_rzx_iterator_snap_is_automatic( it ) ) continue;
+
+    snap = libspectrum_rzx_iterator_get_snap( it );
+
+    for( i = 0; i < MEMORY_SNAPSHOT_RAM_PAGES; i++ ) {
+      if( libspectrum_snap_pages( snap, i ) )
+        last[i] = libspectrum_snap_pages( snap, i );
+      else
+        libspectrum_snap_set_pages( snap, i, last[i] );
+    }
+
+    if( snap == until ) break;
+  }
+}
+
+/* Undo autosave_borrow_pages(): a borrowed page is the very same buffer as
+   in the autosave before, whereas every page an autosave owns is its own
+   copy */
+static void
+autosave_return_pages( libspectrum_rzx *from_rzx )
+{
+  libspectrum_byte *last[ MEMORY_SNAPSHOT_RAM_PAGES ], *page;
+  libspectrum_rzx_iterator it;
+  libspectrum_snap *snap;
+  size_t i;
+
+  memset( last, 0, sizeof( last ) );
+
+  for( it = libspectrum_rzx_iterator_begin( from_rzx );
+       it;
+       it = libspectrum_rzx_iterator_next( it ) ) {
+
+    if( !libspectrum_rzx_iterator_snap_is_automatic( it ) ) continue;
+
+    snap = libspectrum_rzx_iterator_get_snap( it );
+
+    for( i = 0; i < MEMORY_SNAPSHOT_RAM_PAGES; i++ ) {
+      page = libspectrum_snap_pages( snap, i );
+      if( page && page == last[i] )
+        libspectrum_snap_set_pages( snap, i, NULL );
+      else
+        last[i] = page;
+    }
+  }
+}
+
+/* Before deleting an autosave, give the pages the next autosave is
+   relying on it for to that autosave */
+static void
+autosave_pass_on_pages( libspectrum_rzx_iterator autosave )
+{
+  libspectrum_rzx_iterator it;
+  libspectrum_snap *snap, *next;
+  libspectrum_byte *page;
+  size_t i;
+
+  for( it = libspectrum_rzx_iterator_next( autosave );
+       it;
+       it = libspectrum_rzx_iterator_next( it ) )
+    if( libspectrum_rzx_iterator_snap_is_automatic( it ) ) break;
+
+  if( !it ) {
+    /* The next autosave would have been relative to this one */
+    autosave_keyframe_needed = 1;
+    return;
+  }
+
+  snap = libspectrum_rzx_iterator_get_snap( autosave );
+  next = libspectrum_rzx_iterator_get_snap( it );
+
+  for( i = 0; i < MEMORY_SNAPSHOT_RAM_PAGES; i++ ) {
+    page = libspectrum_snap_pages( snap, i );
+    if( page && !libspectrum_snap_pages( next, i ) ) {
+      libspectrum_snap_set_pages( next, i, page );
+      libspectrum_snap_set_pages( snap, i, NULL );
+    }
+  }
+}
+
 int rzx_start_recording( const char *filename, int embed_snapshot )
 {
   int error;
@@ -210,10 +364,12 @@ int rzx_stop_recording( void )
 
   length = 0;
   buffer = NULL;
+  autosave_borrow_pages( rzx, NULL );
   libspec_error = libspectrum_rzx_write(
     &buffer, &length, rzx, LIBSPECTRUM_ID_SNAPSHOT_SZX, fuse_creator,
     settings_current.rzx_compression, rzx_competition_mode ? &rzx_key : NULL
   );
+  autosave_return_pages( rzx );
   if( libspec_error != LIBSPECTRUM_ERROR_NONE ) {
     libspectrum_free( rzx_filename );
     libspectrum_rzx_free( rzx );
@@ -407,6 +563,8 @@ int rzx_stop_playback( int add_interrupt )
 
   debugger_event( end_event );
 
+  batch_rzx_finished();
+
   return 0;
 }  
 
@@ -418,6 +576,8 @@ start_recording( libspectrum_rzx *to_rzx, int competition_mode )
   counter_reset();
   rzx_in_count = 0;
   autosave_frame_count = 0;
+  autosave_delta_count = 0;
+  autosave_keyframe_needed = 1;
 
   rzx_recording = 1;
 
@@ -545,11 +705,26 @@ int rzx_frame( void )
   return 0;
 }
 
+/* The number of frames between autosaves */
+static size_t
+autosave_interval( void )
+{
+  return settings_current.rzx_autosave_interval > 0 ?
+         settings_current.rzx_autosave_interval : 1;
+}
+
 typedef struct prune_info_t {
   libspectrum_rzx_iterator it;
   size_t frames;
 } prune_info_t;
 
+/* Has an autosave just become age frames old? */
+static int
+autosave_reached( size_t frames, size_t age )
+{
+  return frames >= age && frames - age < autosave_interval();
+}
+
 static void
 autosave_prune( void )
 {
@@ -590,13 +765,15 @@ autosave_prune( void )
     prune_info_t save1 = g_array_index( autosaves, prune_info_t, i ),
       save2 = g_array_index( autosaves, prune_info_t, i - 1 );
 
-    if( ( save1.frames == 15 * 50 ||
-          save1.frames == 60 * 50 ||
-	  save1.frames == 300 * 50   ) &&
+    if( ( autosave_reached( save1.frames, 15 * 50 ) ||
+          autosave_reached( save1.frames, 60 * 50 ) ||
+          autosave_reached( save1.frames, 300 * 50 ) ) &&
 	save2.frames < 2 * save1.frames
-      )
+      ) {
       /* FIXME: could possibly merge adjacent IRBs here */
+      autosave_pass_on_pages( save1.it );
       libspectrum_rzx_iterator_delete( rzx, save1.it );
+    }
   }
 
   g_array_free( autosaves, TRUE );
@@ -605,9 +782,9 @@ autosave_prune( void )
 static void
 autosave_frame( void )
 {
-  if( ++autosave_frame_count % AUTOSAVE_INTERVAL ) return;
+  if( ++autosave_frame_count % autosave_interval() ) return;
 
-  rzx_add_snap( rzx, 1 );
+  autosave_add_snap();
 
   libspectrum_rzx_start_input( rzx, tstates );
 
@@ -644,7 +821,7 @@ autosave_reset( void )
   }
 
   /* Reset the frame count. Allow to prune previous points after rolling back */
-  autosave_frame_count = frames % AUTOSAVE_INTERVAL;
+  autosave_frame_count = frames % autosave_interval();
 }
 
 static int recording_frame( void )
@@ -809,9 +986,14 @@ start_after_rollback( libspectrum_snap *snap )
 {
   int error;
 
+  autosave_borrow_pages( rzx, snap );
   error = snapshot_copy_from( snap );
+  autosave_return_pages( rzx );
   if( error ) return error;
 
+  /* The RAM no longer matches the last autosave */
+  autosave_keyframe_needed = 1;
+
   libspectrum_rzx_start_input( rzx, tstates );
 
   error = counter_reset();
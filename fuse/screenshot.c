@@ -456,6 +456,7 @@ screenshot_scr_read( const char *filename )
 
   utils_close_file( &screen );
 
+  memory_ram_mark_dirty( memory_current_screen );
   display_refresh_all();
 
   return error;
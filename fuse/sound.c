@@ -24,10 +24,6 @@
 
 */
 
-/* The AY white noise RNG algorithm is based on info from MAME's ay8910.c -
- * MAME's licence explicitly permits free use of info (even encourages it).
- */
-
 #include <config.h>
 
 #include "fuse.h"
@@ -39,6 +35,8 @@
 #include "sound.h"
 #include "tape.h"
 #include "ui/ui.h"
+#include "sound/audioring.h"
+#include "sound/aysynth.h"
 #include "sound/blipbuffer.h"
 
 /* Do we have any of our sound devices available? */
@@ -68,23 +66,24 @@ int sound_framesiz;
 
 static int sound_channels;
 
-static unsigned int ay_tone_levels[16];
+/* Room for this many samples per channel, enough for a frame even when
+   the sound is being stretched */
+static int samples_size;
 
-static unsigned int ay_tone_tick[3], ay_tone_high[3], ay_noise_tick;
-static unsigned int ay_tone_cycles, ay_env_cycles;
-static unsigned int ay_env_internal_tick, ay_env_tick;
-static unsigned int ay_tone_period[3], ay_noise_period, ay_env_period;
+#ifdef SOUND_FIFO
 
-/* Local copy of the AY registers */
-static libspectrum_byte sound_ay_registers[16];
+/* The most the sound is stretched by when the sound device is running
+   short */
+#define SOUND_STRETCH_MAX 0.005
 
-struct ay_change_tag
-{
-  libspectrum_dword tstates;
-  unsigned char reg, val;
-};
+static double sound_stretch;
 
-static struct ay_change_tag ay_change[ AY_CHANGE_MAX ];
+#endif			/* #ifdef SOUND_FIFO */
+
+/* The AY's tone, noise and envelope generators */
+static aysynth ay_synth;
+
+static aysynth_change ay_change[ AY_CHANGE_MAX ];
 static int ay_change_count;
 
 Blip_Buffer *left_buf = NULL;
@@ -124,6 +123,21 @@ sound_get_effective_processor_speed( void )
            settings_current.emulation_speed;
 }
 
+/* The number of samples at the given frequency the sound device should
+   aim to have queued */
+int
+sound_get_latency_samples( int freq )
+{
+  return (long)freq * settings_current.sound_latency / 1000;
+}
+
+/* The number of bytes of sound each Spectrum frame produces */
+size_t
+sound_get_frame_bytes( void )
+{
+  return sound_framesiz * sound_channels * sizeof( libspectrum_signed_word );
+}
+
 static int
 sound_init_blip( Blip_Buffer **buf, Blip_Synth **synth )
 {
@@ -152,28 +166,7 @@ sound_init_blip( Blip_Buffer **buf, Blip_Synth **synth )
 static void
 sound_ay_init( void )
 {
-  /* AY output doesn't match the claimed levels; these levels are based
-   * on the measurements posted to comp.sys.sinclair in Dec 2001 by
-   * Matthew Westcott, adjusted as I described in a followup to his post,
-   * then scaled to 0..0xffff.
-   */
-  static const int levels[16] = {
-    0x0000, 0x0385, 0x053D, 0x0770,
-    0x0AD7, 0x0FD5, 0x15B0, 0x230C,
-    0x2B4C, 0x43C1, 0x5A4B, 0x732F,
-    0x9204, 0xAFF1, 0xD921, 0xFFFF
-  };
-  int f;
-
-  /* scale the values down to fit */
-  for( f = 0; f < 16; f++ )
-    ay_tone_levels[f] = ( levels[f] * AMPL_AY_TONE + 0x8000 ) / 0xffff;
-
-  ay_noise_tick = ay_noise_period = 0;
-  ay_env_internal_tick = ay_env_tick = ay_env_period = 0;
-  ay_tone_cycles = ay_env_cycles = 0;
-  for( f = 0; f < 3; f++ )
-    ay_tone_tick[f] = ay_tone_high[f] = 0, ay_tone_period[f] = 1;
+  aysynth_reset( &ay_synth );
 
   ay_change_count = 0;
 }
@@ -276,6 +269,10 @@ sound_init( const char *device )
     blip_synth_set_output( ay_c_synth, left_buf );
   }
 
+  ay_synth.synth[0] = ay_a_synth; ay_synth.synth_r[0] = ay_a_synth_r;
+  ay_synth.synth[1] = ay_b_synth; ay_synth.synth_r[1] = ay_b_synth_r;
+  ay_synth.synth[2] = ay_c_synth; ay_synth.synth_r[2] = ay_c_synth_r;
+
   sound_enabled = sound_enabled_ever = 1;
 
   sound_channels = ( sound_stereo_ay != SOUND_STEREO_AY_NONE ? 2 : 1 );
@@ -290,7 +287,13 @@ sound_init( const char *device )
   sound_framesiz = ( float )settings_current.sound_freq / hz;
   sound_framesiz++;
 
-  samples = libspectrum_new0( blip_sample_t, sound_framesiz * sound_channels );
+  samples_size = sound_framesiz + sound_framesiz / 100 + 1;
+  samples = libspectrum_new0( blip_sample_t, samples_size * sound_channels );
+
+#ifdef SOUND_FIFO
+  sound_stretch = 0;
+#endif			/* #ifdef SOUND_FIFO */
+
   /* initialize movie settings... */
   movie_init_sound( settings_current.sound_freq, sound_stereo_ay );
 
@@ -340,248 +343,35 @@ sound_end( void )
   }
 }
 
+static int
+sound_startup_init( void *context GCC_UNUSED )
+{
+  aysynth_init( &ay_synth, AMPL_AY_TONE );
+
+  return 0;
+}
+
 void
 sound_register_startup( void )
 {
   startup_manager_module dependencies[] = { STARTUP_MANAGER_MODULE_SETUID };
   startup_manager_register( STARTUP_MANAGER_MODULE_SOUND, dependencies,
-                            ARRAY_SIZE( dependencies ), NULL, NULL, sound_end );
-}
-
-static inline void
-ay_do_tone( int level, unsigned int tone_count, int *var, int chan )
-{
-  *var = 0;
-
-  ay_tone_tick[ chan ] += tone_count;
-
-  if( ay_tone_tick[ chan ] >= ay_tone_period[ chan ] ) {
-    ay_tone_tick[ chan ] -= ay_tone_period[ chan ];
-    ay_tone_high[ chan ] = !ay_tone_high[ chan ];
-  }
-
-  if( level ) {
-    if( ay_tone_high[ chan ] )
-      *var = level;
-    else {
-      *var = 0;
-    }
-  }
+                            ARRAY_SIZE( dependencies ), sound_startup_init,
+                            NULL, sound_end );
 }
 
-/* bitmasks for envelope */
-#define AY_ENV_CONT	8
-#define AY_ENV_ATTACK	4
-#define AY_ENV_ALT	2
-#define AY_ENV_HOLD	1
-
-/* the AY steps down the external clock by 16 for tone and noise
-   generators */
-#define AY_CLOCK_DIVISOR 16
-/* all Spectrum models and clones with an AY seem to count down the
-   master clock by 2 to drive the AY */
-#define AY_CLOCK_RATIO 2
-
 static void
 sound_ay_overlay( void )
 {
-  static int rng = 1;
-  static int noise_toggle = 0;
-  static int env_first = 1, env_rev = 0, env_counter = 15;
-  int tone_level[3];
-  int mixer, envshape;
-  int g, level;
-  libspectrum_dword f;
-  struct ay_change_tag *change_ptr = ay_change;
-  int changes_left = ay_change_count;
-  int reg, r;
-  int chan1, chan2, chan3;
-  int last_chan1 = 0, last_chan2 = 0, last_chan3 = 0;
-  unsigned int tone_count, noise_count;
-
   /* If no AY chip, don't produce any AY sound (!) */
   if( !( periph_is_active( PERIPH_TYPE_FULLER) ||
          periph_is_active( PERIPH_TYPE_MELODIK ) ||
          machine_current->capabilities & LIBSPECTRUM_MACHINE_CAPABILITY_AY ) )
     return;
 
-  for( f = 0; f < machine_current->timings.tstates_per_frame;
-       f+= AY_CLOCK_DIVISOR * AY_CLOCK_RATIO ) {
-    /* update ay registers. */
-    while( changes_left && f >= change_ptr->tstates ) {
-      sound_ay_registers[ reg = change_ptr->reg ] = change_ptr->val;
-      change_ptr++;
-      changes_left--;
-
-      /* fix things as needed for some register changes */
-      switch ( reg ) {
-      case 0: case 1: case 2: case 3: case 4: case 5:
-        r = reg >> 1;
-        /* a zero-len period is the same as 1 */
-        ay_tone_period[r] = ( sound_ay_registers[ reg & ~1 ] |
-                              ( sound_ay_registers[ reg | 1 ] & 15 ) << 8 );
-        if( !ay_tone_period[r] )
-          ay_tone_period[r]++;
-
-        /* important to get this right, otherwise e.g. Ghouls 'n' Ghosts
-         * has really scratchy, horrible-sounding vibrato.
-         */
-        if( ay_tone_tick[r] >= ay_tone_period[r] * 2 )
-          ay_tone_tick[r] %= ay_tone_period[r] * 2;
-        break;
-      case 6:
-        ay_noise_tick = 0;
-        ay_noise_period = ( sound_ay_registers[ reg ] & 31 );
-        break;
-      case 11: case 12:
-        ay_env_period =
-          sound_ay_registers[11] | ( sound_ay_registers[12] << 8 );
-        break;
-      case 13:
-        ay_env_internal_tick = ay_env_tick = ay_env_cycles = 0;
-        env_first = 1;
-        env_rev = 0;
-        env_counter = ( sound_ay_registers[13] & AY_ENV_ATTACK ) ? 0 : 15;
-        break;
-      }
-    }
-
-    /* the tone level if no enveloping is being used */
-    for( g = 0; g < 3; g++ )
-      tone_level[g] = ay_tone_levels[ sound_ay_registers[ 8 + g ] & 15 ];
-
-    /* envelope */
-    envshape = sound_ay_registers[13];
-    level = ay_tone_levels[ env_counter ];
-
-    for( g = 0; g < 3; g++ )
-      if( sound_ay_registers[ 8 + g ] & 16 )
-        tone_level[g] = level;
-
-    /* envelope output counter gets incr'd every 16 AY cycles. */
-    ay_env_cycles += AY_CLOCK_DIVISOR;
-    noise_count = 0;
-    while( ay_env_cycles >= 16 ) {
-      ay_env_cycles -= 16;
-      noise_count++;
-      ay_env_tick++;
-      while( ay_env_tick >= ay_env_period ) {
-        ay_env_tick -= ay_env_period;
-
-        /* do a 1/16th-of-period incr/decr if needed */
-        if( env_first ||
-            ( ( envshape & AY_ENV_CONT ) && !( envshape & AY_ENV_HOLD ) ) ) {
-          if( env_rev )
-            env_counter -= ( envshape & AY_ENV_ATTACK ) ? 1 : -1;
-          else
-            env_counter += ( envshape & AY_ENV_ATTACK ) ? 1 : -1;
-          if( env_counter < 0 )
-            env_counter = 0;
-          if( env_counter > 15 )
-            env_counter = 15;
-        }
-
-        ay_env_internal_tick++;
-        while( ay_env_internal_tick >= 16 ) {
-          ay_env_internal_tick -= 16;
-
-          /* end of cycle */
-          if( !( envshape & AY_ENV_CONT ) )
-            env_counter = 0;
-          else {
-            if( envshape & AY_ENV_HOLD ) {
-              if( env_first && ( envshape & AY_ENV_ALT ) )
-                env_counter = ( env_counter ? 0 : 15 );
-            } else {
-              /* non-hold */
-              if( envshape & AY_ENV_ALT )
-                env_rev = !env_rev;
-              else
-                env_counter = ( envshape & AY_ENV_ATTACK ) ? 0 : 15;
-            }
-          }
-
-          env_first = 0;
-        }
-
-        /* don't keep trying if period is zero */
-        if( !ay_env_period )
-          break;
-      }
-    }
-
-    /* generate tone+noise... or neither.
-     * (if no tone/noise is selected, the chip just shoves the
-     * level out unmodified. This is used by some sample-playing
-     * stuff.)
-     */
-    chan1 = tone_level[0];
-    chan2 = tone_level[1];
-    chan3 = tone_level[2];
-    mixer = sound_ay_registers[7];
-
-    ay_tone_cycles += AY_CLOCK_DIVISOR;
-    tone_count = ay_tone_cycles >> 3;
-    ay_tone_cycles &= 7;
-
-    if( ( mixer & 1 ) == 0 ) {
-      level = chan1;
-      ay_do_tone( level, tone_count, &chan1, 0 );
-    }
-    if( ( mixer & 0x08 ) == 0 && noise_toggle )
-      chan1 = 0;
-
-    if( ( mixer & 2 ) == 0 ) {
-      level = chan2;
-      ay_do_tone( level, tone_count, &chan2, 1 );
-    }
-    if( ( mixer & 0x10 ) == 0 && noise_toggle )
-      chan2 = 0;
-
-    if( ( mixer & 4 ) == 0 ) {
-      level = chan3;
-      ay_do_tone( level, tone_count, &chan3, 2 );
-    }
-    if( ( mixer & 0x20 ) == 0 && noise_toggle )
-      chan3 = 0;
-
-    if( last_chan1 != chan1 ) {
-      blip_synth_update( ay_a_synth, f, chan1 );
-      if( ay_a_synth_r ) blip_synth_update( ay_a_synth_r, f, chan1 );
-      last_chan1 = chan1;
-    }
-    if( last_chan2 != chan2 ) {
-      blip_synth_update( ay_b_synth, f, chan2 );
-      if( ay_b_synth_r ) blip_synth_update( ay_b_synth_r, f, chan2 );
-      last_chan2 = chan2;
-    }
-    if( last_chan3 != chan3 ) {
-      blip_synth_update( ay_c_synth, f, chan3 );
-      if( ay_c_synth_r ) blip_synth_update( ay_c_synth_r, f, chan3 );
-      last_chan3 = chan3;
-    }
-
-    /* update noise RNG/filter */
-    ay_noise_tick += noise_count;
-    while( ay_noise_tick >= ay_noise_period ) {
-      ay_noise_tick -= ay_noise_period;
-
-      if( ( rng & 1 ) ^ ( ( rng & 2 ) ? 1 : 0 ) )
-        noise_toggle = !noise_toggle;
-
-      /* rng is 17-bit shift reg, bit 0 is output.
-       * input is bit 0 xor bit 3.
-       */
-      if( rng & 1 ) {
-        rng ^= 0x24000;
-      }
-      rng >>= 1;
-
-      /* don't keep trying if period is zero */
-      if( !ay_noise_period )
-        break;
-    }
-  }
+  aysynth_frame( &ay_synth, ay_change, ay_change_count,
+                 machine_current->timings.tstates_per_frame,
+                 settings_current.ay_stepped );
 }
 
 /* don't make the change immediately; record it for later,
@@ -612,9 +402,6 @@ sound_ay_reset( void )
   ay_change_count = 0;
   for( f = 0; f < 16; f++ )
     sound_ay_write( f, 0, 0 );
-  for( f = 0; f < 3; f++ )
-    ay_tone_high[f] = 0;
-  ay_tone_cycles = ay_env_cycles = 0;
 }
 
 /*
@@ -633,6 +420,33 @@ sound_specdrum_write( libspectrum_word port GCC_UNUSED, libspectrum_byte val )
   }
 }
 
+#ifdef SOUND_FIFO
+
+/* If the sound device hasn't been finding the ring full when it comes
+   for more, the emulation is falling behind it; stretch the sound a
+   little so each frame gives it more to play, and ease off again as the
+   ring fills back up */
+static void
+sound_adjust_stretch( void )
+{
+  size_t fill = sound_ring.fill, limit = sound_ring.limit;
+  double target;
+  long rate;
+
+  if( !settings_current.sound || !limit || movie_recording ) return;
+
+  if( fill > limit ) fill = limit;
+  target = SOUND_STRETCH_MAX * ( limit - fill ) / limit;
+
+  sound_stretch += ( target - sound_stretch ) / 8;
+
+  rate = sound_get_effective_processor_speed() / ( 1 + sound_stretch );
+  blip_buffer_set_clock_rate( left_buf, rate );
+  if( right_buf ) blip_buffer_set_clock_rate( right_buf, rate );
+}
+
+#endif			/* #ifdef SOUND_FIFO */
+
 void
 sound_frame( void )
 {
@@ -651,11 +465,11 @@ sound_frame( void )
 
     /* Read left channel into even samples, right channel into odd samples:
        LRLRLRLRLR... */
-    count = blip_buffer_read_samples( left_buf, samples, sound_framesiz, 1 );
+    count = blip_buffer_read_samples( left_buf, samples, samples_size, 1 );
     blip_buffer_read_samples( right_buf, samples + 1, count, 1 );
     count <<= 1;
   } else {
-    count = blip_buffer_read_samples( left_buf, samples, sound_framesiz, BLIP_BUFFER_DEF_STEREO );
+    count = blip_buffer_read_samples( left_buf, samples, samples_size, BLIP_BUFFER_DEF_STEREO );
   }
 
   if( settings_current.sound ) 
@@ -664,6 +478,10 @@ sound_frame( void )
   if( movie_recording )
       movie_add_sound( samples, count );
   ay_change_count = 0;
+
+#ifdef SOUND_FIFO
+  sound_adjust_stretch();
+#endif			/* #ifdef SOUND_FIFO */
 }
 
 void
@@ -27,6 +27,8 @@
 #ifndef FUSE_SOUND_H
 #define FUSE_SOUND_H
 
+#include <stddef.h>
+
 #include <libspectrum.h>
 
 void sound_register_startup( void );
@@ -41,6 +43,8 @@ void sound_specdrum_write( libspectrum_word port, libspectrum_byte val );
 void sound_frame( void );
 void sound_beeper( libspectrum_dword at_tstates, int on );
 libspectrum_dword sound_get_effective_processor_speed( void );
+int sound_get_latency_samples( int freq );
+size_t sound_get_frame_bytes( void );
 
 extern int sound_enabled;
 extern int sound_framesiz;
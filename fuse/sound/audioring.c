@@ -0,0 +1,258 @@
+/* audioring.c: Lock-free single producer, single consumer sound buffer
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#include <sys/time.h>
+#endif				/* #ifdef HAVE_PTHREAD */
+
+#include "sound/audioring.h"
+#include "timer/timer.h"
+
+/* How long the writer waits before checking again for space, in case the
+   reader's wakeup went astray */
+#define WAIT_TIMEOUT_MS 10
+
+#ifndef MIN
+#define MIN(a,b)    (((a) < (b)) ? (a) : (b))
+#endif
+
+/* Read a position written by the other side, seeing everything it wrote
+   before it. Fully ordered, as the writer's wakeup depends on it */
+static size_t
+load_position( volatile size_t *position )
+{
+#ifdef __ATOMIC_SEQ_CST
+  return __atomic_load_n( position, __ATOMIC_SEQ_CST );
+#elif defined( __GNUC__ )
+  size_t value = *position;
+  __sync_synchronize();
+  return value;
+#else
+  return *position;
+#endif
+}
+
+/* Write a position for the other side, after everything before it */
+static void
+store_position( volatile size_t *position, size_t value )
+{
+#ifdef __ATOMIC_SEQ_CST
+  __atomic_store_n( position, value, __ATOMIC_SEQ_CST );
+#elif defined( __GNUC__ )
+  __sync_synchronize();
+  *position = value;
+  __sync_synchronize();
+#else
+  *position = value;
+#endif
+}
+
+#ifdef HAVE_PTHREAD
+
+/* The same for the writer's waiting flag, so the reader's check of it is
+   ordered after its new position and the writer's after the flag */
+static int
+load_flag( volatile int *flag )
+{
+#ifdef __ATOMIC_SEQ_CST
+  return __atomic_load_n( flag, __ATOMIC_SEQ_CST );
+#elif defined( __GNUC__ )
+  int value = *flag;
+  __sync_synchronize();
+  return value;
+#else
+  return *flag;
+#endif
+}
+
+static void
+store_flag( volatile int *flag, int value )
+{
+#ifdef __ATOMIC_SEQ_CST
+  __atomic_store_n( flag, value, __ATOMIC_SEQ_CST );
+#elif defined( __GNUC__ )
+  __sync_synchronize();
+  *flag = value;
+  __sync_synchronize();
+#else
+  *flag = value;
+#endif
+}
+
+#endif				/* #ifdef HAVE_PTHREAD */
+
+int
+audioring_init( audioring *ring, size_t limit )
+{
+  memset( ring, 0, sizeof( *ring ) );
+
+  if( !limit ) limit = 1;
+
+  for( ring->size = 1; ring->size < limit; ring->size <<= 1 )
+    ;
+
+  ring->limit = ring->fill = limit;
+  ring->buffer = libspectrum_new( libspectrum_byte, ring->size );
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_init( &ring->mutex, NULL );
+  pthread_cond_init( &ring->space, NULL );
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  return 0;
+}
+
+void
+audioring_end( audioring *ring )
+{
+  if( !ring->buffer ) return;
+
+#ifdef HAVE_PTHREAD
+  pthread_cond_destroy( &ring->space );
+  pthread_mutex_destroy( &ring->mutex );
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  libspectrum_free( ring->buffer ); ring->buffer = NULL;
+}
+
+void
+audioring_flush( audioring *ring )
+{
+  ring->write_pos = ring->read_pos = 0;
+  ring->fill = ring->limit;
+}
+
+size_t
+audioring_used( audioring *ring )
+{
+  return load_position( &ring->write_pos ) - load_position( &ring->read_pos );
+}
+
+size_t
+audioring_space( audioring *ring )
+{
+  return ring->limit - audioring_used( ring );
+}
+
+size_t
+audioring_write( audioring *ring, const void *data, size_t length )
+{
+  const libspectrum_byte *bytes = data;
+  size_t position, offset, chunk;
+
+  length = MIN( length, audioring_space( ring ) );
+
+  position = ring->write_pos;
+  offset = position & ( ring->size - 1 );
+  chunk = MIN( length, ring->size - offset );
+
+  memcpy( ring->buffer + offset, bytes, chunk );
+  memcpy( ring->buffer, bytes + chunk, length - chunk );
+
+  store_position( &ring->write_pos, position + length );
+
+  return length;
+}
+
+size_t
+audioring_read( audioring *ring, void *data, size_t length )
+{
+  libspectrum_byte *bytes = data;
+  size_t position, offset, chunk, used;
+
+  used = audioring_used( ring );
+  ring->fill = used;
+  length = MIN( length, used );
+
+  position = ring->read_pos;
+  offset = position & ( ring->size - 1 );
+  chunk = MIN( length, ring->size - offset );
+
+  memcpy( bytes, ring->buffer + offset, chunk );
+  memcpy( bytes + chunk, ring->buffer, length - chunk );
+
+  store_position( &ring->read_pos, position + length );
+
+#ifdef HAVE_PTHREAD
+  /* Both fully ordered, so either the writer sees the space or we see it
+     waiting */
+  if( length && load_flag( &ring->waiting ) ) {
+    pthread_mutex_lock( &ring->mutex );
+    pthread_cond_signal( &ring->space );
+    pthread_mutex_unlock( &ring->mutex );
+  }
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  return length;
+}
+
+#ifdef HAVE_PTHREAD
+
+void
+audioring_wait( audioring *ring, size_t length )
+{
+  struct timeval now;
+  struct timespec timeout;
+
+  length = MIN( length, ring->limit );
+
+  if( audioring_space( ring ) >= length ) return;
+
+  pthread_mutex_lock( &ring->mutex );
+
+  store_flag( &ring->waiting, 1 );
+
+  while( audioring_space( ring ) < length ) {
+    gettimeofday( &now, NULL );
+    timeout.tv_sec = now.tv_sec;
+    timeout.tv_nsec = ( now.tv_usec + WAIT_TIMEOUT_MS * 1000 ) * 1000;
+    if( timeout.tv_nsec >= 1000000000 ) {
+      timeout.tv_sec++;
+      timeout.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait( &ring->space, &ring->mutex, &timeout );
+  }
+
+  store_flag( &ring->waiting, 0 );
+
+  pthread_mutex_unlock( &ring->mutex );
+}
+
+#else				/* #ifdef HAVE_PTHREAD */
+
+void
+audioring_wait( audioring *ring, size_t length )
+{
+  length = MIN( length, ring->limit );
+
+  while( audioring_space( ring ) < length )
+    timer_sleep( 1 );
+}
+
+#endif				/* #ifdef HAVE_PTHREAD */
@@ -0,0 +1,89 @@
+/* audioring.h: Lock-free single producer, single consumer sound buffer
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#ifndef FUSE_AUDIORING_H
+#define FUSE_AUDIORING_H
+
+#include <stddef.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif				/* #ifdef HAVE_PTHREAD */
+
+#include <libspectrum.h>
+
+/* Used by the sound backends whose device pulls samples from a callback:
+   the emulation writes each frame of sound into the ring, and the device
+   callback reads it out. Only the positions are shared, so neither side
+   ever takes a lock; the writer can block until there is room, and the
+   reader wakes it as soon as it has made some */
+
+typedef struct audioring {
+
+  libspectrum_byte *buffer;
+  size_t size;			/* A power of two */
+  size_t limit;			/* The most bytes held at once */
+
+  /* Bytes written and read since the ring was emptied; these only ever
+     increase, and wrap round the buffer */
+  volatile size_t write_pos, read_pos;
+
+  /* How many bytes were waiting when the reader last came for more */
+  volatile size_t fill;
+
+#ifdef HAVE_PTHREAD
+  volatile int waiting;		/* Is the writer waiting for space? */
+  pthread_mutex_t mutex;
+  pthread_cond_t space;
+#endif				/* #ifdef HAVE_PTHREAD */
+
+} audioring;
+
+/* Set up a ring which holds at most limit bytes */
+int audioring_init( audioring *ring, size_t limit );
+void audioring_end( audioring *ring );
+
+/* Empty the ring; only safe when the reader isn't running */
+void audioring_flush( audioring *ring );
+
+size_t audioring_used( audioring *ring );
+size_t audioring_space( audioring *ring );
+
+/* Copy as much as will fit of the data into the ring, returning the
+   number of bytes written */
+size_t audioring_write( audioring *ring, const void *data, size_t length );
+
+/* Copy up to length bytes out of the ring, returning the number of bytes
+   read */
+size_t audioring_read( audioring *ring, void *data, size_t length );
+
+/* Wait until there is space for length bytes, or for the whole ring if it
+   is smaller than that */
+void audioring_wait( audioring *ring, size_t length );
+
+/* The ring used by the current sound backend */
+extern audioring sound_ring;
+
+#endif			/* #ifndef FUSE_AUDIORING_H */
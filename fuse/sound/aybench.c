@@ -0,0 +1,424 @@
+/* aybench.c: Benchmark for the AY sound generators
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libspectrum.h>
+
+#include "sound/aysynth.h"
+#include "sound/blipbuffer.h"
+
+/* Renders some AY music with both the stepped and the skipping versions
+   of the generators, times them and checks they give exactly the same
+   samples. The music is either the PSG files given on the command line or
+   some built in tunes which exercise the tone, noise and envelope
+   generators and sample playback, and some random register writes */
+
+static const char *progname;
+
+/* A 128K Spectrum, with the default sound settings */
+#define CLOCK_RATE 3546900
+#define FRAME_LENGTH 70908
+#define SAMPLE_RATE 44100
+#define AMPLITUDE ( 24 * 256 )
+#define BASS_FREQUENCY 200
+#define TREBLE -37.0
+
+#define FRAME_SAMPLES ( SAMPLE_RATE / 50 + 2 )
+
+/* A tune: the register writes for each frame, one after another */
+typedef struct tune {
+  const char *name;
+  aysynth_change *changes;
+  size_t count, allocated;
+  size_t frame_start;		/* Where the current frame's writes start */
+  int *frame_count;		/* How many of changes are in each frame */
+  size_t frames, frames_allocated;
+} tune;
+
+static void
+tune_init( tune *t, const char *name )
+{
+  memset( t, 0, sizeof( *t ) );
+  t->name = name;
+}
+
+static void
+tune_write( tune *t, libspectrum_dword tstates, int reg, int val )
+{
+  if( t->count == t->allocated ) {
+    t->allocated = t->allocated ? 2 * t->allocated : 1024;
+    t->changes = libspectrum_renew( aysynth_change, t->changes,
+                                    t->allocated );
+  }
+
+  t->changes[ t->count ].tstates = tstates;
+  t->changes[ t->count ].reg = reg;
+  t->changes[ t->count ].val = val;
+  t->count++;
+}
+
+/* End the current frame: all writes since the last call belong to it */
+static void
+tune_end_frame( tune *t )
+{
+  if( t->frames == t->frames_allocated ) {
+    t->frames_allocated = t->frames_allocated ? 2 * t->frames_allocated : 256;
+    t->frame_count = libspectrum_renew( int, t->frame_count,
+                                        t->frames_allocated );
+  }
+
+  t->frame_count[ t->frames++ ] = t->count - t->frame_start;
+  t->frame_start = t->count;
+}
+
+static void
+tune_free( tune *t )
+{
+  libspectrum_free( t->changes );
+  libspectrum_free( t->frame_count );
+}
+
+/* A simple random number generator, so the tunes are the same on every
+   platform */
+static libspectrum_dword seed = 1;
+
+static int
+random_int( int n )
+{
+  seed = seed * 1103515245UL + 12345;
+  return ( ( seed >> 16 ) & 0x7fff ) % n;
+}
+
+static void
+tune_tone( tune *t, libspectrum_dword tstates, int chan, int period )
+{
+  tune_write( t, tstates, chan * 2, period & 0xff );
+  tune_write( t, tstates, chan * 2 + 1, period >> 8 );
+}
+
+/* Arpeggios and a bass line on the tone channels with a noise drum, as
+   most Spectrum music is written */
+static void
+make_music( tune *t, int frames )
+{
+  static const int notes[] = { 0x1ab, 0x17c, 0x152, 0x13f, 0x11c, 0x0fd,
+                               0x0e1, 0x0d5 };
+  int i;
+
+  tune_init( t, "tones" );
+
+  tune_write( t, 0, 7, 0x38 );
+
+  for( i = 0; i < frames; i++ ) {
+    int note = notes[ ( i / 8 ) % 8 ];
+
+    tune_tone( t, 0, 0, note >> ( i % 3 ) );
+    tune_write( t, 0, 8, 15 - ( i % 8 ) );
+
+    if( i % 16 == 0 ) tune_tone( t, 0, 1, note * 2 );
+    tune_write( t, 0, 9, 12 - ( ( i % 16 ) >> 2 ) );
+
+    /* Vibrato on the lead */
+    tune_tone( t, 0, 2, notes[ ( i / 32 ) % 8 ] / 2 + ( i & 2 ) - 1 );
+
+    if( i % 8 == 0 ) {
+      tune_write( t, 0, 6, 1 + random_int( 31 ) );
+      tune_write( t, 0, 7, 0x30 );
+    } else if( i % 8 == 2 ) {
+      tune_write( t, 0, 7, 0x38 );
+    }
+    tune_write( t, 0, 10, i % 8 < 2 ? 15 : 10 );
+
+    tune_end_frame( t );
+  }
+}
+
+/* Envelope basses and noise, as in many 128K game tunes */
+static void
+make_envelope( tune *t, int frames )
+{
+  int i;
+
+  tune_init( t, "envelope" );
+
+  tune_write( t, 0, 7, 0x2e );
+  tune_write( t, 0, 8, 0x10 );
+  tune_write( t, 0, 10, 0x08 );
+
+  for( i = 0; i < frames; i++ ) {
+    if( i % 25 == 0 ) {
+      tune_tone( t, 0, 0, 0x200 + 0x40 * ( ( i / 25 ) % 4 ) );
+      tune_write( t, 0, 11, 0x20 + 0x10 * ( ( i / 25 ) % 3 ) );
+      tune_write( t, 0, 12, 0 );
+      tune_write( t, 0, 13, 8 + ( ( i / 25 ) % 8 ) );
+      tune_write( t, 0, 6, 4 + ( ( i / 25 ) % 20 ) );
+    }
+
+    tune_write( t, 0, 10, i % 4 == 0 ? 0x0f : 0x08 );
+
+    tune_end_frame( t );
+  }
+}
+
+/* Four bit samples played by writing to a volume register every 224
+   T-states with the tone and noise turned off */
+static void
+make_samples( tune *t, int frames )
+{
+  libspectrum_dword tstates;
+  int i, level = 8;
+
+  tune_init( t, "samples" );
+
+  tune_write( t, 0, 7, 0x3f );
+
+  for( i = 0; i < frames; i++ ) {
+    for( tstates = 0; tstates < FRAME_LENGTH; tstates += 224 ) {
+      level += random_int( 5 ) - 2;
+      if( level < 0 ) level = 0;
+      if( level > 15 ) level = 15;
+      tune_write( t, tstates, 8, level );
+    }
+    tune_end_frame( t );
+  }
+}
+
+/* Random writes to every register at random times, to check the odd
+   corners: periods changing under the counters, zero periods and so on */
+static void
+make_random( tune *t, int frames )
+{
+  libspectrum_dword tstates;
+  int i, reg, val;
+
+  tune_init( t, "random" );
+
+  for( i = 0; i < frames; i++ ) {
+    for( tstates = random_int( 4096 ); tstates < FRAME_LENGTH;
+         tstates += random_int( 8192 ) ) {
+      reg = random_int( 14 );
+      val = random_int( 256 );
+
+      /* Mostly short periods, so things happen within a frame */
+      if( reg == 1 || reg == 3 || reg == 5 || reg == 12 ) val &= 1;
+      if( reg == 11 ) val &= 0x1f;
+
+      tune_write( t, tstates, reg, val );
+    }
+    tune_end_frame( t );
+  }
+}
+
+static void
+make_silence( tune *t, int frames )
+{
+  int i;
+
+  tune_init( t, "silence" );
+
+  tune_write( t, 0, 7, 0x3f );
+  for( i = 0; i < frames; i++ ) tune_end_frame( t );
+}
+
+/* Read a PSG file: a 16 byte header, then register/value pairs with 0xff
+   marking the end of a frame, 0xfe n marking 4n empty frames and 0xfd
+   marking the end of the music */
+static int
+read_psg( tune *t, const char *filename )
+{
+  FILE *f;
+  int c, value, i;
+
+  f = fopen( filename, "rb" );
+  if( !f ) {
+    fprintf( stderr, "%s: couldn't open '%s'\n", progname, filename );
+    return 1;
+  }
+
+  tune_init( t, filename );
+
+  for( i = 0; i < 16; i++ ) {
+    c = getc( f );
+    if( c == EOF || ( i < 4 && c != "PSG\x1a"[i] ) ) {
+      fprintf( stderr, "%s: '%s' is not a PSG file\n", progname, filename );
+      fclose( f );
+      return 1;
+    }
+  }
+
+  while( ( c = getc( f ) ) != EOF && c != 0xfd ) {
+    switch( c ) {
+
+    case 0xff:
+      tune_end_frame( t );
+      break;
+
+    case 0xfe:
+      value = getc( f );
+      if( value == EOF ) break;
+      for( i = 0; i < 4 * value; i++ ) tune_end_frame( t );
+      break;
+
+    default:
+      value = getc( f );
+      if( value == EOF ) break;
+      if( c < 14 ) tune_write( t, 0, c, value );
+      break;
+
+    }
+  }
+
+  fclose( f );
+
+  return 0;
+}
+
+static double
+cpu_time( void )
+{
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/* Render the tune, returning the samples and how long it took */
+static blip_sample_t*
+render( const tune *t, int stepped, size_t *length, double *time )
+{
+  Blip_Buffer *buffer;
+  Blip_Synth *synth[3];
+  aysynth ay;
+  blip_sample_t *samples;
+  const aysynth_change *changes;
+  size_t frame, total = 0;
+  double start;
+  int i;
+
+  buffer = new_Blip_Buffer();
+  blip_buffer_set_clock_rate( buffer, CLOCK_RATE );
+  if( !buffer || blip_buffer_set_sample_rate( buffer, SAMPLE_RATE, 1000 ) ) {
+    fprintf( stderr, "%s: out of memory\n", progname );
+    exit( 1 );
+  }
+  blip_buffer_set_bass_freq( buffer, BASS_FREQUENCY );
+
+  aysynth_init( &ay, AMPLITUDE );
+
+  for( i = 0; i < 3; i++ ) {
+    synth[i] = new_Blip_Synth();
+    blip_synth_set_volume( synth[i], 1.0 );
+    blip_synth_set_treble_eq( synth[i], TREBLE );
+    blip_synth_set_output( synth[i], buffer );
+    ay.synth[i] = synth[i]; ay.synth_r[i] = NULL;
+  }
+
+  samples = libspectrum_new( blip_sample_t,
+                             ( t->frames + 1 ) * FRAME_SAMPLES );
+
+  changes = t->changes;
+
+  start = cpu_time();
+
+  for( frame = 0; frame < t->frames; frame++ ) {
+    aysynth_frame( &ay, changes, t->frame_count[ frame ], FRAME_LENGTH,
+                   stepped );
+    changes += t->frame_count[ frame ];
+
+    blip_buffer_end_frame( buffer, FRAME_LENGTH );
+    total += blip_buffer_read_samples( buffer, samples + total,
+                                       FRAME_SAMPLES, 0 );
+  }
+
+  *time = cpu_time() - start;
+  *length = total;
+
+  for( i = 0; i < 3; i++ ) delete_Blip_Synth( &synth[i] );
+  delete_Blip_Buffer( &buffer );
+
+  return samples;
+}
+
+static int
+benchmark( const tune *t )
+{
+  blip_sample_t *reference, *samples;
+  size_t reference_length, length;
+  double stepped_time, time;
+  int error;
+
+  reference = render( t, 1, &reference_length, &stepped_time );
+  samples = render( t, 0, &length, &time );
+
+  error = length != reference_length ||
+          memcmp( reference, samples, length * sizeof( *samples ) );
+
+  printf( "  %-20s %6lu %10.4f %10.4f %7.1fx%s\n", t->name,
+          (unsigned long)t->frames, stepped_time * 1000 / t->frames,
+          time * 1000 / t->frames, time > 0 ? stepped_time / time : 0.0,
+          error ? "  MISMATCH" : "" );
+
+  libspectrum_free( samples );
+  libspectrum_free( reference );
+
+  return error;
+}
+
+int
+main( int argc, char **argv )
+{
+  tune t;
+  int i, error = 0, frames = 3000;
+
+  progname = argv[0];
+
+  printf( "  %-20s %6s %10s %10s %8s\n", "tune", "frames", "stepped",
+          "skipping", "speedup" );
+
+  if( argc > 1 ) {
+    for( i = 1; i < argc; i++ ) {
+      if( read_psg( &t, argv[i] ) ) return 1;
+      if( t.frames ) error |= benchmark( &t );
+      tune_free( &t );
+    }
+  } else {
+    make_music( &t, frames ); error |= benchmark( &t ); tune_free( &t );
+    make_envelope( &t, frames ); error |= benchmark( &t ); tune_free( &t );
+    make_samples( &t, frames / 10 ); error |= benchmark( &t );
+    tune_free( &t );
+    make_random( &t, frames ); error |= benchmark( &t ); tune_free( &t );
+    make_silence( &t, frames ); error |= benchmark( &t ); tune_free( &t );
+  }
+
+  printf( "  (ms/frame)\n" );
+
+  if( error ) fprintf( stderr, "%s: output differs from the stepped "
+                       "generators\n", progname );
+
+  return error;
+}
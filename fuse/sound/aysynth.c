@@ -0,0 +1,428 @@
+/* aysynth.c: AY-3-8912 tone, noise and envelope generators
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+/* The AY white noise RNG algorithm is based on info from MAME's ay8910.c -
+ * MAME's licence explicitly permits free use of info (even encourages it).
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "sound/aysynth.h"
+
+/* bitmasks for envelope */
+#define AY_ENV_CONT	8
+#define AY_ENV_ATTACK	4
+#define AY_ENV_ALT	2
+#define AY_ENV_HOLD	1
+
+/* The tone counters count in units of 8 clocks */
+#define TONE_COUNT ( AYSYNTH_CLOCK_DIVISOR >> 3 )
+
+#ifndef MIN
+#define MIN(a,b)    (((a) < (b)) ? (a) : (b))
+#endif
+
+void
+aysynth_init( aysynth *ay, int amplitude )
+{
+  /* AY output doesn't match the claimed levels; these levels are based
+   * on the measurements posted to comp.sys.sinclair in Dec 2001 by
+   * Matthew Westcott, adjusted as I described in a followup to his post,
+   * then scaled to 0..0xffff.
+   */
+  static const int levels[16] = {
+    0x0000, 0x0385, 0x053D, 0x0770,
+    0x0AD7, 0x0FD5, 0x15B0, 0x230C,
+    0x2B4C, 0x43C1, 0x5A4B, 0x732F,
+    0x9204, 0xAFF1, 0xD921, 0xFFFF
+  };
+  int f;
+
+  memset( ay, 0, sizeof( *ay ) );
+
+  /* scale the values down to fit */
+  for( f = 0; f < 16; f++ )
+    ay->tone_levels[f] = ( levels[f] * amplitude + 0x8000 ) / 0xffff;
+
+  ay->rng = 1;
+  ay->noise_toggle = 0;
+  ay->env_first = 1; ay->env_rev = 0; ay->env_counter = 15;
+
+  aysynth_reset( ay );
+}
+
+void
+aysynth_reset( aysynth *ay )
+{
+  int f;
+
+  ay->noise_tick = ay->noise_period = 0;
+  ay->env_internal_tick = ay->env_tick = ay->env_period = 0;
+  for( f = 0; f < 3; f++ )
+    ay->tone_tick[f] = ay->tone_high[f] = 0, ay->tone_period[f] = 1;
+}
+
+static void
+write_register( aysynth *ay, int reg, int val )
+{
+  libspectrum_byte *registers = ay->registers;
+  int r;
+
+  registers[ reg ] = val;
+
+  /* fix things as needed for some register changes */
+  switch ( reg ) {
+  case 0: case 1: case 2: case 3: case 4: case 5:
+    r = reg >> 1;
+    /* a zero-len period is the same as 1 */
+    ay->tone_period[r] = ( registers[ reg & ~1 ] |
+                           ( registers[ reg | 1 ] & 15 ) << 8 );
+    if( !ay->tone_period[r] )
+      ay->tone_period[r]++;
+
+    /* important to get this right, otherwise e.g. Ghouls 'n' Ghosts
+     * has really scratchy, horrible-sounding vibrato.
+     */
+    if( ay->tone_tick[r] >= ay->tone_period[r] * 2 )
+      ay->tone_tick[r] %= ay->tone_period[r] * 2;
+    break;
+  case 6:
+    ay->noise_tick = 0;
+    ay->noise_period = ( registers[ reg ] & 31 );
+    break;
+  case 11: case 12:
+    ay->env_period = registers[11] | ( registers[12] << 8 );
+    break;
+  case 13:
+    ay->env_internal_tick = ay->env_tick = 0;
+    ay->env_first = 1;
+    ay->env_rev = 0;
+    ay->env_counter = ( registers[13] & AY_ENV_ATTACK ) ? 0 : 15;
+    break;
+  }
+}
+
+/* The envelope period has expired */
+static void
+envelope_event( aysynth *ay )
+{
+  int envshape = ay->registers[13];
+
+  /* do a 1/16th-of-period incr/decr if needed */
+  if( ay->env_first ||
+      ( ( envshape & AY_ENV_CONT ) && !( envshape & AY_ENV_HOLD ) ) ) {
+    if( ay->env_rev )
+      ay->env_counter -= ( envshape & AY_ENV_ATTACK ) ? 1 : -1;
+    else
+      ay->env_counter += ( envshape & AY_ENV_ATTACK ) ? 1 : -1;
+    if( ay->env_counter < 0 )
+      ay->env_counter = 0;
+    if( ay->env_counter > 15 )
+      ay->env_counter = 15;
+  }
+
+  ay->env_internal_tick++;
+  while( ay->env_internal_tick >= 16 ) {
+    ay->env_internal_tick -= 16;
+
+    /* end of cycle */
+    if( !( envshape & AY_ENV_CONT ) )
+      ay->env_counter = 0;
+    else {
+      if( envshape & AY_ENV_HOLD ) {
+        if( ay->env_first && ( envshape & AY_ENV_ALT ) )
+          ay->env_counter = ( ay->env_counter ? 0 : 15 );
+      } else {
+        /* non-hold */
+        if( envshape & AY_ENV_ALT )
+          ay->env_rev = !ay->env_rev;
+        else
+          ay->env_counter = ( envshape & AY_ENV_ATTACK ) ? 0 : 15;
+      }
+    }
+
+    ay->env_first = 0;
+  }
+}
+
+/* The envelope output counter gets incremented every 16 AY cycles, which
+   is once a step */
+static void
+envelope_step( aysynth *ay )
+{
+  ay->env_tick++;
+  while( ay->env_tick >= ay->env_period ) {
+    ay->env_tick -= ay->env_period;
+
+    envelope_event( ay );
+
+    /* don't keep trying if period is zero */
+    if( !ay->env_period )
+      break;
+  }
+}
+
+/* The noise period has expired */
+static void
+noise_event( aysynth *ay )
+{
+  if( ( ay->rng & 1 ) ^ ( ( ay->rng & 2 ) ? 1 : 0 ) )
+    ay->noise_toggle = !ay->noise_toggle;
+
+  /* rng is 17-bit shift reg, bit 0 is output.
+   * input is bit 0 xor bit 3.
+   */
+  if( ay->rng & 1 ) {
+    ay->rng ^= 0x24000;
+  }
+  ay->rng >>= 1;
+}
+
+static void
+noise_step( aysynth *ay )
+{
+  ay->noise_tick++;
+  while( ay->noise_tick >= ay->noise_period ) {
+    ay->noise_tick -= ay->noise_period;
+
+    noise_event( ay );
+
+    /* don't keep trying if period is zero */
+    if( !ay->noise_period )
+      break;
+  }
+}
+
+static void
+tone_step( aysynth *ay, int chan )
+{
+  ay->tone_tick[ chan ] += TONE_COUNT;
+
+  if( ay->tone_tick[ chan ] >= ay->tone_period[ chan ] ) {
+    ay->tone_tick[ chan ] -= ay->tone_period[ chan ];
+    ay->tone_high[ chan ] = !ay->tone_high[ chan ];
+  }
+}
+
+/* The level of a channel before the tone and noise are applied */
+static int
+channel_level( const aysynth *ay, int chan )
+{
+  libspectrum_byte volume = ay->registers[ 8 + chan ];
+
+  return ay->tone_levels[ volume & 16 ? ay->env_counter : volume & 15 ];
+}
+
+/* Emulate one step at time f */
+static void
+step( aysynth *ay, libspectrum_dword f, int *last )
+{
+  int tone_level[3];
+  int chan, mixer, g;
+
+  /* the tone level, from the volume or the envelope */
+  for( g = 0; g < 3; g++ )
+    tone_level[g] = channel_level( ay, g );
+
+  envelope_step( ay );
+
+  /* generate tone+noise... or neither.
+   * (if no tone/noise is selected, the chip just shoves the
+   * level out unmodified. This is used by some sample-playing
+   * stuff.)
+   */
+  mixer = ay->registers[7];
+
+  for( g = 0; g < 3; g++ ) {
+    chan = tone_level[g];
+
+    if( ( mixer & ( 0x01 << g ) ) == 0 ) {
+      tone_step( ay, g );
+      if( !ay->tone_high[g] ) chan = 0;
+    }
+    if( ( mixer & ( 0x08 << g ) ) == 0 && ay->noise_toggle )
+      chan = 0;
+
+    if( last[g] != chan ) {
+      blip_synth_update( ay->synth[g], f, chan );
+      if( ay->synth_r[g] ) blip_synth_update( ay->synth_r[g], f, chan );
+      last[g] = chan;
+    }
+  }
+
+  /* update noise RNG/filter */
+  noise_step( ay );
+}
+
+/* How many steps of a counter which counts up to period can be taken
+   before it next expires? */
+static libspectrum_dword
+steps_to_event( unsigned int tick, unsigned int period )
+{
+  return period && tick < period ? period - tick - 1 : 0;
+}
+
+/* The number of steps after the one just emulated, up to limit, for which
+   every channel's output will be the same as it was on that step. The
+   envelope counter and noise state before that step are passed in */
+static libspectrum_dword
+steps_unchanged( const aysynth *ay, libspectrum_dword limit,
+                 int env_counter, int noise_toggle )
+{
+  libspectrum_dword steps = limit;
+  int mixer = ay->registers[7];
+  int env_used = 0, noise_used = 0;
+  int g;
+
+  for( g = 0; g < 3; g++ ) {
+
+    if( ay->registers[ 8 + g ] & 16 ) env_used = 1;
+    if( ( mixer & ( 0x08 << g ) ) == 0 ) noise_used = 1;
+
+    if( mixer & ( 0x01 << g ) ) continue;
+
+    if( channel_level( ay, g ) ) {
+      /* The channel's output changes when the tone next flips */
+      unsigned int tick = ay->tone_tick[g], period = ay->tone_period[g];
+      steps = MIN( steps,
+                   period >= TONE_COUNT && tick < period ?
+                   ( period - tick + TONE_COUNT - 1 ) / TONE_COUNT - 1 : 0 );
+    } else if( ay->tone_period[g] != 1 &&
+               ay->tone_tick[g] >= ay->tone_period[g] ) {
+      /* Silent, but the tone counter can't be skipped ahead */
+      return 0;
+    }
+  }
+
+  /* If the last step changed anything which is heard, the next step will
+     sound different */
+  if( env_used ) {
+    if( ay->env_counter != env_counter ) return 0;
+    steps = MIN( steps, steps_to_event( ay->env_tick, ay->env_period ) );
+  }
+
+  if( noise_used ) {
+    if( ay->noise_toggle != noise_toggle ) return 0;
+    steps = MIN( steps,
+                 steps_to_event( ay->noise_tick, ay->noise_period ) );
+  }
+
+  return steps;
+}
+
+/* Run a counter which counts up to period with an event each time it
+   expires for the given number of steps */
+static void
+skip_counter( aysynth *ay, unsigned int *tick, unsigned int period,
+              libspectrum_dword steps, void (*event)( aysynth *ay ),
+              void (*step_fn)( aysynth *ay ) )
+{
+  libspectrum_dword events;
+
+  if( !period ) {
+    /* Expires on every step */
+    *tick += steps;
+    events = steps;
+  } else if( *tick < period ) {
+    events = ( *tick + steps ) / period;
+    *tick = ( *tick + steps ) % period;
+  } else {
+    /* Period has just been reduced below the counter; do it the slow way */
+    for( ; steps; steps-- ) step_fn( ay );
+    return;
+  }
+
+  for( ; events; events-- ) event( ay );
+}
+
+/* Skip the given number of steps, for which steps_unchanged() says no
+   channel's output will change */
+static void
+skip_steps( aysynth *ay, libspectrum_dword steps )
+{
+  int mixer = ay->registers[7];
+  int g;
+
+  for( g = 0; g < 3; g++ ) {
+    unsigned int *tick = &ay->tone_tick[g], period = ay->tone_period[g];
+    libspectrum_dword total;
+
+    if( mixer & ( 0x01 << g ) ) continue;
+
+    if( period == 1 ) {
+      /* Flips on every step */
+      *tick += steps * ( TONE_COUNT - 1 );
+      ay->tone_high[g] ^= steps & 1;
+    } else {
+      /* Each step adds less than a period, so flips at most once */
+      total = *tick + steps * TONE_COUNT;
+      ay->tone_high[g] ^= ( total / period ) & 1;
+      *tick = total % period;
+    }
+  }
+
+  skip_counter( ay, &ay->env_tick, ay->env_period, steps, envelope_event,
+                envelope_step );
+  skip_counter( ay, &ay->noise_tick, ay->noise_period, steps, noise_event,
+                noise_step );
+}
+
+void
+aysynth_frame( aysynth *ay, const aysynth_change *changes, int count,
+               libspectrum_dword frame_length, int stepped )
+{
+  int last[3] = { 0, 0, 0 };
+  libspectrum_dword f, limit, skip;
+  int env_counter, noise_toggle;
+
+  for( f = 0; f < frame_length; f += AYSYNTH_STEP ) {
+    /* update ay registers. */
+    while( count && f >= changes->tstates ) {
+      write_register( ay, changes->reg, changes->val );
+      changes++;
+      count--;
+    }
+
+    env_counter = ay->env_counter;
+    noise_toggle = ay->noise_toggle;
+
+    step( ay, f, last );
+
+    if( stepped ) continue;
+
+    /* Skip ahead to the step before anything happens, but no further than
+       the next register write or the end of the frame */
+    limit = count && changes->tstates < frame_length ?
+            changes->tstates : frame_length;
+    skip = steps_unchanged( ay, ( limit - f - 1 ) / AYSYNTH_STEP,
+                            env_counter, noise_toggle );
+    if( skip ) {
+      skip_steps( ay, skip );
+      f += skip * AYSYNTH_STEP;
+    }
+  }
+}
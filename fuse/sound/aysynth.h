@@ -0,0 +1,85 @@
+/* aysynth.h: AY-3-8912 tone, noise and envelope generators
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#ifndef FUSE_AYSYNTH_H
+#define FUSE_AYSYNTH_H
+
+#include <libspectrum.h>
+
+#include "sound/blipbuffer.h"
+
+/* The generators are stepped once every this many T-states: the AY steps
+   down its clock by 16 for the tone and noise generators, and all
+   Spectrum models and clones with an AY seem to count down the master
+   clock by 2 to drive it */
+#define AYSYNTH_CLOCK_DIVISOR 16
+#define AYSYNTH_CLOCK_RATIO 2
+#define AYSYNTH_STEP ( AYSYNTH_CLOCK_DIVISOR * AYSYNTH_CLOCK_RATIO )
+
+/* A register write at a given time in the frame */
+typedef struct aysynth_change {
+  libspectrum_dword tstates;
+  unsigned char reg, val;
+} aysynth_change;
+
+typedef struct aysynth {
+
+  /* Output level for each volume */
+  unsigned int tone_levels[16];
+
+  /* Local copy of the AY registers */
+  libspectrum_byte registers[16];
+
+  unsigned int tone_tick[3], tone_high[3], tone_period[3];
+  unsigned int noise_tick, noise_period;
+  unsigned int env_internal_tick, env_tick, env_period;
+
+  int rng, noise_toggle;
+  int env_first, env_rev, env_counter;
+
+  /* Where each channel goes; the second synth may be NULL */
+  Blip_Synth *synth[3], *synth_r[3];
+
+} aysynth;
+
+/* Set up the generators from scratch, with amplitude as the loudest output
+   level of a channel */
+void aysynth_init( aysynth *ay, int amplitude );
+
+/* Reset the tone, noise and envelope counters, as when the machine is
+   reset */
+void aysynth_reset( aysynth *ay );
+
+/* Run the generators for one frame of frame_length T-states, applying the
+   register writes in changes (sorted by time) as the frame goes, and send
+   the output of each channel to its synths.
+
+   If stepped is set, every step is emulated individually; otherwise
+   stretches of steps where nothing can change any channel's output are
+   skipped in one go. The output is identical either way */
+void aysynth_frame( aysynth *ay, const aysynth_change *changes, int count,
+                    libspectrum_dword frame_length, int stepped );
+
+#endif			/* #ifndef FUSE_AYSYNTH_H */
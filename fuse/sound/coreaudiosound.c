@@ -20,6 +20,7 @@
 #include <config.h>
 
 #include <errno.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <AssertMacros.h>
@@ -27,14 +28,11 @@
 #include <AudioToolbox/AudioToolbox.h>
 
 #include "settings.h"
-#include "sfifo.h"
 #include "sound.h"
+#include "sound/audioring.h"
 #include "ui/ui.h"
 
-sfifo_t sound_fifo;
-
-/* Number of Spectrum frames audio latency to use */
-#define NUM_FRAMES 2
+audioring sound_ring;
 
 static
 OSStatus coreaudiowrite( void *inRefCon,
@@ -113,9 +111,8 @@ sound_lowlevel_init( const char *dev, int *freqptr, int *stereoptr )
 {
   OSStatus err = kAudioHardwareNoError;
   AudioDeviceID device = kAudioObjectUnknown; /* the default device */
-  int error;
   float hz;
-  int sound_framesiz;
+  int sound_framesiz, latency;
 
   if( get_default_output_device(&device) ) return 1;
   if( get_default_sample_rate( device, &deviceFormat.mSampleRate ) ) return 1;
@@ -200,14 +197,13 @@ sound_lowlevel_init( const char *dev, int *freqptr, int *stereoptr )
   if( hz > 100.0 ) hz = 100.0;
   sound_framesiz = deviceFormat.mSampleRate / hz;
 
-  if( ( error = sfifo_init( &sound_fifo, NUM_FRAMES
-                                         * deviceFormat.mBytesPerFrame
-                                         * deviceFormat.mChannelsPerFrame
-                                         * sound_framesiz + 1 ) ) ) {
-    ui_error( UI_ERROR_ERROR, "Problem initialising sound fifo: %s",
-              strerror ( error ) );
-    return 1;
-  }
+  /* Hold the target latency, but always at least a frame */
+  latency = sound_get_latency_samples( deviceFormat.mSampleRate );
+  if( latency < sound_framesiz ) latency = sound_framesiz;
+
+  audioring_init( &sound_ring, deviceFormat.mBytesPerFrame
+                               * deviceFormat.mChannelsPerFrame
+                               * latency );
 
   /* wait to run sound until we have some sound to play */
   audio_output_started = 0;
@@ -233,46 +229,53 @@ sound_lowlevel_end( void )
     ui_error( UI_ERROR_ERROR, "AudioComponentInstanceDispose=%ld", (long)err );
   }
 
-  sfifo_flush( &sound_fifo );
-  sfifo_close( &sound_fifo );
+  audioring_flush( &sound_ring );
+  audioring_end( &sound_ring );
 }
 
-/* Copy data to fifo */
+static void
+start_output( void )
+{
+  OSStatus err;
+
+  if( audio_output_started ) return;
+
+  /* Start the rendering
+     The DefaultOutputUnit will do any format conversions to the format of the
+     default device */
+  err = AudioOutputUnitStart( gOutputUnit );
+  if( err ) {
+    ui_error( UI_ERROR_ERROR, "AudioOutputUnitStart=%ld", (long)err );
+    return;
+  }
+
+  audio_output_started = 1;
+}
+
+/* Copy data to the ring */
 void
 sound_lowlevel_frame( libspectrum_signed_word *data, int len )
 {
-  int i = 0;
+  size_t i;
 
   /* Convert to bytes */
   libspectrum_signed_byte* bytes = (libspectrum_signed_byte*)data;
   len <<= 1;
 
   while( len ) {
-    if( ( i = sfifo_write( &sound_fifo, bytes, len ) ) < 0 ) {
-      break;
-    } else if( !i ) {
-      usleep( 10000 );
-    }
+    i = audioring_write( &sound_ring, bytes, len );
     bytes += i;
     len -= i;
-  }
-  if( i < 0 ) {
-    ui_error( UI_ERROR_ERROR, "Couldn't write sound fifo: %s",
-              strerror( i ) );
-  }
 
-  if( !audio_output_started ) {
-    /* Start the rendering
-       The DefaultOutputUnit will do any format conversions to the format of the
-       default device */
-    OSStatus err = AudioOutputUnitStart( gOutputUnit );
-    if( err ) {
-      ui_error( UI_ERROR_ERROR, "AudioOutputUnitStart=%ld", (long)err );
-      return;
+    if( len ) {
+      /* The ring is full, so it had better be playing */
+      start_output();
+      if( !audio_output_started ) return;
+      audioring_wait( &sound_ring, len );
     }
-
-    audio_output_started = 1;
   }
+
+  start_output();
 }
 
 #ifndef MIN
@@ -287,26 +290,18 @@ OSStatus coreaudiowrite( void *inRefCon,
                          UInt32 inNumberFrames,                       
                          AudioBufferList *ioData )
 {
-  int f;
   int len = deviceFormat.mBytesPerFrame * inNumberFrames;
   uint8_t* out = ioData->mBuffers[0].mData;
+  int f;
 
   /* Try to only read an even number of bytes so as not to fragment a sample */
-  len = MIN( len, sfifo_used( &sound_fifo ) );
-  len &= sound_stereo_ay != SOUND_STEREO_AY_NONE ? 0xfffc : 0xfffe;
+  f = MIN( len, (int)audioring_used( &sound_ring ) );
+  f &= sound_stereo_ay != SOUND_STEREO_AY_NONE ? 0xfffc : 0xfffe;
 
-  /* Read input_size bytes from fifo into sound stream */
-  while( ( f = sfifo_read( &sound_fifo, out, len ) ) > 0 ) {
-    out += f;
-    len -= f;
-  }
+  f = audioring_read( &sound_ring, out, f );
 
   /* If we ran out of sound, make do with silence :( */
-  if( f < 0 ) {
-    for( f=0; f<len; f++ ) {
-      *out++ = 0;
-    }
-  }
+  memset( out + f, 0, len - f );
 
   return noErr;
 }
@@ -34,27 +34,35 @@
 #include <SDL.h>
 
 #include "settings.h"
-#include "sfifo.h"
 #include "sound.h"
+#include "sound/audioring.h"
 #include "ui/ui.h"
 
 static void sdlwrite( void *userdata, Uint8 *stream, int len );
 
-sfifo_t sound_fifo;
-
-/* Number of Spectrum frames audio latency to use */
-#define NUM_FRAMES 2
+audioring sound_ring;
 
 /* Records sound writer status information */
 static int audio_output_started;
 
+/* The number of samples to ask SDL to fetch at a time */
+static Uint16
+callback_size( int freq )
+{
+  int samples = sound_get_latency_samples( freq ) / 2;
+
+  if( samples < freq / 100 ) samples = freq / 100;
+  if( samples > 0x8000 ) samples = 0x8000;
+
+  return samples;
+}
+
 int
 sound_lowlevel_init( const char *device, int *freqptr, int *stereoptr )
 {
   SDL_AudioSpec requested, received;
   int error;
-  float hz;
-  int sound_framesiz;
+  int latency, callback_samples, ring_samples;
 
 #ifndef __MORPHOS__    
   /* I'd rather just use setenv, but Windows doesn't have it */
@@ -84,18 +92,11 @@ sound_lowlevel_init( const char *device, int *freqptr, int *stereoptr )
   requested.format = AUDIO_S16SYS;
   requested.callback = sdlwrite;
 
-  /* Adjust relative processor speed to deal with adjusting sound generation
-     frequency against emulation speed (more flexible than adjusting generated
-     sample rate) */
-  hz = (float)sound_get_effective_processor_speed() /
-              machine_current->timings.tstates_per_frame;
-  /* Amount of audio data we will accumulate before yielding back to the OS.
-     Not much point having more than 100Hz playback, we probably get
-     downgraded by the OS as being a hog too (unlimited Hz limits playback
-     speed to about 2000% on my Mac, 100Hz allows up to 5000% for me) */
-  if( hz > 100.0 ) hz = 100.0;
-  sound_framesiz = *freqptr / hz;
-  requested.samples = sound_framesiz;
+  /* SDL plays one callback's worth while the ring holds at least the next,
+     so ask for callbacks of half the target latency. Not much point having
+     more than 100Hz playback, we probably get downgraded by the OS as being
+     a hog too */
+  requested.samples = callback_size( *freqptr );
 
   if ( SDL_OpenAudio( &requested, &received ) < 0 ) {
     settings_current.sound = 0;
@@ -105,6 +106,7 @@ sound_lowlevel_init( const char *device, int *freqptr, int *stereoptr )
   }
 
   *freqptr = received.freq;
+  callback_samples = received.samples;
 
   if( received.format != AUDIO_S16SYS ) {
     /* close audio and then just let SDL convert to this wacky format at a
@@ -112,8 +114,7 @@ sound_lowlevel_init( const char *device, int *freqptr, int *stereoptr )
     SDL_CloseAudio();
 
     requested.freq = *freqptr;
-    sound_framesiz = *freqptr / hz;
-    requested.samples = sound_framesiz;
+    requested.samples = callback_size( *freqptr );
 
     if( SDL_OpenAudio( &requested, NULL ) < 0 ) {
       settings_current.sound = 0;
@@ -121,20 +122,19 @@ sound_lowlevel_init( const char *device, int *freqptr, int *stereoptr )
                 SDL_GetError() );
       return 1;
     }
+    callback_samples = requested.samples;
   } else {
     *stereoptr = received.channels == 1 ? 0 : 1;
   }
 
-  sound_framesiz = *freqptr / hz;
-  sound_framesiz <<= 1;
+  /* The ring must hold a whole callback's worth, or the callback will run
+     dry; beyond that, it and SDL's own buffer make up the target latency
+     between them */
+  latency = sound_get_latency_samples( *freqptr );
+  ring_samples = latency - callback_samples > callback_samples ?
+                 latency - callback_samples : callback_samples;
 
-  if( ( error = sfifo_init( &sound_fifo, NUM_FRAMES
-                                         * received.channels
-                                         * sound_framesiz + 1 ) ) ) {
-    ui_error( UI_ERROR_ERROR, "Problem initialising sound fifo: %s",
-              strerror ( error ) );
-    return 1;
-  }
+  audioring_init( &sound_ring, ring_samples * received.channels * 2 );
 
   /* wait to run sound until we have some sound to play */
   audio_output_started = 0;
@@ -149,59 +149,57 @@ sound_lowlevel_end( void )
   SDL_LockAudio();
   SDL_CloseAudio();
   SDL_QuitSubSystem( SDL_INIT_AUDIO );
-  sfifo_flush( &sound_fifo );
-  sfifo_close( &sound_fifo );
+  audioring_flush( &sound_ring );
+  audioring_end( &sound_ring );
 }
 
-/* Copy data to fifo */
+static void
+start_output( void )
+{
+  if( !audio_output_started ) {
+    SDL_PauseAudio( 0 );
+    audio_output_started = 1;
+  }
+}
+
+/* Copy data to the ring */
 void
 sound_lowlevel_frame( libspectrum_signed_word *data, int len )
 {
-  int i = 0;
+  size_t i;
 
   /* Convert to bytes */
   libspectrum_signed_byte* bytes = (libspectrum_signed_byte*)data;
   len <<= 1;
 
   while( len ) {
-    if( ( i = sfifo_write( &sound_fifo, bytes, len ) ) < 0 ) {
-      break;
-    } else if (!i) {
-      SDL_Delay(10);
-    }
+    i = audioring_write( &sound_ring, bytes, len );
     bytes += i;
     len -= i;
-  }
-  if( i < 0 ) {
-    ui_error( UI_ERROR_ERROR, "Couldn't write sound fifo: %s",
-              strerror( i ) );
-  }
 
-  if( !audio_output_started ) {
-    SDL_PauseAudio( 0 );
-    audio_output_started = 1;
+    if( len ) {
+      /* The ring is full, so it had better be playing */
+      start_output();
+      audioring_wait( &sound_ring, len );
+    }
   }
+
+  start_output();
 }
 
 #ifndef MIN
 #define MIN(a,b)    (((a) < (b)) ? (a) : (b))
 #endif
 
-/* Write len samples from fifo into stream */
+/* Write len samples from the ring into stream */
 void
 sdlwrite( void *userdata, Uint8 *stream, int len )
 {
-  int f;
-
   /* Try to only read an even number of bytes so as not to fragment a sample */
-  len = MIN( len, sfifo_used( &sound_fifo ) );
+  len = MIN( len, (int)audioring_used( &sound_ring ) );
   len &= sound_stereo_ay ? 0xfffc : 0xfffe;
 
-  /* Read input_size bytes from fifo into sound stream */
-  while( ( f = sfifo_read( &sound_fifo, stream, len ) ) > 0 ) {
-    stream += f;
-    len -= f;
-  }
+  audioring_read( &sound_ring, stream, len );
 
   /* If we ran out of sound, do nothing else as SDL has prefilled
      the output buffer with silence :( */
@@ -25,7 +25,7 @@
 #include <unistd.h>
 
 #include "fuse.h"
-#include "sfifo.h"
+#include "sound/audioring.h"
 
 #include <gccore.h>
 #include <ogc/audio.h>
@@ -36,7 +36,7 @@
 
 int samplerate;
 int streamstate;
-sfifo_t sound_fifo;
+audioring sound_ring;
 
 #define BUFSIZE 16384
 u8 dmabuf[BUFSIZE<<1] ATTRIBUTE_ALIGN(32);
@@ -45,10 +45,10 @@ int dmalen = BUFSIZE;
 static void
 sound_dmacallback( void )
 {
-  if( sfifo_used( &sound_fifo ) < 128) return;
+  if( audioring_used( &sound_ring ) < 128) return;
   
-  dmalen = MIN( BUFSIZE, sfifo_used( &sound_fifo ) );
-  sfifo_read( &sound_fifo, dmabuf, dmalen );
+  dmalen = MIN( BUFSIZE, audioring_used( &sound_ring ) );
+  audioring_read( &sound_ring, dmabuf, dmalen );
   DCFlushRange( dmabuf, dmalen );
   AUDIO_InitDMA( (u32)dmabuf, dmalen );
   AUDIO_StartDMA();
@@ -69,7 +69,7 @@ sound_lowlevel_init( const char *device, int *freqptr, int *stereoptr )
     return 1;
   }
 
-  sfifo_init( &sound_fifo, BUFSIZE );
+  audioring_init( &sound_ring, BUFSIZE );
   *stereoptr = 1;
   
   AUDIO_Init( NULL );
@@ -89,24 +89,23 @@ sound_lowlevel_init( const char *device, int *freqptr, int *stereoptr )
 void
 sound_lowlevel_end( void )
 {
-  sfifo_flush( &sound_fifo );
-  sfifo_close( &sound_fifo );
+  audioring_flush( &sound_ring );
+  audioring_end( &sound_ring );
   AUDIO_StopDMA();
 }
 
 void
 sound_lowlevel_frame(libspectrum_signed_word *data, int len)
 {
-  int i;
+  size_t i;
   
   libspectrum_signed_byte *bytes = (libspectrum_signed_byte*)data;
   len <<= 1;
 
   while(len) {
-    if( ( i = sfifo_write( &sound_fifo, bytes, len ) ) < 0 ) 
-      break;
-    else if( !i )
-      usleep(10000);
+    i = audioring_write( &sound_ring, bytes, len );
+    if( !i )
+      audioring_wait( &sound_ring, len );
     bytes += i;
     len -= i;
   }
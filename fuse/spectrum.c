@@ -27,6 +27,7 @@
 
 #include <libspectrum.h>
 
+#include "batch.h"
 #include "compat.h"
 #include "debugger/debugger.h"
 #include "display.h"
@@ -39,6 +40,7 @@
 #include "peripherals/printer.h"
 #include "psg.h"
 #include "profile.h"
+#include "rewind.h"
 #include "rzx.h"
 #include "settings.h"
 #include "sound.h"
@@ -69,8 +71,10 @@ spectrum_frame_event_fn( libspectrum_dword last_tstates, int type,
 {
   if( rzx_playback ) event_force_events();
   rzx_frame();
+  rewind_frame();
   psg_frame();
   spectrum_frame();
+  batch_frame();
   z80_interrupt();
   ui_joystick_poll();
   timer_estimate_speed();
@@ -129,6 +133,7 @@ spectrum_frame( void )
                spectrum_frame_event );
 
   loader_frame( frame_length );
+  tape_frame( frame_length );
 
   return 0;
 }
@@ -77,7 +77,6 @@ static int play_event, stop_event = -1;
 
 /* Spectrum events */
 int tape_edge_event;
-static int record_event;
 static int tape_mic_off_event;
 
 static libspectrum_dword next_tape_edge_tstates;
@@ -85,12 +84,10 @@ static libspectrum_dword next_tape_edge_tstates;
 /* Function prototypes */
 
 static int tape_autoload( libspectrum_machine hardware );
-static int trap_load_block( libspectrum_tape_block *block );
+static int trap_load_block( libspectrum_tape_block *block,
+                            libspectrum_byte b );
 static int tape_play( int autoplay );
 static void make_name( unsigned char *name, const unsigned char *data );
-static void
-tape_event_record_sample( libspectrum_dword last_tstates, int type,
-			  void *user_data );
 static void tape_stop_mic_off( libspectrum_dword last_tstates, int type,
                                void *user_data );
 
@@ -108,8 +105,6 @@ tape_init( void *context )
 
   tape_edge_event = event_register( tape_next_edge, "Tape edge" );
   tape_mic_off_event = event_register( tape_stop_mic_off, "Tape stop MIC off" );
-  record_event = event_register( tape_event_record_sample,
-				 "Tape sample record" );
 
   tape_modified = 0;
 
@@ -398,7 +393,7 @@ int tape_load_trap( void )
     PC = 0x05e2;
   }
 
-  error = trap_load_block( block );
+  error = trap_load_block( block, 0xb0 );
   if( error ) return error;
 
   /* Peek at the next block. If it's a ROM block, move along, initialise
@@ -423,7 +418,7 @@ int tape_load_trap( void )
 }
 
 static int
-trap_load_block( libspectrum_tape_block *block )
+trap_load_block( libspectrum_tape_block *block, libspectrum_byte b )
 {
   libspectrum_byte parity, *data;
   int i = 0, length, read, verify;
@@ -432,11 +427,11 @@ trap_load_block( libspectrum_tape_block *block )
    *  A = calculated parity byte if parity checked, else 0 (CHECKME)
    *  F : if parity checked, all flags are modified
    *      else carry only is modified (FIXME)
-   *  B = 0xB0 (success) or 0x00 (failure)
+   *  B = `b' (0xB0 for the ROM) on success or 0x00 on failure
    *  C = 0x01 (confirmed), 0x21, 0xFE or 0xDE (CHECKME)
    * DE : decremented by number of bytes loaded or verified
    *  H = calculated parity byte or undefined
-   *  L = last byte read, or 1 if none
+   *  L = last byte read (the parity byte if it was), or 1 if none
    * IX : incremented by number of bytes loaded or verified
    * A' = unchanged on error + no flag byte, else 0x01
    * F' = 0x01      on error + no flag byte, else 0x45
@@ -496,10 +491,11 @@ trap_load_block( libspectrum_tape_block *block )
 
   /* If |DE| bytes have been read and there's more data, do the parity check */
   if( DE == i && read + 1 < length ) {
+    L = data[read];
     parity ^= data[read];
     A = parity;
     CP( 1 ); /* parity check is successful if A==0 */
-    B = 0xB0;
+    B = b;
   } else {
     /* Failure to read first bit of the next byte (ref. 48K ROM, 0x5EC) */
     B = 255;
@@ -517,6 +513,69 @@ error_ret:
   return 0;
 }
 
+/* The length of a ROM block's edges for 0 and 1 bits */
+#define ROM_BIT0_LENGTH 855
+#define ROM_BIT1_LENGTH 1710
+
+/* Load all of the current block for a copy of the ROM loader which is
+   waiting for the first edge of the block's data. `threshold' is the
+   length of a bit in tstates above which the loader reads it as a 1, and
+   `b' is what the loader leaves in B after loading successfully. Returns
+   0 if the block was loaded, or non-zero if the block is unsuitable and
+   has to be loaded edge by edge */
+int
+tape_load_block_data( libspectrum_dword threshold, libspectrum_byte b )
+{
+  libspectrum_tape_block *block;
+  libspectrum_dword bit0, bit1;
+  size_t byte, bit;
+
+  if( !tape_playing ) return 1;
+
+  block = libspectrum_tape_current_block( tape );
+
+  switch( libspectrum_tape_block_type( block ) ) {
+
+  case LIBSPECTRUM_TAPE_BLOCK_ROM:
+    bit0 = ROM_BIT0_LENGTH; bit1 = ROM_BIT1_LENGTH;
+    break;
+
+  case LIBSPECTRUM_TAPE_BLOCK_TURBO:
+  case LIBSPECTRUM_TAPE_BLOCK_PURE_DATA:
+    if( libspectrum_tape_block_bits_in_last_byte( block ) != 8 ) return 1;
+    bit0 = libspectrum_tape_block_bit0_length( block );
+    bit1 = libspectrum_tape_block_bit1_length( block );
+    break;
+
+  default:
+    return 1;
+  }
+
+  /* Only if the loader can't mistake one bit for the other */
+  if( 2 * bit0 > threshold - threshold / 8 ||
+      2 * bit1 < threshold + threshold / 8 ) return 1;
+
+  /* The first edge of the data must still be to come */
+  if( libspectrum_tape_state( tape ) != LIBSPECTRUM_TAPE_STATE_DATA2 ||
+      libspectrum_tape_data_position( tape, &byte, &bit ) ||
+      byte || bit ) return 1;
+
+  /* As with the trap, we don't handle partial loading */
+  if( libspectrum_tape_block_data_length( block ) != DE + 2 ) return 1;
+
+  if( trap_load_block( block, b ) ) return 1;
+
+  /* Skip the rest of the data. Its edges leave the microphone as it was,
+     except for the last which tape_next_edge() supplies */
+  libspectrum_tape_set_state( tape, LIBSPECTRUM_TAPE_STATE_PAUSE );
+  tape_microphone = !tape_microphone;
+
+  event_remove_type( tape_edge_event );
+  tape_next_edge( tstates, 0, NULL );
+
+  return 0;
+}
+
 /* Append to the current tape file in memory; returns 0 if a block was
    saved or non-zero if there was an error at the emulator level, or tape
    traps are not active */
@@ -682,14 +741,26 @@ tape_present( void )
   return libspectrum_tape_present( tape );
 }
 
+/* Rather than sampling the MIC line, recording is told by the ULA exactly
+   when the level changes, and turns the time between changes into a
+   number of samples. The rounding error is carried over to the next pulse
+   so the recording never drifts from the real edges */
 typedef struct
 {
   libspectrum_byte *tape_buffer;
   libspectrum_dword tape_buffer_size;
   libspectrum_dword tape_buffer_used;
   int tstates_per_sample;
-  int last_level;
-  int last_level_count;
+
+  /* When in this frame the MIC level last changed, and how many tstates
+     there were at that level before this frame; a level can be held for
+     much longer than a dword of tstates */
+  libspectrum_dword level_start;
+  libspectrum_qword level_tstates;
+
+  /* tstates not yet accounted for by the pulses recorded so far; negative
+     if a pulse had to be stretched to a whole sample */
+  libspectrum_signed_dword balance;
 } tape_rec_state;
 
 int tape_recording = 0;
@@ -708,12 +779,9 @@ tape_record_start( void )
 					  rec_state.tape_buffer_size);
   rec_state.tape_buffer_used = 0;
 
-  /* start scheduling events that record into a buffer that we
-     start allocating here */
-  event_add( tstates + rec_state.tstates_per_sample, record_event );
-
-  rec_state.last_level = ula_tape_level();
-  rec_state.last_level_count = 1;
+  rec_state.level_start = tstates;
+  rec_state.level_tstates = 0;
+  rec_state.balance = 0;
 
   tape_recording = 1;
 
@@ -724,7 +792,7 @@ tape_record_start( void )
 static int
 write_rec_buffer( libspectrum_byte *tape_buffer,
                   libspectrum_dword tape_buffer_used,
-                  int last_level_count )
+                  libspectrum_dword last_level_count )
 {
   if( last_level_count <= 0xff ) {
     tape_buffer[ tape_buffer_used++ ] = last_level_count;
@@ -739,32 +807,61 @@ write_rec_buffer( libspectrum_byte *tape_buffer,
   return tape_buffer_used;
 }
 
+/* The MIC level has changed, so put the pulse which has just ended into
+   the recording buffer */
 void
-tape_event_record_sample( libspectrum_dword last_tstates, int type,
-			  void *user_data )
+tape_record_edge( libspectrum_dword at_tstates )
 {
-  if( rec_state.last_level != (ula_tape_level()) ) {
-    /* put a sample into the recording buffer */
-    rec_state.tape_buffer_used =
-      write_rec_buffer( rec_state.tape_buffer,
-                        rec_state.tape_buffer_used,
-                        rec_state.last_level_count );
-
-    rec_state.last_level_count = 0;
-    rec_state.last_level = ula_tape_level();
-    /* make sure we can still fit a dword and a flag byte in the buffer */
-    if( rec_state.tape_buffer_used+5 >= rec_state.tape_buffer_size ) {
-      rec_state.tape_buffer_size = rec_state.tape_buffer_size*2;
-      rec_state.tape_buffer =
-        libspectrum_renew( libspectrum_byte, rec_state.tape_buffer,
-                           rec_state.tape_buffer_size );
-    }
+  libspectrum_signed_qword length;
+  libspectrum_qword samples;
+
+  length = rec_state.balance +
+           (libspectrum_signed_qword)( rec_state.level_tstates + at_tstates -
+                                       rec_state.level_start );
+
+  /* Every edge is kept, even if it means a pulse is longer than it should
+     be */
+  samples = length > 0 ?
+    ( length + rec_state.tstates_per_sample / 2 ) /
+    rec_state.tstates_per_sample : 0;
+  if( !samples ) samples = 1;
+
+  if( samples > 0xffffffff ) {
+    /* Over a day at one level, which is more than a CSW pulse can hold */
+    samples = 0xffffffff;
+    rec_state.balance = 0;
+  } else {
+    rec_state.balance = length - (libspectrum_signed_qword)samples *
+                                 rec_state.tstates_per_sample;
   }
 
-  rec_state.last_level_count++;
+  /* make sure we can still fit a dword and a flag byte in the buffer */
+  if( rec_state.tape_buffer_used + 5 > rec_state.tape_buffer_size ) {
+    rec_state.tape_buffer_size = rec_state.tape_buffer_size*2;
+    rec_state.tape_buffer =
+      libspectrum_renew( libspectrum_byte, rec_state.tape_buffer,
+                         rec_state.tape_buffer_size );
+  }
 
-  /* schedule next timer */
-  event_add( last_tstates + rec_state.tstates_per_sample, record_event );
+  rec_state.tape_buffer_used = write_rec_buffer( rec_state.tape_buffer,
+                                                 rec_state.tape_buffer_used,
+                                                 samples );
+
+  rec_state.level_start = at_tstates;
+  rec_state.level_tstates = 0;
+}
+
+void
+tape_frame( libspectrum_dword frame_length )
+{
+  if( !tape_recording ) return;
+
+  if( rec_state.level_start <= frame_length ) {
+    rec_state.level_tstates += frame_length - rec_state.level_start;
+    rec_state.level_start = 0;
+  } else {
+    rec_state.level_start -= frame_length;
+  }
 }
 
 int
@@ -772,15 +869,10 @@ tape_record_stop( void )
 {
   libspectrum_tape_block* block;
 
-  /* put last sample into the recording buffer */
-  rec_state.tape_buffer_used = write_rec_buffer( rec_state.tape_buffer,
-                                                 rec_state.tape_buffer_used,
-                                                 rec_state.last_level_count );
-
-  /* stop scheduling events and turn buffer into a block and
-     pop into the current tape */
-  event_remove_type( record_event );
+  /* put last pulse into the recording buffer */
+  tape_record_edge( tstates );
 
+  /* turn buffer into a block and pop into the current tape */
   block = libspectrum_tape_block_alloc( LIBSPECTRUM_TAPE_BLOCK_RLE_PULSE );
 
   libspectrum_tape_block_set_scale( block, rec_state.tstates_per_sample );
@@ -47,6 +47,7 @@ int tape_write( const char *filename );
 int tape_can_autoload( void );
 
 int tape_load_trap( void );
+int tape_load_block_data( libspectrum_dword threshold, libspectrum_byte b );
 int tape_save_trap( void );
 
 int tape_do_play( int autoplay );
@@ -62,6 +63,11 @@ int tape_present( void );
 void tape_record_start( void );
 int tape_record_stop( void );
 
+/* Called by the ULA when the MIC level changes while recording */
+void tape_record_edge( libspectrum_dword at_tstates );
+
+void tape_frame( libspectrum_dword frame_length );
+
 /* Call a user-supplied function for every block in the current tape */
 int
 tape_foreach( void (*function)( libspectrum_tape_block *block,
@@ -142,23 +142,13 @@ timer_register_startup( void )
 #ifdef SOUND_FIFO
 
 /* Callback-style sound based timer */
-#include "sound/sfifo.h"
-
-extern sfifo_t sound_fifo;
+#include "sound/audioring.h"
 
 static void
 timer_frame_callback_sound( libspectrum_dword last_tstates )
 {
-  for(;;) {
-
-    /* Sleep while fifo is full */
-    if( sfifo_space( &sound_fifo ) < sound_framesiz ) {
-      timer_sleep( TEN_MS );
-    } else {
-      break;
-    }
-
-  }
+  /* Wait until the sound device has made room for the next frame */
+  audioring_wait( &sound_ring, sound_get_frame_bytes() );
 
   event_add( last_tstates + machine_current->timings.tstates_per_frame,
              timer_event );
@@ -188,9 +178,10 @@ timer_frame( libspectrum_dword last_tstates, int event GCC_UNUSED,
     return;
   }
 
-  /* If we're fastloading, just schedule another check in a frame's time
-     and do nothing else */
-  if( settings_current.fastload && tape_is_playing() ) {
+  /* If we're fastloading or running unthrottled, just schedule another
+     check in a frame's time and do nothing else */
+  if( !settings_current.throttle ||
+      ( settings_current.fastload && tape_is_playing() ) ) {
 
     libspectrum_dword next_check_time =
       last_tstates + machine_current->timings.tstates_per_frame;
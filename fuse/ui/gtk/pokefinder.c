@@ -27,8 +27,10 @@
 
 #include <config.h>
 
+#include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <gdk/gdkkeysyms.h>
 #include <gtk/gtk.h>
@@ -46,6 +48,10 @@ static void gtkui_pokefinder_incremented( GtkWidget *widget,
 					  gpointer user_data GCC_UNUSED );
 static void gtkui_pokefinder_decremented( GtkWidget *widget,
 					  gpointer user_data GCC_UNUSED );
+static void gtkui_pokefinder_changed( GtkWidget *widget,
+				     gpointer user_data GCC_UNUSED );
+static void gtkui_pokefinder_unchanged( GtkWidget *widget,
+				       gpointer user_data GCC_UNUSED );
 static void gtkui_pokefinder_search( GtkWidget *widget, gpointer user_data );
 static void gtkui_pokefinder_reset( GtkWidget *widget, gpointer user_data );
 static void gtkui_pokefinder_close( GtkWidget *widget, gpointer user_data );
@@ -167,10 +173,12 @@ create_dialog( void )
     static gtkstock_button btn[] = {
       { "Incremented", G_CALLBACK( gtkui_pokefinder_incremented ), NULL, NULL, 0, 0, 0, 0 },
       { "Decremented", G_CALLBACK( gtkui_pokefinder_decremented ), NULL, NULL, 0, 0, 0, 0 },
+      { "Changed", G_CALLBACK( gtkui_pokefinder_changed ), NULL, NULL, 0, 0, 0, 0 },
+      { "Unchanged", G_CALLBACK( gtkui_pokefinder_unchanged ), NULL, NULL, 0, 0, 0, 0 },
       { "!Search", G_CALLBACK( gtkui_pokefinder_search ), NULL, NULL, GDK_KEY_Return, 0, 0, 0 },
       { "Reset", G_CALLBACK( gtkui_pokefinder_reset ), NULL, NULL, 0, 0, 0, 0 }
     };
-    btn[2].actiondata = G_OBJECT( entry );
+    btn[4].actiondata = G_OBJECT( entry );
     accel_group = gtkstock_create_buttons( dialog, NULL, btn,
 					   ARRAY_SIZE( btn ) );
     gtkstock_create_close( dialog, accel_group,
@@ -201,20 +209,64 @@ gtkui_pokefinder_decremented( GtkWidget *widget GCC_UNUSED,
   update_pokefinder();
 }
 
+static void
+gtkui_pokefinder_changed( GtkWidget *widget GCC_UNUSED,
+			  gpointer user_data GCC_UNUSED )
+{
+  pokefinder_changed();
+  update_pokefinder();
+}
+
+static void
+gtkui_pokefinder_unchanged( GtkWidget *widget GCC_UNUSED,
+			    gpointer user_data GCC_UNUSED )
+{
+  pokefinder_unchanged();
+  update_pokefinder();
+}
+
+/* The search text is one of
+     <value>        a byte from 0 to 255, or a word from 256 to 65535
+     <low>-<high>   a byte in the given range
+     +<n> or -<n>   a byte which has changed by n since the last search */
 static void
 gtkui_pokefinder_search( GtkWidget *widget, gpointer user_data GCC_UNUSED )
 {
-  long value;
+  const char *text = gtk_entry_get_text( GTK_ENTRY( widget ) );
+  long value, high;
+  char *end;
+  int error;
+
+  while( isspace( (unsigned char)*text ) ) text++;
 
   errno = 0;
-  value = strtol( gtk_entry_get_text( GTK_ENTRY( widget ) ), NULL, 10 );
+  value = strtol( text, &end, 10 );
+  while( isspace( (unsigned char)*end ) ) end++;
+
+  if( errno != 0 || end == text ) {
+    error = 1;
+  } else if( *text == '+' || *text == '-' ) {
+    error = *end || pokefinder_delta( value );
+  } else if( *end == '-' ) {
+    high = strtol( end + 1, &end, 10 );
+    while( isspace( (unsigned char)*end ) ) end++;
+    error = errno != 0 || *end || value > 255 || high < 0 || high > 255 ||
+            pokefinder_search_range( value, high );
+  } else if( *end || value > 65535 ) {
+    error = 1;
+  } else if( value > 255 ) {
+    error = pokefinder_search_word( value );
+  } else {
+    error = pokefinder_search( value );
+  }
 
-  if( errno != 0 || value < 0 || value > 255 ) {
-    ui_error( UI_ERROR_ERROR, "Invalid value: use an integer from 0 to 255" );
+  if( error ) {
+    ui_error( UI_ERROR_ERROR,
+	      "Invalid value: use a value from 0 to 65535, a range such as "
+	      "1-9 or a change such as +1 or -3" );
     return;
   }
 
-  pokefinder_search( value );
   update_pokefinder();
 }
 
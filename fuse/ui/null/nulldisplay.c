@@ -0,0 +1,92 @@
+/* nulldisplay.c: Routines for dealing with the null display
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include "ui/scaler/scaler.h"
+#include "ui/uidisplay.h"
+
+/* Nothing is ever drawn; the core's own copy of the screen is still kept
+   up to date by display.c, so screenshots work as normal */
+
+int
+uidisplay_init( int width, int height )
+{
+  scaler_register_clear();
+  scaler_select_bitformat( 565 );
+  scaler_register( SCALER_NORMAL );
+  scaler_select_scaler( SCALER_NORMAL );
+
+  return 0;
+}
+
+int
+uidisplay_hotswap_gfx_mode( void )
+{
+  return 0;
+}
+
+void
+uidisplay_frame_end( void )
+{
+}
+
+void
+uidisplay_area( int x, int y, int width, int height )
+{
+}
+
+int
+uidisplay_end( void )
+{
+  return 0;
+}
+
+void
+uidisplay_putpixel( int x, int y, int colour )
+{
+}
+
+void
+uidisplay_plot8( int x, int y, libspectrum_byte data,
+                 libspectrum_byte ink, libspectrum_byte paper )
+{
+}
+
+void
+uidisplay_plot16( int x, int y, libspectrum_word data,
+                  libspectrum_byte ink, libspectrum_byte paper )
+{
+}
+
+void
+uidisplay_frame_save( void )
+{
+}
+
+void
+uidisplay_frame_restore( void )
+{
+}
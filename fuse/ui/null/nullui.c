@@ -0,0 +1,71 @@
+/* nullui.c: Routines for dealing with the null user interface
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+/* The null UI has no display, keyboard or mouse. It is intended for running
+   Fuse headless, e.g. as a regression oracle in batch mode. The widget code
+   is linked in to provide the menu and dialog entry points, but as the
+   display is never marked as initialised no widget is ever shown, so any
+   dialog is cancelled immediately rather than waiting for input */
+
+#include <config.h>
+
+#include "fuse.h"
+#include "keyboard.h"
+#include "ui/ui.h"
+
+/* There is no keyboard to map */
+keysyms_map_t keysyms_map[] = {
+  { 0, 0 },
+};
+
+int
+ui_init( int *argc, char ***argv )
+{
+  return 0;
+}
+
+int
+ui_event( void )
+{
+  return 0;
+}
+
+int
+ui_end( void )
+{
+  return 0;
+}
+
+int
+ui_mouse_grab( int startup GCC_UNUSED )
+{
+  return 0;
+}
+
+int
+ui_mouse_release( int suspend )
+{
+  return !suspend;
+}
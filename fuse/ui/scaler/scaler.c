@@ -31,6 +31,10 @@
 
 #include <string.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif				/* #ifdef HAVE_PTHREAD */
+
 #include <libspectrum.h>
 
 #include "scaler.h"
@@ -72,6 +76,9 @@ static void expand_pal( int *x, int *y, int *w, int *h,
 static void expand_dotmatrix( int *x, int *y, int *w, int *h,
 			      int image_width, int image_height );
 
+/* Run the current scaler over a rectangle, split into bands */
+static ScalerProc scale_bands_16, scale_bands_32;
+
 /* Information on each of the available scalers. Make sure this array stays
    in the same order as scaler.h:scaler_type */
 static const struct scaler_info available_scalers[] = {
@@ -123,6 +130,12 @@ ScalerProc *scaler_proc16, *scaler_proc32;
 scaler_flags_t scaler_flags;
 scaler_expand_fn *scaler_expander;
 
+/* The scaler which scaler_proc16 and scaler_proc32 run in bands, and how
+   many output rows it produces per input row */
+static ScalerProc *band_proc16, *band_proc32;
+static float band_factor;
+static int band_pairs;
+
 int
 scaler_select_scaler( scaler_type scaler )
 {
@@ -136,8 +149,15 @@ scaler_select_scaler( scaler_type scaler )
   settings_current.start_scaler_mode =
     utils_safe_strdup( available_scalers[current_scaler].id );
 
-  scaler_proc16 = scaler_get_proc16( current_scaler );
-  scaler_proc32 = scaler_get_proc32( current_scaler );
+  band_proc16 = scaler_get_proc16( current_scaler );
+  band_proc32 = scaler_get_proc32( current_scaler );
+  band_factor = scaler_get_scaling_factor( current_scaler );
+  band_pairs = current_scaler == SCALER_HALF ||
+               current_scaler == SCALER_HALFSKIP ||
+               current_scaler == SCALER_TIMEXTV ||
+               current_scaler == SCALER_TIMEX1_5X;
+  scaler_proc16 = scale_bands_16;
+  scaler_proc32 = scale_bands_32;
   scaler_flags = scaler_get_flags( current_scaler );
   scaler_expander = scaler_get_expander( current_scaler );
 
@@ -187,14 +207,32 @@ scaler_name( scaler_type scaler )
   return available_scalers[scaler].name;
 }
 
+/* Use the SIMD version of a scaler if one was built in, otherwise the C
+   version. SIMD versions are built only when the compiler targets SSE2
+   (__SSE2__), so the choice is made at build time and not by checking
+   the CPU we're running on */
 ScalerProc*
 scaler_get_proc16( scaler_type scaler )
 {
-  return available_scalers[scaler].scaler16;
+  ScalerProc *simd = scaler_simd_proc_16( scaler );
+  return simd ? simd : available_scalers[scaler].scaler16;
 }
 
 ScalerProc*
 scaler_get_proc32( scaler_type scaler )
+{
+  ScalerProc *simd = scaler_simd_proc_32( scaler );
+  return simd ? simd : available_scalers[scaler].scaler32;
+}
+
+ScalerProc*
+scaler_get_c_proc16( scaler_type scaler )
+{
+  return available_scalers[scaler].scaler16;
+}
+
+ScalerProc*
+scaler_get_c_proc32( scaler_type scaler )
 {
   return available_scalers[scaler].scaler32;
 }
@@ -274,3 +312,294 @@ expand_dotmatrix( int *x GCC_UNUSED, int *y GCC_UNUSED, int *w GCC_UNUSED,
   (*y)-=y_mod;
   (*h)+=y_mod;
 }
+
+/* Splitting a rectangle into horizontal bands, so several threads can
+   scale it at once. The scalers which smear the image read the rows
+   around each band but only ever write their own band's output, so the
+   bands can be scaled independently. Each band except the last is an
+   even number of rows high, so Dot Matrix, whose pattern repeats every
+   two rows, sees the same rows as it would for the whole rectangle. The
+   Timex scalers which turn pairs of rows into one (band_pairs) count the
+   pairs from the bottom of the rectangle, so those only agree when the
+   whole rectangle is an even number of rows high; it always is in
+   practice, but odd heights are just scaled in one go */
+
+#ifdef HAVE_PTHREAD
+
+/* Don't split a rectangle into bands smaller than this */
+#define BAND_MIN_HEIGHT 16
+
+typedef struct band_job {
+  ScalerProc *proc;
+  const libspectrum_byte *src;
+  libspectrum_dword src_pitch;
+  libspectrum_byte *dst;
+  libspectrum_dword dst_pitch;
+  int width, height;
+  int band_height, bands;
+  int next_band, bands_done;
+} band_job;
+
+static band_job job;
+
+static pthread_t band_threads[ SCALER_MAX_THREADS - 1 ];
+static int band_thread_count = 0, band_threads_stopping = 0;
+
+/* band_lock protects job; only one rectangle is scaled at a time */
+static pthread_mutex_t band_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t band_caller_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t band_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done = PTHREAD_COND_INITIALIZER;
+
+/* Scale the next band of the current job. Called with band_lock held,
+   which is dropped while scaling */
+static void
+run_band( void )
+{
+  int first = job.next_band++ * job.band_height;
+  int height = job.height - first;
+  int dst_row = first * band_factor;
+
+  if( height > job.band_height ) height = job.band_height;
+
+  pthread_mutex_unlock( &band_lock );
+
+  job.proc( job.src + first * job.src_pitch, job.src_pitch,
+            job.dst + dst_row * job.dst_pitch, job.dst_pitch, job.width,
+            height );
+
+  pthread_mutex_lock( &band_lock );
+
+  if( ++job.bands_done == job.bands ) pthread_cond_signal( &band_done );
+}
+
+static void*
+band_thread( void *arg GCC_UNUSED )
+{
+  pthread_mutex_lock( &band_lock );
+
+  while( !band_threads_stopping ) {
+    if( job.next_band < job.bands ) {
+      run_band();
+    } else {
+      pthread_cond_wait( &band_start, &band_lock );
+    }
+  }
+
+  pthread_mutex_unlock( &band_lock );
+
+  return NULL;
+}
+
+/* Change the number of worker threads; called with band_caller_lock held
+   and no job running */
+static void
+set_band_threads( int count )
+{
+  int i, error;
+
+  pthread_mutex_lock( &band_lock );
+  band_threads_stopping = 1;
+  pthread_cond_broadcast( &band_start );
+  pthread_mutex_unlock( &band_lock );
+
+  for( i = 0; i < band_thread_count; i++ )
+    pthread_join( band_threads[i], NULL );
+
+  band_thread_count = 0;
+  band_threads_stopping = 0;
+
+  for( i = 0; i < count; i++ ) {
+    error = pthread_create( &band_threads[i], NULL, band_thread, NULL );
+    if( error ) {
+      ui_error( UI_ERROR_ERROR, "error %d creating scaler thread", error );
+      break;
+    }
+    band_thread_count++;
+  }
+}
+
+static void
+scale_bands( ScalerProc *proc, const libspectrum_byte *srcPtr,
+             libspectrum_dword srcPitch, libspectrum_byte *dstPtr,
+             libspectrum_dword dstPitch, int width, int height )
+{
+  int threads = settings_current.scaler_threads, band_height;
+
+  if( threads > SCALER_MAX_THREADS ) threads = SCALER_MAX_THREADS;
+
+  if( threads <= 1 || height < 2 * BAND_MIN_HEIGHT ||
+      ( band_pairs && ( height & 1 ) ) ) {
+    proc( srcPtr, srcPitch, dstPtr, dstPitch, width, height );
+    return;
+  }
+
+  pthread_mutex_lock( &band_caller_lock );
+
+  if( band_thread_count != threads - 1 ) {
+    set_band_threads( threads - 1 );
+    threads = band_thread_count + 1;
+  }
+
+  band_height = ( height + threads - 1 ) / threads;
+  if( band_height < BAND_MIN_HEIGHT ) band_height = BAND_MIN_HEIGHT;
+  band_height += band_height & 1;
+
+  pthread_mutex_lock( &band_lock );
+
+  job.proc = proc;
+  job.src = srcPtr; job.src_pitch = srcPitch;
+  job.dst = dstPtr; job.dst_pitch = dstPitch;
+  job.width = width; job.height = height;
+  job.band_height = band_height;
+  job.bands = ( height + band_height - 1 ) / band_height;
+  job.next_band = 0; job.bands_done = 0;
+
+  pthread_cond_broadcast( &band_start );
+
+  /* Do our share of the bands, then wait for the workers to finish
+     theirs */
+  while( job.next_band < job.bands ) run_band();
+  while( job.bands_done < job.bands )
+    pthread_cond_wait( &band_done, &band_lock );
+
+  pthread_mutex_unlock( &band_lock );
+  pthread_mutex_unlock( &band_caller_lock );
+}
+
+#else				/* #ifdef HAVE_PTHREAD */
+
+static void
+scale_bands( ScalerProc *proc, const libspectrum_byte *srcPtr,
+             libspectrum_dword srcPitch, libspectrum_byte *dstPtr,
+             libspectrum_dword dstPitch, int width, int height )
+{
+  proc( srcPtr, srcPitch, dstPtr, dstPitch, width, height );
+}
+
+#endif				/* #ifdef HAVE_PTHREAD */
+
+static void
+scale_bands_16( const libspectrum_byte *srcPtr, libspectrum_dword srcPitch,
+                libspectrum_byte *dstPtr, libspectrum_dword dstPitch,
+                int width, int height )
+{
+  scale_bands( band_proc16, srcPtr, srcPitch, dstPtr, dstPitch, width,
+               height );
+}
+
+static void
+scale_bands_32( const libspectrum_byte *srcPtr, libspectrum_dword srcPitch,
+                libspectrum_byte *dstPtr, libspectrum_dword dstPitch,
+                int width, int height )
+{
+  scale_bands( band_proc32, srcPtr, srcPitch, dstPtr, dstPitch, width,
+               height );
+}
+
+/* Scratch memory for the scalers. Each thread has its own, as several may
+   be scaling different bands of the same rectangle at once */
+
+typedef struct scratch_buffer {
+  void *data;
+  size_t length;
+} scratch_buffer;
+
+#ifdef HAVE_PTHREAD
+
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+
+/* Called as each thread with some scratch memory exits */
+static void
+scratch_free( void *buffer )
+{
+  scratch_buffer *scratch = buffer;
+
+  libspectrum_free( scratch->data );
+  libspectrum_free( scratch );
+}
+
+static void
+scratch_key_create( void )
+{
+  pthread_key_create( &scratch_key, scratch_free );
+}
+
+static scratch_buffer*
+get_scratch( void )
+{
+  scratch_buffer *scratch;
+
+  pthread_once( &scratch_once, scratch_key_create );
+
+  scratch = pthread_getspecific( scratch_key );
+  if( !scratch ) {
+    scratch = libspectrum_new0( scratch_buffer, 1 );
+    pthread_setspecific( scratch_key, scratch );
+  }
+
+  return scratch;
+}
+
+/* The calling thread won't exit through pthread_exit(), so free its
+   scratch memory by hand */
+static void
+end_scratch( void )
+{
+  scratch_buffer *scratch;
+
+  pthread_once( &scratch_once, scratch_key_create );
+
+  scratch = pthread_getspecific( scratch_key );
+  if( scratch ) {
+    scratch_free( scratch );
+    pthread_setspecific( scratch_key, NULL );
+  }
+}
+
+#else				/* #ifdef HAVE_PTHREAD */
+
+static scratch_buffer scratch;
+
+static scratch_buffer*
+get_scratch( void )
+{
+  return &scratch;
+}
+
+static void
+end_scratch( void )
+{
+  libspectrum_free( scratch.data );
+  scratch.data = NULL;
+  scratch.length = 0;
+}
+
+#endif				/* #ifdef HAVE_PTHREAD */
+
+void*
+scaler_scratch( size_t length )
+{
+  scratch_buffer *scratch = get_scratch();
+
+  if( scratch->length < length ) {
+    libspectrum_free( scratch->data );
+    scratch->data = libspectrum_new0( libspectrum_byte, length );
+    scratch->length = length;
+  }
+
+  return scratch->data;
+}
+
+void
+scaler_end( void )
+{
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock( &band_caller_lock );
+  set_band_threads( 0 );
+  pthread_mutex_unlock( &band_caller_lock );
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  end_scratch();
+}
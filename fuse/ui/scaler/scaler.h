@@ -57,6 +57,10 @@ typedef enum scaler_flags_t {
   SCALER_FLAGS_EXPAND      = 1 << 0,
 } scaler_flags_t;
 
+/* The most threads scaler_proc16 and scaler_proc32 will use to scale a
+   rectangle */
+#define SCALER_MAX_THREADS 16
+
 typedef void ScalerProc( const libspectrum_byte *srcPtr,
 			 libspectrum_dword srcPitch,
 			 libspectrum_byte *dstPtr, libspectrum_dword dstPitch,
@@ -88,4 +92,7 @@ scaler_expand_fn* scaler_get_expander( scaler_type scaler );
 
 int scaler_select_bitformat( libspectrum_dword BitFormat );
 
+/* Stop the threads used to scale in bands and free the scalers' memory */
+void scaler_end( void );
+
 #endif
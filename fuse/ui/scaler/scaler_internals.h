@@ -66,4 +66,18 @@ DECLARE_SCALER(PalTV3x);
 DECLARE_SCALER(HQ2x);
 DECLARE_SCALER(HQ3x);
 
+/* The C versions of the scalers, which the SIMD versions must match
+   exactly */
+ScalerProc *scaler_get_c_proc16( scaler_type scaler );
+ScalerProc *scaler_get_c_proc32( scaler_type scaler );
+
+/* The SIMD version of a scaler, or NULL if there isn't one or this build
+   doesn't target SSE2 */
+ScalerProc *scaler_simd_proc_16( scaler_type scaler );
+ScalerProc *scaler_simd_proc_32( scaler_type scaler );
+
+/* At least length bytes of memory for the calling thread to use while
+   scaling, kept from one call to the next */
+void *scaler_scratch( size_t length );
+
 #endif				/* #ifndef FUSE_SCALER_INTERNALS_H */
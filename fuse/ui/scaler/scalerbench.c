@@ -0,0 +1,326 @@
+/* scalerbench.c: Benchmark for the graphics scalers
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libspectrum.h>
+
+#include "display.h"
+#include "scaler.h"
+#include "scaler_internals.h"
+#include "settings.h"
+#include "ui/ui.h"
+#include "ui/uidisplay.h"
+#include "utils.h"
+
+/* Times each scaler on a synthetic Spectrum frame, in both 16 and 32 bit
+   colour, and checks that the SIMD versions of the scalers give exactly
+   the same output as the C versions */
+
+static const char *progname;
+
+/* The frame is DISPLAY_ASPECT_WIDTH x DISPLAY_SCREEN_HEIGHT, with one pixel
+   of margin above and to the left and two below and to the right, as
+   the user interfaces provide */
+#define IMAGE_WIDTH DISPLAY_ASPECT_WIDTH
+#define IMAGE_HEIGHT DISPLAY_SCREEN_HEIGHT
+#define SOURCE_WIDTH ( IMAGE_WIDTH + 3 )
+#define SOURCE_HEIGHT ( IMAGE_HEIGHT + 3 )
+
+static const libspectrum_byte palette[ 16 ][ 3 ] = {
+  { 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0xc0 }, { 0xc0, 0x00, 0x00 },
+  { 0xc0, 0x00, 0xc0 }, { 0x00, 0xc0, 0x00 }, { 0x00, 0xc0, 0xc0 },
+  { 0xc0, 0xc0, 0x00 }, { 0xc0, 0xc0, 0xc0 }, { 0x00, 0x00, 0x00 },
+  { 0x00, 0x00, 0xff }, { 0xff, 0x00, 0x00 }, { 0xff, 0x00, 0xff },
+  { 0x00, 0xff, 0x00 }, { 0x00, 0xff, 0xff }, { 0xff, 0xff, 0x00 },
+  { 0xff, 0xff, 0xff },
+};
+
+static libspectrum_dword
+pixel_value( int colour, int bytes_per_pixel )
+{
+  const libspectrum_byte *rgb = palette[ colour ];
+
+  if( bytes_per_pixel == 2 )
+    return ( rgb[0] >> 3 ) | ( ( rgb[1] >> 2 ) << 5 ) |
+           ( ( rgb[2] >> 3 ) << 11 );
+
+  return rgb[0] | ( rgb[1] << 8 ) | ( rgb[2] << 16 );
+}
+
+/* A border with some stripes, and an attribute grid with a mixture of
+   solid blocks and text-like detail in the paper area */
+static int
+frame_colour( int x, int y )
+{
+  int column, row;
+  libspectrum_dword hash;
+
+  x -= DISPLAY_BORDER_ASPECT_WIDTH;
+  y -= DISPLAY_BORDER_HEIGHT;
+
+  if( x < 0 || x >= DISPLAY_ASPECT_WIDTH - 2 * DISPLAY_BORDER_ASPECT_WIDTH ||
+      y < 0 || y >= DISPLAY_HEIGHT )
+    return ( ( y + DISPLAY_BORDER_HEIGHT ) / 6 ) % 8;
+
+  column = x / 8; row = y / 8;
+  hash = ( column * 2654435761UL ) ^ ( row * 40503UL );
+
+  if( ( hash >> 7 ) & 1 ) return ( hash >> 3 ) & 0x0f;
+
+  /* Pseudo text: ink where a fixed pattern has a bit set */
+  hash = ( hash * 69069UL ) + ( y & 7 ) * 2654435761UL;
+  return ( hash >> ( 8 + ( x & 7 ) ) ) & 1 ? ( hash & 7 ) | 8 : 7;
+}
+
+static void
+fill_frame( libspectrum_byte *source, int bytes_per_pixel )
+{
+  int x, y;
+
+  memset( source, 0, SOURCE_WIDTH * SOURCE_HEIGHT * bytes_per_pixel );
+
+  for( y = 0; y < IMAGE_HEIGHT; y++ )
+    for( x = 0; x < IMAGE_WIDTH; x++ ) {
+      libspectrum_dword value =
+        pixel_value( frame_colour( x, y ), bytes_per_pixel );
+      libspectrum_byte *p =
+        source + ( ( y + 1 ) * SOURCE_WIDTH + x + 1 ) * bytes_per_pixel;
+
+      if( bytes_per_pixel == 2 )
+        *(libspectrum_word*)p = value;
+      else
+        *(libspectrum_dword*)p = value;
+    }
+}
+
+static void
+run_scaler( ScalerProc *proc, const libspectrum_byte *source,
+            libspectrum_byte *dest, libspectrum_dword dest_pitch,
+            int bytes_per_pixel, int width, int height )
+{
+  libspectrum_dword source_pitch = SOURCE_WIDTH * bytes_per_pixel;
+
+  proc( source + source_pitch + bytes_per_pixel, source_pitch, dest,
+        dest_pitch, width, height );
+}
+
+/* The wall clock time, as the banded scalers run on several threads */
+static double
+wall_time( void )
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return now.tv_sec + now.tv_nsec / 1e9;
+#else				/* #ifdef CLOCK_MONOTONIC */
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif				/* #ifdef CLOCK_MONOTONIC */
+}
+
+static double
+time_scaler( ScalerProc *proc, const libspectrum_byte *source,
+             libspectrum_byte *dest, libspectrum_dword dest_pitch,
+             int bytes_per_pixel, int frames )
+{
+  double start;
+  int i;
+
+  start = wall_time();
+  for( i = 0; i < frames; i++ )
+    run_scaler( proc, source, dest, dest_pitch, bytes_per_pixel,
+                IMAGE_WIDTH, IMAGE_HEIGHT );
+
+  return wall_time() - start;
+}
+
+/* Check proc gives exactly the same output as the C version of the
+   scaler, for both the full frame and a size which isn't a multiple of
+   the vector size or the band height, as happens when updating part of
+   the screen */
+static int
+check_scaler( ScalerProc *c_proc, ScalerProc *proc,
+              const libspectrum_byte *source, libspectrum_byte *reference,
+              libspectrum_byte *dest, libspectrum_dword dest_pitch,
+              size_t dest_size, int bytes_per_pixel )
+{
+  int inset;
+
+  for( inset = 0; inset <= 3; inset += 3 ) {
+    memset( reference, 0, dest_size );
+    memset( dest, 0, dest_size );
+    run_scaler( c_proc, source, reference, dest_pitch, bytes_per_pixel,
+                IMAGE_WIDTH - inset, IMAGE_HEIGHT - inset );
+    run_scaler( proc, source, dest, dest_pitch, bytes_per_pixel,
+                IMAGE_WIDTH - inset, IMAGE_HEIGHT - inset );
+    if( memcmp( reference, dest, dest_size ) ) return 1;
+  }
+
+  return 0;
+}
+
+static int
+benchmark( int bytes_per_pixel, int frames, int threads )
+{
+  libspectrum_byte *source, *reference, *dest;
+  libspectrum_dword dest_pitch;
+  size_t dest_size;
+  scaler_type scaler;
+  int error = 0;
+
+  /* Big enough for a 3x scaler */
+  dest_pitch = IMAGE_WIDTH * 3 * bytes_per_pixel;
+  dest_size = dest_pitch * IMAGE_HEIGHT * 3;
+
+  source = libspectrum_new( libspectrum_byte,
+                            SOURCE_WIDTH * SOURCE_HEIGHT * bytes_per_pixel );
+  reference = libspectrum_new( libspectrum_byte, dest_size );
+  dest = libspectrum_new( libspectrum_byte, dest_size );
+
+  fill_frame( source, bytes_per_pixel );
+
+  printf( "%d bit colour, %d frames, ms/frame for C, SIMD and %d threads\n",
+          bytes_per_pixel * 8, frames, threads );
+
+  for( scaler = 0; scaler < SCALER_NUM; scaler++ ) {
+    ScalerProc *c_proc, *proc;
+    int mismatch = 0;
+
+    if( bytes_per_pixel == 2 ) {
+      c_proc = scaler_get_c_proc16( scaler );
+      proc = scaler_get_proc16( scaler );
+    } else {
+      c_proc = scaler_get_c_proc32( scaler );
+      proc = scaler_get_proc32( scaler );
+    }
+
+    printf( "  %-22s %8.3f", scaler_name( scaler ),
+            time_scaler( c_proc, source, dest, dest_pitch, bytes_per_pixel,
+                         frames ) * 1000 / frames );
+
+    if( proc != c_proc ) {
+      mismatch |= check_scaler( c_proc, proc, source, reference, dest,
+                                dest_pitch, dest_size, bytes_per_pixel );
+      printf( " %8.3f",
+              time_scaler( proc, source, dest, dest_pitch, bytes_per_pixel,
+                           frames ) * 1000 / frames );
+    } else {
+      printf( " %8s", "-" );
+    }
+
+    /* The scaler as the UIs call it, split into bands across threads */
+    scaler_register( scaler );
+    scaler_select_scaler( scaler );
+    proc = bytes_per_pixel == 2 ? scaler_proc16 : scaler_proc32;
+
+    settings_current.scaler_threads = threads;
+    mismatch |= check_scaler( c_proc, proc, source, reference, dest,
+                              dest_pitch, dest_size, bytes_per_pixel );
+    printf( " %8.3f",
+            time_scaler( proc, source, dest, dest_pitch, bytes_per_pixel,
+                         frames ) * 1000 / frames );
+    settings_current.scaler_threads = 1;
+
+    if( mismatch ) {
+      printf( "  MISMATCH" );
+      error = 1;
+    }
+
+    printf( "\n" );
+  }
+
+  libspectrum_free( dest );
+  libspectrum_free( reference );
+  libspectrum_free( source );
+
+  return error;
+}
+
+int
+main( int argc, char **argv )
+{
+  int frames = 100, threads = 4, error = 0;
+
+  progname = argv[0];
+
+  if( argc > 1 ) frames = atoi( argv[1] );
+  if( argc > 2 ) threads = atoi( argv[2] );
+  if( frames <= 0 || threads <= 0 || threads > SCALER_MAX_THREADS ) {
+    fprintf( stderr, "Usage: %s [<frames> [<threads>]]\n", progname );
+    return 1;
+  }
+
+  if( scaler_select_bitformat( 565 ) ) return 1;
+
+  error |= benchmark( 2, frames, threads );
+  error |= benchmark( 4, frames, threads );
+
+  if( error ) fprintf( stderr, "%s: output differs from the C scalers\n",
+                       progname );
+
+  return error;
+}
+
+/* Stubs for the parts of Fuse the scalers use */
+
+settings_info settings_current;
+
+int
+ui_error( ui_error_level severity GCC_UNUSED, const char *format, ... )
+{
+  va_list ap;
+
+  va_start( ap, format );
+  fprintf( stderr, "%s: ", progname );
+  vfprintf( stderr, format, ap );
+  fprintf( stderr, "\n" );
+  va_end( ap );
+
+  return 0;
+}
+
+int
+uidisplay_hotswap_gfx_mode( void )
+{
+  return 0;
+}
+
+char*
+utils_safe_strdup( const char *src )
+{
+  char *dest = NULL;
+  if( src ) {
+    dest = libspectrum_new( char, strlen( src ) + 1 );
+    strcpy( dest, src );
+  }
+  return dest;
+}
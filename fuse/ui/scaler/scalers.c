@@ -30,6 +30,10 @@
 
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif				/* #ifdef __SSE2__ */
+
 #include <libspectrum.h>
 
 #include "scaler.h"
@@ -1808,8 +1812,6 @@ FUNCTION( scaler_HQ3x ) ( const libspectrum_byte *srcPtr,
        | w7 | w8 | w9 |
        +----+----+----+ */
   for( j = 0; j < height; j++ ) {
-    if( j == height - 1 ) nextline = 0;
-
     p = p0;
     q = q0;
     q1 = q + 1; q2 = q + 2;
@@ -1880,3 +1882,466 @@ FUNCTION( scaler_HQ3x ) ( const libspectrum_byte *srcPtr,
     q0 += ( nextlineDst << 1 ) + nextlineDst;
   }
 }
+
+#ifdef __SSE2__
+
+/* SSE2 versions of the HQ scalers.
+
+   Most of the time in the C versions goes on converting pixels to YUV
+   (each pixel three times, as the 3x3 window passes over it) and on the
+   eight YUV comparisons which make up each pixel's pattern. Here each
+   source line is converted just once into planes of Y, U and V values,
+   and the patterns for a whole line are then worked out eight pixels at
+   a time. The interpolation itself is the same code as the C versions,
+   so the output is identical */
+
+typedef struct hq_line {
+  libspectrum_signed_word *y, *u, *v;
+} hq_line;
+
+/* Each plane holds the pixels from -1 to width inclusive, plus enough
+   padding that the pattern code can always read eight values at once.
+   They live in the calling thread's scratch memory as several threads
+   may be scaling different parts of the screen at once; the patterns for
+   a line go in the space after the last plane */
+static void
+hq_lines_get( hq_line *lines, int width, libspectrum_byte **patterns )
+{
+  size_t plane_width = width + 2 + 8, i;
+  libspectrum_signed_word *planes =
+    scaler_scratch( 10 * plane_width * sizeof( *planes ) );
+
+  for( i = 0; i < 3; i++ ) {
+    lines[i].y = planes + ( 3 * i     ) * plane_width;
+    lines[i].u = planes + ( 3 * i + 1 ) * plane_width;
+    lines[i].v = planes + ( 3 * i + 2 ) * plane_width;
+  }
+  *patterns = (libspectrum_byte*)( planes + 9 * plane_width );
+}
+
+static inline void
+hq_convert_pixel( libspectrum_dword w, const hq_line *line, int i )
+{
+  libspectrum_byte r, g, b;
+
+#if SCALER_DATA_SIZE == 2
+  r = R_TO_R( w );
+  g = G_TO_G( w );
+  b = B_TO_B( w );
+#else
+  r =  w & redMask;
+  g = (w & greenMask) >> 8;
+  b = (w & blueMask) >> 16;
+#endif
+
+  line->y[i] = RGB_TO_Y( r, g, b );
+  line->u[i] = RGB_TO_U( r, g, b );
+  line->v[i] = RGB_TO_V( r, g, b );
+}
+
+/* Fill line with the YUV values of pixels -1 to width of p */
+static void
+hq_convert_line( const scaler_data_type *p, int width, const hq_line *line )
+{
+  int i = 0, count = width + 2;
+
+  p--;
+
+#if SCALER_DATA_SIZE == 4 && !defined( WORDS_BIGENDIAN )
+  {
+    const __m128i byte_mask = _mm_set1_epi32( 0xff );
+    const __m128i rg_y = _mm_set_epi16( 4809, 2449, 4809, 2449,
+                                        4809, 2449, 4809, 2449 );
+    const __m128i b1_y = _mm_set_epi16( 1024, 934, 1024, 934,
+                                        1024, 934, 1024, 934 );
+    const __m128i rg_u = _mm_set_epi16( -2713, -1383, -2713, -1383,
+                                        -2713, -1383, -2713, -1383 );
+    const __m128i b1_u = _mm_set_epi16( 1024, 4096, 1024, 4096,
+                                        1024, 4096, 1024, 4096 );
+    const __m128i rg_v = _mm_set_epi16( -3430, 4096, -3430, 4096,
+                                        -3430, 4096, -3430, 4096 );
+    const __m128i b1_v = _mm_set_epi16( 1024, -666, 1024, -666,
+                                        1024, -666, 1024, -666 );
+    const __m128i one = _mm_set1_epi16( 1 );
+
+    for( ; i + 8 <= count; i += 8 ) {
+      __m128i lo = _mm_loadu_si128( (const __m128i*)( p + i ) );
+      __m128i hi = _mm_loadu_si128( (const __m128i*)( p + i + 4 ) );
+      __m128i r, g, b, rg_lo, rg_hi, b1_lo, b1_hi, y, u, v;
+
+      r = _mm_packs_epi32( _mm_and_si128( lo, byte_mask ),
+                           _mm_and_si128( hi, byte_mask ) );
+      g = _mm_packs_epi32( _mm_and_si128( _mm_srli_epi32( lo, 8 ), byte_mask ),
+                           _mm_and_si128( _mm_srli_epi32( hi, 8 ), byte_mask ) );
+      b = _mm_packs_epi32(
+        _mm_and_si128( _mm_srli_epi32( lo, 16 ), byte_mask ),
+        _mm_and_si128( _mm_srli_epi32( hi, 16 ), byte_mask ) );
+
+      rg_lo = _mm_unpacklo_epi16( r, g ); rg_hi = _mm_unpackhi_epi16( r, g );
+      b1_lo = _mm_unpacklo_epi16( b, one ); b1_hi = _mm_unpackhi_epi16( b, one );
+
+#define HQ_CONVERT( rg, b1 ) \
+      _mm_packs_epi32( \
+        _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( rg_lo, rg ), \
+                                       _mm_madd_epi16( b1_lo, b1 ) ), 11 ), \
+        _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( rg_hi, rg ), \
+                                       _mm_madd_epi16( b1_hi, b1 ) ), 11 ) )
+
+      y = HQ_CONVERT( rg_y, b1_y );
+      u = HQ_CONVERT( rg_u, b1_u );
+      v = HQ_CONVERT( rg_v, b1_v );
+
+#undef HQ_CONVERT
+
+      _mm_storeu_si128( (__m128i*)( line->y + i ), y );
+      _mm_storeu_si128( (__m128i*)( line->u + i ), u );
+      _mm_storeu_si128( (__m128i*)( line->v + i ), v );
+    }
+  }
+#endif				/* #if SCALER_DATA_SIZE == 4 && ... */
+
+  for( ; i < count; i++ ) hq_convert_pixel( p[i], line, i );
+}
+
+/* A mask of the pixels where the pixel at index i of line differs from
+   the centre pixel */
+static inline __m128i
+hq_differs( __m128i y, __m128i u, __m128i v, const hq_line *line, int i )
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i dy, du, dv;
+
+  dy = _mm_sub_epi16( y, _mm_loadu_si128( (const __m128i*)( line->y + i ) ) );
+  du = _mm_sub_epi16( u, _mm_loadu_si128( (const __m128i*)( line->u + i ) ) );
+  dv = _mm_sub_epi16( v, _mm_loadu_si128( (const __m128i*)( line->v + i ) ) );
+
+  dy = _mm_max_epi16( dy, _mm_sub_epi16( zero, dy ) );
+  du = _mm_max_epi16( du, _mm_sub_epi16( zero, du ) );
+  dv = _mm_max_epi16( dv, _mm_sub_epi16( zero, dv ) );
+
+  return _mm_or_si128(
+    _mm_cmpgt_epi16( dy, _mm_set1_epi16( HQ_trY ) ),
+    _mm_or_si128( _mm_cmpgt_epi16( du, _mm_set1_epi16( HQ_trU ) ),
+                  _mm_cmpgt_epi16( dv, _mm_set1_epi16( HQ_trV ) ) ) );
+}
+
+/* Work out the pattern for each pixel of the current line */
+static void
+hq_find_patterns( const hq_line *prev, const hq_line *cur,
+                  const hq_line *next, int width, libspectrum_byte *patterns )
+{
+  int i;
+
+  for( i = 0; i < width; i += 8 ) {
+    __m128i y = _mm_loadu_si128( (const __m128i*)( cur->y + i + 1 ) );
+    __m128i u = _mm_loadu_si128( (const __m128i*)( cur->u + i + 1 ) );
+    __m128i v = _mm_loadu_si128( (const __m128i*)( cur->v + i + 1 ) );
+    __m128i pattern;
+
+#define HQ_BIT( line, offset, bit ) \
+    _mm_and_si128( hq_differs( y, u, v, line, i + offset ), \
+                   _mm_set1_epi16( bit ) )
+
+    pattern = _mm_or_si128(
+      _mm_or_si128( _mm_or_si128( HQ_BIT( prev, 0, 0x01 ),
+                                  HQ_BIT( prev, 1, 0x02 ) ),
+                    _mm_or_si128( HQ_BIT( prev, 2, 0x04 ),
+                                  HQ_BIT( cur,  0, 0x08 ) ) ),
+      _mm_or_si128( _mm_or_si128( HQ_BIT( cur,  2, 0x10 ),
+                                  HQ_BIT( next, 0, 0x20 ) ),
+                    _mm_or_si128( HQ_BIT( next, 1, 0x40 ),
+                                  HQ_BIT( next, 2, 0x80 ) ) ) );
+
+#undef HQ_BIT
+
+    _mm_storel_epi64( (__m128i*)( patterns + i ),
+                      _mm_packus_epi16( pattern, pattern ) );
+  }
+}
+
+/* The YUV values the HQ interpolation code needs for pixel i */
+#define HQ_FETCH_YUV( k, line, index ) \
+  y[k] = (line)->y[index]; u[k] = (line)->u[index]; v[k] = (line)->v[index];
+
+static void
+FUNCTION( scaler_HQ2x_sse2 ) ( const libspectrum_byte *srcPtr,
+                               libspectrum_dword srcPitch,
+                               libspectrum_byte *dstPtr,
+                               libspectrum_dword dstPitch,
+                               int width, int height )
+{
+  int i, j, pattern;
+  int nextlineSrc = srcPitch / sizeof( scaler_data_type );
+  const scaler_data_type *p, *p0 = (const scaler_data_type *)srcPtr;
+  int nextlineDst = dstPitch / sizeof( scaler_data_type );
+  scaler_data_type *q, *q1, *qN, *qN1, *q0 = (scaler_data_type *)dstPtr;
+  libspectrum_qword w[10];
+  libspectrum_signed_dword y[10], u[10], v[10];
+  hq_line lines[3], *prev = &lines[0], *cur = &lines[1], *next = &lines[2],
+    *spare;
+  libspectrum_byte *patterns;
+
+  hq_lines_get( lines, width, &patterns );
+  hq_convert_line( p0 + prevline, width, prev );
+  hq_convert_line( p0, width, cur );
+
+  for( j = 0; j < height; j++ ) {
+    hq_convert_line( p0 + nextline, width, next );
+    hq_find_patterns( prev, cur, next, width, patterns );
+
+    p = p0;
+    q = q0; q1 = q + 1;
+    qN = q + nextlineDst; qN1 = qN + 1;
+    w[2] = *(p + prevline);
+    w[5] = *p;
+    w[8] = *(p + nextline);
+    w[1] = *(p + prevline - 1);
+    w[4] = *(p - 1);
+    w[7] = *(p + nextline - 1);
+    w[3] = *(p + prevline + 1);
+    w[6] = *(p + 1);
+    w[9] = *(p + nextline + 1);
+
+    for( i = 0; i < width; i++ ) {
+      pattern = patterns[i];
+      HQ_FETCH_YUV( 2, prev, i + 1 );
+      HQ_FETCH_YUV( 4, cur, i );
+      HQ_FETCH_YUV( 6, cur, i + 2 );
+      HQ_FETCH_YUV( 8, next, i + 1 );
+
+#include "scaler_hq2x.c"
+
+      p++;
+      q  += 2; q1  += 2;
+      qN += 2; qN1 += 2;
+      w[1] = w[2]; w[4] = w[5]; w[7] = w[8];
+      w[2] = w[3]; w[5] = w[6]; w[8] = w[9];
+      w[3] = *(p + prevline + 1);
+      w[6] = *(p + 1);
+      w[9] = *(p + nextline + 1);
+    }
+
+    spare = prev; prev = cur; cur = next; next = spare;
+    p0 += nextlineSrc;
+    q0 += nextlineDst << 1;
+  }
+}
+
+static void
+FUNCTION( scaler_HQ3x_sse2 ) ( const libspectrum_byte *srcPtr,
+                               libspectrum_dword srcPitch,
+                               libspectrum_byte *dstPtr,
+                               libspectrum_dword dstPitch,
+                               int width, int height )
+{
+  int i, j, pattern;
+  int nextlineSrc = srcPitch / sizeof( scaler_data_type );
+  const scaler_data_type *p, *p0 = (const scaler_data_type *)srcPtr;
+  int nextlineDst = dstPitch / sizeof( scaler_data_type );
+  scaler_data_type *q, *qN, *qNN, *q1, *qN1, *qNN1, *q2, *qN2, *qNN2,
+		   *q0 = (scaler_data_type *)dstPtr;
+  libspectrum_qword w[10];
+  libspectrum_signed_dword y[10], u[10], v[10];
+  hq_line lines[3], *prev = &lines[0], *cur = &lines[1], *next = &lines[2],
+    *spare;
+  libspectrum_byte *patterns;
+
+  hq_lines_get( lines, width, &patterns );
+  hq_convert_line( p0 + prevline, width, prev );
+  hq_convert_line( p0, width, cur );
+
+  for( j = 0; j < height; j++ ) {
+    hq_convert_line( p0 + nextline, width, next );
+    hq_find_patterns( prev, cur, next, width, patterns );
+
+    p = p0;
+    q = q0;
+    q1 = q + 1; q2 = q + 2;
+    qN = q + nextlineDst; qN1 = qN + 1; qN2 = qN + 2;
+    qNN = qN + nextlineDst;  qNN1 = qNN + 1; qNN2 = qNN + 2;
+
+    w[2] = *(p + prevline);
+    w[5] = *p;
+    w[8] = *(p + nextline);
+    w[1] = *(p + prevline - 1);
+    w[4] = *(p - 1);
+    w[7] = *(p + nextline - 1);
+    w[3] = *(p + prevline + 1);
+    w[6] = *(p + 1);
+    w[9] = *(p + nextline + 1);
+
+    for( i = 0; i < width; i++ ) {
+      pattern = patterns[i];
+      HQ_FETCH_YUV( 2, prev, i + 1 );
+      HQ_FETCH_YUV( 4, cur, i );
+      HQ_FETCH_YUV( 6, cur, i + 2 );
+      HQ_FETCH_YUV( 8, next, i + 1 );
+
+#include "scaler_hq3x.c"
+
+      p++;
+      q   += 3; q1   += 3; q2   += 3;
+      qN  += 3; qN1  += 3; qN2  += 3;
+      qNN += 3; qNN1 += 3; qNN2 += 3;
+      w[1] = w[2]; w[4] = w[5]; w[7] = w[8];
+      w[2] = w[3]; w[5] = w[6]; w[8] = w[9];
+      w[3] = *(p + prevline + 1);
+      w[6] = *(p + 1);
+      w[9] = *(p + nextline + 1);
+    }
+
+    spare = prev; prev = cur; cur = next; next = spare;
+    p0 += nextlineSrc;
+    q0 += ( nextlineDst << 1 ) + nextlineDst;
+  }
+}
+
+/* SSE2 versions of the AdvMAME scalers, which make the choice for each
+   corner of the output for a whole vector of pixels at once */
+
+#if SCALER_DATA_SIZE == 2
+#define SIMD_LANES 8
+#define SIMD_CMPEQ _mm_cmpeq_epi16
+#define SIMD_UNPACKLO _mm_unpacklo_epi16
+#define SIMD_UNPACKHI _mm_unpackhi_epi16
+#else				/* #if SCALER_DATA_SIZE == 2 */
+#define SIMD_LANES 4
+#define SIMD_CMPEQ _mm_cmpeq_epi32
+#define SIMD_UNPACKLO _mm_unpacklo_epi32
+#define SIMD_UNPACKHI _mm_unpackhi_epi32
+#endif				/* #if SCALER_DATA_SIZE == 2 */
+
+#define SIMD_LOAD( p ) _mm_loadu_si128( (const __m128i*)( p ) )
+#define SIMD_STORE( p, x ) _mm_storeu_si128( (__m128i*)( p ), x )
+#define SIMD_SELECT( mask, a, b ) \
+  _mm_or_si128( _mm_and_si128( mask, a ), _mm_andnot_si128( mask, b ) )
+
+/* The four corners of the AdvMAME output for the pixels at p */
+static inline void
+advmame_corners( const scaler_data_type *p, int nextlineSrc, __m128i *c00,
+                 __m128i *c01, __m128i *c10, __m128i *c11 )
+{
+  __m128i B = SIMD_LOAD( p - nextlineSrc ), D = SIMD_LOAD( p - 1 ),
+    E = SIMD_LOAD( p ), F = SIMD_LOAD( p + 1 ),
+    H = SIMD_LOAD( p + nextlineSrc );
+  __m128i DB = SIMD_CMPEQ( D, B ), BF = SIMD_CMPEQ( B, F ),
+    DH = SIMD_CMPEQ( D, H ), FH = SIMD_CMPEQ( F, H );
+
+  *c00 = SIMD_SELECT( _mm_andnot_si128( _mm_or_si128( BF, DH ), DB ), D, E );
+  *c01 = SIMD_SELECT( _mm_andnot_si128( _mm_or_si128( DB, FH ), BF ), F, E );
+  *c10 = SIMD_SELECT( _mm_andnot_si128( _mm_or_si128( DB, FH ), DH ), D, E );
+  *c11 = SIMD_SELECT( _mm_andnot_si128( _mm_or_si128( DH, BF ), FH ), F, E );
+}
+
+static void
+FUNCTION( scaler_AdvMame2x_sse2 )( const libspectrum_byte *srcPtr,
+                                   libspectrum_dword srcPitch,
+                                   libspectrum_byte *dstPtr,
+                                   libspectrum_dword dstPitch,
+                                   int width, int height )
+{
+  int nextlineSrc = srcPitch / sizeof( scaler_data_type );
+  const scaler_data_type *p = (const scaler_data_type*) srcPtr;
+
+  int nextlineDst = dstPitch / sizeof( scaler_data_type );
+  scaler_data_type *q = (scaler_data_type*) dstPtr;
+
+  while( height-- ) {
+    int i = 0;
+
+    for( ; i + SIMD_LANES <= width; i += SIMD_LANES ) {
+      __m128i c00, c01, c10, c11;
+
+      advmame_corners( p + i, nextlineSrc, &c00, &c01, &c10, &c11 );
+
+      SIMD_STORE( q + 2 * i, SIMD_UNPACKLO( c00, c01 ) );
+      SIMD_STORE( q + 2 * i + SIMD_LANES, SIMD_UNPACKHI( c00, c01 ) );
+      SIMD_STORE( q + nextlineDst + 2 * i, SIMD_UNPACKLO( c10, c11 ) );
+      SIMD_STORE( q + nextlineDst + 2 * i + SIMD_LANES,
+                  SIMD_UNPACKHI( c10, c11 ) );
+    }
+
+    if( i < width )
+      FUNCTION( scaler_AdvMame2x )( (const libspectrum_byte*)( p + i ),
+                                    srcPitch,
+                                    (libspectrum_byte*)( q + 2 * i ),
+                                    dstPitch, width - i, 1 );
+
+    p += nextlineSrc;
+    q += nextlineDst << 1;
+  }
+}
+
+static void
+FUNCTION( scaler_AdvMame3x_sse2 )( const libspectrum_byte *srcPtr,
+                                   libspectrum_dword srcPitch,
+                                   libspectrum_byte *dstPtr,
+                                   libspectrum_dword dstPitch,
+                                   int width, int height )
+{
+  int nextlineSrc = srcPitch / sizeof( scaler_data_type );
+  const scaler_data_type *p = (const scaler_data_type*) srcPtr;
+
+  int nextlineDst = dstPitch / sizeof( scaler_data_type );
+  scaler_data_type *q = (scaler_data_type*) dstPtr;
+
+  scaler_data_type corners[4][ SIMD_LANES ];
+
+  while( height-- ) {
+    int i = 0, k;
+
+    for( ; i + SIMD_LANES <= width; i += SIMD_LANES ) {
+      __m128i c00, c01, c10, c11;
+      scaler_data_type *r = q + 3 * i;
+
+      advmame_corners( p + i, nextlineSrc, &c00, &c01, &c10, &c11 );
+
+      SIMD_STORE( corners[0], c00 );
+      SIMD_STORE( corners[1], c01 );
+      SIMD_STORE( corners[2], c10 );
+      SIMD_STORE( corners[3], c11 );
+
+      for( k = 0; k < SIMD_LANES; k++, r += 3 ) {
+        scaler_data_type E = p[ i + k ];
+
+        *(r) = corners[0][k];
+        *(r + 1) = E;
+        *(r + 2) = corners[1][k];
+        *(r + nextlineDst) = E;
+        *(r + nextlineDst + 1) = E;
+        *(r + nextlineDst + 2) = E;
+        *(r + 2 * nextlineDst) = corners[2][k];
+        *(r + 2 * nextlineDst + 1) = E;
+        *(r + 2 * nextlineDst + 2) = corners[3][k];
+      }
+    }
+
+    if( i < width )
+      FUNCTION( scaler_AdvMame3x )( (const libspectrum_byte*)( p + i ),
+                                    srcPitch,
+                                    (libspectrum_byte*)( q + 3 * i ),
+                                    dstPitch, width - i, 1 );
+
+    p += nextlineSrc;
+    q += nextlineDst * 3;
+  }
+}
+
+#endif				/* #ifdef __SSE2__ */
+
+ScalerProc*
+FUNCTION( scaler_simd_proc )( scaler_type scaler )
+{
+  switch( scaler ) {
+
+#ifdef __SSE2__
+  case SCALER_ADVMAME2X: return FUNCTION( scaler_AdvMame2x_sse2 );
+  case SCALER_ADVMAME3X: return FUNCTION( scaler_AdvMame3x_sse2 );
+  case SCALER_HQ2X: return FUNCTION( scaler_HQ2x_sse2 );
+  case SCALER_HQ3X: return FUNCTION( scaler_HQ3x_sse2 );
+#endif				/* #ifdef __SSE2__ */
+
+  default: return NULL;
+
+  }
+}
@@ -0,0 +1,282 @@
+/* uirender.c: Scale and display frames on a separate thread
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif				/* #ifdef HAVE_PTHREAD */
+
+#include <libspectrum.h>
+
+#include "ui/ui.h"
+#include "ui/uirender.h"
+
+#ifdef HAVE_PTHREAD
+
+/* Three buffers: one being filled by the emulation thread, one waiting to
+   be drawn and one being drawn by the render thread */
+#define BUFFER_COUNT 3
+
+typedef struct render_buffer {
+  libspectrum_byte *image;
+  size_t image_size;
+  uirender_rect rects[ UIRENDER_MAX_RECTS ];
+  size_t count;
+  int full;
+} render_buffer;
+
+static render_buffer buffers[ BUFFER_COUNT ];
+
+/* Which buffer is in which state, or -1 for none. The filling buffer is
+   only ever touched by the emulation thread; the others are protected
+   by the lock */
+static int filling = -1, pending = -1, drawing = -1;
+
+static int running = 0, stopping = 0;
+static unsigned long dropped_frames;
+
+static uirender_render_fn render_fn;
+
+static pthread_t thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t frame_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t frame_done = PTHREAD_COND_INITIALIZER;
+
+static void*
+render_thread( void *arg GCC_UNUSED )
+{
+  render_buffer *buffer;
+
+  pthread_mutex_lock( &lock );
+
+  while( 1 ) {
+
+    while( pending == -1 && !stopping )
+      pthread_cond_wait( &frame_ready, &lock );
+
+    if( pending == -1 ) break;
+
+    drawing = pending; pending = -1;
+    buffer = &buffers[ drawing ];
+    pthread_mutex_unlock( &lock );
+
+    render_fn( buffer->image, buffer->rects, buffer->count, buffer->full );
+
+    pthread_mutex_lock( &lock );
+    drawing = -1;
+    pthread_cond_broadcast( &frame_done );
+  }
+
+  pthread_mutex_unlock( &lock );
+
+  return NULL;
+}
+
+int
+uirender_start( size_t image_size, uirender_render_fn render )
+{
+  int i, error;
+
+  if( running ) return 0;
+
+  for( i = 0; i < BUFFER_COUNT; i++ ) {
+    buffers[i].image = libspectrum_new( libspectrum_byte, image_size );
+    buffers[i].image_size = image_size;
+    buffers[i].count = 0;
+    buffers[i].full = 1;
+  }
+
+  filling = 0; pending = -1; drawing = -1;
+  stopping = 0;
+  dropped_frames = 0;
+  render_fn = render;
+
+  error = pthread_create( &thread, NULL, render_thread, NULL );
+  if( error ) {
+    ui_error( UI_ERROR_ERROR, "error %d creating render thread", error );
+    for( i = 0; i < BUFFER_COUNT; i++ ) libspectrum_free( buffers[i].image );
+    return 1;
+  }
+
+  running = 1;
+
+  return 0;
+}
+
+/* Add the rectangles from an unused frame to the one replacing it */
+static void
+merge_rects( render_buffer *dest, const render_buffer *src )
+{
+  if( src->full || dest->count + src->count > UIRENDER_MAX_RECTS ) {
+    dest->full = 1;
+    return;
+  }
+
+  memcpy( &dest->rects[ dest->count ], src->rects,
+          src->count * sizeof( *src->rects ) );
+  dest->count += src->count;
+}
+
+void
+uirender_frame( const void *image, size_t image_size,
+                const uirender_rect *rects, size_t count, int full )
+{
+  render_buffer *buffer;
+  int i;
+
+  if( !running ) return;
+
+  buffer = &buffers[ filling ];
+
+  if( image_size > buffer->image_size ) {
+    image_size = buffer->image_size;
+    full = 1;
+  }
+
+  memcpy( buffer->image, image, image_size );
+
+  if( full || count > UIRENDER_MAX_RECTS ) {
+    buffer->count = 0;
+    buffer->full = 1;
+  } else {
+    memcpy( buffer->rects, rects, count * sizeof( *rects ) );
+    buffer->count = count;
+    buffer->full = 0;
+  }
+
+  pthread_mutex_lock( &lock );
+
+  /* If the render thread hasn't got round to the last frame, drop it and
+     reuse its buffer */
+  if( pending != -1 ) {
+    merge_rects( buffer, &buffers[ pending ] );
+    dropped_frames++;
+  }
+
+  pending = filling;
+
+  for( i = 0; i < BUFFER_COUNT; i++ )
+    if( i != pending && i != drawing ) break;
+  filling = i;
+
+  pthread_cond_signal( &frame_ready );
+  pthread_mutex_unlock( &lock );
+}
+
+void
+uirender_flush( void )
+{
+  if( !running ) return;
+
+  pthread_mutex_lock( &lock );
+  while( pending != -1 || drawing != -1 )
+    pthread_cond_wait( &frame_done, &lock );
+  pthread_mutex_unlock( &lock );
+}
+
+void
+uirender_stop( void )
+{
+  int i;
+
+  if( !running ) return;
+
+  pthread_mutex_lock( &lock );
+  stopping = 1;
+  pthread_cond_signal( &frame_ready );
+  pthread_mutex_unlock( &lock );
+
+  pthread_join( thread, NULL );
+
+  for( i = 0; i < BUFFER_COUNT; i++ ) {
+    libspectrum_free( buffers[i].image );
+    buffers[i].image = NULL;
+  }
+
+  running = 0;
+}
+
+int
+uirender_running( void )
+{
+  return running;
+}
+
+unsigned long
+uirender_dropped_frames( void )
+{
+  unsigned long dropped;
+
+  pthread_mutex_lock( &lock );
+  dropped = dropped_frames;
+  pthread_mutex_unlock( &lock );
+
+  return dropped;
+}
+
+#else				/* #ifdef HAVE_PTHREAD */
+
+/* Without threads, the UI just keeps drawing its own frames */
+
+int
+uirender_start( size_t image_size GCC_UNUSED,
+                uirender_render_fn render GCC_UNUSED )
+{
+  return 1;
+}
+
+void
+uirender_frame( const void *image GCC_UNUSED, size_t image_size GCC_UNUSED,
+                const uirender_rect *rects GCC_UNUSED,
+                size_t count GCC_UNUSED, int full GCC_UNUSED )
+{
+}
+
+void
+uirender_flush( void )
+{
+}
+
+void
+uirender_stop( void )
+{
+}
+
+int
+uirender_running( void )
+{
+  return 0;
+}
+
+unsigned long
+uirender_dropped_frames( void )
+{
+  return 0;
+}
+
+#endif				/* #ifdef HAVE_PTHREAD */
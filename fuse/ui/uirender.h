@@ -0,0 +1,78 @@
+/* uirender.h: Scale and display frames on a separate thread
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+/* A UI which wants to scale and display its frames away from the
+ * emulation thread calls uirender_start() with a function which draws a
+ * frame. At the end of each frame, uirender_frame() copies the UI's
+ * native resolution image and the list of rectangles which have changed
+ * into a free buffer and hands it to the render thread. If the render
+ * thread is still busy with an earlier frame which it hasn't started, that
+ * frame is dropped and its rectangles are merged into the new one.
+ *
+ * Anything else which touches the state the render function uses (the
+ * scaler, the size of the output image, ...) must call uirender_flush()
+ * first to wait for the render thread to go idle.
+ */
+
+#ifndef FUSE_UI_UIRENDER_H
+#define FUSE_UI_UIRENDER_H
+
+#include <stddef.h>
+
+/* The most rectangles a frame can carry before it is treated as a full
+   redraw */
+#define UIRENDER_MAX_RECTS 300
+
+typedef struct uirender_rect {
+  int x, y, w, h;
+} uirender_rect;
+
+/* Draw the given rectangles of image, or all of it if full is set */
+typedef void (*uirender_render_fn)( const void *image,
+                                    const uirender_rect *rects, size_t count,
+                                    int full );
+
+/* Start the render thread; image_size is the most bytes of image any
+   frame will pass. Returns non-zero if the thread can't be started, in
+   which case the UI should keep drawing frames itself */
+int uirender_start( size_t image_size, uirender_render_fn render );
+
+/* Hand a frame to the render thread */
+void uirender_frame( const void *image, size_t image_size,
+                     const uirender_rect *rects, size_t count, int full );
+
+/* Wait until every frame handed over has been drawn */
+void uirender_flush( void );
+
+/* Draw any outstanding frame and stop the render thread */
+void uirender_stop( void );
+
+/* Is the render thread running? */
+int uirender_running( void );
+
+/* The number of frames dropped since the thread was started */
+unsigned long uirender_dropped_frames( void );
+
+#endif			/* #ifndef FUSE_UI_UIRENDER_H */
@@ -828,6 +828,9 @@ ui_popup_menu( int native_key )
     menu_file_exit( 0 );
     fuse_emulation_unpause();
     break;
+  case INPUT_KEY_F12:
+    menu_machine_rewind( 0 );
+    break;
 
   default: break;		/* Remove gcc warning */
 
@@ -64,6 +64,7 @@
 #include "ui/scaler/scaler.h"
 #include "ui/ui.h"
 #include "ui/uidisplay.h"
+#include "ui/uirender.h"
 
 void xstatusbar_init( int size );
 
@@ -89,8 +90,8 @@ static int image_width, image_height, scaled_image_w, scaled_image_h;
 
 /* An RGB image of the Spectrum screen; slightly bigger than the real
    screen to handle the smoothing filters which read around each pixel 16bpp */
-static libspectrum_word
-  rgb_image[2 * ( DISPLAY_SCREEN_HEIGHT + 4 )][2 * ( DISPLAY_SCREEN_WIDTH  + 3 )];
+typedef libspectrum_word rgb_row_t[2 * ( DISPLAY_SCREEN_WIDTH + 3 )];
+static rgb_row_t rgb_image[2 * ( DISPLAY_SCREEN_HEIGHT + 4 )];
 static const int rgb_pitch = 2 * ( DISPLAY_SCREEN_WIDTH + 3 );
 
 /* A scaled copy of the image displayed on the Spectrum's screen */
@@ -117,11 +118,8 @@ static int rShift = 16, gShift = 8, bShift = 0;
 
 /* This is a rule of thumb for the maximum number of rects that can be updated
    each frame. If more are generated we just update the whole screen */
-typedef struct {
-  int x; int y; int w; int h;
-} X_Rect;
-#define MAX_UPDATE_RECT 300
-static X_Rect updated_rects[MAX_UPDATE_RECT];
+#define MAX_UPDATE_RECT UIRENDER_MAX_RECTS
+static uirender_rect updated_rects[MAX_UPDATE_RECT];
 static int num_rects = 0;
 static libspectrum_byte xdisplay_force_full_refresh = 1;
 
@@ -135,7 +133,8 @@ static int get_shm_id( const int size );
 
 static int shm_used = 0;
 
-typedef void xdisplay_update_rect_t( int x, int y, int w, int h );
+typedef void xdisplay_update_rect_t( const rgb_row_t *source, int x, int y,
+                                     int w, int h );
 
 static xdisplay_update_rect_t *xdisplay_update_rect;
 static xdisplay_update_rect_t xdisplay_update_rect_noscale;
@@ -150,8 +149,11 @@ static int xdisplay_allocate_image( void );
 static void register_scalers( void );
 static void xdisplay_destroy_image( void );
 static void xdisplay_catch_signal( int sig );
+static void xdisplay_render( const void *rgb, const uirender_rect *rects,
+                             size_t count, int full );
 
-typedef void xdisplay_putpixel_t( int x, int y, libspectrum_word *color );
+typedef void xdisplay_putpixel_t( int x, int y,
+                                  const libspectrum_word *color );
 
 static xdisplay_putpixel_t *xdisplay_putpixel;
 
@@ -203,6 +205,11 @@ xdisplay_init( void )
   if( xdisplay_allocate_image() ) return 1;
   ui_statusbar_update( UI_STATUSBAR_ITEM_TAPE, UI_STATUSBAR_STATE_INACTIVE );
 
+  /* Scale and draw the screen on a separate thread if we can; if not,
+     just carry on drawing it at the end of each frame */
+  if( settings_current.render_thread )
+    uirender_start( sizeof( rgb_image ), xdisplay_render );
+
   return 0;
 }
 
@@ -253,13 +260,13 @@ xdisplay_find_visual( void )
 }
 
 static void
-xdisplay_putpixel_4( int x, int y, libspectrum_word *colour)
+xdisplay_putpixel_4( int x, int y, const libspectrum_word *colour)
 {
   XPutPixel( image, x, y, *colour );
 }
 
 static void
-xdisplay_putpixel_8( int x, int y, libspectrum_word *colour)
+xdisplay_putpixel_8( int x, int y, const libspectrum_word *colour)
 {
   unsigned long c = *colour;
 
@@ -270,7 +277,7 @@ xdisplay_putpixel_8( int x, int y, libspectrum_word *colour)
 }
 
 static void
-xdisplay_putpixel_15( int x, int y, libspectrum_word *colour)
+xdisplay_putpixel_15( int x, int y, const libspectrum_word *colour)
 {
   unsigned long c = *colour;
 
@@ -279,13 +286,13 @@ xdisplay_putpixel_15( int x, int y, libspectrum_word *colour)
 }
 
 static void
-xdisplay_putpixel_16( int x, int y, libspectrum_word *colour)
+xdisplay_putpixel_16( int x, int y, const libspectrum_word *colour)
 {
   XPutPixel( image, x, y, *colour );
 }
 
 static void
-xdisplay_putpixel_24( int x, int y, libspectrum_word *colour)
+xdisplay_putpixel_24( int x, int y, const libspectrum_word *colour)
 {
   unsigned long c = *colour;
 
@@ -598,6 +605,8 @@ register_scalers( void )
 {
   int f = -1;
 
+  uirender_flush();
+
   scaler_register_clear();
   scaler_select_bitformat( 565 );		/* 16bit always */
 
@@ -690,28 +699,30 @@ xdisplay_configure_notify( int width, int height )
 }
 
 static void
-xdisplay_update_rect_noscale( int x, int y, int w, int h )
+xdisplay_update_rect_noscale( const rgb_row_t *source, int x, int y, int w,
+                              int h )
 {
  int yy, xx;
 
   /* Call putpixel multiple times */
   for( yy = y; yy < y + h; yy++ )
     for( xx = x; xx < x + w; xx++ )
-      xdisplay_putpixel( xx, yy, &rgb_image[yy + 2][xx + 1] );
+      xdisplay_putpixel( xx, yy, &source[yy + 2][xx + 1] );
   /* Blit to the real screen at the frame end end */
   xdisplay_area( x, y, w, h );
 }
 
 static void
-xdisplay_update_rect_scale( int x, int y, int w, int h )
+xdisplay_update_rect_scale( const rgb_row_t *source, int x, int y, int w,
+                            int h )
 {
   int yy = y, xx = x;
 
   y = y * image_scale >> 2;
   x = x * image_scale >> 2;
   scaler_proc16(
-        (libspectrum_byte *)&(rgb_image[yy + 2][xx + 1]),
-        rgb_pitch * sizeof(rgb_image[0][0]),
+        (const libspectrum_byte *)&(source[yy + 2][xx + 1]),
+        rgb_pitch * sizeof(source[0][0]),
         (libspectrum_byte *)&(scaled_image[y][x]),
         scaled_pitch,
         w, h
@@ -728,29 +739,43 @@ xdisplay_update_rect_scale( int x, int y, int w, int h )
   xdisplay_area( x, y, w, h );
 }
 
-void
-uidisplay_frame_end( void ) 
+/* Draw part or all of the screen; called either directly at the end of
+   each frame or on the render thread */
+static void
+xdisplay_render( const void *rgb, const uirender_rect *rects, size_t count,
+                 int full )
 {
-  X_Rect *r, *last_rect;
-
-  /* Force a full redraw if requested */
-  if ( xdisplay_force_full_refresh ) {
-    num_rects = 1;
+  const rgb_row_t *source = rgb;
+  size_t i;
 
-    updated_rects[0].x = 0;
-    updated_rects[0].y = 0;
-    updated_rects[0].w = image_width;
-    updated_rects[0].h = image_height;
+  if( full ) {
+    xdisplay_update_rect( source, 0, 0, image_width, image_height );
+  } else {
+    for( i = 0; i < count; i++ )
+      xdisplay_update_rect( source, rects[i].x, rects[i].y, rects[i].w,
+                            rects[i].h );
   }
 
-  if ( !( ui_widget_level >= 0 ) && num_rects == 0 && !status_updated ) return;
-
-  last_rect = updated_rects + num_rects;
-
-  for( r = updated_rects; r != last_rect; r++ )
-    xdisplay_update_rect( r->x, r->y, r->w, r->h );
   if ( settings_current.statusbar )
     xstatusbar_overlay();
+}
+
+void
+uidisplay_frame_end( void ) 
+{
+  if ( !( ui_widget_level >= 0 ) && num_rects == 0 &&
+       !xdisplay_force_full_refresh && !status_updated ) return;
+
+  if( uirender_running() ) {
+    /* The scalers also read the rows just outside the image */
+    uirender_frame( rgb_image, ( image_height + 4 ) * sizeof( rgb_image[0] ),
+                    updated_rects, num_rects, xdisplay_force_full_refresh );
+    status_updated = 0;
+  } else {
+    xdisplay_render( rgb_image, updated_rects, num_rects,
+                     xdisplay_force_full_refresh );
+  }
+
   num_rects = 0;
   xdisplay_force_full_refresh = 0;
 }
@@ -765,7 +790,8 @@ void
 uidisplay_frame_restore( void )
 {
   memcpy( rgb_image, rgb_image_backup, sizeof( rgb_image ) );
-  xdisplay_update_rect( 0, 0, image_width, image_height );
+  uirender_flush();
+  xdisplay_update_rect( rgb_image, 0, 0, image_width, image_height );
 }
 
 void
@@ -854,6 +880,8 @@ xdisplay_setup_rgb_putpixel( void )
 int
 uidisplay_hotswap_gfx_mode( void )
 {
+  uirender_flush();
+
   image_scale = 4.0 * scaler_get_scaling_factor( current_scaler );
   scaled_image_w = image_width  * image_scale >> 2;
   scaled_image_h = image_height * image_scale >> 2;
@@ -880,6 +908,7 @@ uidisplay_hotswap_gfx_mode( void )
 int
 uidisplay_end( void )
 {
+  uirender_flush();
   display_ui_initialised = 0;
   return 0;
 }
@@ -37,6 +37,7 @@
 #include "settings.h"
 #include "ui/ui.h"
 #include "ui/uidisplay.h"
+#include "ui/uirender.h"
 #include "xdisplay.h"
 #include "xkeyboard.h"
 #include "xui.h"
@@ -62,6 +63,11 @@ ui_init( int *argc, char ***argv )
   unsigned long windowFlags;
   XSetWindowAttributes windowAttributes;
 
+  /* The render thread draws to the display while we handle events here,
+     so Xlib must be told before we make any other call */
+  if( settings_current.render_thread && !XInitThreads() )
+    settings_current.render_thread = 0;
+
   /* Allocate memory for various things */
 
   if( ui_widget_init() ) return 1;
@@ -258,6 +264,9 @@ int ui_end(void)
 {
   int error;
 
+  /* Stop drawing before taking the window away */
+  uirender_stop();
+
   /* Don't display the window whilst doing all this */
   XUnmapWindow(display,xui_mainWindow);
 
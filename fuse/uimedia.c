@@ -36,6 +36,7 @@
 #include "ui/ui.h"
 #include "ui/uimedia.h"
 #include "utils.h"
+#include "writeback.h"
 
 #define DISK_TRY_MERGE(heads) \
   ( option_enumerate_diskoptions_disk_try_merge() == 2 || \
@@ -183,21 +184,52 @@ ui_media_drive_writeprotect( int controller, int which, int wrprot )
 }
 
 
+static const char*
+write_disk_copy( const char *filename, void *data )
+{
+  int error;
+
+  error = disk_write( data, filename );
+
+  return error == DISK_OK ? NULL : disk_strerror( error );
+}
+
+static void
+free_disk_copy( void *data )
+{
+  disk_close( data );
+  libspectrum_free( data );
+}
+
+static void
+disk_copy_written( void *context, int error )
+{
+  fdd_t *fdd = context;
+
+  /* The disk still needs saving if it couldn't be written */
+  if( error ) fdd->disk.dirty = 1;
+}
+
 static int
 drive_disk_write( const ui_media_drive_info_t *drive, const char *filename )
 {
+  disk_t *copy;
   int error;
 
   drive->fdd->disk.type = DISK_TYPE_NONE;
   if( filename == NULL )
     filename = drive->fdd->disk.filename; /* write over original file */
-  error = disk_write( &drive->fdd->disk, filename );
+  disk_guess_type( &drive->fdd->disk, filename );
 
-  if( error != DISK_OK ) {
-    ui_error( UI_ERROR_ERROR, "couldn't write '%s' file: %s", filename,
-              disk_strerror( error ) );
-    return 1;
-  }
+  /* Write a snapshot of the disk in the background so the emulation doesn't
+     have to wait for it */
+  copy = libspectrum_new( disk_t, 1 );
+  disk_copy( copy, &drive->fdd->disk );
+
+  error = writeback_queue( filename, copy->sides * copy->cylinders * copy->tlen,
+                           write_disk_copy, free_disk_copy, copy,
+                           disk_copy_written, drive->fdd );
+  if( error ) return 1;
 
   if( !drive->fdd->disk.filename ||
       strcmp( filename, drive->fdd->disk.filename ) ) {
@@ -260,6 +292,10 @@ drive_eject( const ui_media_drive_info_t *drive )
   if( !drive->fdd->loaded || drive->fdd->disk.type == DISK_TYPE_NONE )
     return 0;
 
+  /* Finish any earlier saves first, as they may not have worked */
+  if( drive->fdd->disk.filename )
+    writeback_flush( drive->fdd->disk.filename );
+
   if( drive->fdd->disk.dirty ) {
 
     ui_confirm_save_t confirm = ui_confirm_save(
@@ -281,6 +317,12 @@ drive_eject( const ui_media_drive_info_t *drive )
     }
   }
 
+  /* Don't let go of the disk until it has been written, and keep it if
+     that failed */
+  if( drive->fdd->disk.filename &&
+      writeback_flush( drive->fdd->disk.filename ) )
+    return 1;
+
   fdd_unload( drive->fdd );
   disk_close( &drive->fdd->disk );
   ui_media_drive_update_menus( drive, UI_MEDIA_DRIVE_UPDATE_EJECT );
@@ -330,6 +372,7 @@ ui_media_drive_insert( const ui_media_drive_info_t *drive,
   }
 
   if( filename ) {
+    writeback_flush( filename );
     error = disk_open( &drive->fdd->disk, filename, 0,
                        DISK_TRY_MERGE( drive->fdd->fdd_heads ) );
     if( error != DISK_OK ) {
@@ -26,12 +26,22 @@
 
 #include <config.h>
 
+#include <stdio.h>
+#include <string.h>
+
 #include <libspectrum.h>
 
+#include "compat.h"
+#include "debugger/debugger_internals.h"
+#include "event.h"
 #include "fuse.h"
 #include "machine.h"
+#include "memory.h"
 #include "mempool.h"
 #include "periph.h"
+#include "pokefinder/pokefinder.h"
+#include "rewind.h"
+#include "rzx.h"
 #include "peripherals/disk/beta.h"
 #include "peripherals/disk/didaktik.h"
 #include "peripherals/disk/disciple.h"
@@ -46,7 +56,10 @@
 #include "peripherals/ula.h"
 #include "peripherals/usource.h"
 #include "settings.h"
+#include "spectrum.h"
 #include "unittests.h"
+#include "utils.h"
+#include "z80/z80.h"
 
 static int
 contention_test( void )
@@ -246,6 +259,354 @@ floating_bus_merge_test( void )
   return 0;
 }
 
+/* Check one value against the breakpoints, leaving the debugger active
+   afterwards */
+static int
+breakpoint_hit( debugger_breakpoint_type type, libspectrum_dword value )
+{
+  int hit = debugger_check( type, value );
+  if( debugger_mode == DEBUGGER_MODE_HALTED )
+    debugger_mode = DEBUGGER_MODE_ACTIVE;
+  return hit;
+}
+
+static int
+breakpoint_test( void )
+{
+  int r = 0;
+
+  debugger_breakpoint_remove_all();
+
+  debugger_breakpoint_add_address( DEBUGGER_BREAKPOINT_TYPE_EXECUTE,
+                                   memory_source_any, 0, 0x8000, 0,
+                                   DEBUGGER_BREAKPOINT_LIFE_PERMANENT, NULL );
+  debugger_breakpoint_add_port( DEBUGGER_BREAKPOINT_TYPE_PORT_WRITE,
+                                0x00fe, 0x00ff, 0,
+                                DEBUGGER_BREAKPOINT_LIFE_PERMANENT, NULL );
+
+  TEST_ASSERT( breakpoint_hit( DEBUGGER_BREAKPOINT_TYPE_EXECUTE, 0x8000 ) );
+  TEST_ASSERT( !breakpoint_hit( DEBUGGER_BREAKPOINT_TYPE_EXECUTE, 0x8001 ) );
+  TEST_ASSERT( !breakpoint_hit( DEBUGGER_BREAKPOINT_TYPE_READ, 0x8000 ) );
+
+  TEST_ASSERT( breakpoint_hit( DEBUGGER_BREAKPOINT_TYPE_PORT_WRITE, 0x12fe ) );
+  TEST_ASSERT( !breakpoint_hit( DEBUGGER_BREAKPOINT_TYPE_PORT_WRITE, 0x12fd ) );
+  TEST_ASSERT( !breakpoint_hit( DEBUGGER_BREAKPOINT_TYPE_PORT_READ, 0x12fe ) );
+
+  /* Breakpoints added after the first check must be seen too */
+  debugger_breakpoint_add_address( DEBUGGER_BREAKPOINT_TYPE_WRITE,
+                                   memory_source_any, 0, 0x4000, 0,
+                                   DEBUGGER_BREAKPOINT_LIFE_ONESHOT, NULL );
+  TEST_ASSERT( breakpoint_hit( DEBUGGER_BREAKPOINT_TYPE_WRITE, 0x4000 ) );
+  TEST_ASSERT( !breakpoint_hit( DEBUGGER_BREAKPOINT_TYPE_WRITE, 0x4000 ) );
+
+  debugger_breakpoint_remove_all();
+  TEST_ASSERT( !breakpoint_hit( DEBUGGER_BREAKPOINT_TYPE_EXECUTE, 0x8000 ) );
+
+  return r;
+}
+
+static int
+pokefinder_test( void )
+{
+  libspectrum_byte *saved, *bank = RAM[0];
+  size_t all;
+  int r = 0;
+
+  saved = libspectrum_new( libspectrum_byte, sizeof( RAM ) );
+  memcpy( saved, RAM, sizeof( RAM ) );
+  memset( RAM, 0, sizeof( RAM ) );
+
+  bank[ 0x0005 ] = 7;
+  bank[ 0x3fff ] = 7;
+  pokefinder_clear();
+  all = pokefinder_count;
+
+  pokefinder_search( 7 );
+  TEST_ASSERT( pokefinder_count == 2 );
+  pokefinder_search( 0 );
+  TEST_ASSERT( pokefinder_count == 0 );
+
+  pokefinder_clear();
+  pokefinder_search_range( 1, 7 );
+  TEST_ASSERT( pokefinder_count == 2 );
+
+  /* Words may cross a page boundary, but not a 16K bank */
+  bank[ 0x07ff ] = 0x34; bank[ 0x0800 ] = 0x12;
+  bank[ 0x3fff ] = 0x34; RAM[1][ 0x0000 ] = 0x12;
+  pokefinder_clear();
+  pokefinder_search_word( 0x1234 );
+  TEST_ASSERT( pokefinder_count == 1 );
+  TEST_ASSERT( !( pokefinder_impossible[0][ 0xff ] & 0x80 ) );
+
+  pokefinder_clear();
+  bank[ 0x0005 ] = 8; bank[ 0x0006 ] = 1;
+  pokefinder_incremented();
+  TEST_ASSERT( pokefinder_count == 2 );
+  bank[ 0x0005 ] = 10; bank[ 0x0006 ] = 3;
+  pokefinder_delta( 2 );
+  TEST_ASSERT( pokefinder_count == 2 );
+  bank[ 0x0006 ] = 4;
+  pokefinder_unchanged();
+  TEST_ASSERT( pokefinder_count == 1 );
+  bank[ 0x0005 ] = 9;
+  pokefinder_changed();
+  TEST_ASSERT( pokefinder_count == 1 );
+  pokefinder_decremented();
+  TEST_ASSERT( pokefinder_count == 0 );
+
+  pokefinder_clear();
+  pokefinder_unchanged();
+  TEST_ASSERT( pokefinder_count == all );
+  pokefinder_changed();
+  TEST_ASSERT( pokefinder_count == 0 );
+
+  memcpy( RAM, saved, sizeof( RAM ) );
+  libspectrum_free( saved );
+  pokefinder_clear();
+
+  return r;
+}
+
+static int event_test_count;
+
+static void
+event_test_fn( libspectrum_dword event_tstates GCC_UNUSED,
+               int type GCC_UNUSED, void *user_data GCC_UNUSED )
+{
+  event_test_count++;
+}
+
+static int
+event_test( void )
+{
+  int r = 0, type;
+
+  type = event_register( event_test_fn, "Unit test event" );
+  event_test_count = 0;
+
+  /* Events added as deleted, and timed breakpoints which are removed,
+     must not be left on any per-type list once they have happened */
+  event_add( tstates, event_type_null );
+  debugger_breakpoint_remove_all();
+  debugger_breakpoint_add_time( DEBUGGER_BREAKPOINT_TYPE_TIME, tstates, 0,
+                                DEBUGGER_BREAKPOINT_LIFE_PERMANENT, NULL );
+  debugger_breakpoint_remove( 1 );
+  event_do_events();
+
+  /* ... so reusing their entries mustn't let these be removed as well */
+  event_add( tstates, type );
+  event_add( tstates, type );
+  event_remove_type( event_type_null );
+  event_remove_type( debugger_breakpoint_event );
+  event_do_events();
+  TEST_ASSERT( event_test_count == 2 );
+
+  return r;
+}
+
+/* Peripherals' RAM counts against the rewind budget */
+static int
+rewind_budget_test( size_t budget )
+{
+  int r = 0, i;
+
+  rewind_reset();
+  for( i = 0; i < 16; i++ ) rewind_frame();
+
+  TEST_ASSERT( rewind_total_size() > 1024 * 1024 );
+  TEST_ASSERT( rewind_total_size() <= budget );
+
+  rewind_reset();
+  TEST_ASSERT( rewind_total_size() == 0 );
+
+  return r;
+}
+
+/* Going back restores RAM and the registers */
+static int
+rewind_back_test( void )
+{
+  int r = 0, i;
+  libspectrum_byte before[3];
+
+  rewind_reset();
+
+  for( i = 1; i <= 3; i++ ) before[ i - 1 ] = readbyte_internal( 0xc123 + i );
+
+  writebyte_internal( 0x8000, 0x12 );
+  writebyte_internal( 0xc123, 0x34 );
+  z80.bc.w = 0x1234; z80.pc.w = 0x8000;
+  rewind_frame();
+
+  for( i = 1; i <= 3; i++ ) {
+    writebyte_internal( 0x8000, 0x12 + i );
+    writebyte_internal( 0xc123 + i, before[ i - 1 ] ^ 0xff );
+    z80.bc.w = 0x1234 + i; z80.pc.w = 0x8000 + i;
+    rewind_frame();
+  }
+
+  TEST_ASSERT( rewind_back( 3 ) == 0 );
+
+  TEST_ASSERT( readbyte_internal( 0x8000 ) == 0x12 );
+  TEST_ASSERT( readbyte_internal( 0xc123 ) == 0x34 );
+  for( i = 1; i <= 3; i++ )
+    TEST_ASSERT( readbyte_internal( 0xc123 + i ) == before[ i - 1 ] );
+  TEST_ASSERT( z80.bc.w == 0x1234 );
+  TEST_ASSERT( z80.pc.w == 0x8000 );
+
+  return r;
+}
+
+static int
+rewind_test( void )
+{
+  int r = 0;
+  size_t budget = 4 * 1024 * 1024;
+
+  int old_zxcf = settings_current.zxcf_active;
+  int old_divide = settings_current.divide_enabled;
+  int old_rewind = settings_current.rewind;
+  int old_interval = settings_current.rewind_interval;
+  int old_size = settings_current.rewind_size;
+
+  settings_current.rewind = 1;
+  settings_current.rewind_interval = 1;
+  settings_current.rewind_size = budget / ( 1024 * 1024 );
+
+  /* Both of these put their RAM into every rewind point */
+  settings_current.zxcf_active = 1;
+  settings_current.divide_enabled = 1;
+  periph_update();
+
+  r += rewind_budget_test( budget );
+
+  settings_current.zxcf_active = old_zxcf;
+  settings_current.divide_enabled = old_divide;
+  periph_update();
+
+  r += rewind_back_test();
+
+  rewind_reset();
+  settings_current.rewind = old_rewind;
+  settings_current.rewind_interval = old_interval;
+  settings_current.rewind_size = old_size;
+
+  return r;
+}
+
+/* The RAM page mapped in at address */
+static int
+ram_page_at( libspectrum_word address )
+{
+  return memory_map_read[ address >> MEMORY_PAGE_SIZE_LOGARITHM ].page_num;
+}
+
+/* Fill in snaps with the snapshots in an RZX file, returning how many
+   there were */
+static size_t
+recording_snaps( libspectrum_rzx *from_rzx, libspectrum_snap **snaps,
+               size_t count, int automatic_only )
+{
+  libspectrum_rzx_iterator it;
+  size_t n = 0;
+
+  for( it = libspectrum_rzx_iterator_begin( from_rzx );
+       it && n < count;
+       it = libspectrum_rzx_iterator_next( it ) ) {
+    if( !libspectrum_rzx_iterator_get_snap( it ) ) continue;
+    if( automatic_only && !libspectrum_rzx_iterator_snap_is_automatic( it ) )
+      continue;
+    snaps[ n++ ] = libspectrum_rzx_iterator_get_snap( it );
+  }
+
+  return n;
+}
+
+/* A delta autosave borrows the pages it doesn't hold from the autosave
+   before it while being restored or written out, and must give them back
+   afterwards */
+static int
+rzx_autosave_pages_test( const char *filename )
+{
+  int r = 0;
+  int low = ram_page_at( 0x8000 ), high = ram_page_at( 0xc000 );
+  libspectrum_snap *snaps[4];
+  libspectrum_rzx *written;
+  utils_file file;
+
+  TEST_ASSERT( low != high );
+
+  TEST_ASSERT( rzx_start_recording( filename, 1 ) == 0 );
+
+  /* A keyframe holding every page, then a delta holding just low */
+  writebyte_internal( 0x8000, 0x01 );
+  writebyte_internal( 0xc000, 0x01 );
+  TEST_ASSERT( rzx_frame() == 0 );
+  writebyte_internal( 0x8000, 0x02 );
+  TEST_ASSERT( rzx_frame() == 0 );
+
+  TEST_ASSERT( recording_snaps( rzx, snaps, 2, 1 ) == 2 );
+  TEST_ASSERT( libspectrum_snap_pages( snaps[0], high ) );
+  TEST_ASSERT( !libspectrum_snap_pages( snaps[1], high ) );
+  TEST_ASSERT( libspectrum_snap_pages( snaps[1], low ) );
+
+  /* Rolling back to the delta restores high from the keyframe */
+  writebyte_internal( 0x8000, 0xff );
+  writebyte_internal( 0xc000, 0xff );
+  TEST_ASSERT( rzx_rollback() == 0 );
+  TEST_ASSERT( readbyte_internal( 0x8000 ) == 0x02 );
+  TEST_ASSERT( readbyte_internal( 0xc000 ) == 0x01 );
+
+  TEST_ASSERT( recording_snaps( rzx, snaps, 2, 1 ) == 2 );
+  TEST_ASSERT( libspectrum_snap_pages( snaps[0], high ) );
+  TEST_ASSERT( !libspectrum_snap_pages( snaps[1], high ) );
+
+  /* And written out, the delta holds every page */
+  TEST_ASSERT( rzx_stop_recording() == 0 );
+
+  TEST_ASSERT( utils_read_file( filename, &file ) == 0 );
+  written = libspectrum_rzx_alloc();
+  r = libspectrum_rzx_read( written, file.buffer, file.length ) ||
+      recording_snaps( written, snaps, 4, 0 ) != 4 ||
+      !libspectrum_snap_pages( snaps[2], low ) ||
+      !libspectrum_snap_pages( snaps[2], high ) ||
+      libspectrum_snap_pages( snaps[2], low )[0] != 0x02 ||
+      libspectrum_snap_pages( snaps[2], high )[0] != 0x01;
+  libspectrum_rzx_free( written );
+  utils_close_file( &file );
+
+  return r;
+}
+
+static int
+rzx_autosave_test( void )
+{
+  int r = 0;
+  char filename[ PATH_MAX ];
+
+  int old_autosaves = settings_current.rzx_autosaves;
+  int old_interval = settings_current.rzx_autosave_interval;
+  int old_competition = settings_current.competition_mode;
+
+  snprintf( filename, sizeof( filename ), "%s" FUSE_DIR_SEP_STR
+            "fuse-unittest.rzx", compat_get_temp_path() );
+
+  settings_current.rzx_autosaves = 1;
+  settings_current.rzx_autosave_interval = 1;
+  settings_current.competition_mode = 0;
+
+  r += rzx_autosave_pages_test( filename );
+
+  if( rzx_recording ) rzx_stop_recording();
+  remove( filename );
+
+  settings_current.rzx_autosaves = old_autosaves;
+  settings_current.rzx_autosave_interval = old_interval;
+  settings_current.competition_mode = old_competition;
+
+  return r;
+}
+
 static int
 mempool_test( void )
 {
@@ -385,6 +746,28 @@ assert_all_ram( int ram0000, int ram4000, int ram8000, int ramc000 )
   return r;
 }
 
+/* Check that writes will be checked against the screen for exactly those
+   chunks of RAM which hold it */
+static int
+assert_screen_chunks( void )
+{
+  int page, chunk;
+
+  for( page = 0; page < SPECTRUM_RAM_PAGES; page++ )
+    for( chunk = 0; chunk < MEMORY_PAGES_IN_16K; chunk++ ) {
+      memory_page *mapping =
+        &memory_map_ram[ page * MEMORY_PAGES_IN_16K + chunk ];
+      int screen = page == memory_current_screen &&
+        ( ( chunk * MEMORY_PAGE_SIZE ) & memory_screen_mask ) < 0x1b00;
+
+      TEST_ASSERT( !memory_screen_chunks[ mapping->ram_chunk ] == !screen );
+    }
+
+  TEST_ASSERT( memory_screen_chunks[ 0 ] == 0 );
+
+  return 0;
+}
+
 static int
 paging_test_16( void )
 {
@@ -405,6 +788,7 @@ unittests_paging_test_48( int ram8000 )
 
   r += assert_16k_pages( 0, 5, ram8000, 0 );
   TEST_ASSERT( memory_current_screen == 5 );
+  r += assert_screen_chunks();
 
   return r;
 }
@@ -425,6 +809,7 @@ paging_test_128_unlocked( int ram8000 )
   writeport_internal( 0x7ffd, 0x08 );
   r += assert_16k_pages( 0, 5, ram8000, 0 );
   TEST_ASSERT( memory_current_screen == 7 );
+  r += assert_screen_chunks();
 
   writeport_internal( 0x7ffd, 0x10 );
   r += assert_16k_pages( 1, 5, ram8000, 0 );
@@ -433,6 +818,7 @@ paging_test_128_unlocked( int ram8000 )
   writeport_internal( 0x7ffd, 0x1f );
   r += assert_16k_pages( 1, 5, ram8000, 7 );
   TEST_ASSERT( memory_current_screen == 7 );
+  r += assert_screen_chunks();
 
   return r;
 }
@@ -780,7 +1166,12 @@ unittests_run( void )
   r += contention_test();
   r += floating_bus_test();
   r += floating_bus_merge_test();
+  r += breakpoint_test();
+  r += event_test();
+  r += rewind_test();
+  r += rzx_autosave_test();
   r += mempool_test();
+  r += pokefinder_test();
   r += paging_test();
 
   return r;
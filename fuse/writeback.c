@@ -0,0 +1,470 @@
+/* writeback.c: Write disk images in the background
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif				/* #ifdef HAVE_PTHREAD */
+
+#include <libspectrum.h>
+
+#include "compat.h"
+#include "debugger/debugger.h"
+#include "infrastructure/startup_manager.h"
+#include "ui/ui.h"
+#include "utils.h"
+#include "writeback.h"
+
+/* Saving a large disk image can take long enough to cause the sound to
+   drop out, so images are handed to a single thread which writes them
+   while the emulation carries on. Having just the one thread means
+   everything is written in the order it was queued. Errors can only be
+   reported, and the jobs' done functions called, from the main thread, so
+   finished jobs are kept until the next time anything is queued or
+   flushed */
+
+typedef struct writeback_job {
+  char *filename;
+  size_t length;
+  writeback_write_fn write;
+  writeback_free_fn free_data;
+  void *data;
+  writeback_done_fn done;
+  void *context;
+  int error;
+  struct writeback_job *next;
+} writeback_job;
+
+/* The most which can be waiting to be written before queueing more has to
+   wait for some of it to be done */
+#define MAX_PENDING ( 64 * 1024 * 1024 )
+
+static const char * const debugger_type_string = "writeback";
+static const char * const pending_detail_string = "pending";
+
+/* The first error since the last one was reported */
+static char *error_message;
+
+static size_t pending_bytes;
+
+/* The files whose last write failed, which writeback_flush() hasn't yet
+   returned an error for */
+static GSList *failed_files;
+
+static void
+free_data( writeback_job *job )
+{
+  if( job->free_data ) job->free_data( job->data );
+  job->data = NULL;
+}
+
+static gint
+compare_filename( gconstpointer a, gconstpointer b )
+{
+  return strcmp( a, b );
+}
+
+/* Tell the job's owner it has finished, and remember whether it failed */
+static void
+finish_job( writeback_job *job )
+{
+  GSList *failed;
+
+  failed = g_slist_find_custom( failed_files, job->filename,
+                                compare_filename );
+  if( job->error && !failed ) {
+    failed_files = g_slist_prepend( failed_files,
+                                    utils_safe_strdup( job->filename ) );
+  } else if( !job->error && failed ) {
+    libspectrum_free( failed->data );
+    failed_files = g_slist_delete_link( failed_files, failed );
+  }
+
+  if( job->done ) job->done( job->context, job->error );
+
+  libspectrum_free( job->filename );
+  libspectrum_free( job );
+}
+
+static char*
+describe_error( const char *filename, const char *error )
+{
+  const char *format = "couldn't write '%s': %s";
+  size_t length = strlen( format ) + strlen( filename ) + strlen( error );
+  char *message;
+
+  message = libspectrum_new( char, length );
+  snprintf( message, length, format, filename, error );
+
+  return message;
+}
+
+#ifdef HAVE_PTHREAD
+
+static pthread_t thread;
+static int running = 0, stopping = 0, thread_failed = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+
+/* Jobs waiting to be written, oldest first, and the one being written */
+static writeback_job *queue_head, *queue_tail, *current;
+
+/* Jobs which have been written, oldest first */
+static writeback_job *finished_head, *finished_tail;
+
+static void*
+writeback_thread( void *arg GCC_UNUSED )
+{
+  writeback_job *job;
+  const char *error;
+  char *message;
+
+  pthread_mutex_lock( &lock );
+
+  while( 1 ) {
+
+    while( !queue_head && !stopping )
+      pthread_cond_wait( &job_queued, &lock );
+
+    if( !queue_head ) break;
+
+    job = current = queue_head;
+    queue_head = job->next;
+    if( !queue_head ) queue_tail = NULL;
+    pthread_mutex_unlock( &lock );
+
+    error = job->write( job->filename, job->data );
+    message = error ? describe_error( job->filename, error ) : NULL;
+    job->error = error ? 1 : 0;
+    free_data( job );
+
+    pthread_mutex_lock( &lock );
+    if( message && !error_message ) {
+      error_message = message; message = NULL;
+    }
+    pending_bytes -= job->length;
+    current = NULL;
+    job->next = NULL;
+    if( finished_tail ) {
+      finished_tail->next = job;
+    } else {
+      finished_head = job;
+    }
+    finished_tail = job;
+    pthread_cond_broadcast( &job_done );
+    pthread_mutex_unlock( &lock );
+
+    libspectrum_free( message );
+
+    pthread_mutex_lock( &lock );
+  }
+
+  pthread_mutex_unlock( &lock );
+
+  return NULL;
+}
+
+static int
+start_thread( void )
+{
+  int error;
+
+  if( running ) return 0;
+  if( thread_failed ) return 1;
+
+  stopping = 0;
+
+  error = pthread_create( &thread, NULL, writeback_thread, NULL );
+  if( error ) {
+    ui_error( UI_ERROR_WARNING,
+              "error %d creating writeback thread; writing in the foreground",
+              error );
+    thread_failed = 1;
+    return 1;
+  }
+
+  running = 1;
+
+  return 0;
+}
+
+static int
+waiting_for( const char *filename )
+{
+  writeback_job *job;
+
+  if( current && ( !filename || !strcmp( current->filename, filename ) ) )
+    return 1;
+
+  for( job = queue_head; job; job = job->next )
+    if( !filename || !strcmp( job->filename, filename ) ) return 1;
+
+  return 0;
+}
+
+#endif				/* #ifdef HAVE_PTHREAD */
+
+/* Report any error from the background thread, and finish off the jobs it
+   has written */
+static void
+finish_jobs( void )
+{
+  char *message;
+  writeback_job *job = NULL, *next;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock( &lock );
+  job = finished_head; finished_head = finished_tail = NULL;
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  message = error_message; error_message = NULL;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock( &lock );
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  if( message ) {
+    ui_error( UI_ERROR_ERROR, "%s", message );
+    libspectrum_free( message );
+  }
+
+  for( ; job; job = next ) {
+    next = job->next;
+    finish_job( job );
+  }
+}
+
+int
+writeback_queue( const char *filename, size_t length,
+                 writeback_write_fn write, writeback_free_fn free_fn,
+                 void *data, writeback_done_fn done, void *context )
+{
+  writeback_job *job;
+  const char *error;
+  char *message;
+
+  finish_jobs();
+
+  job = libspectrum_new( writeback_job, 1 );
+  job->filename = utils_safe_strdup( filename );
+  job->length = length;
+  job->write = write;
+  job->free_data = free_fn;
+  job->data = data;
+  job->done = done;
+  job->context = context;
+  job->error = 0;
+  job->next = NULL;
+
+#ifdef HAVE_PTHREAD
+  if( !start_thread() ) {
+
+    pthread_mutex_lock( &lock );
+
+    while( pending_bytes && pending_bytes + length > MAX_PENDING )
+      pthread_cond_wait( &job_done, &lock );
+
+    if( queue_tail ) {
+      queue_tail->next = job;
+    } else {
+      queue_head = job;
+    }
+    queue_tail = job;
+    pending_bytes += length;
+
+    pthread_cond_signal( &job_queued );
+    pthread_mutex_unlock( &lock );
+
+    return 0;
+  }
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  /* No background thread, so just write it now */
+  error = write( job->filename, job->data );
+  if( error ) {
+    message = describe_error( job->filename, error );
+    ui_error( UI_ERROR_ERROR, "%s", message );
+    libspectrum_free( message );
+  }
+  job->error = error ? 1 : 0;
+  free_data( job );
+  finish_job( job );
+
+  return error ? 1 : 0;
+}
+
+typedef struct file_data {
+  libspectrum_byte *buffer;
+  size_t length;
+} file_data;
+
+static const char*
+write_file( const char *filename, void *data )
+{
+  file_data *file = data;
+  FILE *f;
+
+  f = fopen( filename, "wb" );
+  if( !f ) return strerror( errno );
+
+  if( fwrite( file->buffer, 1, file->length, f ) != file->length ) {
+    fclose( f );
+    return "write error";
+  }
+
+  if( fclose( f ) ) return strerror( errno );
+
+  return NULL;
+}
+
+static void
+free_file( void *data )
+{
+  file_data *file = data;
+
+  libspectrum_free( file->buffer );
+  libspectrum_free( file );
+}
+
+int
+writeback_file( const char *filename, const libspectrum_byte *buffer,
+                size_t length, writeback_done_fn done, void *context )
+{
+  file_data *file;
+
+  file = libspectrum_new( file_data, 1 );
+  file->buffer = libspectrum_new( libspectrum_byte, length );
+  memcpy( file->buffer, buffer, length );
+  file->length = length;
+
+  return writeback_queue( filename, length, write_file, free_file, file,
+                          done, context );
+}
+
+int
+writeback_flush( const char *filename )
+{
+  GSList *failed;
+  int error = 0;
+
+#ifdef HAVE_PTHREAD
+  if( running ) {
+    pthread_mutex_lock( &lock );
+    while( waiting_for( filename ) ) pthread_cond_wait( &job_done, &lock );
+    pthread_mutex_unlock( &lock );
+  }
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  finish_jobs();
+
+  while( 1 ) {
+    failed = filename ?
+             g_slist_find_custom( failed_files, filename, compare_filename ) :
+             failed_files;
+    if( !failed ) break;
+
+    libspectrum_free( failed->data );
+    failed_files = g_slist_delete_link( failed_files, failed );
+    error = 1;
+  }
+
+  return error;
+}
+
+size_t
+writeback_pending( void )
+{
+  size_t pending;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock( &lock );
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  pending = pending_bytes;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock( &lock );
+#endif				/* #ifdef HAVE_PTHREAD */
+
+  return pending;
+}
+
+static libspectrum_dword
+get_pending( void )
+{
+  return writeback_pending();
+}
+
+static int
+writeback_init( void *context GCC_UNUSED )
+{
+  debugger_system_variable_register(
+    debugger_type_string, pending_detail_string, get_pending, NULL );
+
+  return 0;
+}
+
+static void
+writeback_end( void )
+{
+  writeback_flush( NULL );
+
+#ifdef HAVE_PTHREAD
+  if( running ) {
+    pthread_mutex_lock( &lock );
+    stopping = 1;
+    pthread_cond_signal( &job_queued );
+    pthread_mutex_unlock( &lock );
+
+    pthread_join( thread, NULL );
+    running = 0;
+  }
+#endif				/* #ifdef HAVE_PTHREAD */
+}
+
+void
+writeback_register_startup( void )
+{
+  /* The IDE interfaces are needed until the last of their writes is done,
+     so must end after this does */
+  startup_manager_module dependencies[] = {
+    STARTUP_MANAGER_MODULE_DEBUGGER,
+    STARTUP_MANAGER_MODULE_DIVIDE,
+    STARTUP_MANAGER_MODULE_SETUID,
+    STARTUP_MANAGER_MODULE_SIMPLEIDE,
+    STARTUP_MANAGER_MODULE_ZXATASP,
+    STARTUP_MANAGER_MODULE_ZXCF,
+  };
+  startup_manager_register( STARTUP_MANAGER_MODULE_WRITEBACK, dependencies,
+                            ARRAY_SIZE( dependencies ), writeback_init, NULL,
+                            writeback_end );
+}
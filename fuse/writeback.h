@@ -0,0 +1,69 @@
+/* writeback.h: Write disk images in the background
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#ifndef FUSE_WRITEBACK_H
+#define FUSE_WRITEBACK_H
+
+#include <stddef.h>
+
+#include <libspectrum.h>
+
+/* Write `data' to `filename'; called on the background thread, so must not
+   touch anything but `data'. Returns NULL on success or a description of
+   the error */
+typedef const char* (*writeback_write_fn)( const char *filename, void *data );
+
+/* Free `data' once it has been written */
+typedef void (*writeback_free_fn)( void *data );
+
+/* Called on the main thread, from writeback_queue() or writeback_flush(),
+   once `data' has been written; `error' is non-zero if the write failed */
+typedef void (*writeback_done_fn)( void *context, int error );
+
+void writeback_register_startup( void );
+
+/* Queue `data' to be written to `filename' by `write'. `length' is roughly
+   how many bytes will be written, and is used to limit how much can be
+   waiting at once. Writes to the same file happen in the order they were
+   queued. If the writes can't be done in the background they are done
+   before this returns. `done', if not NULL, is called with `context' once
+   the write has finished */
+int writeback_queue( const char *filename, size_t length,
+                     writeback_write_fn write, writeback_free_fn free_fn,
+                     void *data, writeback_done_fn done, void *context );
+
+/* Queue a copy of `buffer' to be written as the whole of `filename' */
+int writeback_file( const char *filename, const libspectrum_byte *buffer,
+                    size_t length, writeback_done_fn done, void *context );
+
+/* Wait for everything queued for `filename', or for every file if NULL, to
+   be written. Returns non-zero if the last write to `filename' (or to any
+   file) failed and that hasn't already been returned from here */
+int writeback_flush( const char *filename );
+
+/* The number of bytes still waiting to be written */
+size_t writeback_pending( void );
+
+#endif			/* #ifndef FUSE_WRITEBACK_H */
@@ -36,6 +36,7 @@
 #include "module.h"
 #include "peripherals/scld.h"
 #include "peripherals/spectranet.h"
+#include "profile.h"
 #include "rzx.h"
 #include "settings.h"
 #include "spectrum.h"
@@ -200,6 +201,8 @@ z80_interrupt( void )
     }
 
     if( z80.halted ) { PC++; z80.halted = 0; }
+
+    if( profile_active ) profile_interrupt();
     
     IFF1=IFF2=0;
     R++; rzx_instructions_offset--;
@@ -253,6 +256,8 @@ z80_nmi( libspectrum_dword ts, int type, void *user_data )
 
   if( z80.halted ) { PC++; z80.halted = 0; }
 
+  if( profile_active ) profile_interrupt();
+
   IFF1 = 0;
   R++; tstates += 5;
 
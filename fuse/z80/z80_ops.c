@@ -49,6 +49,7 @@
 #include "rzx.h"
 #include "settings.h"
 #include "slt.h"
+#include "spectrum.h"
 #include "svg.h"
 #include "tape.h"
 #include "z80.h"
@@ -109,6 +110,84 @@ enum {
 static libspectrum_byte opcode = 0x00;
 #endif
 
+#ifndef CORETEST
+
+/* Most of the core's memory reads are operand fetches from the
+   instruction stream; if nothing can intercept a read (no debugger
+   breakpoints, no Opus or Spectranet memory mapped devices paged in),
+   do it here with exactly the same contention and timing as readbyte()
+   rather than calling out to memory.c for every byte. These are static so
+   the compiler can inline them wherever that pays; forcing it everywhere
+   only grows the rarely taken paths */
+static libspectrum_byte
+z80_readbyte( libspectrum_word address )
+{
+  memory_page *mapping;
+
+  if( debugger_mode != DEBUGGER_MODE_INACTIVE || opus_active ||
+      spectranet_paged )
+    return readbyte( address );
+
+  mapping = &memory_map_read[ address >> MEMORY_PAGE_SIZE_LOGARITHM ];
+
+  if( mapping->contended ) tstates += ula_contention[ tstates ];
+  tstates += 3;
+
+  return mapping->page[ address & MEMORY_PAGE_SIZE_MASK ];
+}
+
+/* And the same for writes; only the common case of writing to a
+   writable page is done inline, anything else goes through
+   writebyte_internal() as usual */
+static void
+z80_writebyte( libspectrum_word address, libspectrum_byte b )
+{
+  memory_page *mapping;
+
+  if( debugger_mode != DEBUGGER_MODE_INACTIVE || opus_active ||
+      spectranet_paged ) {
+    writebyte( address, b );
+    return;
+  }
+
+  mapping = &memory_map_write[ address >> MEMORY_PAGE_SIZE_LOGARITHM ];
+
+  if( mapping->contended ) tstates += ula_contention[ tstates ];
+  tstates += 3;
+
+  if( mapping->writable ) {
+    memory_write_page( mapping, address, b );
+  } else {
+    writebyte_internal( address, b );
+  }
+}
+
+#define readbyte( address ) z80_readbyte( address )
+#define writebyte( address, b ) z80_writebyte( address, b )
+
+static int z80_fast_path_usable( void );
+static void z80_do_opcodes_fast( void );
+
+#endif				/* #ifndef CORETEST */
+
+#define NOT_128_TYPE_OR_IS_48_TYPE ( !( machine_current->capabilities & \
+            LIBSPECTRUM_MACHINE_CAPABILITY_128_MEMORY ) || \
+            machine_current->ram.current_rom )
+
+/* Page the Beta 128 ROM in or out depending on where we're executing */
+static void
+z80_beta_check( void )
+{
+  if( beta_active ) {
+    if( NOT_128_TYPE_OR_IS_48_TYPE && PC >= 16384 ) {
+      beta_unpage();
+    }
+  } else if( ( PC & beta_pc_mask ) == beta_pc_value &&
+             NOT_128_TYPE_OR_IS_48_TYPE ) {
+    beta_page();
+  }
+}
+
 /* Execute Z80 opcodes until the next event */
 void
 z80_do_opcodes( void )
@@ -138,6 +217,11 @@ z80_do_opcodes( void )
 
 #endif				/* #ifdef __GNUC__ */
 
+#ifndef CORETEST
+  while( tstates < event_next_event && z80_fast_path_usable() )
+    z80_do_opcodes_fast();
+#endif				/* #ifndef CORETEST */
+
   while( tstates < event_next_event ) {
 
     /* Profiler */
@@ -168,18 +252,7 @@ z80_do_opcodes( void )
 
     CHECK( beta, beta_available )
 
-#define NOT_128_TYPE_OR_IS_48_TYPE ( !( machine_current->capabilities & \
-            LIBSPECTRUM_MACHINE_CAPABILITY_128_MEMORY ) || \
-            machine_current->ram.current_rom )
-
-    if( beta_active ) {
-      if( NOT_128_TYPE_OR_IS_48_TYPE && PC >= 16384 ) {
-	beta_unpage();
-      }
-    } else if( ( PC & beta_pc_mask ) == beta_pc_value &&
-               NOT_128_TYPE_OR_IS_48_TYPE ) {
-      beta_page();
-    }
+    z80_beta_check();
 
     END_CHECK
 
@@ -394,3 +467,126 @@ z80_ddfdcbxx( libspectrum_byte opcode3, libspectrum_word tempaddr )
 }
 
 #endif			/* #ifndef HAVE_ENOUGH_MEMORY */
+
+#ifndef CORETEST
+
+/* The optional fast path. When no page in the memory map is contended
+   (or the machine has no contention at all), every contend_*() in the
+   opcode bodies is just a fixed number of tstates, so the opcodes can be
+   run back to back up to the next event with their cycle costs simply
+   summed, and without the per-opcode checks of z80_do_opcodes(). That is
+   only valid while nothing wants to look at each opcode, so the debugger,
+   profiler, RZX playback and every peripheral which pages on the program
+   counter keep us on the exact core; the exception is the Beta 128
+   interface, which is built into all the uncontended machines and is
+   cheap enough to check here. Port accesses may page memory, so they
+   end the run and the conditions are reconsidered */
+
+static int z80_fast_port_accessed = 0;
+
+static int
+z80_fast_path_usable( void )
+{
+  size_t i;
+
+  if( !settings_current.fast_core ) return 0;
+
+  if( debugger_mode != DEBUGGER_MODE_INACTIVE || profile_active ||
+      rzx_playback || svg_capture_active || z80.iff2_read ||
+      didaktik80_snap ||
+      machine_current->capabilities & LIBSPECTRUM_MACHINE_CAPABILITY_EVEN_M1 )
+    return 0;
+
+  if( plusd_available || didaktik80_available || disciple_available ||
+      usource_available || if1_available || opus_available ||
+      settings_current.divide_enabled || spectranet_available )
+    return 0;
+
+  if( machine_current->ram.contend_delay == spectrum_contend_delay_none )
+    return 1;
+
+  for( i = 0; i < MEMORY_PAGES_IN_64K; i++ )
+    if( memory_map_read[i].contended || memory_map_write[i].contended )
+      return 0;
+
+  return 1;
+}
+
+static libspectrum_byte
+z80_fast_readbyte( libspectrum_word address )
+{
+  tstates += 3;
+  return readbyte_internal( address );
+}
+
+static void
+z80_fast_writebyte( libspectrum_word address, libspectrum_byte b )
+{
+  memory_page *mapping =
+    &memory_map_write[ address >> MEMORY_PAGE_SIZE_LOGARITHM ];
+
+  tstates += 3;
+
+  if( mapping->writable ) {
+    memory_write_page( mapping, address, b );
+  } else {
+    writebyte_internal( address, b );
+  }
+}
+
+static libspectrum_byte
+z80_fast_readport( libspectrum_word port )
+{
+  z80_fast_port_accessed = 1;
+  return readport( port );
+}
+
+static void
+z80_fast_writeport( libspectrum_word port, libspectrum_byte b )
+{
+  z80_fast_port_accessed = 1;
+  writeport( port, b );
+}
+
+#undef contend_read
+#undef contend_read_no_mreq
+#undef contend_write_no_mreq
+#undef readbyte
+#undef writebyte
+
+#define contend_read( address, time ) tstates += (time);
+#define contend_read_no_mreq( address, time ) tstates += (time);
+#define contend_write_no_mreq( address, time ) tstates += (time);
+#define readbyte( address ) z80_fast_readbyte( address )
+#define writebyte( address, b ) z80_fast_writebyte( address, b )
+#define readport( port ) z80_fast_readport( port )
+#define writeport( port, b ) z80_fast_writeport( port, b )
+
+/* Execute Z80 opcodes on the fast path until the next event or the next
+   port access */
+static void
+z80_do_opcodes_fast( void )
+{
+#ifdef HAVE_ENOUGH_MEMORY
+  libspectrum_byte opcode = 0x00;
+#endif
+
+  z80_fast_port_accessed = 0;
+
+  while( tstates < event_next_event && !z80_fast_port_accessed ) {
+
+    if( beta_available ) z80_beta_check();
+
+    tstates += 4;
+    opcode = readbyte_internal( PC );
+
+  end_opcode:
+    PC++; R++;
+    switch(opcode) {
+#include "z80/opcodes_base.c"
+    }
+
+  }
+}
+
+#endif				/* #ifndef CORETEST */
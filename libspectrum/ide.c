@@ -41,6 +41,9 @@ typedef enum libspectrum_ide_command {
   LIBSPECTRUM_IDE_COMMAND_IDENTIFY_DRIVE_ATA = 0xec,
   LIBSPECTRUM_IDE_COMMAND_IDENTIFY_DRIVE_ATAPI = 0xa1,
   LIBSPECTRUM_IDE_COMMAND_INITIALIZE_DEVICE_PARAMETERS = 0x91,
+  LIBSPECTRUM_IDE_COMMAND_READ_MULTIPLE = 0xc4,
+  LIBSPECTRUM_IDE_COMMAND_WRITE_MULTIPLE = 0xc5,
+  LIBSPECTRUM_IDE_COMMAND_SET_MULTIPLE_MODE = 0xc6,
 
 } libspectrum_ide_command;
 
@@ -83,6 +86,7 @@ typedef enum libspectrum_ide_identityfield {
   LIBSPECTRUM_IDE_IDENTITY_NUM_CYLINDERS = 1,
   LIBSPECTRUM_IDE_IDENTITY_NUM_HEADS = 3,
   LIBSPECTRUM_IDE_IDENTITY_NUM_SECTORS = 6,
+  LIBSPECTRUM_IDE_IDENTITY_MAX_MULTIPLE = 47,
   LIBSPECTRUM_IDE_IDENTITY_CAPABILITIES = 49,
   LIBSPECTRUM_IDE_IDENTITY_FIELD_VALIDITY = 53,
   LIBSPECTRUM_IDE_IDENTITY_CURRENT_CYLINDERS = 54,
@@ -90,6 +94,7 @@ typedef enum libspectrum_ide_identityfield {
   LIBSPECTRUM_IDE_IDENTITY_CURRENT_SECTORS = 56,
   LIBSPECTRUM_IDE_IDENTITY_CURRENT_CAPACITY_LOW = 57,
   LIBSPECTRUM_IDE_IDENTITY_CURRENT_CAPACITY_HI = 58,
+  LIBSPECTRUM_IDE_IDENTITY_MULTIPLE_SETTING = 59,
   LIBSPECTRUM_IDE_IDENTITY_TOTAL_SECTORS_LOW = 60,
   LIBSPECTRUM_IDE_IDENTITY_TOTAL_SECTORS_HI = 61,
 
@@ -118,6 +123,25 @@ typedef struct libspectrum_hdf_header {
   libspectrum_byte drive_identity[0x6a];
 
 } libspectrum_hdf_header;
+
+/* The most sectors which can be transferred per DRQ block by READ
+   MULTIPLE and WRITE MULTIPLE */
+#define MAX_MULTIPLE 16
+
+/* Sectors are read from the HDF file a block of this many at a time, so a
+   directory scan or a file load costs one read per block rather than one
+   per sector. The most recently used blocks are kept around */
+#define READ_CACHE_BLOCK_SECTORS 64
+#define READ_CACHE_BLOCKS 16
+
+typedef struct libspectrum_ide_block {
+
+  long number;			/* -1 if this entry is unused */
+  int sectors;			/* May be short at the end of the file */
+  unsigned long last_used;
+  libspectrum_byte *data;
+
+} libspectrum_ide_block;
   
 typedef struct libspectrum_ide_drive {
 
@@ -132,6 +156,13 @@ typedef struct libspectrum_ide_drive {
   int heads;
   int sectors;
 
+  /* Sectors per block for READ/WRITE MULTIPLE; 0 if disabled */
+  int multiple;
+
+  /* Blocks recently read from the HDF file */
+  libspectrum_ide_block read_cache[ READ_CACHE_BLOCKS ];
+  unsigned long read_clock;
+
   libspectrum_byte error;
   libspectrum_byte status;
   
@@ -162,21 +193,34 @@ struct libspectrum_ide_channel {
   int datacounter;
   
   /* Sector buffer */
-  libspectrum_byte buffer[512];
+  libspectrum_byte buffer[ 512 * MAX_MULTIPLE ];
   int sector_number;
 
-  /* One write cache for each drive */
+  /* Sectors per DRQ block for the current command, the number of sectors
+     in the current block and its length in the buffer */
+  int block_size;
+  int block_sectors;
+  int transfer_length;
+
+  /* One write cache for each drive. Each sector in the cache is followed
+     by a flag saying whether it has been changed since it was last
+     committed */
   GHashTable *cache[2];
+  int dirty_count[2];
 
 };
 
 /* Private function prototypes */
 static gboolean write_to_disk( gpointer key, gpointer value,
   gpointer user_data );
+static void commit_to_function( gpointer key, gpointer value,
+  gpointer user_data );
 static gboolean clear_cache( gpointer key, gpointer value,
   gpointer user_data GCC_UNUSED );
-static int read_hdf( libspectrum_ide_channel *chn );
-static int write_hdf( libspectrum_ide_channel *chn );
+static void clear_read_cache( libspectrum_ide_drive *drv );
+static int read_hdf( libspectrum_ide_channel *chn, libspectrum_byte *dest );
+static int write_hdf( libspectrum_ide_channel *chn,
+  const libspectrum_byte *src );
 static libspectrum_byte read_data( libspectrum_ide_channel *chn );
 static void write_data( libspectrum_ide_channel *chn,
   libspectrum_byte data );
@@ -184,7 +228,10 @@ static libspectrum_error seek( libspectrum_ide_channel *chn );
 static void identifydevice( libspectrum_ide_channel *chn );
 static void readsector( libspectrum_ide_channel *chn );
 static void writesector( libspectrum_ide_channel *chn );
+static void write_block( libspectrum_ide_channel *chn );
 static void init_device_params( libspectrum_ide_channel *chn );
+static void set_multiple_mode( libspectrum_ide_channel *chn );
+static void read_write_multiple( libspectrum_ide_channel *chn, int write );
 static void execute_command( libspectrum_ide_channel *chn,
   libspectrum_byte data );
 
@@ -195,11 +242,13 @@ libspectrum_ide_alloc( libspectrum_ide_databus databus )
 {
   libspectrum_ide_channel *channel;
 
-  channel = libspectrum_new( libspectrum_ide_channel, 1 );
+  channel = libspectrum_new0( libspectrum_ide_channel, 1 );
 
   channel->databus = databus;
   channel->drive[ LIBSPECTRUM_IDE_MASTER ].disk = NULL;
   channel->drive[ LIBSPECTRUM_IDE_SLAVE  ].disk = NULL;
+  clear_read_cache( &channel->drive[ LIBSPECTRUM_IDE_MASTER ] );
+  clear_read_cache( &channel->drive[ LIBSPECTRUM_IDE_SLAVE  ] );
 
   channel->cache[ LIBSPECTRUM_IDE_MASTER ] =
     g_hash_table_new( g_int_hash, g_int_equal );
@@ -285,6 +334,8 @@ libspectrum_ide_insert( libspectrum_ide_channel *chn,
     drv->hdf.drive_identity, LIBSPECTRUM_IDE_IDENTITY_NUM_HEADS );
   drv->sectors = GET_WORD(
     drv->hdf.drive_identity, LIBSPECTRUM_IDE_IDENTITY_NUM_SECTORS );
+
+  drv->multiple = 0;
   
   return LIBSPECTRUM_ERROR_NONE;
 }
@@ -326,6 +377,56 @@ libspectrum_ide_commit( libspectrum_ide_channel *chn,
 
   g_hash_table_foreach_remove( cache, write_to_disk, drv );
 
+  /* Anything which couldn't be written is still dirty */
+  chn->dirty_count[ unit ] = g_hash_table_size( cache );
+
+  /* The cached blocks may now be out of date */
+  clear_read_cache( drv );
+
+  return LIBSPECTRUM_ERROR_NONE;
+}
+
+typedef struct commit_info {
+  libspectrum_ide_drive *drive;
+  libspectrum_ide_write_fn write;
+  void *context;
+} commit_info;
+
+static void
+commit_to_function( gpointer key, gpointer value, gpointer user_data )
+{
+  guint sector_number = *(guint*)key;
+  libspectrum_byte *buffer = value;
+  commit_info *info = user_data;
+  libspectrum_ide_drive *drv = info->drive;
+
+  if( !buffer[ drv->sector_size ] ) return;
+
+  info->write( drv->data_offset + (long)drv->sector_size * sector_number,
+               buffer, drv->sector_size, info->context );
+  buffer[ drv->sector_size ] = 0;
+}
+
+/* Pass any pending writes to a function to be written to the image. The
+   data stays in the write cache, so the image can be written to at leisure
+   without it being read back before then */
+libspectrum_error
+libspectrum_ide_commit_to( libspectrum_ide_channel *chn,
+                           libspectrum_ide_unit unit,
+                           libspectrum_ide_write_fn write, void *context )
+{
+  commit_info info;
+
+  if( !chn->drive[ unit ].disk ) return LIBSPECTRUM_ERROR_NONE;
+
+  info.drive = &chn->drive[ unit ];
+  info.write = write;
+  info.context = context;
+
+  g_hash_table_foreach( chn->cache[ unit ], commit_to_function, &info );
+
+  chn->dirty_count[ unit ] = 0;
+
   return LIBSPECTRUM_ERROR_NONE;
 }
 
@@ -342,7 +443,59 @@ int
 libspectrum_ide_dirty( libspectrum_ide_channel *chn,
 		       libspectrum_ide_unit unit )
 {
-  return g_hash_table_size( chn->cache[ unit ] ) != 0;
+  return chn->dirty_count[ unit ] != 0;
+}
+
+static void
+mark_dirty( gpointer key GCC_UNUSED, gpointer value, gpointer user_data )
+{
+  libspectrum_byte *buffer = value;
+  libspectrum_ide_drive *drv = user_data;
+
+  buffer[ drv->sector_size ] = 1;
+}
+
+/* Mark everything in the write cache as not yet committed, for when
+   writing the sectors passed on by libspectrum_ide_commit_to() failed */
+void
+libspectrum_ide_mark_dirty( libspectrum_ide_channel *chn,
+                            libspectrum_ide_unit unit )
+{
+  GHashTable *cache = chn->cache[ unit ];
+
+  if( !chn->drive[ unit ].disk ) return;
+
+  g_hash_table_foreach( cache, mark_dirty, &chn->drive[ unit ] );
+  chn->dirty_count[ unit ] = g_hash_table_size( cache );
+}
+
+static gboolean
+drop_committed( gpointer key, gpointer value, gpointer user_data )
+{
+  libspectrum_byte *buffer = value;
+  libspectrum_ide_drive *drv = user_data;
+
+  if( buffer[ drv->sector_size ] ) return FALSE;
+
+  libspectrum_free( key ); libspectrum_free( value );
+
+  return TRUE;
+}
+
+/* Remove everything which has been committed from the write cache, once
+   the sectors passed on by libspectrum_ide_commit_to() are in the image */
+void
+libspectrum_ide_drop_committed( libspectrum_ide_channel *chn,
+                                libspectrum_ide_unit unit )
+{
+  libspectrum_ide_drive *drv = &chn->drive[ unit ];
+
+  if( !drv->disk ) return;
+
+  g_hash_table_foreach_remove( chn->cache[ unit ], drop_committed, drv );
+
+  /* The cached blocks may have been read before the image was written */
+  clear_read_cache( drv );
 }
 
 /* Eject a hard disk from a drive */
@@ -362,6 +515,8 @@ libspectrum_ide_eject( libspectrum_ide_channel *chn,
   drv->disk = NULL;
 
   g_hash_table_foreach_remove( cache, clear_cache, NULL );
+  chn->dirty_count[ unit ] = 0;
+  clear_read_cache( drv );
   
   return LIBSPECTRUM_ERROR_NONE;
 }
@@ -410,6 +565,10 @@ libspectrum_ide_reset( libspectrum_ide_channel *chn )
     /* Feature is write-only */
     chn->feature = 0xff;
 
+    /* Multiple mode is disabled by a hardware reset */
+    chn->drive[LIBSPECTRUM_IDE_MASTER].multiple = 0;
+    chn->drive[LIBSPECTRUM_IDE_SLAVE].multiple = 0;
+
   } else {
 
     /* If no drive is present, set all registers to 0xff */
@@ -430,14 +589,70 @@ libspectrum_ide_reset( libspectrum_ide_channel *chn )
 }
 
 
+/* Forget all the blocks read from the HDF file */
+static void
+clear_read_cache( libspectrum_ide_drive *drv )
+{
+  size_t i;
+
+  for( i = 0; i < READ_CACHE_BLOCKS; i++ ) {
+    libspectrum_free( drv->read_cache[i].data );
+    drv->read_cache[i].data = NULL;
+    drv->read_cache[i].number = -1;
+  }
+}
+
+/* Find the cached copy of a block, reading it from the HDF file if it's not
+   already cached; returns NULL on error */
+static libspectrum_ide_block*
+get_block( libspectrum_ide_drive *drv, long number )
+{
+  libspectrum_ide_block *block, *oldest;
+  size_t i, block_length, length;
+  long position;
+
+  oldest = &drv->read_cache[0];
+
+  for( i = 0; i < READ_CACHE_BLOCKS; i++ ) {
+    block = &drv->read_cache[i];
+    if( block->number == number ) {
+      block->last_used = ++drv->read_clock;
+      return block;
+    }
+    if( block->number == -1 ) {
+      oldest = block; break;
+    }
+    if( block->last_used < oldest->last_used ) oldest = block;
+  }
+
+  block = oldest;
+  block->number = -1;
+
+  block_length = READ_CACHE_BLOCK_SECTORS * drv->sector_size;
+  if( !block->data )
+    block->data = libspectrum_new( libspectrum_byte, block_length );
+
+  position = drv->data_offset + block_length * number;
+  if( fseek( drv->disk, position, SEEK_SET ) ) return NULL;
+
+  length = fread( block->data, 1, block_length, drv->disk );
+  if( length < drv->sector_size ) return NULL;
+
+  block->number = number;
+  block->sectors = length / drv->sector_size;
+  block->last_used = ++drv->read_clock;
+
+  return block;
+}
+
 /* Read a sector from the HDF file */
 static int
-read_hdf( libspectrum_ide_channel *chn )
+read_hdf( libspectrum_ide_channel *chn, libspectrum_byte *dest )
 {
   libspectrum_ide_unit selected;
   libspectrum_ide_drive *drv;
   GHashTable *cache;
-  libspectrum_byte *buffer, packed_buf[512];
+  libspectrum_byte *buffer;
 
   selected = chn->selected;
   drv = &chn->drive[ selected ];
@@ -449,20 +664,16 @@ read_hdf( libspectrum_ide_channel *chn )
   /* If it's not in the write cache, read from the disk image */
   if( !buffer ) {
 
-    long sector_position;
-
-    sector_position =
-      drv->data_offset + ( drv->sector_size * chn->sector_number );
+    libspectrum_ide_block *block;
+    int offset;
 
-    /* Seek to the correct file position */
-    if( fseek( drv->disk, sector_position, SEEK_SET ) ) return 1;
+    block = get_block( drv, chn->sector_number / READ_CACHE_BLOCK_SECTORS );
+    if( !block ) return 1;
 
-    /* Read the packed data into a temporary buffer */
-    if ( fread( packed_buf, 1, drv->sector_size, drv->disk ) !=
-	 drv->sector_size                                       )
-      return 1;		/* read error */
+    offset = chn->sector_number % READ_CACHE_BLOCK_SECTORS;
+    if( offset >= block->sectors ) return 1;	/* read error */
 
-    buffer = packed_buf;
+    buffer = block->data + offset * drv->sector_size;
   }
 
   /* Unpack or copy the data into the sector buffer */
@@ -471,12 +682,12 @@ read_hdf( libspectrum_ide_channel *chn )
     int i;
     
     for( i = 0; i < 256; i++ ) {
-      chn->buffer[ i*2 ] = buffer[ i ];
-      chn->buffer[ i*2 + 1 ] = 0xff;
+      dest[ i*2 ] = buffer[ i ];
+      dest[ i*2 + 1 ] = 0xff;
     }
 
   } else {
-    memcpy( chn->buffer, buffer, 512 );
+    memcpy( dest, buffer, 512 );
   }
   
   return 0;
@@ -485,7 +696,7 @@ read_hdf( libspectrum_ide_channel *chn )
 
 /* Write a sector to the HDF file */
 static int
-write_hdf( libspectrum_ide_channel *chn )
+write_hdf( libspectrum_ide_channel *chn, const libspectrum_byte *src )
 {
   libspectrum_ide_unit selected;
   libspectrum_ide_drive *drv;
@@ -504,19 +715,25 @@ write_hdf( libspectrum_ide_channel *chn )
     gint *key;
 
     key = libspectrum_new( gint, 1 );
-    buffer = libspectrum_new( libspectrum_byte, drv->sector_size );
+    buffer = libspectrum_new( libspectrum_byte, drv->sector_size + 1 );
+    buffer[ drv->sector_size ] = 0;
 
     *key = chn->sector_number;
     g_hash_table_insert( cache, key, buffer );
 
   }
 
+  if( !buffer[ drv->sector_size ] ) {
+    buffer[ drv->sector_size ] = 1;
+    chn->dirty_count[ selected ]++;
+  }
+
   /* Pack or copy the data into the write cache */
   if ( drv->sector_size == 256 ) {
     int i;
-    for( i = 0; i < 256; i++ ) buffer[i] = chn->buffer[ i * 2 ];
+    for( i = 0; i < 256; i++ ) buffer[i] = src[ i * 2 ];
   } else {
-    memcpy( buffer, chn->buffer, 512 );
+    memcpy( buffer, src, 512 );
   }
 
   return 0;
@@ -561,7 +778,7 @@ read_data( libspectrum_ide_channel *chn )
   }
 
   /* Check for end of phase */
-  if( chn->datacounter >= 512 ) {
+  if( chn->datacounter >= chn->transfer_length ) {
     if( chn->sector_count ) {
       /* more sectors to read */
       readsector( chn );
@@ -607,8 +824,6 @@ libspectrum_ide_read( libspectrum_ide_channel *chn,
 static void
 write_data( libspectrum_ide_channel *chn, libspectrum_byte data )
 {
-  libspectrum_ide_drive *drv = &chn->drive[ chn->selected ];
-
   /* Data register can only be written in PIO output phase */
   if( chn->phase != LIBSPECTRUM_IDE_PHASE_PIO_OUT ) return;
 
@@ -637,23 +852,7 @@ write_data( libspectrum_ide_channel *chn, libspectrum_byte data )
   }
     
   /* Check for end of phase */
-  if( chn->datacounter >= 512 ) {
-
-    /* Write data to disk */
-    if ( write_hdf( chn ) ) {
-      drv->status |= LIBSPECTRUM_IDE_STATUS_ERR;
-      drv->error = LIBSPECTRUM_IDE_ERROR_ABRT | LIBSPECTRUM_IDE_ERROR_UNC;
-    }
-
-    if( chn->sector_count ) {
-      /* more sectors to write */
-      writesector( chn );
-    } else {
-      /* all sectors done */
-      chn->phase = LIBSPECTRUM_IDE_PHASE_READY;
-      drv->status &= ~LIBSPECTRUM_IDE_STATUS_DRQ;
-    }
-  }
+  if( chn->datacounter >= chn->transfer_length ) write_block( chn );
 
 }
 
@@ -784,6 +983,12 @@ identifydevice( libspectrum_ide_channel *chn )
 	      ( sector_count & 0xffff0000 ) >> 16 );
   }
 
+  /* READ/WRITE MULTIPLE support */
+  SET_WORD( chn->buffer, LIBSPECTRUM_IDE_IDENTITY_MAX_MULTIPLE,
+	    0x8000 | MAX_MULTIPLE );
+  SET_WORD( chn->buffer, LIBSPECTRUM_IDE_IDENTITY_MULTIPLE_SETTING,
+	    drv->multiple ? 0x0100 | drv->multiple : 0 );
+
   /* prevent read_data from trying to read from disk after identity block
      is completely read in */
   chn->sector_count = 0;
@@ -792,44 +997,93 @@ identifydevice( libspectrum_ide_channel *chn )
   chn->phase = LIBSPECTRUM_IDE_PHASE_PIO_IN;
   drv->status |= LIBSPECTRUM_IDE_STATUS_DRQ;
   chn->datacounter = 0;
+  chn->transfer_length = 512;
 }
 
-/* Execute the READ SECTOR command */
+/* Read the next block of sectors for the READ SECTOR or READ MULTIPLE
+   command */
 static void
 readsector( libspectrum_ide_channel *chn )
 {
   libspectrum_ide_drive *drv = &chn->drive[ chn->selected ];
+  int sectors = 0;
 
-  if( seek( chn ) ) return;
+  do {
 
-  /* Read data from disk */
-  if( read_hdf( chn ) ) {
-    
-    drv->status |= LIBSPECTRUM_IDE_STATUS_ERR;
-    drv->error = LIBSPECTRUM_IDE_ERROR_ABRT | LIBSPECTRUM_IDE_ERROR_UNC;
+    if( seek( chn ) ) return;
 
-  } else {
+    /* Read data from disk */
+    if( read_hdf( chn, &chn->buffer[ sectors * 512 ] ) ) {
+      drv->status |= LIBSPECTRUM_IDE_STATUS_ERR;
+      drv->error = LIBSPECTRUM_IDE_ERROR_ABRT | LIBSPECTRUM_IDE_ERROR_UNC;
+      return;
+    }
 
-    /* Initiate the PIO input phase */
-    chn->phase = LIBSPECTRUM_IDE_PHASE_PIO_IN;
-    drv->status |= LIBSPECTRUM_IDE_STATUS_DRQ;
-    chn->datacounter = 0;
+    sectors++;
 
-  }
+  } while( sectors < chn->block_size && chn->sector_count );
+
+  /* Initiate the PIO input phase */
+  chn->phase = LIBSPECTRUM_IDE_PHASE_PIO_IN;
+  drv->status |= LIBSPECTRUM_IDE_STATUS_DRQ;
+  chn->datacounter = 0;
+  chn->transfer_length = sectors * 512;
 }
 
-/* Execute the WRITE SECTOR command */
+/* Start the next block of sectors for the WRITE SECTOR or WRITE MULTIPLE
+   command */
 static void
 writesector( libspectrum_ide_channel *chn )
 {
   libspectrum_ide_drive *drv = &chn->drive[ chn->selected ];
+  int remaining;
 
+  /* A sector count of zero means 256 sectors */
+  remaining = chn->sector_count ? chn->sector_count : 256;
+  chn->block_sectors =
+    remaining < chn->block_size ? remaining : chn->block_size;
+
+  /* Check the first sector of the block can be written */
   if( seek( chn ) ) return;
 
   /* Initiate the PIO output phase */
   chn->phase = LIBSPECTRUM_IDE_PHASE_PIO_OUT;
   drv->status |= LIBSPECTRUM_IDE_STATUS_DRQ;
   chn->datacounter = 0;
+  chn->transfer_length = chn->block_sectors * 512;
+}
+
+/* Write out a block of sectors once all its data has been received */
+static void
+write_block( libspectrum_ide_channel *chn )
+{
+  libspectrum_ide_drive *drv = &chn->drive[ chn->selected ];
+  int i;
+
+  for( i = 0; i < chn->block_sectors; i++ ) {
+
+    /* The first sector was sought when the block was started */
+    if( i && seek( chn ) ) {
+      chn->phase = LIBSPECTRUM_IDE_PHASE_READY;
+      drv->status &= ~LIBSPECTRUM_IDE_STATUS_DRQ;
+      return;
+    }
+
+    /* Write data to disk */
+    if ( write_hdf( chn, &chn->buffer[ i * 512 ] ) ) {
+      drv->status |= LIBSPECTRUM_IDE_STATUS_ERR;
+      drv->error = LIBSPECTRUM_IDE_ERROR_ABRT | LIBSPECTRUM_IDE_ERROR_UNC;
+    }
+  }
+
+  if( chn->sector_count ) {
+    /* more sectors to write */
+    writesector( chn );
+  } else {
+    /* all sectors done */
+    chn->phase = LIBSPECTRUM_IDE_PHASE_READY;
+    drv->status &= ~LIBSPECTRUM_IDE_STATUS_DRQ;
+  }
 }
 
 /* Execute the INITIALIZE DEVICE PARAMETERS command */
@@ -864,6 +1118,44 @@ init_device_params( libspectrum_ide_channel *chn )
   drv->status |= LIBSPECTRUM_IDE_STATUS_DRDY;
 }
 
+/* Execute the SET MULTIPLE MODE command */
+static void
+set_multiple_mode( libspectrum_ide_channel *chn )
+{
+  libspectrum_ide_drive *drv = &chn->drive[ chn->selected ];
+  int count = chn->sector_count;
+
+  /* Zero disables multiple mode; otherwise the count must be a power of two
+     no bigger than we support */
+  if( count > MAX_MULTIPLE || ( count & ( count - 1 ) ) ) {
+    drv->status |= LIBSPECTRUM_IDE_STATUS_ERR;
+    drv->error = LIBSPECTRUM_IDE_ERROR_ABRT;
+    return;
+  }
+
+  drv->multiple = count;
+}
+
+/* Start the READ MULTIPLE or WRITE MULTIPLE command */
+static void
+read_write_multiple( libspectrum_ide_channel *chn, int write )
+{
+  libspectrum_ide_drive *drv = &chn->drive[ chn->selected ];
+
+  if( !drv->multiple ) {
+    drv->status |= LIBSPECTRUM_IDE_STATUS_ERR;
+    drv->error = LIBSPECTRUM_IDE_ERROR_ABRT;
+    return;
+  }
+
+  chn->block_size = drv->multiple;
+  if( write ) {
+    writesector( chn );
+  } else {
+    readsector( chn );
+  }
+}
+
 /* Execute a command */
 static void
 execute_command( libspectrum_ide_channel *chn, libspectrum_byte data )
@@ -878,6 +1170,9 @@ execute_command( libspectrum_ide_channel *chn, libspectrum_byte data )
   drv->status &= ~(LIBSPECTRUM_IDE_STATUS_ERR | LIBSPECTRUM_IDE_STATUS_BSY);
   drv->status |= LIBSPECTRUM_IDE_STATUS_DRDY;
 
+  /* Everything but READ/WRITE MULTIPLE transfers a sector at a time */
+  chn->block_size = 1;
+
   /* Perform command */
   switch( data ) {
 
@@ -889,6 +1184,12 @@ execute_command( libspectrum_ide_channel *chn, libspectrum_byte data )
   case LIBSPECTRUM_IDE_COMMAND_IDENTIFY_DRIVE_ATAPI: identifydevice( chn ); break;
   case LIBSPECTRUM_IDE_COMMAND_INITIALIZE_DEVICE_PARAMETERS:
     init_device_params( chn ); break;
+  case LIBSPECTRUM_IDE_COMMAND_READ_MULTIPLE:
+    read_write_multiple( chn, 0 ); break;
+  case LIBSPECTRUM_IDE_COMMAND_WRITE_MULTIPLE:
+    read_write_multiple( chn, 1 ); break;
+  case LIBSPECTRUM_IDE_COMMAND_SET_MULTIPLE_MODE:
+    set_multiple_mode( chn ); break;
       
     /* Unknown/unsupported commands */
   default:
@@ -324,6 +324,71 @@ libspectrum_snap_free( libspectrum_snap *snap )
   return LIBSPECTRUM_ERROR_NONE;
 }
 
+/* The total length of the memory buffers held in a snapshot */
+size_t
+libspectrum_snap_memory_size( libspectrum_snap *snap )
+{
+  size_t size = 0, i;
+
+  for( i = 0; i < 4; i++ )
+    if( libspectrum_snap_roms( snap, i ) )
+      size += libspectrum_snap_rom_length( snap, i );
+
+  for( i = 0; i < SNAPSHOT_RAM_PAGES; i++ )
+    if( libspectrum_snap_pages( snap, i ) ) size += 0x4000;
+
+  for( i = 0; i < SNAPSHOT_SLT_PAGES; i++ )
+    if( libspectrum_snap_slt( snap, i ) )
+      size += libspectrum_snap_slt_length( snap, i );
+
+  if( libspectrum_snap_slt_screen( snap ) ) size += 6912;
+
+  for( i = 0; i < SNAPSHOT_ZXATASP_PAGES; i++ )
+    if( libspectrum_snap_zxatasp_ram( snap, i ) ) size += 0x4000;
+
+  for( i = 0; i < SNAPSHOT_ZXCF_PAGES; i++ )
+    if( libspectrum_snap_zxcf_ram( snap, i ) ) size += 0x4000;
+
+  if( libspectrum_snap_interface2_rom( snap, 0 ) ) size += 0x4000;
+
+  for( i = 0; i < SNAPSHOT_DOCK_EXROM_PAGES; i++ ) {
+    if( libspectrum_snap_dock_cart( snap, i ) ) size += 0x2000;
+    if( libspectrum_snap_exrom_cart( snap, i ) ) size += 0x2000;
+  }
+
+  if( libspectrum_snap_beta_rom( snap, 0 ) ) size += 0x4000;
+
+  if( libspectrum_snap_plusd_rom( snap, 0 ) ) size += 0x2000;
+  if( libspectrum_snap_plusd_ram( snap, 0 ) ) size += 0x2000;
+
+  if( libspectrum_snap_opus_rom( snap, 0 ) ) size += 0x2000;
+  if( libspectrum_snap_opus_ram( snap, 0 ) ) size += 0x0800;
+
+  if( libspectrum_snap_interface1_rom( snap, 0 ) )
+    size += libspectrum_snap_interface1_rom_length( snap, 0 );
+
+  if( libspectrum_snap_divide_eprom( snap, 0 ) ) size += 0x2000;
+  for( i = 0; i < SNAPSHOT_DIVIDE_PAGES; i++ )
+    if( libspectrum_snap_divide_ram( snap, i ) ) size += 0x2000;
+
+  if( libspectrum_snap_spectranet_w5100( snap, 0 ) ) size += 0x30;
+  if( libspectrum_snap_spectranet_flash( snap, 0 ) ) size += 0x20000;
+  if( libspectrum_snap_spectranet_ram( snap, 0 ) ) size += 0x20000;
+
+  if( libspectrum_snap_usource_rom( snap, 0 ) )
+    size += libspectrum_snap_usource_rom_length( snap, 0 );
+
+  if( libspectrum_snap_disciple_rom( snap, 0 ) )
+    size += libspectrum_snap_disciple_rom_length( snap, 0 );
+  if( libspectrum_snap_disciple_ram( snap, 0 ) ) size += 0x2000;
+
+  if( libspectrum_snap_didaktik80_rom( snap, 0 ) )
+    size += libspectrum_snap_didaktik80_rom_length( snap, 0 );
+  if( libspectrum_snap_didaktik80_ram( snap, 0 ) ) size += 0x0800;
+
+  return size;
+}
+
 /* Read in a snapshot, optionally guessing what type it is */
 libspectrum_error
 libspectrum_snap_read( libspectrum_snap *snap, const libspectrum_byte *buffer,
@@ -324,11 +324,163 @@ const int LIBSPECTRUM_TAPE_FLAGS_LENGTH_LONG = 1 << 7; /* Long edge; used for
                                                           loader acceleration */
 const int LIBSPECTRUM_TAPE_FLAGS_TAPE       = 1 << 8; /* End of tape */
 
-libspectrum_error
-libspectrum_tape_get_next_edge_internal( libspectrum_dword *tstates,
-                                         int *flags,
-                                         libspectrum_tape *tape,
-                                         libspectrum_tape_block_state *it )
+/* Get the next edge from a block which doesn't depend on the rest of the
+   tape */
+static libspectrum_error
+block_edge( libspectrum_tape_block *block, libspectrum_tape_block_state *it,
+            libspectrum_dword *tstates, int *end_of_block, int *flags )
+{
+  switch( block->type ) {
+  case LIBSPECTRUM_TAPE_BLOCK_ROM:
+    return rom_edge( &(block->types.rom), &(it->block_state.rom), tstates,
+                     end_of_block, flags );
+  case LIBSPECTRUM_TAPE_BLOCK_TURBO:
+    return turbo_edge( &(block->types.turbo), &(it->block_state.turbo),
+                       tstates, end_of_block, flags );
+  case LIBSPECTRUM_TAPE_BLOCK_PURE_TONE:
+    return tone_edge( &(block->types.pure_tone), &(it->block_state.pure_tone),
+                      tstates, end_of_block );
+  case LIBSPECTRUM_TAPE_BLOCK_PULSES:
+    return pulses_edge( &(block->types.pulses), &(it->block_state.pulses),
+                        tstates, end_of_block );
+  case LIBSPECTRUM_TAPE_BLOCK_PURE_DATA:
+    return pure_data_edge( &(block->types.pure_data),
+                           &(it->block_state.pure_data), tstates,
+                           end_of_block, flags );
+  case LIBSPECTRUM_TAPE_BLOCK_RAW_DATA:
+    return raw_data_edge( &(block->types.raw_data),
+                          &(it->block_state.raw_data), tstates, end_of_block,
+                          flags );
+
+  case LIBSPECTRUM_TAPE_BLOCK_GENERALISED_DATA:
+    return generalised_data_edge( &(block->types.generalised_data),
+                                  &(it->block_state.generalised_data),
+                                  tstates, end_of_block, flags );
+
+  case LIBSPECTRUM_TAPE_BLOCK_PAUSE:
+    *tstates = block->types.pause.length_tstates; *end_of_block = 1;
+    /* If the pause isn't a "don't care" level then set the appropriate pulse
+       level */
+    if( block->types.pause.level != -1 &&
+        block->types.pause.length_tstates ) {
+      *flags |= block->types.pause.level ? LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH :
+                                           LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW;
+    }
+    /* 0 ms pause => stop tape */
+    if( *tstates == 0 ) { *flags |= LIBSPECTRUM_TAPE_FLAGS_STOP; }
+    return LIBSPECTRUM_ERROR_NONE;
+
+  case LIBSPECTRUM_TAPE_BLOCK_STOP48:
+    *tstates = 0; *flags |= LIBSPECTRUM_TAPE_FLAGS_STOP48; *end_of_block = 1;
+    return LIBSPECTRUM_ERROR_NONE;
+
+  case LIBSPECTRUM_TAPE_BLOCK_SET_SIGNAL_LEVEL:
+    *tstates = 0; *end_of_block = 1;
+    /* Inverted as the following block will flip the level before recording
+       the edge */
+    *flags |= block->types.set_signal_level.level ?
+        LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW : LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH;
+    return LIBSPECTRUM_ERROR_NONE;
+
+  /* For blocks which contain no Spectrum-readable data, return zero
+     tstates and set end of block set so we instantly get the next block */
+  case LIBSPECTRUM_TAPE_BLOCK_GROUP_START: 
+  case LIBSPECTRUM_TAPE_BLOCK_GROUP_END:
+  case LIBSPECTRUM_TAPE_BLOCK_SELECT:
+  case LIBSPECTRUM_TAPE_BLOCK_COMMENT:
+  case LIBSPECTRUM_TAPE_BLOCK_MESSAGE:
+  case LIBSPECTRUM_TAPE_BLOCK_ARCHIVE_INFO:
+  case LIBSPECTRUM_TAPE_BLOCK_HARDWARE:
+  case LIBSPECTRUM_TAPE_BLOCK_CUSTOM:
+    *tstates = 0; *flags |= LIBSPECTRUM_TAPE_FLAGS_NO_EDGE; *end_of_block = 1;
+    return LIBSPECTRUM_ERROR_NONE;
+
+  case LIBSPECTRUM_TAPE_BLOCK_RLE_PULSE:
+    return rle_pulse_edge( &(block->types.rle_pulse),
+                           &(it->block_state.rle_pulse), tstates,
+                           end_of_block );
+
+  case LIBSPECTRUM_TAPE_BLOCK_PULSE_SEQUENCE:
+    return pulse_sequence_edge( &(block->types.pulse_sequence),
+                                &(it->block_state.pulse_sequence), tstates,
+                                end_of_block, flags );
+
+  case LIBSPECTRUM_TAPE_BLOCK_DATA_BLOCK:
+    return data_block_edge( &(block->types.data_block),
+                            &(it->block_state.data_block), tstates,
+                            end_of_block, flags );
+
+  default:
+    *tstates = 0;
+    libspectrum_print_error(
+      LIBSPECTRUM_ERROR_LOGIC,
+      "libspectrum_tape_get_next_edge: unknown block type 0x%02x",
+      block->type
+    );
+    return LIBSPECTRUM_ERROR_LOGIC;
+  }
+}
+
+/* Walking the edge state machine for every edge of the generalised data
+   and CSW-style blocks is slow, so these are played back from the block's
+   edge runs instead. ROM, turbo and data blocks aren't, as their state can
+   be examined and changed while playing them */
+static int
+uses_edge_runs( libspectrum_tape_type type )
+{
+  switch( type ) {
+  case LIBSPECTRUM_TAPE_BLOCK_GENERALISED_DATA:
+  case LIBSPECTRUM_TAPE_BLOCK_RLE_PULSE:
+  case LIBSPECTRUM_TAPE_BLOCK_PULSE_SEQUENCE:
+  case LIBSPECTRUM_TAPE_BLOCK_DATA_BLOCK:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+/* Get up to `max' edges from the current run of a block, returning how
+   many in `count' */
+static libspectrum_error
+edge_run_edges( libspectrum_tape_block *block,
+                libspectrum_tape_block_state *it, libspectrum_dword *tstates,
+                size_t *count, size_t max, int *end_of_block, int *flags )
+{
+  const libspectrum_tape_edge_run *run;
+  size_t run_count;
+  libspectrum_error error;
+
+  error = libspectrum_tape_block_edges( block, &run, &run_count );
+  if( error ) return error;
+
+  if( it->edge_run >= run_count ) {
+    libspectrum_print_error( LIBSPECTRUM_ERROR_LOGIC,
+                             "%s: block played past its last edge",
+                             __func__ );
+    return LIBSPECTRUM_ERROR_LOGIC;
+  }
+
+  run += it->edge_run;
+
+  *count = run->count - it->edge_repeat;
+  if( *count > max ) *count = max;
+
+  *tstates = run->tstates;
+  *flags |= run->flags;
+
+  it->edge_repeat += *count;
+  if( it->edge_repeat == run->count ) {
+    it->edge_repeat = 0;
+    if( ++(it->edge_run) == run_count ) *end_of_block = 1;
+  }
+
+  return LIBSPECTRUM_ERROR_NONE;
+}
+
+static libspectrum_error
+get_next_edges( libspectrum_dword *tstates, size_t *count, size_t max,
+                int *flags, libspectrum_tape *tape,
+                libspectrum_tape_block_state *it )
 {
   int error;
 
@@ -344,59 +496,11 @@ libspectrum_tape_get_next_edge_internal( libspectrum_dword *tstates,
   /* Assume no special flags by default */
   *flags = 0;
 
+  /* and just the one edge */
+  *count = 1;
+
   if( block ) {
     switch( block->type ) {
-    case LIBSPECTRUM_TAPE_BLOCK_ROM:
-      error = rom_edge( &(block->types.rom), &(it->block_state.rom), tstates,
-                        &end_of_block, flags );
-      if( error ) return error;
-      break;
-    case LIBSPECTRUM_TAPE_BLOCK_TURBO:
-      error = turbo_edge( &(block->types.turbo), &(it->block_state.turbo), tstates,
-                          &end_of_block, flags );
-      if( error ) return error;
-      break;
-    case LIBSPECTRUM_TAPE_BLOCK_PURE_TONE:
-      error = tone_edge( &(block->types.pure_tone), &(it->block_state.pure_tone),
-                         tstates, &end_of_block );
-      if( error ) return error;
-      break;
-    case LIBSPECTRUM_TAPE_BLOCK_PULSES:
-      error = pulses_edge( &(block->types.pulses), &(it->block_state.pulses),
-                           tstates, &end_of_block );
-      if( error ) return error;
-      break;
-    case LIBSPECTRUM_TAPE_BLOCK_PURE_DATA:
-      error = pure_data_edge( &(block->types.pure_data),
-                              &(it->block_state.pure_data), tstates,
-			      &end_of_block, flags );
-      if( error ) return error;
-      break;
-    case LIBSPECTRUM_TAPE_BLOCK_RAW_DATA:
-      error = raw_data_edge( &(block->types.raw_data), &(it->block_state.raw_data),
-                             tstates, &end_of_block, flags );
-      if( error ) return error;
-      break;
-
-    case LIBSPECTRUM_TAPE_BLOCK_GENERALISED_DATA:
-      error = generalised_data_edge( &(block->types.generalised_data),
-                                     &(it->block_state.generalised_data),
-                                     tstates, &end_of_block, flags );
-      if( error ) return error;
-      break;
-
-    case LIBSPECTRUM_TAPE_BLOCK_PAUSE:
-      *tstates = block->types.pause.length_tstates; end_of_block = 1;
-      /* If the pause isn't a "don't care" level then set the appropriate pulse
-         level */
-      if( block->types.pause.level != -1 &&
-          block->types.pause.length_tstates ) {
-        *flags |= block->types.pause.level ? LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH :
-                                             LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW;
-      }
-      /* 0 ms pause => stop tape */
-      if( *tstates == 0 ) { *flags |= LIBSPECTRUM_TAPE_FLAGS_STOP; }
-      break;
 
     case LIBSPECTRUM_TAPE_BLOCK_JUMP:
       error = jump_blocks( tape, block->types.jump.offset );
@@ -425,59 +529,15 @@ libspectrum_tape_get_next_edge_internal( libspectrum_dword *tstates,
       *tstates = 0; *flags |= LIBSPECTRUM_TAPE_FLAGS_NO_EDGE; end_of_block = 1;
       break;
 
-    case LIBSPECTRUM_TAPE_BLOCK_STOP48:
-      *tstates = 0; *flags |= LIBSPECTRUM_TAPE_FLAGS_STOP48; end_of_block = 1;
-      break;
-
-    case LIBSPECTRUM_TAPE_BLOCK_SET_SIGNAL_LEVEL:
-      *tstates = 0; end_of_block = 1;
-      /* Inverted as the following block will flip the level before recording
-         the edge */
-      *flags |= block->types.set_signal_level.level ?
-          LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW : LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH;
-      break;
-
-    /* For blocks which contain no Spectrum-readable data, return zero
-       tstates and set end of block set so we instantly get the next block */
-    case LIBSPECTRUM_TAPE_BLOCK_GROUP_START: 
-    case LIBSPECTRUM_TAPE_BLOCK_GROUP_END:
-    case LIBSPECTRUM_TAPE_BLOCK_SELECT:
-    case LIBSPECTRUM_TAPE_BLOCK_COMMENT:
-    case LIBSPECTRUM_TAPE_BLOCK_MESSAGE:
-    case LIBSPECTRUM_TAPE_BLOCK_ARCHIVE_INFO:
-    case LIBSPECTRUM_TAPE_BLOCK_HARDWARE:
-    case LIBSPECTRUM_TAPE_BLOCK_CUSTOM:
-      *tstates = 0; *flags |= LIBSPECTRUM_TAPE_FLAGS_NO_EDGE; end_of_block = 1;
-      break;
-
-    case LIBSPECTRUM_TAPE_BLOCK_RLE_PULSE:
-      error = rle_pulse_edge( &(block->types.rle_pulse),
-                              &(it->block_state.rle_pulse), tstates, &end_of_block);
-      if( error ) return error;
-      break;
-
-    case LIBSPECTRUM_TAPE_BLOCK_PULSE_SEQUENCE:
-      error = pulse_sequence_edge( &(block->types.pulse_sequence),
-                                   &(it->block_state.pulse_sequence), tstates,
-                                   &end_of_block, flags );
-      if( error ) return error;
-      break;
-
-    case LIBSPECTRUM_TAPE_BLOCK_DATA_BLOCK:
-      error = data_block_edge( &(block->types.data_block),
-                               &(it->block_state.data_block), tstates,
-                               &end_of_block, flags );
+    default:
+      if( uses_edge_runs( block->type ) ) {
+        error = edge_run_edges( block, it, tstates, count, max, &end_of_block,
+                                flags );
+      } else {
+        error = block_edge( block, it, tstates, &end_of_block, flags );
+      }
       if( error ) return error;
       break;
-
-    default:
-      *tstates = 0;
-      libspectrum_print_error(
-        LIBSPECTRUM_ERROR_LOGIC,
-        "libspectrum_tape_get_next_edge: unknown block type 0x%02x",
-        block->type
-      );
-      return LIBSPECTRUM_ERROR_LOGIC;
     }
   } else {
     *tstates = 0;
@@ -517,6 +577,17 @@ libspectrum_tape_get_next_edge_internal( libspectrum_dword *tstates,
   return LIBSPECTRUM_ERROR_NONE;
 }
 
+libspectrum_error
+libspectrum_tape_get_next_edge_internal( libspectrum_dword *tstates,
+                                         int *flags,
+                                         libspectrum_tape *tape,
+                                         libspectrum_tape_block_state *it )
+{
+  size_t count;
+
+  return get_next_edges( tstates, &count, 1, flags, tape, it );
+}
+
 /* The main function: called with a tape object and returns the number of
    t-states until the next edge, and a marker if this was the last edge
    on the tape */
@@ -528,6 +599,100 @@ libspectrum_tape_get_next_edge( libspectrum_dword *tstates, int *flags,
                                                   &(tape->state) );
 }
 
+/* As libspectrum_tape_get_next_edge, but returns in `count' the number of
+   edges of `tstates' each with the same flags */
+libspectrum_error
+libspectrum_tape_get_next_edges( libspectrum_dword *tstates, size_t *count,
+                                 int *flags, libspectrum_tape *tape )
+{
+  return get_next_edges( tstates, count, (size_t)-1, flags, tape,
+                         &(tape->state) );
+}
+
+/* The longest run of edges which fits in a libspectrum_tape_edge_run */
+#define MAX_RUN_COUNT 0xffff
+
+static void
+add_edge( libspectrum_tape_block *block, size_t *allocated,
+          libspectrum_dword tstates, int flags )
+{
+  libspectrum_tape_edge_run *run;
+
+  if( block->edge_count ) {
+    run = &block->edges[ block->edge_count - 1 ];
+    if( run->tstates == tstates && run->flags == flags &&
+        run->count < MAX_RUN_COUNT ) {
+      run->count++;
+      return;
+    }
+  }
+
+  if( block->edge_count == *allocated ) {
+    *allocated = *allocated ? 2 * *allocated : 64;
+    block->edges = libspectrum_renew( libspectrum_tape_edge_run, block->edges,
+                                      *allocated );
+  }
+
+  run = &block->edges[ block->edge_count++ ];
+  run->tstates = tstates;
+  run->count = 1;
+  run->flags = flags;
+}
+
+/* Get all the edges of `block' as runs of identical edges. These are
+   worked out the first time they are asked for and kept with the block
+   until it is changed or freed */
+libspectrum_error
+libspectrum_tape_block_edges( libspectrum_tape_block *block,
+                              const libspectrum_tape_edge_run **runs,
+                              size_t *count )
+{
+  libspectrum_tape_block_state state;
+  libspectrum_dword tstates;
+  int end_of_block = 0, flags;
+  size_t allocated = 0;
+  libspectrum_error error;
+
+  if( !block->edges ) {
+
+    switch( block->type ) {
+    case LIBSPECTRUM_TAPE_BLOCK_JUMP:
+    case LIBSPECTRUM_TAPE_BLOCK_LOOP_START:
+    case LIBSPECTRUM_TAPE_BLOCK_LOOP_END:
+      libspectrum_print_error(
+        LIBSPECTRUM_ERROR_INVALID,
+        "%s: block type 0x%02x depends on the rest of the tape", __func__,
+        block->type
+      );
+      return LIBSPECTRUM_ERROR_INVALID;
+    default:
+      break;
+    }
+
+    error = libspectrum_tape_block_init( block, &state );
+    if( error ) return error;
+
+    while( !end_of_block ) {
+      flags = 0;
+      error = block_edge( block, &state, &tstates, &end_of_block, &flags );
+      if( error ) {
+        libspectrum_tape_block_free_edges( block );
+        return error;
+      }
+      if( end_of_block ) flags |= LIBSPECTRUM_TAPE_FLAGS_BLOCK;
+      add_edge( block, &allocated, tstates, flags );
+    }
+
+    block->edges = libspectrum_renew( libspectrum_tape_edge_run, block->edges,
+                                      block->edge_count );
+  }
+
+  *runs = block->edges;
+  *count = block->edge_count;
+
+  return LIBSPECTRUM_ERROR_NONE;
+}
+
 /* TZX pauses should have no edge if there is no duration, from the spec:
    A 'Pause' block of zero duration is completely ignored, so the 'current pulse
    level' will NOT change in this case. This also applies to 'Data' blocks that
@@ -1612,3 +1777,35 @@ libspectrum_tape_set_state( libspectrum_tape *tape, libspectrum_tape_state_type
 
   return LIBSPECTRUM_ERROR_NONE;
 }
+
+libspectrum_error
+libspectrum_tape_data_position( libspectrum_tape *tape, size_t *byte,
+                                size_t *bit )
+{
+  libspectrum_tape_block *block =
+    libspectrum_tape_iterator_current( tape->state.current_block );
+  switch( block->type ) {
+
+    case LIBSPECTRUM_TAPE_BLOCK_PURE_DATA:
+      *byte = tape->state.block_state.pure_data.bytes_through_block;
+      *bit = tape->state.block_state.pure_data.bits_through_byte;
+      break;
+    case LIBSPECTRUM_TAPE_BLOCK_ROM:
+      *byte = tape->state.block_state.rom.bytes_through_block;
+      *bit = tape->state.block_state.rom.bits_through_byte;
+      break;
+    case LIBSPECTRUM_TAPE_BLOCK_TURBO:
+      *byte = tape->state.block_state.turbo.bytes_through_block;
+      *bit = tape->state.block_state.turbo.bits_through_byte;
+      break;
+
+    default:
+      libspectrum_print_error(
+        LIBSPECTRUM_ERROR_INVALID,
+        "invalid current block type 0x%2x in tape given to %s", block->type, __func__
+      );
+      return LIBSPECTRUM_ERROR_INVALID;
+  }
+
+  return LIBSPECTRUM_ERROR_NONE;
+}
@@ -64,10 +64,21 @@ libspectrum_tape_block*
 libspectrum_tape_block_alloc( libspectrum_tape_type type )
 {
   libspectrum_tape_block *block = libspectrum_new( libspectrum_tape_block, 1 );
+  block->edges = NULL;
+  block->edge_count = 0;
   libspectrum_tape_block_set_type( block, type );
   return block;
 }
 
+/* Throw away the block's edge runs, as it has changed */
+void
+libspectrum_tape_block_free_edges( libspectrum_tape_block *block )
+{
+  libspectrum_free( block->edges );
+  block->edges = NULL;
+  block->edge_count = 0;
+}
+
 static void
 free_symbol_table( libspectrum_tape_generalised_data_symbol_table *table )
 {
@@ -191,6 +202,7 @@ libspectrum_tape_block_free( libspectrum_tape_block *block )
     return LIBSPECTRUM_ERROR_LOGIC;
   }
 
+  libspectrum_tape_block_free_edges( block );
   libspectrum_free( block );
 
   return LIBSPECTRUM_ERROR_NONE;
@@ -206,6 +218,7 @@ libspectrum_error
 libspectrum_tape_block_set_type( libspectrum_tape_block *block,
 				 libspectrum_tape_type type )
 {
+  libspectrum_tape_block_free_edges( block );
   block->type = type;
   return LIBSPECTRUM_ERROR_NONE;
 }
@@ -217,6 +230,9 @@ libspectrum_tape_block_init( libspectrum_tape_block *block,
 {
   if( !block ) return LIBSPECTRUM_ERROR_NONE;
 
+  state->edge_run = 0;
+  state->edge_repeat = 0;
+
   switch( libspectrum_tape_block_type( block ) ) {
 
   case LIBSPECTRUM_TAPE_BLOCK_ROM:
@@ -468,6 +468,11 @@ struct libspectrum_tape_block {
 
   } types;
 
+  /* The block's edges as runs of identical edges; NULL until they are
+     first asked for */
+  libspectrum_tape_edge_run *edges;
+  size_t edge_count;
+
 };
 
 struct libspectrum_tape_block_state {
@@ -480,6 +485,11 @@ struct libspectrum_tape_block_state {
   GSList* loop_block;
   size_t loop_count;
 
+  /* How far through the edge runs of the current block we are, for those
+     blocks played from their edge runs */
+  size_t edge_run;
+  size_t edge_repeat;
+
   union {
     libspectrum_tape_rom_block_state rom;
     libspectrum_tape_turbo_block_state turbo;
@@ -497,6 +507,8 @@ struct libspectrum_tape_block_state {
 };
 
 /* Functions needed by both tape.c and tape_block.c */
+void
+libspectrum_tape_block_free_edges( libspectrum_tape_block *block );
 libspectrum_error
 libspectrum_tape_pure_data_next_bit( libspectrum_tape_pure_data_block *block,
                              libspectrum_tape_pure_data_block_state *state );
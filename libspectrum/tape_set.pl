@@ -105,7 +105,8 @@ while( <> ) {
 
 	printf "libspectrum_error\nlibspectrum_tape_block_set_$name( libspectrum_tape_block *block, $type %s$name",
             ( $indexed ? "*" : "" );
-	print " )\n{\n  switch( block->type ) {\n\n";
+	print " )\n{\n  libspectrum_tape_block_free_edges( block );\n\n";
+	print "  switch( block->type ) {\n\n";
 
         $started = 1;
     }
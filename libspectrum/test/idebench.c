@@ -0,0 +1,387 @@
+/* idebench.c: Benchmark for replaying IDE accesses against an HDF file
+   Copyright (c) 2026 Fuse contributors
+
+   $Id$
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+   Author contact information:
+
+   E-mail: philip-fuse@shadowmagic.org.uk
+
+*/
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libspectrum.h"
+
+/* Replays a trace of sector reads and writes through an IDE channel, once
+   a sector per command and once with READ/WRITE MULTIPLE, and compares
+   these with seeking and reading each sector straight from the file as
+   the IDE code used to. The trace is either read from a file with one
+   access per line
+
+     r <first sector> <count>
+     w <first sector> <count>
+
+   or made up to look like a DOS scanning directories and loading files.
+   Writes are never committed, so an existing HDF file can safely be used */
+
+#define CYLINDERS 256
+#define HEADS 16
+#define SECTORS 16
+
+#define DEFAULT_FILENAME "idebench.hdf"
+
+#define MULTIPLE 16
+
+typedef struct access_t {
+  int write;
+  long sector;
+  int count;
+} access_t;
+
+static const char *progname;
+
+static access_t *trace;
+static size_t trace_length, trace_allocated;
+
+static long disk_sectors;
+
+static void
+add_access( int write, long sector, int count )
+{
+  if( sector < 0 || count < 1 ) return;
+  if( sector + count > disk_sectors ) return;
+
+  if( trace_length == trace_allocated ) {
+    trace_allocated = trace_allocated ? 2 * trace_allocated : 1024;
+    trace = libspectrum_renew( access_t, trace, trace_allocated );
+  }
+
+  trace[ trace_length ].write = write;
+  trace[ trace_length ].sector = sector;
+  trace[ trace_length ].count = count;
+  trace_length++;
+}
+
+static unsigned long seed = 1;
+
+static unsigned long
+random_number( unsigned long limit )
+{
+  seed = seed * 1103515245 + 12345;
+  return ( ( seed >> 16 ) & 0x7fff ) % limit;
+}
+
+/* Directory scans read the FAT and directory a sector at a time, file loads
+   read runs of sectors and saves write them */
+static void
+make_trace( void )
+{
+  long fat = 32, directory = 544, data = 1024, sector;
+  int i, j, length;
+
+  for( i = 0; i < 200; i++ ) {
+
+    for( j = 0; j < 16; j++ ) add_access( 0, fat + j, 1 );
+    for( j = 0; j < 32; j++ ) add_access( 0, directory + j, 1 );
+
+    sector = data + random_number( disk_sectors - data - 256 );
+    length = 16 + random_number( 240 );
+
+    if( random_number( 8 ) ) {
+      for( j = 0; j < length; j += 4 ) add_access( 0, sector + j, 4 );
+    } else {
+      add_access( 1, fat + random_number( 16 ), 1 );
+      add_access( 1, directory + random_number( 32 ), 1 );
+      add_access( 1, sector, length );
+    }
+
+  }
+}
+
+static int
+read_trace( const char *filename )
+{
+  FILE *f;
+  char type;
+  long sector;
+  int count;
+
+  f = fopen( filename, "r" );
+  if( !f ) {
+    fprintf( stderr, "%s: couldn't open `%s'\n", progname, filename );
+    return 1;
+  }
+
+  while( fscanf( f, " %c %ld %d", &type, &sector, &count ) == 3 )
+    add_access( type == 'w', sector, count );
+
+  fclose( f );
+
+  return 0;
+}
+
+static int
+create_hdf( const char *filename )
+{
+  libspectrum_byte header[ 0x80 ], sector[ 512 ];
+  FILE *f;
+  long i;
+
+  memset( header, 0, sizeof( header ) );
+  memcpy( header, "RS-IDE", 6 );
+  header[ 0x06 ] = 0x1a;
+  header[ 0x07 ] = 0x11;
+  header[ 0x09 ] = 0x80;
+  header[ 0x16 + 2 ] = CYLINDERS & 0xff; header[ 0x16 + 3 ] = CYLINDERS >> 8;
+  header[ 0x16 + 6 ] = HEADS;
+  header[ 0x16 + 12 ] = SECTORS;
+  header[ 0x16 + 99 ] = 0x02;		/* LBA supported */
+
+  f = fopen( filename, "wb" );
+  if( !f ) {
+    fprintf( stderr, "%s: couldn't create `%s'\n", progname, filename );
+    return 1;
+  }
+
+  fwrite( header, 1, sizeof( header ), f );
+  for( i = 0; i < CYLINDERS * HEADS * SECTORS; i++ ) {
+    memset( sector, i & 0xff, 512 );
+    fwrite( sector, 1, 512, f );
+  }
+
+  if( fclose( f ) ) {
+    fprintf( stderr, "%s: couldn't write `%s'\n", progname, filename );
+    return 1;
+  }
+
+  return 0;
+}
+
+/* Get the number of sectors and the data offset from the HDF header */
+static int
+read_geometry( const char *filename, long *offset )
+{
+  libspectrum_byte header[ 0x80 ];
+  FILE *f;
+
+  f = fopen( filename, "rb" );
+  if( !f || fread( header, 1, sizeof( header ), f ) != sizeof( header ) ) {
+    fprintf( stderr, "%s: couldn't read `%s'\n", progname, filename );
+    if( f ) fclose( f );
+    return 1;
+  }
+  fclose( f );
+
+  *offset = header[ 0x09 ] | ( header[ 0x0a ] << 8 );
+  disk_sectors = (long)( header[ 0x18 ] | ( header[ 0x19 ] << 8 ) ) *
+                 ( header[ 0x1c ] | ( header[ 0x1d ] << 8 ) ) *
+                 ( header[ 0x22 ] | ( header[ 0x23 ] << 8 ) );
+
+  return 0;
+}
+
+static void
+command( libspectrum_ide_channel *chn, libspectrum_byte code, long sector,
+         int count )
+{
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_HEAD_DRIVE,
+                         0xe0 | ( ( sector >> 24 ) & 0x0f ) );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_CYLINDER_HIGH,
+                         ( sector >> 16 ) & 0xff );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_CYLINDER_LOW,
+                         ( sector >> 8 ) & 0xff );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_SECTOR, sector & 0xff );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_SECTOR_COUNT, count );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_COMMAND_STATUS, code );
+}
+
+/* Transfer all the data for the current command; returns the number of
+   bytes moved, or -1 if the drive reported an error */
+static long
+transfer( libspectrum_ide_channel *chn, int write, libspectrum_dword *sum )
+{
+  libspectrum_byte status;
+  long bytes = 0;
+  int i;
+
+  while( 1 ) {
+    status = libspectrum_ide_read( chn,
+                                   LIBSPECTRUM_IDE_REGISTER_COMMAND_STATUS );
+    if( status & 0x01 ) return -1;
+    if( !( status & 0x08 ) ) return bytes;
+
+    for( i = 0; i < 512; i++ ) {
+      if( write ) {
+        libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_DATA, i );
+      } else {
+        *sum += libspectrum_ide_read( chn, LIBSPECTRUM_IDE_REGISTER_DATA );
+      }
+    }
+    bytes += 512;
+  }
+}
+
+static double
+replay_ide( const char *filename, int multiple, libspectrum_dword *sum )
+{
+  libspectrum_ide_channel *chn;
+  clock_t start;
+  size_t i;
+  long bytes;
+  access_t *access;
+
+  chn = libspectrum_ide_alloc( LIBSPECTRUM_IDE_DATA16 );
+  if( libspectrum_ide_insert( chn, LIBSPECTRUM_IDE_MASTER, filename ) ) {
+    libspectrum_ide_free( chn );
+    return -1;
+  }
+  libspectrum_ide_reset( chn );
+
+  if( multiple ) command( chn, 0xc6, 0, MULTIPLE );
+
+  *sum = 0;
+  start = clock();
+
+  for( i = 0, access = trace; i < trace_length; i++, access++ ) {
+    if( access->write ) {
+      command( chn, multiple ? 0xc5 : 0x30, access->sector, access->count );
+    } else {
+      command( chn, multiple ? 0xc4 : 0x20, access->sector, access->count );
+    }
+    bytes = transfer( chn, access->write, sum );
+    if( bytes != access->count * 512 ) {
+      fprintf( stderr, "%s: access to sector %ld failed\n", progname,
+               access->sector );
+      libspectrum_ide_free( chn );
+      return -1;
+    }
+  }
+
+  start = clock() - start;
+
+  libspectrum_ide_free( chn );
+
+  return (double)start / CLOCKS_PER_SEC;
+}
+
+/* What the IDE code used to do for each sector, less the emulation of the
+   data register */
+static double
+replay_direct( const char *filename, long offset )
+{
+  libspectrum_byte buffer[ 512 ];
+  FILE *f;
+  clock_t start;
+  size_t i;
+  int j;
+  access_t *access;
+
+  f = fopen( filename, "rb" );
+  if( !f ) return -1;
+
+  start = clock();
+
+  for( i = 0, access = trace; i < trace_length; i++, access++ ) {
+    if( access->write ) continue;
+    for( j = 0; j < access->count; j++ ) {
+      if( fseek( f, offset + ( access->sector + j ) * 512, SEEK_SET ) ||
+          fread( buffer, 1, 512, f ) != 512 ) {
+        fclose( f );
+        return -1;
+      }
+    }
+  }
+
+  start = clock() - start;
+
+  fclose( f );
+
+  return (double)start / CLOCKS_PER_SEC;
+}
+
+int
+main( int argc, char **argv )
+{
+  const char *filename = DEFAULT_FILENAME;
+  libspectrum_dword single_sum, multiple_sum;
+  double direct_time, single_time, multiple_time;
+  long offset, sectors = 0, read_sectors = 0;
+  size_t i;
+  int created = 0;
+
+  progname = argv[0];
+
+  if( libspectrum_init() ) return 1;
+
+  if( argc > 1 ) {
+    filename = argv[1];
+  } else {
+    if( create_hdf( filename ) ) return 1;
+    created = 1;
+  }
+
+  if( read_geometry( filename, &offset ) ) return 1;
+
+  if( argc > 2 ) {
+    if( read_trace( argv[2] ) ) return 1;
+  } else {
+    make_trace();
+  }
+
+  if( !trace_length ) {
+    fprintf( stderr, "Usage: %s [<hdf file> [<trace file>]]\n", progname );
+    return 1;
+  }
+
+  for( i = 0; i < trace_length; i++ ) {
+    sectors += trace[i].count;
+    if( !trace[i].write ) read_sectors += trace[i].count;
+  }
+
+  direct_time = replay_direct( filename, offset );
+  single_time = replay_ide( filename, 0, &single_sum );
+  multiple_time = replay_ide( filename, 1, &multiple_sum );
+
+  if( created ) remove( filename );
+
+  if( direct_time < 0 || single_time < 0 || multiple_time < 0 ) return 1;
+
+  if( single_sum != multiple_sum ) {
+    fprintf( stderr, "%s: READ SECTORS and READ MULTIPLE data differ\n",
+             progname );
+    return 1;
+  }
+
+  printf( "%lu accesses, %ld sectors\n", (unsigned long)trace_length,
+          sectors );
+  printf( "seek and read:  %8.3f s  %6.2f us/sector (reads only)\n",
+          direct_time, direct_time * 1e6 / read_sectors );
+  printf( "READ SECTORS:   %8.3f s  %6.2f us/sector\n",
+          single_time, single_time * 1e6 / sectors );
+  printf( "READ MULTIPLE:  %8.3f s  %6.2f us/sector\n",
+          multiple_time, multiple_time * 1e6 / sectors );
+
+  libspectrum_free( trace );
+
+  return 0;
+}
@@ -733,6 +733,201 @@ test_27( void )
   return r;
 }
 
+/* The position through a block's data is that of the bit being played */
+static test_return_t
+test_32( void )
+{
+  libspectrum_tape *tape;
+  libspectrum_tape_block *block;
+  libspectrum_tape_state_type state;
+  libspectrum_byte *data;
+  libspectrum_dword tstates;
+  size_t byte, bit, data_edges = 0;
+  int flags;
+
+  tape = libspectrum_tape_alloc();
+
+  block = libspectrum_tape_block_alloc( LIBSPECTRUM_TAPE_BLOCK_ROM );
+  data = libspectrum_new( libspectrum_byte, 3 );
+  data[0] = 0xff; data[1] = 0x80; data[2] = 0x7f;
+  libspectrum_tape_block_set_data_length( block, 3 );
+  libspectrum_tape_block_set_data( block, data );
+  libspectrum_tape_block_set_pause( block, 1000 );
+  libspectrum_tape_append_block( tape, block );
+
+  if( libspectrum_tape_nth_block( tape, 0 ) ) {
+    libspectrum_tape_free( tape );
+    return TEST_INCOMPLETE;
+  }
+
+  while( 1 ) {
+
+    state = libspectrum_tape_state( tape );
+    if( state == LIBSPECTRUM_TAPE_STATE_PAUSE ) break;
+
+    if( state == LIBSPECTRUM_TAPE_STATE_DATA1 ||
+        state == LIBSPECTRUM_TAPE_STATE_DATA2 ) {
+      libspectrum_tape_data_position( tape, &byte, &bit );
+      if( byte != data_edges / 16 || bit != ( data_edges / 2 ) % 8 ) {
+        fprintf( stderr,
+                 "%s: after %lu data edges, position is byte %lu bit %lu\n",
+                 progname, (unsigned long)data_edges, (unsigned long)byte,
+                 (unsigned long)bit );
+        libspectrum_tape_free( tape );
+        return TEST_FAIL;
+      }
+    }
+
+    if( libspectrum_tape_get_next_edge( &tstates, &flags, tape ) ) {
+      libspectrum_tape_free( tape );
+      return TEST_INCOMPLETE;
+    }
+
+    if( state == LIBSPECTRUM_TAPE_STATE_DATA1 ||
+        state == LIBSPECTRUM_TAPE_STATE_DATA2 ) data_edges++;
+  }
+
+  libspectrum_tape_free( tape );
+
+  if( data_edges != 3 * 16 ) {
+    fprintf( stderr, "%s: block had %lu data edges, not the expected 48\n",
+             progname, (unsigned long)data_edges );
+    return TEST_FAIL;
+  }
+
+  return TEST_PASS;
+}
+
+static test_return_t
+check_edge_run( libspectrum_tape *tape, libspectrum_dword expected_tstates,
+             size_t expected_count, int expected_flags )
+{
+  libspectrum_dword tstates;
+  size_t count;
+  int flags;
+
+  if( libspectrum_tape_get_next_edges( &tstates, &count, &flags, tape ) )
+    return TEST_INCOMPLETE;
+
+  if( tstates != expected_tstates || count != expected_count ||
+      flags != expected_flags ) {
+    fprintf( stderr,
+             "%s: got %lu edges of %lu tstates with flags 0x%02x, not %lu "
+             "of %lu with 0x%02x\n", progname, (unsigned long)count,
+             (unsigned long)tstates, flags, (unsigned long)expected_count,
+             (unsigned long)expected_tstates, expected_flags );
+    return TEST_FAIL;
+  }
+
+  return TEST_PASS;
+}
+
+/* Edge runs from a CSW block */
+static test_return_t
+test_33( void )
+{
+  libspectrum_byte csw[] = { 3, 3, 3, 3, 0, 0x10, 0x27, 0, 0, 7 };
+  libspectrum_tape *tape;
+  libspectrum_tape_block *block;
+  const libspectrum_tape_edge_run *runs;
+  libspectrum_byte *data;
+  libspectrum_dword tstates;
+  size_t count;
+  int flags, end = LIBSPECTRUM_TAPE_FLAGS_BLOCK | LIBSPECTRUM_TAPE_FLAGS_STOP |
+                   LIBSPECTRUM_TAPE_FLAGS_TAPE;
+  test_return_t r = TEST_INCOMPLETE;
+
+  tape = libspectrum_tape_alloc();
+
+  block = libspectrum_tape_block_alloc( LIBSPECTRUM_TAPE_BLOCK_RLE_PULSE );
+  data = libspectrum_new( libspectrum_byte, sizeof( csw ) );
+  memcpy( data, csw, sizeof( csw ) );
+  libspectrum_tape_block_set_scale( block, 100 );
+  libspectrum_tape_block_set_data_length( block, sizeof( csw ) );
+  libspectrum_tape_block_set_data( block, data );
+  libspectrum_tape_append_block( tape, block );
+
+  if( libspectrum_tape_block_edges( block, &runs, &count ) ) goto end;
+
+  if( count != 3 ||
+      runs[0].tstates != 300 || runs[0].count != 4 || runs[0].flags ||
+      runs[1].tstates != 1000000 || runs[1].count != 1 || runs[1].flags ||
+      runs[2].tstates != 700 || runs[2].count != 1 ||
+      runs[2].flags != LIBSPECTRUM_TAPE_FLAGS_BLOCK ) {
+    fprintf( stderr, "%s: CSW block gave the wrong edge runs\n", progname );
+    r = TEST_FAIL;
+    goto end;
+  }
+
+  if( libspectrum_tape_nth_block( tape, 0 ) ) goto end;
+
+  if( ( r = check_edge_run( tape, 300, 4, 0 ) ) ||
+      ( r = check_edge_run( tape, 1000000, 1, 0 ) ) ||
+      ( r = check_edge_run( tape, 700, 1, end ) ) ) goto end;
+
+  /* Single edges can be mixed with runs */
+  r = TEST_INCOMPLETE;
+  if( libspectrum_tape_get_next_edge( &tstates, &flags, tape ) ) goto end;
+  if( ( r = check_edge_run( tape, 300, 3, 0 ) ) ) goto end;
+
+  /* and changing the block changes its edges */
+  libspectrum_free( libspectrum_tape_block_data( block ) );
+  data = libspectrum_new( libspectrum_byte, 1 );
+  data[0] = 9;
+  libspectrum_tape_block_set_data_length( block, 1 );
+  libspectrum_tape_block_set_data( block, data );
+
+  r = TEST_INCOMPLETE;
+  if( libspectrum_tape_nth_block( tape, 0 ) ) goto end;
+  r = check_edge_run( tape, 900, 1, end );
+
+end:
+  libspectrum_tape_free( tape );
+
+  return r;
+}
+
+/* The memory held in a snapshot is counted */
+static test_return_t
+test_34( void )
+{
+  libspectrum_snap *snap;
+  libspectrum_byte *rom;
+  size_t size;
+
+  snap = libspectrum_snap_alloc();
+
+  if( libspectrum_snap_memory_size( snap ) ) {
+    fprintf( stderr, "%s: empty snapshot holds %lu bytes\n", progname,
+             (unsigned long)libspectrum_snap_memory_size( snap ) );
+    libspectrum_snap_free( snap );
+    return TEST_FAIL;
+  }
+
+  libspectrum_snap_set_pages( snap, 5,
+                              libspectrum_new0( libspectrum_byte, 0x4000 ) );
+  libspectrum_snap_set_zxcf_ram( snap, 3,
+                                 libspectrum_new0( libspectrum_byte, 0x4000 ) );
+  libspectrum_snap_set_beta_rom( snap, 0,
+                                 libspectrum_new0( libspectrum_byte, 0x4000 ) );
+
+  rom = libspectrum_new0( libspectrum_byte, 0x2000 );
+  libspectrum_snap_set_interface1_rom( snap, 0, rom );
+  libspectrum_snap_set_interface1_rom_length( snap, 0, 0x2000 );
+
+  size = libspectrum_snap_memory_size( snap );
+  libspectrum_snap_free( snap );
+
+  if( size != 3 * 0x4000 + 0x2000 ) {
+    fprintf( stderr, "%s: snapshot holds %lu bytes, not the expected %lu\n",
+             progname, (unsigned long)size,
+             (unsigned long)( 3 * 0x4000 + 0x2000 ) );
+    return TEST_FAIL;
+  }
+
+  return TEST_PASS;
+}
+
 struct test_description {
 
   test_fn test;
@@ -771,6 +966,11 @@ static struct test_description tests[] = {
   { test_27, "Reading old SZX file", 0 },
   { test_28, "Zero tail length PZX file", 0 },
   { test_29, "No pilot pulse GDB TZX file", 0 },
+  { test_30, "IDE READ/WRITE MULTIPLE", 0 },
+  { test_31, "Committing IDE writes through a function", 0 },
+  { test_32, "Tape data position", 0 },
+  { test_33, "Tape edge runs", 0 },
+  { test_34, "Snapshot memory size", 0 },
 };
 
 static size_t test_count = ARRAY_SIZE( tests );
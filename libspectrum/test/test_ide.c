@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+#define CYLINDERS 64
+#define HEADS 4
+#define SECTORS 32
+
+#define HDF_FILENAME DYNAMIC_TEST_PATH( "ide.hdf" )
+
+static libspectrum_byte
+pattern( int sector, int offset, int generation )
+{
+  return ( sector * 7 + offset + generation * 13 ) & 0xff;
+}
+
+static int
+create_hdf( const char *filename )
+{
+  libspectrum_byte header[ 0x80 ], sector[ 512 ];
+  FILE *f;
+  int i, j;
+
+  memset( header, 0, sizeof( header ) );
+  memcpy( header, "RS-IDE", 6 );
+  header[ 0x06 ] = 0x1a;		/* ID */
+  header[ 0x07 ] = 0x11;		/* Revision */
+  header[ 0x09 ] = 0x80;		/* Data offset */
+
+  /* Drive identity, word 1: cylinders, 3: heads, 6: sectors,
+     49: capabilities (LBA supported) */
+  header[ 0x16 + 2 ] = CYLINDERS;
+  header[ 0x16 + 6 ] = HEADS;
+  header[ 0x16 + 12 ] = SECTORS;
+  header[ 0x16 + 99 ] = 0x02;
+
+  f = fopen( filename, "wb" );
+  if( !f ) {
+    fprintf( stderr, "%s: couldn't create `%s'\n", progname, filename );
+    return 1;
+  }
+
+  fwrite( header, 1, sizeof( header ), f );
+  for( i = 0; i < CYLINDERS * HEADS * SECTORS; i++ ) {
+    for( j = 0; j < 512; j++ ) sector[j] = pattern( i, j, 0 );
+    fwrite( sector, 1, 512, f );
+  }
+
+  if( fclose( f ) ) {
+    fprintf( stderr, "%s: couldn't write `%s'\n", progname, filename );
+    return 1;
+  }
+
+  return 0;
+}
+
+/* Read a sector's worth of data directly from the file on disk */
+static int
+read_from_file( const char *filename, int sector, libspectrum_byte *buffer )
+{
+  FILE *f;
+  size_t length;
+
+  f = fopen( filename, "rb" );
+  if( !f ) return 1;
+
+  if( fseek( f, 0x80 + sector * 512, SEEK_SET ) ) { fclose( f ); return 1; }
+  length = fread( buffer, 1, 512, f );
+  fclose( f );
+
+  return length != 512;
+}
+
+static void
+command( libspectrum_ide_channel *chn, libspectrum_byte code, int lba,
+	 int count )
+{
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_HEAD_DRIVE,
+			 0xe0 | ( ( lba >> 24 ) & 0x0f ) );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_CYLINDER_HIGH,
+			 ( lba >> 16 ) & 0xff );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_CYLINDER_LOW,
+			 ( lba >> 8 ) & 0xff );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_SECTOR, lba & 0xff );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_SECTOR_COUNT, count );
+  libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_COMMAND_STATUS, code );
+}
+
+static int
+status( libspectrum_ide_channel *chn )
+{
+  return libspectrum_ide_read( chn, LIBSPECTRUM_IDE_REGISTER_COMMAND_STATUS );
+}
+
+/* Read count sectors starting at lba, checking they hold the pattern for
+   the given generation */
+static test_return_t
+check_read( libspectrum_ide_channel *chn, libspectrum_byte code, int lba,
+	    int count, int generation )
+{
+  int i, j;
+  libspectrum_byte data;
+
+  command( chn, code, lba, count );
+
+  for( i = 0; i < count; i++ ) {
+
+    if( !( status( chn ) & 0x08 ) || ( status( chn ) & 0x01 ) ) {
+      fprintf( stderr, "%s: no data for sector %d (status 0x%02x)\n",
+	       progname, lba + i, status( chn ) );
+      return TEST_FAIL;
+    }
+
+    for( j = 0; j < 512; j++ ) {
+      data = libspectrum_ide_read( chn, LIBSPECTRUM_IDE_REGISTER_DATA );
+      if( data != pattern( lba + i, j, generation ) ) {
+	fprintf( stderr,
+		 "%s: sector %d byte %d is 0x%02x, not the expected 0x%02x\n",
+		 progname, lba + i, j, data, pattern( lba + i, j, generation ) );
+	return TEST_FAIL;
+      }
+    }
+  }
+
+  if( status( chn ) & 0x09 ) {
+    fprintf( stderr, "%s: read of %d sectors at %d left status 0x%02x\n",
+	     progname, count, lba, status( chn ) );
+    return TEST_FAIL;
+  }
+
+  return TEST_PASS;
+}
+
+static test_return_t
+ide_multiple( libspectrum_ide_channel *chn )
+{
+  libspectrum_byte buffer[ 512 ];
+  test_return_t r;
+  int i, j, word;
+
+  /* READ MULTIPLE isn't allowed until multiple mode is set */
+  command( chn, 0xc4, 0, 1 );
+  if( !( status( chn ) & 0x01 ) ) {
+    fprintf( stderr, "%s: READ MULTIPLE accepted with multiple mode off\n",
+	     progname );
+    return TEST_FAIL;
+  }
+
+  /* SET MULTIPLE MODE to 8 sectors, and check IDENTIFY reports it */
+  command( chn, 0xc6, 0, 8 );
+  if( status( chn ) & 0x01 ) {
+    fprintf( stderr, "%s: SET MULTIPLE MODE failed\n", progname );
+    return TEST_FAIL;
+  }
+
+  command( chn, 0xec, 0, 0 );
+  for( i = 0; i < 256; i++ ) {
+    word = libspectrum_ide_read( chn, LIBSPECTRUM_IDE_REGISTER_DATA );
+    word |= libspectrum_ide_read( chn, LIBSPECTRUM_IDE_REGISTER_DATA ) << 8;
+    if( i == 59 && word != 0x0108 ) {
+      fprintf( stderr, "%s: IDENTIFY word 59 is 0x%04x, not 0x0108\n",
+	       progname, word );
+      return TEST_FAIL;
+    }
+  }
+
+  /* Reads which end on, before and after a block boundary, across a read
+     cache block and at the end of the disk */
+  r = check_read( chn, 0xc4, 100, 16, 0 ); if( r ) return r;
+  r = check_read( chn, 0xc4, 60, 13, 0 ); if( r ) return r;
+  r = check_read( chn, 0x20, 120, 20, 0 ); if( r ) return r;
+  r = check_read( chn, 0xc4, CYLINDERS * HEADS * SECTORS - 3, 3, 0 );
+  if( r ) return r;
+
+  /* WRITE MULTIPLE of a partial last block */
+  command( chn, 0xc5, 1000, 11 );
+  for( i = 0; i < 11; i++ ) {
+    if( !( status( chn ) & 0x08 ) ) {
+      fprintf( stderr, "%s: no DRQ for written sector %d\n", progname,
+	       1000 + i );
+      return TEST_FAIL;
+    }
+    for( j = 0; j < 512; j++ )
+      libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_DATA,
+			     pattern( 1000 + i, j, 1 ) );
+  }
+  if( status( chn ) & 0x09 ) {
+    fprintf( stderr, "%s: write left status 0x%02x\n", progname,
+	     status( chn ) );
+    return TEST_FAIL;
+  }
+
+  r = check_read( chn, 0x20, 1000, 11, 1 ); if( r ) return r;
+  r = check_read( chn, 0xc4, 1011, 1, 0 ); if( r ) return r;
+
+  /* The image on disk is untouched until the writes are committed */
+  if( read_from_file( HDF_FILENAME, 1005, buffer ) ) return TEST_INCOMPLETE;
+  if( buffer[0] != pattern( 1005, 0, 0 ) ) {
+    fprintf( stderr, "%s: image written before commit\n", progname );
+    return TEST_FAIL;
+  }
+
+  libspectrum_ide_commit( chn, LIBSPECTRUM_IDE_MASTER );
+
+  if( read_from_file( HDF_FILENAME, 1005, buffer ) ) return TEST_INCOMPLETE;
+  if( buffer[0] != pattern( 1005, 0, 1 ) ) {
+    fprintf( stderr, "%s: image not written by commit\n", progname );
+    return TEST_FAIL;
+  }
+
+  r = check_read( chn, 0xc4, 996, 4, 0 ); if( r ) return r;
+  return check_read( chn, 0xc4, 1000, 11, 1 );
+}
+
+/* READ/WRITE MULTIPLE and the read cache */
+test_return_t
+test_30( void )
+{
+  libspectrum_ide_channel *chn;
+  test_return_t r;
+
+  if( create_hdf( HDF_FILENAME ) ) return TEST_INCOMPLETE;
+
+  chn = libspectrum_ide_alloc( LIBSPECTRUM_IDE_DATA16 );
+
+  if( libspectrum_ide_insert( chn, LIBSPECTRUM_IDE_MASTER, HDF_FILENAME ) ) {
+    libspectrum_ide_free( chn );
+    remove( HDF_FILENAME );
+    return TEST_INCOMPLETE;
+  }
+  libspectrum_ide_reset( chn );
+
+  r = ide_multiple( chn );
+
+  libspectrum_ide_free( chn );
+  remove( HDF_FILENAME );
+
+  return r;
+}
+
+typedef struct commit_record {
+  int count;
+  long first_offset;
+  int wrong_data;
+} commit_record;
+
+static void
+record_write( long offset, const libspectrum_byte *data, size_t length,
+	      void *context )
+{
+  commit_record *record = context;
+  int sector = ( offset - 0x80 ) / 512;
+  size_t i;
+
+  if( !record->count || offset < record->first_offset )
+    record->first_offset = offset;
+  record->count++;
+
+  for( i = 0; i < length; i++ )
+    if( data[i] != pattern( sector, i, 2 ) ) record->wrong_data = 1;
+}
+
+static test_return_t
+ide_commit_to( libspectrum_ide_channel *chn )
+{
+  commit_record record = { 0, 0, 0 };
+  test_return_t r;
+  int i;
+
+  command( chn, 0x30, 2000, 3 );
+  for( i = 0; i < 3 * 512; i++ )
+    libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_DATA,
+			   pattern( 2000 + i / 512, i % 512, 2 ) );
+
+  if( !libspectrum_ide_dirty( chn, LIBSPECTRUM_IDE_MASTER ) ) {
+    fprintf( stderr, "%s: drive not dirty after writing\n", progname );
+    return TEST_FAIL;
+  }
+
+  libspectrum_ide_commit_to( chn, LIBSPECTRUM_IDE_MASTER, record_write,
+			     &record );
+
+  if( record.count != 3 || record.first_offset != 0x80 + 2000 * 512 ||
+      record.wrong_data ) {
+    fprintf( stderr, "%s: commit passed on %d sectors from offset %ld\n",
+	     progname, record.count, record.first_offset );
+    return TEST_FAIL;
+  }
+
+  if( libspectrum_ide_dirty( chn, LIBSPECTRUM_IDE_MASTER ) ) {
+    fprintf( stderr, "%s: drive still dirty after commit\n", progname );
+    return TEST_FAIL;
+  }
+
+  /* Nothing has been written to the file, but the data is still there */
+  r = check_read( chn, 0x20, 2000, 3, 2 ); if( r ) return r;
+
+  /* and isn't passed on again */
+  record.count = 0;
+  libspectrum_ide_commit_to( chn, LIBSPECTRUM_IDE_MASTER, record_write,
+			     &record );
+  if( record.count ) {
+    fprintf( stderr, "%s: clean sectors committed again\n", progname );
+    return TEST_FAIL;
+  }
+
+  /* unless writing them failed, when they must be passed on again */
+  libspectrum_ide_mark_dirty( chn, LIBSPECTRUM_IDE_MASTER );
+  if( !libspectrum_ide_dirty( chn, LIBSPECTRUM_IDE_MASTER ) ) {
+    fprintf( stderr, "%s: drive not dirty after marking it\n", progname );
+    return TEST_FAIL;
+  }
+
+  libspectrum_ide_commit_to( chn, LIBSPECTRUM_IDE_MASTER, record_write,
+			     &record );
+  if( record.count != 3 || record.wrong_data ) {
+    fprintf( stderr, "%s: %d sectors committed after marking dirty\n",
+	     progname, record.count );
+    return TEST_FAIL;
+  }
+
+  /* Dropping committed sectors keeps any changed since */
+  command( chn, 0x30, 2001, 1 );
+  for( i = 0; i < 512; i++ )
+    libspectrum_ide_write( chn, LIBSPECTRUM_IDE_REGISTER_DATA,
+			   pattern( 2001, i, 3 ) );
+
+  libspectrum_ide_drop_committed( chn, LIBSPECTRUM_IDE_MASTER );
+
+  if( !libspectrum_ide_dirty( chn, LIBSPECTRUM_IDE_MASTER ) ) {
+    fprintf( stderr, "%s: drive not dirty after dropping committed\n",
+	     progname );
+    return TEST_FAIL;
+  }
+
+  /* The others were never written to the file, so read back as before */
+  r = check_read( chn, 0x20, 2000, 1, 0 ); if( r ) return r;
+  r = check_read( chn, 0x20, 2001, 1, 3 ); if( r ) return r;
+  r = check_read( chn, 0x20, 2002, 1, 0 ); if( r ) return r;
+
+  return TEST_PASS;
+}
+
+/* Committing IDE writes through a function */
+test_return_t
+test_31( void )
+{
+  libspectrum_ide_channel *chn;
+  test_return_t r;
+
+  if( create_hdf( HDF_FILENAME ) ) return TEST_INCOMPLETE;
+
+  chn = libspectrum_ide_alloc( LIBSPECTRUM_IDE_DATA16 );
+
+  if( libspectrum_ide_insert( chn, LIBSPECTRUM_IDE_MASTER, HDF_FILENAME ) ) {
+    libspectrum_ide_free( chn );
+    remove( HDF_FILENAME );
+    return TEST_INCOMPLETE;
+  }
+  libspectrum_ide_reset( chn );
+
+  r = ide_commit_to( chn );
+
+  libspectrum_ide_free( chn );
+  remove( HDF_FILENAME );
+
+  return r;
+}